@@ -377,6 +377,114 @@ protected:
     }
 };
 
+class CUnspentSummary
+{
+    friend class xengine::CStream;
+
+public:
+    int64 nTotal;
+    int64 nCount;
+    int64 nUnconfirmed;
+    std::map<uint32, int64> mapLocked;            // lock height -> amount
+    std::map<uint32, int64> mapUnconfirmedLocked; // lock height -> amount
+
+public:
+    CUnspentSummary()
+    {
+        SetNull();
+    }
+    void SetNull()
+    {
+        nTotal = 0;
+        nCount = 0;
+        nUnconfirmed = 0;
+        mapLocked.clear();
+        mapUnconfirmedLocked.clear();
+    }
+    bool IsNull() const
+    {
+        return (nTotal == 0 && nCount == 0 && nUnconfirmed == 0 && mapLocked.empty() && mapUnconfirmedLocked.empty());
+    }
+    void Add(const CUnspentOut& unspent, const bool fUnconfirmed = false)
+    {
+        Change(unspent, fUnconfirmed, 1);
+    }
+    void Remove(const CUnspentOut& unspent, const bool fUnconfirmed = false)
+    {
+        Change(unspent, fUnconfirmed, -1);
+    }
+    void Merge(const CUnspentSummary& summary)
+    {
+        nTotal += summary.nTotal;
+        nCount += summary.nCount;
+        nUnconfirmed += summary.nUnconfirmed;
+        for (const auto& kv : summary.mapLocked)
+        {
+            AddLocked(mapLocked, kv.first, kv.second);
+        }
+        for (const auto& kv : summary.mapUnconfirmedLocked)
+        {
+            AddLocked(mapUnconfirmedLocked, kv.first, kv.second);
+        }
+    }
+    int64 GetLocked(int nBlockHeight) const
+    {
+        return GetLocked(mapLocked, nBlockHeight);
+    }
+    int64 GetUnconfirmedLocked(int nBlockHeight) const
+    {
+        return GetLocked(mapUnconfirmedLocked, nBlockHeight);
+    }
+
+protected:
+    void Change(const CUnspentOut& unspent, const bool fUnconfirmed, const int64 nSign)
+    {
+        uint32 nLockHeight = (unspent.nLockUntil & 0x7FFFFFFF);
+        nTotal += nSign * unspent.nAmount;
+        nCount += nSign;
+        if (nLockHeight > 0)
+        {
+            AddLocked(mapLocked, nLockHeight, nSign * unspent.nAmount);
+        }
+        if (fUnconfirmed)
+        {
+            nUnconfirmed += nSign * unspent.nAmount;
+            if (nLockHeight > 0)
+            {
+                AddLocked(mapUnconfirmedLocked, nLockHeight, nSign * unspent.nAmount);
+            }
+        }
+    }
+    static void AddLocked(std::map<uint32, int64>& mapLockedIn, const uint32 nLockHeight, const int64 nAmount)
+    {
+        auto it = mapLockedIn.insert(std::make_pair(nLockHeight, (int64)0)).first;
+        if ((it->second += nAmount) == 0)
+        {
+            mapLockedIn.erase(it);
+        }
+    }
+    static int64 GetLocked(const std::map<uint32, int64>& mapLockedIn, int nBlockHeight)
+    {
+        // same as CUnspentOut::IsLocked: locked while block height < lock height
+        int64 nLocked = 0;
+        auto it = (nBlockHeight < 0 ? mapLockedIn.begin() : mapLockedIn.upper_bound((uint32)nBlockHeight));
+        for (; it != mapLockedIn.end(); ++it)
+        {
+            nLocked += it->second;
+        }
+        return nLocked;
+    }
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(nTotal, opt);
+        s.Serialize(nCount, opt);
+        s.Serialize(nUnconfirmed, opt);
+        s.Serialize(mapLocked, opt);
+        s.Serialize(mapUnconfirmedLocked, opt);
+    }
+};
+
 class CTxUnspent : public CTxOutPoint
 {
 public:
@@ -268,15 +268,56 @@ static const unsigned int crc24q_table[256] = {
     0xFFDD8538,
 };
 
+// Slicing-by-8 tables, the crc register is kept in the high 24 bits of a 32 bits word.
+// Table k gives the contribution of a byte followed by k zero bytes.
+class CCrc24qSliceTable
+{
+public:
+    CCrc24qSliceTable()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            table[0][i] = (crc24q_table[i] & 0x00ffffff) << 8;
+        }
+        for (int k = 1; k < 8; k++)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                unsigned int prev = table[k - 1][i];
+                table[k][i] = (prev << 8) ^ table[0][prev >> 24];
+            }
+        }
+    }
+
+public:
+    unsigned int table[8][256];
+};
+
+static const CCrc24qSliceTable& GetSliceTable()
+{
+    // Function static, crc24q may be called during static initialization of other units
+    static const CCrc24qSliceTable sliceTable;
+    return sliceTable;
+}
+
 unsigned int crc24q(const unsigned char* data, int size)
 {
+    const unsigned int(&t)[8][256] = GetSliceTable().table;
     unsigned int crc = 0;
-    for (int i = 0; i < size; i++)
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const unsigned char* p = data + i;
+        unsigned int w = crc ^ (((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3]);
+        crc = t[7][w >> 24] ^ t[6][(w >> 16) & 0xFF] ^ t[5][(w >> 8) & 0xFF] ^ t[4][w & 0xFF]
+              ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; i < size; i++)
     {
-        crc = (crc << 8) ^ crc24q_table[data[i] ^ (0xFF & (crc >> 16))];
+        crc = (crc << 8) ^ t[0][(crc >> 24) ^ data[i]];
     }
 
-    crc = (crc & 0x00ffffff);
+    crc = (crc >> 8);
 
     return crc;
 }
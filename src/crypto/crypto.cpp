@@ -116,6 +116,13 @@ uint256 CryptoHash(const uint256& h1, const uint256& h2)
     return hash;
 }
 
+uint64 CryptoShortHash(const void* msg, std::size_t len, const uint256& key)
+{
+    uint64 hash[2] = { 0, 0 };
+    crypto_generichash_blake2b((uint8*)hash, sizeof(hash), (const uint8*)msg, len, key.begin(), 16);
+    return hash[0];
+}
+
 uint256 CryptoPowHash(const void* msg, size_t len)
 {
     return CryptoHash(msg, len);
@@ -97,6 +97,9 @@ uint256 CryptoHash(const void* msg, std::size_t len);
 uint256 CryptoHash(const uint256& h1, const uint256& h2);
 uint256 CryptoPowHash(const void* msg, size_t len);
 
+// Keyed 64 bits hash, the first 16 bytes of key are used
+uint64 CryptoShortHash(const void* msg, std::size_t len, const uint256& key);
+
 // SHA256
 uint256 CryptoSHA256(const void* msg, size_t len);
 
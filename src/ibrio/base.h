@@ -41,7 +41,7 @@ public:
     virtual const uint256& GetGenesisBlockHash() = 0;
     virtual void GetGenesisBlock(CBlock& block) = 0;
     virtual Errno ValidateTransaction(const CTransaction& tx, int nHeight) = 0;
-    virtual Errno ValidateBlock(const CBlock& block) = 0;
+    virtual Errno ValidateBlock(const CBlock& block, const bool fTrustSignature = false) = 0;
     virtual Errno VerifyForkTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight) = 0;
     virtual Errno VerifyForkRedeem(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork,
                                    const uint256& hashPrevBlock, const vector<uint8>& vchSubSig, const int64 nValueIn)
@@ -55,7 +55,7 @@ public:
                                    const CDelegateAgreement& agreement)
         = 0;
     virtual Errno VerifyBlock(const CBlock& block, CBlockIndex* pIndexPrev) = 0;
-    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nBlockHeight, const uint256& fork, const CProfile& profile) = 0;
+    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nBlockHeight, const uint256& fork, const CProfile& profile, const bool fTrustSignature = false) = 0;
     virtual Errno VerifyTransaction(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& fork, const CProfile& profile) = 0;
     virtual Errno VerifyMintHeightTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight, const CProfile& profile) = 0;
     virtual bool GetBlockTrust(const CBlock& block, uint256& nChainTrust, const CBlockIndex* pIndexPrev = nullptr, const CDelegateAgreement& agreement = CDelegateAgreement(), const CBlockIndex* pIndexRef = nullptr, std::size_t nEnrollTrust = 0) = 0;
@@ -121,6 +121,8 @@ public:
     virtual bool GetBlockStatus(const uint256& hashBlock, CBlockStatus& status) = 0;
     virtual bool GetLastBlockOfHeight(const uint256& hashFork, const int nHeight, uint256& hashBlock, int64& nTime) = 0;
     virtual bool GetLastBlockStatus(const uint256& hashFork, CBlockStatus& status) = 0;
+    virtual bool GetReadSnapshot(const uint256& hashFork, CReadSnapshot& snapshot) = 0;
+    virtual bool VerifyReadSnapshot(const CReadSnapshot& snapshot) = 0;
     virtual bool GetLastBlockTime(const uint256& hashFork, int nDepth, std::vector<int64>& vTime) = 0;
     virtual bool GetBlock(const uint256& hashBlock, CBlock& block) = 0;
     virtual bool GetBlockEx(const uint256& hashBlock, CBlockEx& block) = 0;
@@ -136,7 +138,8 @@ public:
     virtual bool FilterTx(const uint256& hashFork, CTxFilter& filter) = 0;
     virtual bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter) = 0;
     virtual bool ListForkContext(std::vector<CForkContext>& vForkCtxt, std::map<uint256, CValidForkId>& mapValidForkId) = 0;
-    virtual Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update) = 0;
+    virtual Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update, const bool fTrustSignature = false, const CBlockVerify* pVerify = nullptr) = 0;
+    virtual Errno VerifyBlockHeader(const CBlock& block, CBlockVerify& verify) = 0;
     virtual Errno AddNewOrigin(const CBlock& block, CBlockChainUpdate& update) = 0;
     virtual bool GetProofOfWorkTarget(const uint256& hashPrev, int nAlgo, int& nBits, int64& nReward) = 0;
     virtual bool GetBlockMintReward(const uint256& hashPrev, int64& nReward) = 0;
@@ -148,6 +151,10 @@ public:
     virtual bool InitDeFiRelation(const uint256& hashFork) = 0;
     virtual bool CheckAddDeFiRelation(const uint256& hashFork, const CDestination& dest, const CDestination& parent) = 0;
     virtual bool GetAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) = 0;
+    virtual bool GetAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut) = 0;
+    virtual bool WalkAddressUnspentByAmount(const uint256& hashFork, const CDestination& dest, const int64 nAmount, const bool fDescending,
+                                            const boost::function<bool(const CTxOutPoint&, const CUnspentOut&)>& fnWalker, uint256& hashLastBlockOut)
+        = 0;
     virtual int64 GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) = 0;
 
     /////////////    CheckPoints    /////////////////////
@@ -208,6 +215,7 @@ public:
     virtual void Clear() = 0;
     virtual std::size_t Count(const uint256& fork) const = 0;
     virtual Errno Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn) = 0;
+    virtual Errno PushBatch(const std::vector<CTransaction>& vTx, uint256& hashFork, std::vector<std::pair<CDestination, int64>>& vTxIn) = 0;
     //virtual void Pop(const uint256& txid) = 0;
     virtual bool Get(const uint256& txid, CTransaction& tx) const = 0;
     virtual bool Get(const uint256& txid, CAssembledTx& tx) const = 0;
@@ -225,7 +233,11 @@ public:
     virtual bool SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChange& change) = 0;
     virtual void AddDestDelegate(const CDestination& destDeleage) = 0;
     virtual bool GetTxpoolAddressUnspent(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) = 0;
+    virtual bool GetTxpoolAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, CUnspentSummary& summary) = 0;
+    virtual bool GetTxpoolAddressUnspentChange(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapChange) = 0;
     virtual int GetDestTxpoolTxCount(const CDestination& dest) = 0;
+    virtual bool GetLastBlock(const uint256& hashFork, uint256& hashLastBlock) = 0;
+    virtual bool WaitLastBlock(const uint256& hashFork, const uint256& hashBlock, const int64 nWaitMillis) = 0;
     const CStorageConfig* StorageConfig()
     {
         return dynamic_cast<const CStorageConfig*>(xengine::IBase::Config());
@@ -325,6 +337,10 @@ public:
     /* Update */
     virtual bool AddMemKey(const uint256& secret, crypto::CPubKey& pubkey) = 0;
     virtual void RemoveMemKey(const crypto::CPubKey& pubkey) = 0;
+    /* Wallet index */
+    virtual bool UpdateWalletIndex(const CBlockChainUpdate& update) = 0;
+    virtual bool GetWalletUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) = 0;
+    virtual int64 GetWalletTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) = 0;
 
     const CBasicConfig* Config()
     {
@@ -342,7 +358,10 @@ public:
     IDispatcher()
       : IBase("dispatcher") {}
     virtual Errno AddNewBlock(const CBlock& block, uint64 nNonce = 0) = 0;
+    virtual Errno AddRecoveryBlock(const CBlock& block, const bool fTrustSignature) = 0;
+    virtual void CompleteRecovery() = 0;
     virtual Errno AddNewTx(const CTransaction& tx, uint64 nNonce = 0) = 0;
+    virtual Errno AddNewTxBatch(const std::vector<CTransaction>& vTx, std::size_t& nAdded) = 0;
     virtual bool AddNewDistribute(const uint256& hashAnchor, const CDestination& dest,
                                   const std::vector<unsigned char>& vchDistribute)
         = 0;
@@ -352,6 +371,7 @@ public:
     virtual void SetConsensus(const CAgreementBlock& agreeBlock) = 0;
     virtual void CheckAllSubForkLastBlock() = 0;
     virtual bool FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) = 0;
+    virtual bool FetchAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary) = 0;
 };
 
 class IService : public xengine::IBase
@@ -428,6 +448,11 @@ public:
                                                                     const CDestination& destSendTo, const uint16 nType, const int64 nAmount, const int64 nTxFee, const int nLockHeight,
                                                                     const std::vector<unsigned char>& vchData, CTransaction& txNew)
         = 0;
+    virtual boost::optional<std::string> CreateTransactionBatch(const uint256& hashFork, const CDestination& destFrom,
+                                                                const std::vector<std::pair<CDestination, int64>>& vSendTo, const int64 nTxFee,
+                                                                const std::vector<uint8>& vchFromData, std::vector<CTransaction>& vTxNew)
+        = 0;
+    virtual Errno SendTransactionBatch(std::vector<CTransaction>& vTx, std::size_t& nSent) = 0;
     virtual bool SignOfflineTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchDestInData, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, bool& fCompleted) = 0;
     virtual Errno SendOfflineSignedTransaction(CTransaction& tx) = 0;
     virtual bool AesEncrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vMessage, std::vector<uint8>& vCiphertext) = 0;
@@ -443,6 +468,11 @@ public:
     virtual Errno SubmitWork(const std::vector<unsigned char>& vchWorkData, const CTemplateMintPtr& templMint,
                              crypto::CKey& keyMint, uint256& hashBlock)
         = 0;
+
+    const CBasicConfig* Config()
+    {
+        return dynamic_cast<const CBasicConfig*>(xengine::IBase::Config());
+    }
 };
 
 class IDataStat : public xengine::IIOModule
@@ -58,6 +58,8 @@ bool CBlockChain::HandleInitialize()
         return false;
     }
 
+    defiReward.SetParallelNum(std::max(Config()->nDeFiThreads, 0));
+
     return true;
 }
 
@@ -370,6 +372,28 @@ bool CBlockChain::GetLastBlockStatus(const uint256& hashFork, CBlockStatus& stat
     return true;
 }
 
+bool CBlockChain::GetReadSnapshot(const uint256& hashFork, CReadSnapshot& snapshot)
+{
+    CBlockIndex* pIndex = nullptr;
+    uint64 nCommitSeq = 0;
+    if (!cntrBlock.RetrieveForkCommitSeq(hashFork, &pIndex, nCommitSeq))
+    {
+        return false;
+    }
+    snapshot.hashFork = hashFork;
+    snapshot.hashBlock = pIndex->GetBlockHash();
+    snapshot.nBlockHeight = pIndex->GetBlockHeight();
+    snapshot.nBlockTime = pIndex->GetBlockTime();
+    snapshot.nCommitSeq = nCommitSeq;
+    return true;
+}
+
+bool CBlockChain::VerifyReadSnapshot(const CReadSnapshot& snapshot)
+{
+    uint64 nCommitSeq = 0;
+    return (cntrBlock.RetrieveForkCommitSeq(snapshot.hashFork, nCommitSeq) && snapshot.IsValid(nCommitSeq));
+}
+
 bool CBlockChain::GetLastBlockTime(const uint256& hashFork, int nDepth, vector<int64>& vTime)
 {
     CBlockIndex* pIndex = nullptr;
@@ -466,7 +490,24 @@ bool CBlockChain::ListForkContext(vector<CForkContext>& vForkCtxt, map<uint256,
     return cntrBlock.ListForkContext(vForkCtxt, mapValidForkId);
 }
 
-Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
+Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update, const bool fTrustSignature, const CBlockVerify* pVerify)
+{
+    // Blocks of different subsidiary forks are connected concurrently. Primary blocks,
+    // which subsidiary blocks refer to, are connected exclusively
+    CBlockIndex* pIndexPrev = nullptr;
+    if (block.IsPrimary() || !cntrBlock.RetrieveIndex(block.hashPrev, &pIndexPrev))
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+        return InnerAddNewBlock(block, update, fTrustSignature, pVerify);
+    }
+
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    std::shared_ptr<boost::mutex> spForkMutex = GetForkMutex(pIndexPrev->GetOriginHash());
+    boost::unique_lock<boost::mutex> lock(*spForkMutex);
+    return InnerAddNewBlock(block, update, fTrustSignature, pVerify);
+}
+
+Errno CBlockChain::InnerAddNewBlock(const CBlock& block, CBlockChainUpdate& update, const bool fTrustSignature, const CBlockVerify* pVerify)
 {
     uint256 hash = block.GetHash();
     Errno err = OK;
@@ -477,11 +518,16 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
         return ERR_ALREADY_HAVE;
     }
 
-    err = pCoreProtocol->ValidateBlock(block);
-    if (err != OK)
+    // Verified by VerifyBlockHeader, the result only depends on the block and its prev block
+    bool fVerified = (pVerify != nullptr && pVerify->IsVerified(hash));
+    if (!fVerified)
     {
-        Log("AddNewBlock Validate Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
-        return err;
+        err = pCoreProtocol->ValidateBlock(block, fTrustSignature);
+        if (err != OK)
+        {
+            Log("AddNewBlock Validate Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
+            return err;
+        }
     }
 
     CBlockIndex* pIndexPrev;
@@ -496,11 +542,21 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
     CDelegateAgreement agreement;
     size_t nEnrollTrust = 0;
     CBlockIndex* pIndexRef = nullptr;
-    err = VerifyBlock(hash, block, pIndexPrev, nReward, agreement, nEnrollTrust, &pIndexRef);
-    if (err != OK)
+    if (fVerified)
     {
-        Log("AddNewBlock Verify Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
-        return err;
+        nReward = pVerify->nReward;
+        agreement = pVerify->agreement;
+        nEnrollTrust = pVerify->nEnrollTrust;
+        pIndexRef = pVerify->pIndexRef;
+    }
+    else
+    {
+        err = VerifyBlock(hash, block, pIndexPrev, nReward, agreement, nEnrollTrust, &pIndexRef);
+        if (err != OK)
+        {
+            Log("AddNewBlock Verify Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
+            return err;
+        }
     }
 
     bool fGetBranchBlock = true;
@@ -639,7 +695,7 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
 
             if (tx.nType != CTransaction::TX_DEFI_REWARD)
             {
-                err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, block.GetBlockHeight(), forkid, profile);
+                err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, block.GetBlockHeight(), forkid, profile, fTrustSignature);
                 if (err != OK)
                 {
                     Log("AddNewBlock Verify BlockTx Error(%s) : %s ", ErrorString(err), txid.ToString().c_str());
@@ -795,8 +851,58 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
     return OK;
 }
 
+std::shared_ptr<boost::mutex> CBlockChain::GetForkMutex(const uint256& hashFork)
+{
+    boost::unique_lock<boost::mutex> lock(mtxForkMutex);
+    std::shared_ptr<boost::mutex>& spForkMutex = mapForkMutex[hashFork];
+    if (!spForkMutex)
+    {
+        spForkMutex = std::make_shared<boost::mutex>();
+    }
+    return spForkMutex;
+}
+
+Errno CBlockChain::VerifyBlockHeader(const CBlock& block, CBlockVerify& verify)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+
+    uint256 hash = block.GetHash();
+    Errno err = OK;
+
+    verify.SetNull();
+    if (cntrBlock.Exists(hash))
+    {
+        return ERR_ALREADY_HAVE;
+    }
+
+    err = pCoreProtocol->ValidateBlock(block);
+    if (err != OK)
+    {
+        Log("VerifyBlockHeader Validate Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
+        return err;
+    }
+
+    CBlockIndex* pIndexPrev;
+    if (!cntrBlock.RetrieveIndex(block.hashPrev, &pIndexPrev))
+    {
+        Log("VerifyBlockHeader Retrieve Prev Index Error: %s ", block.hashPrev.ToString().c_str());
+        return ERR_SYS_STORAGE_ERROR;
+    }
+
+    err = VerifyBlock(hash, block, pIndexPrev, verify.nReward, verify.agreement, verify.nEnrollTrust, &verify.pIndexRef);
+    if (err != OK)
+    {
+        Log("VerifyBlockHeader Verify Block Error(%s) : %s ", ErrorString(err), hash.ToString().c_str());
+        return err;
+    }
+    verify.hashBlock = hash;
+    return OK;
+}
+
 Errno CBlockChain::AddNewOrigin(const CBlock& block, CBlockChainUpdate& update)
 {
+    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+
     uint256 hash = block.GetHash();
     Errno err = OK;
 
@@ -2295,19 +2401,21 @@ list<CDeFiReward> CBlockChain::GetDeFiReward(const uint256& forkid, const uint25
 
     for (const uint256& section : listSection)
     {
-        bool fIsNull;
-        CDeFiRewardSet& s = defiReward.GetForkSection(forkid, section, fIsNull);
+        std::shared_ptr<const CDeFiRewardSet> spSection = defiReward.GetForkSection(forkid, section);
 
         // generate section reward
-        if (fIsNull)
+        if (!spSection)
         {
             CProfile profile = defiReward.GetForkProfile(forkid);
             CDeFiRewardSet st = ComputeDeFiSection(forkid, section, profile);
-            defiReward.AddForkSection(forkid, section, std::move(st));
-            s = defiReward.GetForkSection(forkid, section, fIsNull);
+            spSection = defiReward.AddForkSection(forkid, section, std::move(st));
+            if (!spSection)
+            {
+                continue;
+            }
         }
 
-        const CDeFiRewardSetByReward& idxByReward = s.get<1>();
+        const CDeFiRewardSetByReward& idxByReward = spSection->get<1>();
         CDeFiRewardSetByReward::iterator it = idxByReward.begin();
         if (section == nLastSection)
         {
@@ -2496,7 +2604,7 @@ CDeFiRewardSet CBlockChain::ComputeDeFiSection(const uint256& forkid, const uint
     CDeFiRewardSet stakeReward = defiReward.ComputeStakeReward(profile.defi.nStakeMinToken, nStakeReward, mapAddressAmount);
 
     // get invitation relation
-    CDeFiRelationGraph relation;
+    CDeFiRelationFlatGraph relation;
     if (!cntrBlock.ListDeFiRelation(forkid, view, relation, [](const CTransaction& tx, const CDestination& parentIn)
                                     { return CDeFiRelationRewardNode(parentIn); }))
     {
@@ -2576,6 +2684,20 @@ bool CBlockChain::GetAddressUnspent(const uint256& hashFork, const CDestination&
     return cntrBlock.RetrieveAddressUnspent(hashFork, dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CBlockChain::GetAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut)
+{
+    return cntrBlock.RetrieveAddressUnspentSummary(hashFork, dest, summary, hashLastBlockOut);
+}
+
+bool CBlockChain::WalkAddressUnspentByAmount(const uint256& hashFork, const CDestination& dest, const int64 nAmount, const bool fDescending,
+                                             const boost::function<bool(const CTxOutPoint&, const CUnspentOut&)>& fnWalker, uint256& hashLastBlockOut)
+{
+    storage::CFnAddressUnspentWalker walker([&](const storage::CAddrUnspentKey& out, const CUnspentOut& unspent) {
+        return fnWalker(out.out, unspent);
+    });
+    return cntrBlock.WalkThroughAddressUnspentByAmount(hashFork, walker, dest, nAmount, fDescending, hashLastBlockOut);
+}
+
 int64 CBlockChain::GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
 {
     return cntrBlock.RetrieveAddressTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx);
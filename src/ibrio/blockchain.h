@@ -35,6 +35,8 @@ public:
     bool GetBlockStatus(const uint256& hashBlock, CBlockStatus& status) override;
     bool GetLastBlockOfHeight(const uint256& hashFork, const int nHeight, uint256& hashBlock, int64& nTime) override;
     bool GetLastBlockStatus(const uint256& hashFork, CBlockStatus& status) override;
+    bool GetReadSnapshot(const uint256& hashFork, CReadSnapshot& snapshot) override;
+    bool VerifyReadSnapshot(const CReadSnapshot& snapshot) override;
     bool GetLastBlockTime(const uint256& hashFork, int nDepth, std::vector<int64>& vTime) override;
     bool GetBlock(const uint256& hashBlock, CBlock& block) override;
     bool GetBlockEx(const uint256& hashBlock, CBlockEx& block) override;
@@ -49,7 +51,8 @@ public:
     bool FilterTx(const uint256& hashFork, CTxFilter& filter) override;
     bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter) override;
     bool ListForkContext(std::vector<CForkContext>& vForkCtxt, std::map<uint256, CValidForkId>& mapValidForkId) override;
-    Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update) override;
+    Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update, const bool fTrustSignature = false, const CBlockVerify* pVerify = nullptr) override;
+    Errno VerifyBlockHeader(const CBlock& block, CBlockVerify& verify) override;
     Errno AddNewOrigin(const CBlock& block, CBlockChainUpdate& update) override;
     bool GetProofOfWorkTarget(const uint256& hashPrev, int nAlgo, int& nBits, int64& nReward) override;
     bool GetBlockMintReward(const uint256& hashPrev, int64& nReward) override;
@@ -79,6 +82,9 @@ public:
     bool InitDeFiRelation(const uint256& hashFork) override;
     bool CheckAddDeFiRelation(const uint256& hashFork, const CDestination& dest, const CDestination& parent) override;
     bool GetAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) override;
+    bool GetAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut) override;
+    bool WalkAddressUnspentByAmount(const uint256& hashFork, const CDestination& dest, const int64 nAmount, const bool fDescending,
+                                    const boost::function<bool(const CTxOutPoint&, const CUnspentOut&)>& fnWalker, uint256& hashLastBlockOut) override;
     int64 GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) override;
 
     /////////////    CheckPoints    /////////////////////
@@ -119,6 +125,8 @@ protected:
                          std::vector<CBlockEx>& vBlockAddNew, std::vector<CBlockEx>& vBlockRemove);
     bool GetBlockDelegateAgreement(const uint256& hashBlock, const CBlock& block, const CBlockIndex* pIndexPrev,
                                    CDelegateAgreement& agreement, std::size_t& nEnrollTrust);
+    Errno InnerAddNewBlock(const CBlock& block, CBlockChainUpdate& update, const bool fTrustSignature, const CBlockVerify* pVerify);
+    std::shared_ptr<boost::mutex> GetForkMutex(const uint256& hashFork);
     Errno VerifyBlock(const uint256& hashBlock, const CBlock& block, CBlockIndex* pIndexPrev,
                       int64& nReward, CDelegateAgreement& agreement, std::size_t& nEnrollTrust, CBlockIndex** ppIndexRef);
     bool VerifyBlockCertTx(const CBlock& block);
@@ -136,6 +144,8 @@ protected:
 
 protected:
     boost::shared_mutex rwAccess;
+    boost::mutex mtxForkMutex;
+    std::map<uint256, std::shared_ptr<boost::mutex>> mapForkMutex;
     ICoreProtocol* pCoreProtocol;
     ITxPool* pTxPool;
     IForkManager* pForkManager;
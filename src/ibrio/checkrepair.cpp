@@ -4,6 +4,10 @@
 
 #include "checkrepair.h"
 
+#include <atomic>
+#include <boost/thread/thread.hpp>
+
+#include "parallel.h"
 #include "param.h"
 #include "template/activate.h"
 #include "template/vote.h"
@@ -14,10 +18,59 @@ using namespace xengine;
 using namespace boost::filesystem;
 
 #define BLOCKFILE_PREFIX "block"
+#define CHECK_REPAIR_POINT_FILE "checkrepair.dat"
 
 namespace ibrio
 {
 
+// fnLoad runs on each fork one by one before the checks, it opens the fork db under the db write lock,
+// so that fnCheck only takes the shared lock and the forks are really checked at the same time
+static bool ParallelCheckFork(map<uint256, CCheckBlockFork>& mapCheckFork, const uint32 nThreads, const string& strPhase,
+                              std::function<bool(const uint256&)> fnLoad, std::function<bool(const uint256&, CCheckBlockFork&)> fnCheck)
+{
+    vector<map<uint256, CCheckBlockFork>::iterator> vFork;
+    vFork.reserve(mapCheckFork.size());
+    for (auto it = mapCheckFork.begin(); it != mapCheckFork.end(); ++it)
+    {
+        if (fnLoad && !fnLoad(it->first))
+        {
+            return false;
+        }
+        vFork.push_back(it);
+    }
+
+    if (nThreads <= 1 || vFork.size() <= 1)
+    {
+        for (size_t i = 0; i < vFork.size(); i++)
+        {
+            if (!fnCheck(vFork[i]->first, vFork[i]->second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<bool> fRet(true);
+    std::atomic<size_t> nCompleted(0);
+    ParallelComputer computer(std::min(nThreads, (uint32)UINT8_MAX));
+    if (!computer.Execute(vFork.size(),
+                          [&](const uint32 nIndex) { return vFork[nIndex]; },
+                          [&](map<uint256, CCheckBlockFork>::iterator it) {
+                              if (fRet && !fnCheck(it->first, it->second))
+                              {
+                                  fRet = false;
+                                  return;
+                              }
+                              StdLog("check", "%s: fork complete, %lu/%lu, fork: %s", strPhase.c_str(),
+                                     (size_t)++nCompleted, vFork.size(), it->first.GetHex().c_str());
+                          }))
+    {
+        return false;
+    }
+    return fRet;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckForkUnspentWalker
 
@@ -842,6 +895,10 @@ bool CCheckTxPoolData::CheckTxPool(const string& strPath, const bool fOnlyCheck)
                     fCheckRet = false;
                     break;
                 }
+                if (mt->second.fSkipData)
+                {
+                    continue;
+                }
                 it = mapForkTxPool.insert(make_pair(hashFork, CCheckForkTxPool(mt->second.mapBlockUnspent))).first;
             }
             if (!it->second.AddTx(vTx[i].second.first, vTx[i].second.second))
@@ -869,6 +926,185 @@ bool CCheckTxPoolData::CheckTxPool(const string& strPath, const bool fOnlyCheck)
     return true;
 }
 
+/////////////////////////////////////////////////////////////////////////
+// CCheckRepairPoint
+
+bool CCheckRepairPoint::Initialize(const string& strDataPath)
+{
+    pathPointFile = path(strDataPath) / CHECK_REPAIR_POINT_FILE;
+    if (exists(pathPointFile) && !is_regular_file(pathPointFile))
+    {
+        return false;
+    }
+    return true;
+}
+
+void CCheckRepairPoint::Prepare(const uint64 nBlockDataSizeIn, const uint32 nAllPhaseIn, map<uint256, int32>& mapSkipFork)
+{
+    boost::unique_lock<boost::mutex> lock(mtxPoint);
+    mapSkipFork.clear();
+    setSkipFork.clear();
+    mapForkPhase.clear();
+
+    if (pathPointFile.empty() || !is_regular_file(pathPointFile))
+    {
+        return;
+    }
+    try
+    {
+        CFileStream fs(pathPointFile.string().c_str());
+        fs >> nBlockDataSize >> nAllPhase >> mapForkLast >> mapForkParent >> mapForkMintHeight >> nBlockCount >> mapForkPhase;
+    }
+    catch (std::exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        mapForkPhase.clear();
+        return;
+    }
+    if (nBlockDataSize != nBlockDataSizeIn || nAllPhase != nAllPhaseIn)
+    {
+        StdLog("check", "Repair point: Block data changed, discard repair point");
+        mapForkPhase.clear();
+        return;
+    }
+
+    // a fork inheriting from its parent needs the parent data, so a fork not completed keeps all its ancestors
+    set<uint256> setKeepFork;
+    for (const auto& kv : mapForkLast)
+    {
+        auto it = mapForkPhase.find(kv.first);
+        if (it != mapForkPhase.end() && (it->second & nAllPhase) == nAllPhase)
+        {
+            continue;
+        }
+        uint256 hashFork = kv.first;
+        while (hashFork != 0 && setKeepFork.insert(hashFork).second)
+        {
+            auto mt = mapForkParent.find(hashFork);
+            hashFork = (mt != mapForkParent.end() ? mt->second : uint256());
+        }
+    }
+    for (const auto& kv : mapForkLast)
+    {
+        if (setKeepFork.count(kv.first) == 0)
+        {
+            auto it = mapForkMintHeight.find(kv.first);
+            mapSkipFork.insert(make_pair(kv.first, (it != mapForkMintHeight.end() ? it->second : -2)));
+            setSkipFork.insert(kv.first);
+        }
+    }
+    StdLog("check", "Repair point: Resume from repair point, skip fork count: %lu", setSkipFork.size());
+}
+
+bool CCheckRepairPoint::Load(const map<uint256, CCheckBlockFork>& mapCheckFork, const int64 nBlockCountIn, const uint64 nBlockDataSizeIn)
+{
+    boost::unique_lock<boost::mutex> lock(mtxPoint);
+    map<uint256, uint256> mapNewForkLast;
+    map<uint256, uint256> mapNewForkParent;
+    map<uint256, int32> mapNewForkMintHeight;
+    for (const auto& kv : mapCheckFork)
+    {
+        const CCheckBlockFork& checkFork = kv.second;
+        if (checkFork.pLast != nullptr)
+        {
+            mapNewForkLast.insert(make_pair(kv.first, checkFork.pLast->GetBlockHash()));
+        }
+        if (checkFork.pOrigin != nullptr && checkFork.pOrigin->pPrev != nullptr)
+        {
+            mapNewForkParent.insert(make_pair(kv.first, checkFork.pOrigin->pPrev->GetOriginHash()));
+        }
+        mapNewForkMintHeight.insert(make_pair(kv.first, checkFork.nMintHeight));
+    }
+
+    bool fRet = true;
+    if (mapNewForkLast != mapForkLast || nBlockCountIn != nBlockCount)
+    {
+        if (!mapForkPhase.empty())
+        {
+            StdLog("check", "Repair point: Block data changed, discard repair point");
+        }
+        mapForkPhase.clear();
+        if (!setSkipFork.empty())
+        {
+            StdError("check", "Repair point: Skipped forks do not match the block data, check again");
+            fRet = false;
+        }
+    }
+    setSkipFork.clear();
+
+    fEnable = (fRet && !pathPointFile.empty());
+    nBlockDataSize = nBlockDataSizeIn;
+    mapForkLast.swap(mapNewForkLast);
+    mapForkParent.swap(mapNewForkParent);
+    mapForkMintHeight.swap(mapNewForkMintHeight);
+    nBlockCount = nBlockCountIn;
+    if (!fRet && is_regular_file(pathPointFile))
+    {
+        remove(pathPointFile);
+    }
+    return fRet;
+}
+
+bool CCheckRepairPoint::IsCompleted(const uint256& hashFork, const uint32 nPhase)
+{
+    boost::unique_lock<boost::mutex> lock(mtxPoint);
+    auto it = mapForkPhase.find(hashFork);
+    return (it != mapForkPhase.end() && (it->second & nPhase) != 0);
+}
+
+void CCheckRepairPoint::SetCompleted(const uint256& hashFork, const uint32 nPhase)
+{
+    boost::unique_lock<boost::mutex> lock(mtxPoint);
+    if (!fEnable)
+    {
+        return;
+    }
+    mapForkPhase[hashFork] |= nPhase;
+    if (!Save())
+    {
+        StdError("check", "Repair point: Save fail, fork: %s", hashFork.GetHex().c_str());
+    }
+}
+
+void CCheckRepairPoint::Remove()
+{
+    boost::unique_lock<boost::mutex> lock(mtxPoint);
+    fEnable = false;
+    mapForkPhase.clear();
+    if (is_regular_file(pathPointFile))
+    {
+        remove(pathPointFile);
+    }
+}
+
+bool CCheckRepairPoint::Save()
+{
+    path pathTemp = pathPointFile;
+    pathTemp += ".tmp";
+
+    FILE* fp = fopen(pathTemp.string().c_str(), "w");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    fclose(fp);
+
+    try
+    {
+        {
+            CFileStream fs(pathTemp.string().c_str());
+            fs << nBlockDataSize << nAllPhase << mapForkLast << mapForkParent << mapForkMintHeight << nBlockCount << mapForkPhase;
+        }
+        rename(pathTemp, pathPointFile);
+    }
+    catch (std::exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckBlockFork
 
@@ -966,6 +1202,10 @@ CBlockIndex* CCheckBlockFork::GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIn
 
 bool CCheckBlockFork::AddBlockData(const CBlockEx& block, const CBlockIndex* pBlockIndex)
 {
+    if (fSkipData)
+    {
+        return true;
+    }
     if (!block.IsNull() && (!block.IsVacant() || !block.txMint.sendTo.IsNull()))
     {
         const uint256& hashFork = pBlockIndex->GetOriginHash();
@@ -1053,6 +1293,10 @@ bool CCheckBlockFork::AddBlockData(const CBlockEx& block, const CBlockIndex* pBl
 
 bool CCheckBlockFork::RemoveBlockData(const CBlockEx& block, const CBlockIndex* pBlockIndex)
 {
+    if (fSkipData)
+    {
+        return true;
+    }
     if (!block.IsNull() && (!block.IsVacant() || !block.txMint.sendTo.IsNull()))
     {
         for (int64 i = block.vtx.size() - 1; i >= 0; i--)
@@ -1242,6 +1486,10 @@ bool CCheckBlockFork::AddBlockSpent(const CTxOutPoint& txPoint)
 
 bool CCheckBlockFork::InheritCopyData(const CCheckBlockFork& fromParent, const CBlockIndex* pJointBlockIndex)
 {
+    if (fSkipData)
+    {
+        return true;
+    }
     mapBlockUnspent.clear();
     mapBlockUnspent.insert(fromParent.mapBlockUnspent.begin(), fromParent.mapBlockUnspent.end());
 
@@ -1286,7 +1534,12 @@ bool CCheckBlockFork::InheritCopyData(const CCheckBlockFork& fromParent, const C
 
 bool CCheckBlockFork::CheckForkAddressTxIndex(const uint256& hashFork, const int nCheckHeight)
 {
-    if (!dbAddressTxIndex.LoadFork(hashFork))
+    if (fReindexAddress)
+    {
+        return ReindexForkAddressTxIndex(hashFork, nCheckHeight);
+    }
+
+    if (!dbAddressTxIndex.ExistFork(hashFork) && !dbAddressTxIndex.LoadFork(hashFork))
     {
         StdLog("check", "Check fork address tx index: dbAddressTxIndex LoadFork fail");
         return false;
@@ -1383,6 +1636,55 @@ bool CCheckBlockFork::CheckForkAddressTxIndex(const uint256& hashFork, const int
     return true;
 }
 
+bool CCheckBlockFork::ReindexForkAddressTxIndex(const uint256& hashFork, const int nCheckHeight)
+{
+    if (!dbAddressTxIndex.ExistFork(hashFork) && !dbAddressTxIndex.LoadFork(hashFork))
+    {
+        StdLog("check", "Reindex fork address tx index: dbAddressTxIndex LoadFork fail");
+        return false;
+    }
+
+    // the confirmed tx info becomes one sorted run, no db read is needed as the index is rebuilt from empty
+    vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
+    vAddNew.reserve(mapBlockTxInfo.size() * 2);
+    for (auto nt = mapBlockTxInfo.begin(); nt != mapBlockTxInfo.end();)
+    {
+        const uint256& txid = nt->first;
+        const CCheckTxInfo& checkTxInfo = nt->second;
+        if (checkTxInfo.nBlockHeight > nCheckHeight)
+        {
+            ++nt;
+            continue;
+        }
+
+        if (!checkTxInfo.destFrom.IsNull())
+        {
+            int nDirection = (checkTxInfo.destFrom == checkTxInfo.destTo ? CAddrTxInfo::TXI_DIRECTION_TWO : CAddrTxInfo::TXI_DIRECTION_FROM);
+            vAddNew.push_back(make_pair(CAddrTxIndex(checkTxInfo.destFrom, checkTxInfo.nBlockHeight, checkTxInfo.nBlockSeqNo, checkTxInfo.nTxSeqNo, txid),
+                                        CAddrTxInfo(nDirection, checkTxInfo.destTo, checkTxInfo.nTxType, checkTxInfo.nTimeStamp,
+                                                    checkTxInfo.nLockUntil, checkTxInfo.nAmount, checkTxInfo.nTxFee)));
+        }
+        if (!checkTxInfo.destTo.IsNull() && checkTxInfo.destFrom != checkTxInfo.destTo)
+        {
+            vAddNew.push_back(make_pair(CAddrTxIndex(checkTxInfo.destTo, checkTxInfo.nBlockHeight, checkTxInfo.nBlockSeqNo, checkTxInfo.nTxSeqNo, txid),
+                                        CAddrTxInfo(CAddrTxInfo::TXI_DIRECTION_TO, checkTxInfo.destFrom, checkTxInfo.nTxType, checkTxInfo.nTimeStamp,
+                                                    checkTxInfo.nLockUntil, checkTxInfo.nAmount, checkTxInfo.nTxFee)));
+        }
+        mapBlockTxInfo.erase(nt++);
+    }
+
+    sort(vAddNew.begin(), vAddNew.end(),
+         [](const pair<CAddrTxIndex, CAddrTxInfo>& a, const pair<CAddrTxIndex, CAddrTxInfo>& b) { return a.first < b.first; });
+    if (!dbAddressTxIndex.BulkLoadAddressTxIndex(hashFork, vAddNew))
+    {
+        StdLog("check", "Reindex fork address tx index: Bulk load fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+
+    nCacheTxInfoBlockCount = 0;
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckBlockWalker
 
@@ -1414,7 +1716,7 @@ bool CCheckBlockWalker::Initialize(const string& strPath)
 
     if (fCheckAddrTxIndex)
     {
-        if (!dbAddressTxIndex.Initialize(path(strPath), false))
+        if (!dbAddressTxIndex.Initialize(path(fReindexAddress ? strReindexPath : strPath), false))
         {
             StdLog("check", "dbAddressTxIndex Initialize fail");
             return false;
@@ -1510,7 +1812,13 @@ bool CCheckBlockWalker::Walk(const CBlockEx& block, uint32 nFile, uint32 nOffset
     auto nt = mapCheckFork.find(hashFork);
     if (nt == mapCheckFork.end())
     {
-        nt = mapCheckFork.insert(make_pair(hashFork, CCheckBlockFork(strDataPath, fOnlyCheck, fCheckAddrTxIndex, objTsBlock, objForkManager, dbAddressTxIndex))).first;
+        nt = mapCheckFork.insert(make_pair(hashFork, CCheckBlockFork(strDataPath, fOnlyCheck, fCheckAddrTxIndex, fReindexAddress, objTsBlock, objForkManager, dbAddressTxIndex))).first;
+        auto mt = mapSkipFork.find(hashFork);
+        if (mt != mapSkipFork.end())
+        {
+            nt->second.fSkipData = true;
+            nt->second.nMintHeight = mt->second;
+        }
         if (block.IsOrigin() && !block.IsGenesis())
         {
             if (!InheritForkData(block, nt->second))
@@ -2293,38 +2601,65 @@ bool CCheckBlockWalker::CheckRefBlock()
     return true;
 }
 
-bool CCheckBlockWalker::CheckSurplusAddressTxIndex(uint64& nTxIndexCount)
+bool CCheckBlockWalker::CheckSurplusAddressTxIndex(uint64& nTxIndexCount, const uint32 nThreads, CCheckRepairPoint& objRepairPoint)
 {
-    map<uint256, CCheckBlockFork>::iterator mt = mapCheckFork.begin();
-    for (; mt != mapCheckFork.end(); ++mt)
-    {
-        nTxIndexCount += mt->second.mapBlockTxInfo.size();
-        if (!mt->second.CheckForkAddressTxIndex(mt->first, 0x7FFFFFFF))
+    std::atomic<uint64> nCount(0);
+    auto fnCheck = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        nCount += checkFork.mapBlockTxInfo.size();
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_TXINDEX))
+        {
+            checkFork.mapBlockTxInfo.clear();
+            return true;
+        }
+
+        if (!checkFork.CheckForkAddressTxIndex(hashFork, 0x7FFFFFFF))
         {
-            StdLog("check", "Check address tx index: Check fork address txindex fail, fork: %s", mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Check fork address txindex fail, fork: %s", hashFork.GetHex().c_str());
             return false;
         }
+        if (fReindexAddress)
+        {
+            return true;
+        }
 
-        CCheckAddressTxIndexWalker walker(mt->second.mapBlockTxIndex);
-        if (!dbAddressTxIndex.WalkThrough(mt->first, walker))
+        CCheckAddressTxIndexWalker walker(checkFork.mapBlockTxIndex);
+        if (!dbAddressTxIndex.WalkThrough(hashFork, walker))
         {
-            StdLog("check", "Check address tx index: Walk through address txindex fail, fork: %s", mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Walk through address txindex fail, fork: %s", hashFork.GetHex().c_str());
             return false;
         }
         if (!walker.vRemove.empty())
         {
-            StdLog("check", "Check address tx index: Remove address txindex count: %lu, fork: %s", walker.vRemove.size(), mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Remove address txindex count: %lu, fork: %s", walker.vRemove.size(), hashFork.GetHex().c_str());
             if (!fOnlyCheck)
             {
-                if (!dbAddressTxIndex.RepairAddressTxIndex(mt->first, vector<pair<CAddrTxIndex, CAddrTxInfo>>(), walker.vRemove))
+                if (!dbAddressTxIndex.RepairAddressTxIndex(hashFork, vector<pair<CAddrTxIndex, CAddrTxInfo>>(), walker.vRemove))
                 {
-                    StdLog("check", "Check address tx index: RepairAddressTxIndex fail, fork: %s", mt->first.GetHex().c_str());
+                    StdLog("check", "Check address tx index: RepairAddressTxIndex fail, fork: %s", hashFork.GetHex().c_str());
                     return false;
                 }
             }
         }
-    }
-    return true;
+        objRepairPoint.SetCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_TXINDEX);
+        return true;
+    };
+
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_TXINDEX))
+        {
+            return true;
+        }
+        if (!dbAddressTxIndex.LoadFork(hashFork))
+        {
+            StdLog("check", "Check address tx index: dbAddressTxIndex LoadFork fail, fork: %s", hashFork.GetHex().c_str());
+            return false;
+        }
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(mapCheckFork, nThreads, "Check address tx index", fnLoad, fnCheck);
+    nTxIndexCount += nCount;
+    return fRet;
 }
 
 bool CCheckBlockWalker::UpdateInvest(const uint256& hashBlock, const CBlockEx& block)
@@ -2579,6 +2914,7 @@ bool CCheckBlockWalker::UpdateActivate(const uint256& hashBlock, const CBlockEx&
 
 bool CCheckRepairData::FetchBlockData()
 {
+    uint64 nBlockDataSize = 0;
     {
         CTimeSeriesCached tsBlock;
         if (!tsBlock.Initialize(path(strDataPath) / "block", BLOCKFILE_PREFIX))
@@ -2594,17 +2930,30 @@ bool CCheckRepairData::FetchBlockData()
             return false;
         }
 
+        if (!fOnlyCheck)
+        {
+            uint32 nAllPhase = CCheckRepairPoint::CHECK_PHASE_UNSPENT | CCheckRepairPoint::CHECK_PHASE_ADDRESS_UNSPENT
+                               | CCheckRepairPoint::CHECK_PHASE_ADDRESS | CCheckRepairPoint::CHECK_PHASE_TXINDEX;
+            if (objBlockWalker.fCheckAddrTxIndex)
+            {
+                nAllPhase |= CCheckRepairPoint::CHECK_PHASE_ADDRESS_TXINDEX;
+            }
+            objRepairPoint.Prepare(tsBlock.GetSize(), nAllPhase, objBlockWalker.mapSkipFork);
+        }
+
         uint32 nLastFileRet = 0;
         uint32 nLastPosRet = 0;
 
-        StdLog("check", "Fetch block starting");
-        if (!tsBlock.WalkThrough(objBlockWalker, nLastFileRet, nLastPosRet, !fOnlyCheck))
+        StdLog("check", "Fetch block starting, check threads: %u", nCheckThreads);
+        bool fWalkRet = tsBlock.ParallelWalkThrough(objBlockWalker, nLastFileRet, nLastPosRet, !fOnlyCheck, nCheckThreads);
+        if (!fWalkRet)
         {
             StdError("check", "Fetch block fail.");
             tsBlock.Deinitialize();
             return false;
         }
         StdLog("check", "Fetch block success, count: %ld.", objBlockWalker.nBlockCount);
+        nBlockDataSize = tsBlock.GetSize();
         tsBlock.Deinitialize();
     }
     objBlockWalker.objDelegateDB.Deinitialize();
@@ -2644,11 +2993,17 @@ bool CCheckRepairData::FetchBlockData()
         }
         StdLog("check", "Check repair fork success.");
 
+        if (!fOnlyCheck && !objRepairPoint.Load(objBlockWalker.mapCheckFork, objBlockWalker.nBlockCount, nBlockDataSize))
+        {
+            StdError("check", "Fetch block and tx, load repair point fail");
+            return false;
+        }
+
         if (objBlockWalker.fCheckAddrTxIndex)
         {
             StdLog("check", "Check surplus address txindex starting");
             uint64 nTxIndexCount = 0;
-            if (!objBlockWalker.CheckSurplusAddressTxIndex(nTxIndexCount))
+            if (!objBlockWalker.CheckSurplusAddressTxIndex(nTxIndexCount, nCheckThreads, objRepairPoint))
             {
                 StdError("check", "Check surplus address txindex fail");
                 return false;
@@ -2677,21 +3032,18 @@ bool CCheckRepairData::CheckRepairUnspent(uint64& nUnspentCount)
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
-    {
-        const uint256& hashFork = it->first;
-        if (!dbUnspent.LoadFork(hashFork))
+    std::atomic<uint64> nCount(0);
+    auto fnCheck = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        nCount += checkFork.mapBlockUnspent.size();
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_UNSPENT))
         {
-            StdError("check", "Check repair unspent: dbUnspent AddNewFork fail.");
-            dbUnspent.Deinitialize();
-            return false;
+            return true;
         }
-        CCheckForkUnspentWalker forkUnspentWalker(it->second.mapBlockUnspent);
+
+        CCheckForkUnspentWalker forkUnspentWalker(checkFork.mapBlockUnspent);
         if (!dbUnspent.WalkThrough(hashFork, forkUnspentWalker))
         {
             StdError("check", "Check repair unspent: dbUnspent WalkThrough fail.");
-            dbUnspent.Deinitialize();
             return false;
         }
         if (!forkUnspentWalker.CheckForkUnspent())
@@ -2705,16 +3057,32 @@ bool CCheckRepairData::CheckRepairUnspent(uint64& nUnspentCount)
                 if (!dbUnspent.RepairUnspent(hashFork, forkUnspentWalker.vAddUpdate, forkUnspentWalker.vRemove))
                 {
                     StdError("check", "Check repair unspent: Repair unspent fail.");
-                    dbUnspent.Deinitialize();
                     return false;
                 }
             }
         }
-        nUnspentCount += it->second.mapBlockUnspent.size();
-    }
+        objRepairPoint.SetCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_UNSPENT);
+        return true;
+    };
+
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_UNSPENT))
+        {
+            return true;
+        }
+        if (!dbUnspent.LoadFork(hashFork))
+        {
+            StdError("check", "Check repair unspent: dbUnspent AddNewFork fail.");
+            return false;
+        }
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(objBlockWalker.mapCheckFork, nCheckThreads, "Check repair unspent", fnLoad, fnCheck);
+    nUnspentCount += nCount;
 
     dbUnspent.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckRepairAddressUnspent()
@@ -2726,21 +3094,17 @@ bool CCheckRepairData::CheckRepairAddressUnspent()
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
-    {
-        const uint256& hashFork = it->first;
-        if (!dbAddressUnspent.LoadFork(hashFork))
+    auto fnCheck = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_UNSPENT))
         {
-            StdError("check", "Check address unspent: dbAddress AddNewFork fail.");
-            dbAddressUnspent.Deinitialize();
-            return false;
+            checkFork.mapBlockUnspent.clear();
+            return true;
         }
-        CCheckAddressUnspentWalker addressUnspentWalker(it->second.mapBlockUnspent);
+
+        CCheckAddressUnspentWalker addressUnspentWalker(checkFork.mapBlockUnspent);
         if (!dbAddressUnspent.WalkThrough(hashFork, addressUnspentWalker))
         {
             StdError("check", "Check address unspent: dbAddress WalkThrough fail.");
-            dbAddressUnspent.Deinitialize();
             return false;
         }
         if (!addressUnspentWalker.CheckForkAddressUnspent())
@@ -2754,16 +3118,32 @@ bool CCheckRepairData::CheckRepairAddressUnspent()
                 if (!dbAddressUnspent.RepairAddressUnspent(hashFork, addressUnspentWalker.vAddUpdate, addressUnspentWalker.vRemove))
                 {
                     StdError("check", "Check address unspent: Repair address unspent fail.");
-                    dbAddressUnspent.Deinitialize();
                     return false;
                 }
             }
         }
-        it->second.mapBlockUnspent.clear();
-    }
+        checkFork.mapBlockUnspent.clear();
+        objRepairPoint.SetCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_UNSPENT);
+        return true;
+    };
+
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS_UNSPENT))
+        {
+            return true;
+        }
+        if (!dbAddressUnspent.LoadFork(hashFork))
+        {
+            StdError("check", "Check address unspent: dbAddress AddNewFork fail.");
+            return false;
+        }
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(objBlockWalker.mapCheckFork, nCheckThreads, "Check address unspent", fnLoad, fnCheck);
 
     dbAddressUnspent.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckRepairAddress(uint64& nAddressCount)
@@ -2775,21 +3155,19 @@ bool CCheckRepairData::CheckRepairAddress(uint64& nAddressCount)
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
-    {
-        const uint256& hashFork = it->first;
-        if (!dbAddress.LoadFork(hashFork))
+    std::atomic<uint64> nCount(0);
+    auto fnCheck = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        nCount += checkFork.mapBlockAddress.size();
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS))
         {
-            StdError("check", "Check address: dbAddress AddNewFork fail.");
-            dbAddress.Deinitialize();
-            return false;
+            checkFork.mapBlockAddress.clear();
+            return true;
         }
-        CCheckAddressWalker checkAddressWalker(it->second.mapBlockAddress);
+
+        CCheckAddressWalker checkAddressWalker(checkFork.mapBlockAddress);
         if (!dbAddress.WalkThrough(hashFork, checkAddressWalker))
         {
             StdError("check", "Check address: dbAddress WalkThrough fail.");
-            dbAddress.Deinitialize();
             return false;
         }
         if (!checkAddressWalker.CheckAddress())
@@ -2804,17 +3182,33 @@ bool CCheckRepairData::CheckRepairAddress(uint64& nAddressCount)
                 {
                     StdError("check", "Check address: Repair address fail, update: %lu, remove: %lu, fork: %s",
                              checkAddressWalker.vAddUpdate.size(), checkAddressWalker.vRemove.size(), hashFork.GetHex().c_str());
-                    dbAddress.Deinitialize();
                     return false;
                 }
             }
         }
-        nAddressCount += it->second.mapBlockAddress.size();
-        it->second.mapBlockAddress.clear();
-    }
+        checkFork.mapBlockAddress.clear();
+        objRepairPoint.SetCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS);
+        return true;
+    };
+
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_ADDRESS))
+        {
+            return true;
+        }
+        if (!dbAddress.LoadFork(hashFork))
+        {
+            StdError("check", "Check address: dbAddress AddNewFork fail.");
+            return false;
+        }
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(objBlockWalker.mapCheckFork, nCheckThreads, "Check address", fnLoad, fnCheck);
+    nAddressCount += nCount;
 
     dbAddress.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
@@ -2826,18 +3220,18 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
         return false;
     }
 
-    map<uint256, vector<pair<uint256, CTxIndex>>> mapTxNew;
-    map<uint256, CCheckBlockFork>::iterator mt = objBlockWalker.mapCheckFork.begin();
-    for (; mt != objBlockWalker.mapCheckFork.end(); ++mt)
-    {
-        if (!dbTxIndex.LoadFork(mt->first))
+    std::atomic<uint64> nCount(0);
+    std::atomic<uint64> nUpdateTxIndexCount(0);
+    auto fnCheck = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        auto& mapBlockTxIndex = checkFork.mapBlockTxIndex;
+        nCount += mapBlockTxIndex.size();
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_TXINDEX))
         {
-            StdLog("check", "Check tx index: dbTxIndex LoadFork fail");
-            dbTxIndex.Deinitialize();
-            return false;
+            mapBlockTxIndex.clear();
+            return true;
         }
-        const uint256& hashFork = mt->first;
-        const auto& mapBlockTxIndex = mt->second.mapBlockTxIndex;
+
+        vector<pair<uint256, CTxIndex>> vTxNew;
         for (auto nt = mapBlockTxIndex.begin(); nt != mapBlockTxIndex.end(); ++nt)
         {
             CTxIndex txIndex;
@@ -2846,7 +3240,7 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
                 StdLog("check", "Check tx index: Retrieve tx index fail, height: %d, tx: %s.",
                        nt->second.nBlockHeight, nt->first.GetHex().c_str());
 
-                mapTxNew[hashFork].push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
+                vTxNew.push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
             }
             else
             {
@@ -2856,35 +3250,96 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
                            nt->second.nBlockHeight, nt->first.GetHex().c_str(),
                            txIndex.nFile, txIndex.nOffset, nt->second.nFile, nt->second.nOffset);
 
-                    mapTxNew[hashFork].push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
+                    vTxNew.push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
                 }
             }
-            ++nTxIndexCount;
         }
-        mt->second.mapBlockTxIndex.clear();
-    }
+        mapBlockTxIndex.clear();
 
-    // repair
-    if (!fOnlyCheck && !mapTxNew.empty())
-    {
-        StdLog("check", "Repair tx index starting");
-        int64 nUpdateTxIndexCount = 0;
-        for (const auto& fork : mapTxNew)
+        // repair
+        if (!fOnlyCheck && !vTxNew.empty())
         {
-            if (!dbTxIndex.Update(fork.first, fork.second, vector<uint256>()))
+            if (!dbTxIndex.Update(hashFork, vTxNew, vector<uint256>()))
             {
-                StdLog("check", "Repair tx index update fail");
-                dbTxIndex.Deinitialize();
+                StdLog("check", "Repair tx index update fail, fork: %s", hashFork.GetHex().c_str());
                 return false;
             }
-            dbTxIndex.Flush(fork.first);
-            nUpdateTxIndexCount += fork.second.size();
+            dbTxIndex.Flush(hashFork);
+            nUpdateTxIndexCount += vTxNew.size();
+        }
+        objRepairPoint.SetCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_TXINDEX);
+        return true;
+    };
+
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (objRepairPoint.IsCompleted(hashFork, CCheckRepairPoint::CHECK_PHASE_TXINDEX))
+        {
+            return true;
         }
-        StdLog("check", "Repair tx index success, update: %lu", nUpdateTxIndexCount);
+        if (!dbTxIndex.LoadFork(hashFork))
+        {
+            StdLog("check", "Check tx index: dbTxIndex LoadFork fail");
+            return false;
+        }
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(objBlockWalker.mapCheckFork, nCheckThreads, "Check tx index", fnLoad, fnCheck);
+    nTxIndexCount += nCount;
+    if (nUpdateTxIndexCount > 0)
+    {
+        StdLog("check", "Repair tx index success, update: %lu", (uint64)nUpdateTxIndexCount);
     }
 
     dbTxIndex.Deinitialize();
-    return true;
+    return fRet;
+}
+
+bool CCheckRepairData::ReindexAddressUnspent(const path& pathReindex, uint64& nUnspentCount)
+{
+    CAddressUnspentDB dbAddressUnspent;
+    if (!dbAddressUnspent.Initialize(pathReindex, false))
+    {
+        StdError("check", "Reindex address unspent: dbAddressUnspent Initialize fail");
+        return false;
+    }
+
+    std::atomic<uint64> nCount(0);
+    auto fnLoad = [&](const uint256& hashFork) -> bool {
+        if (!dbAddressUnspent.LoadFork(hashFork))
+        {
+            StdError("check", "Reindex address unspent: dbAddressUnspent LoadFork fail.");
+            return false;
+        }
+        return true;
+    };
+
+    auto fnReindex = [&](const uint256& hashFork, CCheckBlockFork& checkFork) -> bool {
+        vector<pair<CAddrUnspentKey, CUnspentOut>> vUnspent;
+        vUnspent.reserve(checkFork.mapBlockUnspent.size());
+        for (const auto& kv : checkFork.mapBlockUnspent)
+        {
+            vUnspent.push_back(make_pair(CAddrUnspentKey(kv.second.destTo, kv.first),
+                                         CUnspentOut(static_cast<const CTxOut&>(kv.second), kv.second.nTxType, kv.second.nHeight)));
+        }
+        checkFork.mapBlockUnspent.clear();
+        sort(vUnspent.begin(), vUnspent.end(),
+             [](const pair<CAddrUnspentKey, CUnspentOut>& a, const pair<CAddrUnspentKey, CUnspentOut>& b) { return a.first < b.first; });
+
+        if (!dbAddressUnspent.BulkLoadAddressUnspent(hashFork, vUnspent))
+        {
+            StdError("check", "Reindex address unspent: Bulk load fail, fork: %s", hashFork.GetHex().c_str());
+            return false;
+        }
+        nCount += vUnspent.size();
+        return true;
+    };
+
+    bool fRet = ParallelCheckFork(objBlockWalker.mapCheckFork, nCheckThreads, "Reindex address unspent", fnLoad, fnReindex);
+    nUnspentCount += nCount;
+
+    dbAddressUnspent.Deinitialize();
+    return fRet;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -2892,6 +3347,16 @@ bool CCheckRepairData::CheckRepairData()
 {
     StdLog("check", "Start check and repair, path: %s", strDataPath.c_str());
 
+    if (nCheckThreads == 0)
+    {
+        nCheckThreads = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+    if (!objRepairPoint.Initialize(strDataPath))
+    {
+        StdLog("check", "Repair point initialize fail");
+        return false;
+    }
+
     if (!objForkManager.FetchForkStatus())
     {
         StdLog("check", "Fetch fork status fail");
@@ -2952,6 +3417,87 @@ bool CCheckRepairData::CheckRepairData()
         return false;
     }
     StdLog("check", "Check tx index complete, count: %lu", nTxIndexCount);
+
+    objRepairPoint.Remove();
+    return true;
+}
+
+bool CCheckRepairData::ReindexAddressData()
+{
+    StdLog("check", "Start reindex address, path: %s", strDataPath.c_str());
+
+    if (nCheckThreads == 0)
+    {
+        nCheckThreads = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+
+    // the address indexes are written from empty into a separate directory, the current ones
+    // are replaced only after the rebuild succeeds, so an interrupted rebuild leaves them intact
+    const path pathReindex = path(strDataPath) / "reindexaddress";
+    remove_all(pathReindex);
+    create_directories(pathReindex);
+    objBlockWalker.fReindexAddress = true;
+    objBlockWalker.strReindexPath = pathReindex.string();
+
+    if (!objForkManager.FetchForkStatus())
+    {
+        StdLog("check", "Fetch fork status fail");
+        return false;
+    }
+
+    StdLog("check", "Fetch block data starting");
+    if (!FetchBlockData())
+    {
+        StdLog("check", "Fetch block data fail");
+        return false;
+    }
+    StdLog("check", "Fetch block data success");
+
+    StdLog("check", "Reindex address unspent starting");
+    uint64 nUnspentCount = 0;
+    if (!ReindexAddressUnspent(pathReindex, nUnspentCount))
+    {
+        StdLog("check", "Reindex address unspent fail");
+        return false;
+    }
+    StdLog("check", "Reindex address unspent success, count: %lu", nUnspentCount);
+
+    if (!ReplaceAddressData(pathReindex))
+    {
+        StdLog("check", "Replace address data fail");
+        return false;
+    }
+    return true;
+}
+
+bool CCheckRepairData::ReplaceAddressData(const path& pathReindex)
+{
+    vector<string> vName;
+    vName.push_back("addressunspent");
+    if (objBlockWalker.fCheckAddrTxIndex)
+    {
+        vName.push_back("addresstxindex");
+    }
+
+    try
+    {
+        // each index is swapped by two renames, the old one is removed with the reindex directory
+        for (const string& strName : vName)
+        {
+            const path pathCurrent = path(strDataPath) / strName;
+            if (exists(pathCurrent))
+            {
+                rename(pathCurrent, pathReindex / (strName + ".old"));
+            }
+            rename(pathReindex / strName, pathCurrent);
+        }
+        remove_all(pathReindex);
+    }
+    catch (const filesystem_error& e)
+    {
+        StdError("check", "Replace address data: %s", e.what());
+        return false;
+    }
     return true;
 }
 
@@ -24,6 +24,8 @@
 #include "unspentdb.h"
 #include "util.h"
 
+#include <boost/thread/mutex.hpp>
+
 using namespace xengine;
 using namespace ibrio::storage;
 using namespace boost::filesystem;
@@ -307,6 +309,55 @@ public:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////
+// CCheckRepairPoint
+
+class CCheckBlockFork;
+
+class CCheckRepairPoint
+{
+public:
+    enum
+    {
+        CHECK_PHASE_ADDRESS_TXINDEX = (1 << 0),
+        CHECK_PHASE_UNSPENT = (1 << 1),
+        CHECK_PHASE_ADDRESS_UNSPENT = (1 << 2),
+        CHECK_PHASE_ADDRESS = (1 << 3),
+        CHECK_PHASE_TXINDEX = (1 << 4)
+    };
+
+public:
+    CCheckRepairPoint()
+      : fEnable(false), nBlockDataSize(0), nAllPhase(0), nBlockCount(0) {}
+
+    bool Initialize(const string& strDataPath);
+    // Before the block walk: the forks that completed every phase, together with all the forks
+    // inheriting from them, need no block data on resume, their defi mint height is returned
+    void Prepare(const uint64 nBlockDataSizeIn, const uint32 nAllPhaseIn, map<uint256, int32>& mapSkipFork);
+    // After the block walk: discards the recorded progress if it was taken against other block data,
+    // fails if forks were skipped in the walk on that progress
+    bool Load(const map<uint256, CCheckBlockFork>& mapCheckFork, const int64 nBlockCountIn, const uint64 nBlockDataSizeIn);
+    bool IsCompleted(const uint256& hashFork, const uint32 nPhase);
+    void SetCompleted(const uint256& hashFork, const uint32 nPhase);
+    void Remove();
+
+protected:
+    bool Save();
+
+protected:
+    boost::mutex mtxPoint;
+    bool fEnable;
+    path pathPointFile;
+    uint64 nBlockDataSize;
+    uint32 nAllPhase;
+    map<uint256, uint256> mapForkLast;
+    map<uint256, uint256> mapForkParent;
+    map<uint256, int32> mapForkMintHeight;
+    int64 nBlockCount;
+    map<uint256, uint32> mapForkPhase;
+    set<uint256> setSkipFork;
+};
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckBlockIndexWalker
 
@@ -351,8 +402,6 @@ protected:
     map<CTxOutPoint, CCheckTxOut> mapTxPoolUnspent;
 };
 
-class CCheckBlockFork;
-
 class CCheckTxPoolData
 {
 public:
@@ -382,10 +431,10 @@ class CCheckBlockFork
     };
 
 public:
-    CCheckBlockFork(const string& strPathIn, const bool fOnlyCheckIn, const bool fAddrTxIndexIn, CCheckTsBlock& tsBlockIn,
+    CCheckBlockFork(const string& strPathIn, const bool fOnlyCheckIn, const bool fAddrTxIndexIn, const bool fReindexAddressIn, CCheckTsBlock& tsBlockIn,
                     CCheckForkManager& objForkManagerIn, CAddressTxIndexDB& dbAddressTxIndexIn)
-      : pOrigin(nullptr), pLast(nullptr), fInvalidFork(false), strDataPath(strPathIn), fOnlyCheck(fOnlyCheckIn), fCheckAddrTxIndex(fAddrTxIndexIn),
-        tsBlock(tsBlockIn), objForkManager(objForkManagerIn), dbAddressTxIndex(dbAddressTxIndexIn), nCacheTxInfoBlockCount(0), nMintHeight(-2) {}
+      : pOrigin(nullptr), pLast(nullptr), fInvalidFork(false), fSkipData(false), strDataPath(strPathIn), fOnlyCheck(fOnlyCheckIn), fCheckAddrTxIndex(fAddrTxIndexIn),
+        fReindexAddress(fReindexAddressIn), tsBlock(tsBlockIn), objForkManager(objForkManagerIn), dbAddressTxIndex(dbAddressTxIndexIn), nCacheTxInfoBlockCount(0), nMintHeight(-2) {}
 
     bool AddForkBlock(const CBlockEx& block, CBlockIndex* pBlockIndex);
     CBlockIndex* GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIndex, vector<CBlockIndex*>& vPath);
@@ -400,16 +449,21 @@ public:
     bool InheritCopyData(const CCheckBlockFork& fromParent, const CBlockIndex* pJointBlockIndex);
     bool CheckForkAddressTxIndex(const uint256& hashFork, const int nCheckHeight);
 
+protected:
+    bool ReindexForkAddressTxIndex(const uint256& hashFork, const int nCheckHeight);
+
 public:
     string strDataPath;
     bool fOnlyCheck;
     bool fCheckAddrTxIndex;
+    bool fReindexAddress;
     CCheckTsBlock& tsBlock;
     CCheckForkManager& objForkManager;
     CAddressTxIndexDB& dbAddressTxIndex;
     CBlockIndex* pOrigin;
     CBlockIndex* pLast;
     bool fInvalidFork;
+    bool fSkipData;
     map<uint256, CCheckTxIndex> mapParentForkBlockTxIndex;
     map<uint256, CCheckTxIndex> mapBlockTxIndex;
     map<uint256, CCheckTxInfo> mapBlockTxInfo;
@@ -427,7 +481,7 @@ class CCheckBlockWalker : public CTSWalker<CBlockEx>
 public:
     CCheckBlockWalker(const bool fTestnetIn, const bool fOnlyCheckIn, const bool fAddrTxIndexIn, const int64& nMaxBlockRewardTxCountIn, CCheckForkManager& objForkManagerIn)
       : nBlockCount(0), nMainChainHeight(0), objProofParam(fTestnetIn), fOnlyCheck(fOnlyCheckIn),
-        fCheckAddrTxIndex(fAddrTxIndexIn), nMaxBlockRewardTxCount(nMaxBlockRewardTxCountIn), objForkManager(objForkManagerIn), dbInvest(false), dbActivate(false), nBlockPrevTime(0) {}
+        fCheckAddrTxIndex(fAddrTxIndexIn), fReindexAddress(false), nMaxBlockRewardTxCount(nMaxBlockRewardTxCountIn), objForkManager(objForkManagerIn), dbInvest(false), dbActivate(false), nBlockPrevTime(0) {}
     ~CCheckBlockWalker();
 
     bool Initialize(const string& strPath);
@@ -452,14 +506,16 @@ public:
     void ClearBlockIndex();
     bool CheckBlockIndex();
     bool CheckRefBlock();
-    bool CheckSurplusAddressTxIndex(uint64& nTxIndexCount);
+    bool CheckSurplusAddressTxIndex(uint64& nTxIndexCount, const uint32 nThreads, CCheckRepairPoint& objRepairPoint);
     bool UpdateInvest(const uint256& hashBlock, const CBlockEx& block);
     bool UpdateActivate(const uint256& hashBlock, const CBlockEx& block);
 
 public:
     bool fOnlyCheck;
     bool fCheckAddrTxIndex;
+    bool fReindexAddress;
     string strDataPath;
+    string strReindexPath;
     int64 nBlockCount;
     uint32 nMainChainHeight;
     uint256 hashGenesis;
@@ -467,6 +523,7 @@ public:
     CProofOfWorkParam objProofParam;
     CCheckForkManager& objForkManager;
     map<uint256, CCheckBlockFork> mapCheckFork;
+    map<uint256, int32> mapSkipFork;
     map<uint256, CBlockIndex*> mapBlockIndex;
     map<uint256, uint256> mapRefBlock;
     CBlockIndexDB dbBlockIndex;
@@ -485,8 +542,9 @@ public:
 class CCheckRepairData
 {
 public:
-    CCheckRepairData(const string& strPath, const bool fTestnetIn, const bool fOnlyCheckIn, const bool fAddrTxIndexIn, const int64& nMaxBlockRewardTxCountIn)
-      : strDataPath(strPath), fTestnet(fTestnetIn), fOnlyCheck(fOnlyCheckIn),
+    CCheckRepairData(const string& strPath, const bool fTestnetIn, const bool fOnlyCheckIn, const bool fAddrTxIndexIn, const int64& nMaxBlockRewardTxCountIn,
+                     const uint32 nCheckThreadsIn = 1)
+      : strDataPath(strPath), fTestnet(fTestnetIn), fOnlyCheck(fOnlyCheckIn), nCheckThreads(nCheckThreadsIn),
         objProofOfWorkParam(fTestnetIn), objForkManager(strPath, fTestnetIn, fOnlyCheckIn, objProofOfWorkParam),
         objBlockWalker(fTestnetIn, fOnlyCheckIn, fAddrTxIndexIn, nMaxBlockRewardTxCountIn, objForkManager)
     {
@@ -498,18 +556,24 @@ protected:
     bool CheckRepairAddressUnspent();
     bool CheckRepairAddress(uint64& nAddressCount);
     bool CheckTxIndex(uint64& nTxIndexCount);
+    bool ReindexAddressUnspent(const path& pathReindex, uint64& nUnspentCount);
+    bool ReplaceAddressData(const path& pathReindex);
 
 public:
     bool CheckRepairData();
+    // Rebuild the address unspent and address tx index from the block files, the other data is only read
+    bool ReindexAddressData();
 
 protected:
     string strDataPath;
     bool fTestnet;
     bool fOnlyCheck;
+    uint32 nCheckThreads;
 
     CProofOfWorkParam objProofOfWorkParam;
     CCheckForkManager objForkManager;
     CCheckBlockWalker objBlockWalker;
+    CCheckRepairPoint objRepairPoint;
 };
 
 } // namespace ibrio
@@ -251,7 +251,7 @@ Errno CCoreProtocol::ValidateTransaction(const CTransaction& tx, int nHeight)
     return OK;
 }
 
-Errno CCoreProtocol::ValidateBlock(const CBlock& block)
+Errno CCoreProtocol::ValidateBlock(const CBlock& block, const bool fTrustSignature)
 {
     // These are checks that are independent of context
     // Only allow CBlock::BLOCK_PRIMARY type in v1.0.0
@@ -323,7 +323,7 @@ Errno CCoreProtocol::ValidateBlock(const CBlock& block)
         }
     }
 
-    if (!CheckBlockSignature(block))
+    if (!fTrustSignature && !CheckBlockSignature(block))
     {
         return DEBUG(ERR_BLOCK_SIGNATURE_INVALID, "Check block signature fail");
     }
@@ -714,7 +714,7 @@ Errno CCoreProtocol::VerifyBlock(const CBlock& block, CBlockIndex* pIndexPrev)
 }
 
 Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev,
-                                   int nBlockHeight, const uint256& fork, const CProfile& profile)
+                                   int nBlockHeight, const uint256& fork, const CProfile& profile, const bool fTrustSignature)
 {
     Errno err = OK;
     const CDestination& destIn = txContxt.destIn;
@@ -849,7 +849,7 @@ Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txCo
         nBlockHeight -= 1;
     }*/
 
-    if (!destIn.VerifyTxSignature(tx.GetSignatureHash(), tx.nType, tx.hashAnchor, tx.sendTo, vchSig, nBlockHeight, fork))
+    if (!fTrustSignature && !destIn.VerifyTxSignature(tx.GetSignatureHash(), tx.nType, tx.hashAnchor, tx.sendTo, vchSig, nBlockHeight, fork))
     {
         return DEBUG(ERR_TRANSACTION_SIGNATURE_INVALID, "invalid signature");
     }
@@ -4,6 +4,7 @@
 
 #include "defi.h"
 
+#include "parallel.h"
 #include "param.h"
 
 using namespace std;
@@ -13,17 +14,112 @@ using namespace ibrio::storage;
 namespace ibrio
 {
 
+//////////////////////////////
+// parallel kernels
+// [0, nSize) is split into chunks, every chunk is handled by one thread.
+// The result of all kernels does not depend on the number of threads.
+
+static uint32 ParallelChunkCount(const uint32 nParallelNum, const std::size_t nSize)
+{
+    std::size_t nThreads = (nParallelNum == 0) ? std::max(1u, std::thread::hardware_concurrency()) : nParallelNum;
+    std::size_t nChunk = std::min(nThreads, nSize / CDeFiForkReward::PARALLEL_CHUNK_MIN_SIZE);
+    return std::max((std::size_t)1, std::min(nChunk, (std::size_t)UINT8_MAX));
+}
+
+// fn: void (nBegin, nEnd)
+template <typename Func>
+static void ParallelFor(const uint32 nParallelNum, const std::size_t nSize, Func fn)
+{
+    uint32 nChunk = ParallelChunkCount(nParallelNum, nSize);
+    if (nChunk <= 1
+        || !ParallelComputer(nChunk).Execute(
+            nChunk, [](const uint32 i) { return i; },
+            [&](const uint32 i) { fn(nSize * i / nChunk, nSize * (i + 1) / nChunk); }))
+    {
+        fn(0, nSize);
+    }
+}
+
+// fn: uint64 (nBegin, nEnd), partial sum of [nBegin, nEnd)
+template <typename Func>
+static uint64 ParallelSum(const uint32 nParallelNum, const std::size_t nSize, Func fn)
+{
+    uint32 nChunk = ParallelChunkCount(nParallelNum, nSize);
+    vector<uint64> vSum(nChunk, 0);
+    if (nChunk <= 1
+        || !ParallelComputer(nChunk).Execute(
+            nChunk, [](const uint32 i) { return i; },
+            [&](const uint32 i) { vSum[i] = fn(nSize * i / nChunk, nSize * (i + 1) / nChunk); }))
+    {
+        return fn(0, nSize);
+    }
+    return std::accumulate(vSum.begin(), vSum.end(), (uint64)0);
+}
+
+// stable sort, chunks are sorted in parallel then merged pairwise in parallel
+template <typename T, typename Compare>
+static void ParallelStableSort(const uint32 nParallelNum, vector<T>& v, Compare comp)
+{
+    uint32 nChunk = ParallelChunkCount(nParallelNum, v.size());
+    if (nChunk <= 1)
+    {
+        std::stable_sort(v.begin(), v.end(), comp);
+        return;
+    }
+
+    vector<std::size_t> vBound(nChunk + 1);
+    for (uint32 i = 0; i <= nChunk; i++)
+    {
+        vBound[i] = v.size() * i / nChunk;
+    }
+
+    ParallelComputer computer(nChunk);
+    bool fSucceed = computer.Execute(nChunk, [](const uint32 i) { return i; }, [&](const uint32 i) {
+        std::stable_sort(v.begin() + vBound[i], v.begin() + vBound[i + 1], comp);
+    });
+
+    for (uint32 nStep = 1; fSucceed && nStep < nChunk; nStep *= 2)
+    {
+        uint32 nMerge = (nChunk + 2 * nStep - 1) / (2 * nStep);
+        fSucceed = computer.Execute(nMerge, [](const uint32 i) { return i; }, [&](const uint32 i) {
+            uint32 nBegin = i * 2 * nStep;
+            uint32 nMiddle = std::min(nBegin + nStep, nChunk);
+            uint32 nEnd = std::min(nBegin + 2 * nStep, nChunk);
+            if (nMiddle < nEnd)
+            {
+                std::inplace_merge(v.begin() + vBound[nBegin], v.begin() + vBound[nMiddle], v.begin() + vBound[nEnd], comp);
+            }
+        });
+    }
+
+    // sorted chunks keep the original order of equal elements, so sorting again gives the same result
+    if (!fSucceed)
+    {
+        std::stable_sort(v.begin(), v.end(), comp);
+    }
+}
+
 //////////////////////////////
 // CDeFiForkReward
-CDeFiRewardSet CDeFiForkReward::null;
+CDeFiForkReward::CDeFiForkReward()
+  : nParallelNum(0)
+{
+}
+
+void CDeFiForkReward::SetParallelNum(const uint32 nNum)
+{
+    nParallelNum = nNum;
+}
 
 bool CDeFiForkReward::ExistFork(const uint256& forkid) const
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     return forkReward.count(forkid);
 }
 
 bool CDeFiForkReward::IsMinted(const uint256& forkid, const int32 nHeight) const
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     auto it = forkReward.find(forkid);
     if (it != forkReward.end())
     {
@@ -49,17 +145,20 @@ void CDeFiForkReward::AddFork(const uint256& forkid, const CProfile& profile)
 {
     CForkReward fr;
     fr.profile = profile;
+    boost::unique_lock<boost::shared_mutex> wlock(rwReward);
     forkReward[forkid] = fr;
 }
 
 CProfile CDeFiForkReward::GetForkProfile(const uint256& forkid)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     auto it = forkReward.find(forkid);
     return (it == forkReward.end()) ? CProfile() : it->second.profile;
 }
 
 int32 CDeFiForkReward::PrevRewardHeight(const uint256& forkid, const int32 nHeight)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     auto it = forkReward.find(forkid);
     if (it != forkReward.end())
     {
@@ -129,6 +228,7 @@ int64 CDeFiForkReward::GetSectionReward(const uint256& forkid, const uint256& se
 
 bool CDeFiForkReward::ExistForkSection(const uint256& forkid, const uint256& section)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     auto it = forkReward.find(forkid);
     if (it != forkReward.end())
     {
@@ -137,42 +237,47 @@ bool CDeFiForkReward::ExistForkSection(const uint256& forkid, const uint256& sec
     return false;
 }
 
-CDeFiRewardSet& CDeFiForkReward::GetForkSection(const uint256& forkid, const uint256& section, bool& fIsNull)
+std::shared_ptr<const CDeFiRewardSet> CDeFiForkReward::GetForkSection(const uint256& forkid, const uint256& section)
 {
+    boost::shared_lock<boost::shared_mutex> rlock(rwReward);
     auto it = forkReward.find(forkid);
     if (it != forkReward.end())
     {
         auto im = it->second.reward.find(section);
         if (im != it->second.reward.end())
         {
-            fIsNull = false;
             return im->second;
         }
     }
-    fIsNull = true;
-    return null;
+    return nullptr;
 }
 
-void CDeFiForkReward::AddForkSection(const uint256& forkid, const uint256& hash, CDeFiRewardSet&& reward)
+std::shared_ptr<const CDeFiRewardSet> CDeFiForkReward::AddForkSection(const uint256& forkid, const uint256& hash, CDeFiRewardSet&& reward)
 {
+    std::shared_ptr<const CDeFiRewardSet> spReward = std::make_shared<const CDeFiRewardSet>(std::move(reward));
+
+    boost::unique_lock<boost::shared_mutex> wlock(rwReward);
     auto it = forkReward.find(forkid);
-    if (it != forkReward.end())
+    if (it == forkReward.end())
     {
-        auto& mapReward = it->second.reward;
-        mapReward[hash] = std::move(reward);
+        return nullptr;
+    }
 
-        while (mapReward.size() > MAX_REWARD_CACHE)
+    auto& mapReward = it->second.reward;
+    mapReward[hash] = spReward;
+
+    while (mapReward.size() > MAX_REWARD_CACHE)
+    {
+        if (mapReward.begin()->first != hash)
         {
-            if (mapReward.begin()->first != hash)
-            {
-                mapReward.erase(mapReward.begin());
-            }
-            else
-            {
-                break;
-            }
+            mapReward.erase(mapReward.begin());
+        }
+        else
+        {
+            break;
         }
     }
+    return spReward;
 }
 
 CDeFiRewardSet CDeFiForkReward::ComputeStakeReward(const int64 nMin, const int64 nReward,
@@ -185,48 +290,58 @@ CDeFiRewardSet CDeFiForkReward::ComputeStakeReward(const int64 nMin, const int64
         return rewardSet;
     }
 
-    // sort by token
-    multimap<int64, pair<CDestination, uint64>> mapRank;
+    // sort by token, the same token is ordered by address
+    typedef pair<int64, const CDestination*> TokenAddress;
+    auto compToken = [](const TokenAddress& a, const TokenAddress& b) { return a.first < b.first; };
+    vector<TokenAddress> vRank;
+    vRank.reserve(mapAddressAmount.size());
     for (auto& p : mapAddressAmount)
     {
         if (p.second >= nMin)
         {
-            mapRank.insert(make_pair(p.second, make_pair(p.first, 0)));
+            vRank.push_back(make_pair(p.second, &p.first));
         }
     }
-
-    // tag rank
-    uint64 nRank = 1;
-    uint64 nPos = 0;
-    uint64 nTotal = 0;
-    int64 nToken = -1;
-    for (auto& p : mapRank)
+    if (vRank.empty())
     {
-        ++nPos;
-        if (p.first != nToken)
-        {
-            p.second.second = nPos;
-            nRank = nPos;
-            nToken = p.first;
-        }
-        else
+        return rewardSet;
+    }
+    ParallelStableSort(nParallelNum, vRank, compToken);
+
+    // tag rank, the rank of the same token is the position of the first one
+    vector<uint64> vRankNo(vRank.size());
+    uint64 nTotal = ParallelSum(nParallelNum, vRank.size(), [&](const std::size_t nBegin, const std::size_t nEnd) -> uint64 {
+        uint64 nRank = std::lower_bound(vRank.begin(), vRank.begin() + nBegin, vRank[nBegin], compToken) - vRank.begin() + 1;
+        uint64 nSum = 0;
+        for (std::size_t i = nBegin; i < nEnd; i++)
         {
-            p.second.second = nRank;
+            if (i > nBegin && vRank[i].first != vRank[i - 1].first)
+            {
+                nRank = i + 1;
+            }
+            vRankNo[i] = nRank;
+            nSum += nRank;
         }
-
-        nTotal += p.second.second;
-    }
+        return nSum;
+    });
 
     // reward
     double fUnitReward = (double)nReward / nTotal;
-    for (auto& p : mapRank)
-    {
-        CDeFiReward reward;
-        reward.dest = p.second.first;
-        reward.nAmount = p.first;
-        reward.nRank = p.second.second;
-        reward.nStakeReward = fUnitReward * p.second.second;
-        reward.nReward = reward.nStakeReward;
+    vector<CDeFiReward> vReward(vRank.size());
+    ParallelFor(nParallelNum, vRank.size(), [&](const std::size_t nBegin, const std::size_t nEnd) {
+        for (std::size_t i = nBegin; i < nEnd; i++)
+        {
+            CDeFiReward& reward = vReward[i];
+            reward.dest = *vRank[i].second;
+            reward.nAmount = vRank[i].first;
+            reward.nRank = vRankNo[i];
+            reward.nStakeReward = fUnitReward * vRankNo[i];
+            reward.nReward = reward.nStakeReward;
+        }
+    });
+
+    for (CDeFiReward& reward : vReward)
+    {
         rewardSet.insert(std::move(reward));
     }
 
@@ -290,24 +405,7 @@ CDeFiRewardSet CDeFiForkReward::ComputePromotionReward(const int64 nReward,
                                                 continue;
                                             }
 
-                                            uint64 nLastToken = 0;
-                                            uint64 nChildPower = 0;
-                                            for (auto& tokenTimes : mapPromotionTokenTimes)
-                                            {
-                                                if (n > tokenTimes.first)
-                                                {
-                                                    nChildPower += (tokenTimes.first - nLastToken) * tokenTimes.second;
-                                                    nLastToken = tokenTimes.first;
-                                                }
-                                                else
-                                                {
-                                                    nChildPower += (n - nLastToken) * tokenTimes.second;
-                                                    nLastToken = n;
-                                                    break;
-                                                }
-                                            }
-                                            nChildPower += (n - nLastToken);
-                                            pNode->data.nPower += nChildPower;
+                                            pNode->data.nPower += ComputeChildPower(n, mapPromotionTokenTimes);
                                         }
                                         pNode->data.nPower += llround(pow(nMax, 1.0 / 3));
                                     }
@@ -341,6 +439,152 @@ CDeFiRewardSet CDeFiForkReward::ComputePromotionReward(const int64 nReward,
     return rewardSet;
 }
 
+CDeFiRewardSet CDeFiForkReward::ComputePromotionReward(const int64 nReward,
+                                                       const map<CDestination, int64>& mapAddressAmount,
+                                                       const std::map<int64, uint32>& mapPromotionTokenTimes,
+                                                       CDeFiRelationFlatGraph& relation,
+                                                       const std::set<CDestination>& setBlackList)
+{
+    typedef CDeFiRelationFlatGraph::CFlatNode Node;
+
+    CDeFiRewardSet rewardSet;
+
+    if (nReward == 0)
+    {
+        return rewardSet;
+    }
+
+    // amount of every node, -1 means in blacklist
+    vector<Node>& vNode = relation.vNode;
+    vector<int64> vAmount(vNode.size());
+    ParallelFor(nParallelNum, vNode.size(), [&](const std::size_t nBegin, const std::size_t nEnd) {
+        for (std::size_t i = nBegin; i < nEnd; i++)
+        {
+            if (setBlackList.count(vNode[i].key))
+            {
+                vAmount[i] = -1;
+            }
+            else
+            {
+                auto it = mapAddressAmount.find(vNode[i].key);
+                vAmount[i] = (it == mapAddressAmount.end()) ? 0 : (it->second / COIN);
+            }
+        }
+    });
+
+    // compute promotion power, nodes are stored in postorder so children are always computed before parent
+    vector<uint32> vPower;
+    for (uint32 i = 0; i < vNode.size(); i++)
+    {
+        Node& node = vNode[i];
+
+        // blacklist
+        if (vAmount[i] < 0)
+        {
+            node.data.nPower = 0;
+            node.data.nAmount = 0;
+            continue;
+        }
+
+        // power
+        node.data.nPower = 0;
+        node.data.nAmount = vAmount[i];
+        if (node.nChildBegin != node.nChildEnd)
+        {
+            int64 nMax = -1;
+            for (uint32 j = node.nChildBegin; j < node.nChildEnd; j++)
+            {
+                const Node& child = vNode[relation.vChild[j]];
+                node.data.nAmount += child.data.nAmount;
+                int64 n = 0;
+                if (child.data.nAmount <= nMax)
+                {
+                    n = child.data.nAmount;
+                }
+                else
+                {
+                    n = nMax;
+                    nMax = child.data.nAmount;
+                }
+
+                if (n < 0)
+                {
+                    continue;
+                }
+
+                node.data.nPower += ComputeChildPower(n, mapPromotionTokenTimes);
+            }
+            node.data.nPower += llround(pow(nMax, 1.0 / 3));
+        }
+
+        if (node.data.nPower > 0)
+        {
+            vPower.push_back(i);
+        }
+    }
+
+    uint64 nTotal = ParallelSum(nParallelNum, vPower.size(), [&](const std::size_t nBegin, const std::size_t nEnd) -> uint64 {
+        uint64 nSum = 0;
+        for (std::size_t i = nBegin; i < nEnd; i++)
+        {
+            nSum += vNode[vPower[i]].data.nPower;
+        }
+        return nSum;
+    });
+
+    // reward
+    if (nTotal > 0)
+    {
+        // sort by power
+        ParallelStableSort(nParallelNum, vPower, [&](const uint32 a, const uint32 b) { return vNode[a].data.nPower < vNode[b].data.nPower; });
+
+        double fUnitReward = (double)nReward / nTotal;
+        vector<CDeFiReward> vReward(vPower.size());
+        ParallelFor(nParallelNum, vPower.size(), [&](const std::size_t nBegin, const std::size_t nEnd) {
+            for (std::size_t i = nBegin; i < nEnd; i++)
+            {
+                const Node& node = vNode[vPower[i]];
+                CDeFiReward& reward = vReward[i];
+                reward.dest = node.key;
+                reward.nAmount = vAmount[vPower[i]];
+                reward.nAchievement = node.data.nAmount;
+                reward.nPower = node.data.nPower;
+                reward.nPromotionReward = fUnitReward * node.data.nPower;
+                reward.nReward = reward.nPromotionReward;
+            }
+        });
+
+        for (CDeFiReward& reward : vReward)
+        {
+            rewardSet.insert(std::move(reward));
+        }
+    }
+
+    return rewardSet;
+}
+
+uint64 CDeFiForkReward::ComputeChildPower(const int64 n, const std::map<int64, uint32>& mapPromotionTokenTimes)
+{
+    uint64 nLastToken = 0;
+    uint64 nChildPower = 0;
+    for (auto& tokenTimes : mapPromotionTokenTimes)
+    {
+        if (n > tokenTimes.first)
+        {
+            nChildPower += (tokenTimes.first - nLastToken) * tokenTimes.second;
+            nLastToken = tokenTimes.first;
+        }
+        else
+        {
+            nChildPower += (n - nLastToken) * tokenTimes.second;
+            nLastToken = n;
+            break;
+        }
+    }
+    nChildPower += (n - nLastToken);
+    return nChildPower;
+}
+
 int64 CDeFiForkReward::GetFixedDecayReward(const CProfile& profile, const int32 nHeight)
 {
     if (profile.defi.nMintHeight < 0)
@@ -6,6 +6,7 @@
 #define IBRIO_DEFI_H
 
 #include <map>
+#include <numeric>
 #include <set>
 #include <stack>
 #include <type_traits>
@@ -34,16 +35,18 @@ public:
 };
 
 typedef xengine::CForest<CDestination, CDeFiRelationRewardNode> CDeFiRelationGraph;
+typedef xengine::CFlatForest<CDestination, CDeFiRelationRewardNode> CDeFiRelationFlatGraph;
 
 class CDeFiForkReward
 {
 public:
     enum
     {
-        MAX_REWARD_CACHE = 5
+        MAX_REWARD_CACHE = 5,
+        PARALLEL_CHUNK_MIN_SIZE = 4096
     };
 
-    typedef std::map<uint256, CDeFiRewardSet> MapSectionReward;
+    typedef std::map<uint256, std::shared_ptr<const CDeFiRewardSet>> MapSectionReward;
     struct CForkReward
     {
         MapSectionReward reward;
@@ -51,6 +54,10 @@ public:
     };
     typedef std::map<uint256, CForkReward> MapForkReward;
 
+    CDeFiForkReward();
+
+    // set the number of threads used by reward computation, 0 means hardware concurrency
+    void SetParallelNum(const uint32 nNum);
     // return exist fork or not
     bool ExistFork(const uint256& forkid) const;
     // return fork has been minted or not
@@ -65,12 +72,12 @@ public:
     int64 GetSectionReward(const uint256& forkid, const uint256& section, const int64 nSupply = -1, const int64 nInvalidSupply = 0);
     // return exist section cache of fork or not
     bool ExistForkSection(const uint256& forkid, const uint256& section);
-    // return the section reward set. Should use ExistForkSection to determine if it exists first.
-    CDeFiRewardSet& GetForkSection(const uint256& forkid, const uint256& section, bool& fIsNull);
-    // Add a section reward set of fork
-    void AddForkSection(const uint256& forkid, const uint256& hash, CDeFiRewardSet&& reward);
+    // return the section reward set, or nullptr if it is not cached. The set stays valid after it is evicted from cache.
+    std::shared_ptr<const CDeFiRewardSet> GetForkSection(const uint256& forkid, const uint256& section);
+    // Add a section reward set of fork, return the cached set or nullptr if fork is not exist
+    std::shared_ptr<const CDeFiRewardSet> AddForkSection(const uint256& forkid, const uint256& hash, CDeFiRewardSet&& reward);
 
-    // compute stake reward
+    // compute stake reward. Sort, rank and reward are computed in parallel on large set.
     CDeFiRewardSet ComputeStakeReward(const int64 nMin, const int64 nReward,
                                       const std::map<CDestination, int64>& mapAddressAmount);
     // compute promotion reward
@@ -79,6 +86,12 @@ public:
                                           const std::map<int64, uint32>& mapPromotionTokenTimes,
                                           CDeFiRelationGraph& relation,
                                           const std::set<CDestination>& setBlackList);
+    // compute promotion reward by one linear pass over flat relation graph. Amount lookup, sort and reward are computed in parallel on large graph.
+    CDeFiRewardSet ComputePromotionReward(const int64 nReward,
+                                          const std::map<CDestination, int64>& mapAddressAmount,
+                                          const std::map<int64, uint32>& mapPromotionTokenTimes,
+                                          CDeFiRelationFlatGraph& relation,
+                                          const std::set<CDestination>& setBlackList);
 
     // for fixed decay coinbase, return the reward of between [nHeight, nHeight + nRewardCycle), nHeight must be a beginning of nRewardCycle
     int64 GetFixedDecayReward(const CProfile& profile, const int32 nHeight);
@@ -92,8 +105,14 @@ public:
     int64 GetSpecificDecayRewardWithSupply(const CProfile& profile, const int32 nHeight, const int64 nSupply, const int64 nInvalidSupply = 0);
 
 protected:
+    // return the promotion power of a child with amount n
+    static uint64 ComputeChildPower(const int64 n, const std::map<int64, uint32>& mapPromotionTokenTimes);
+
+protected:
+    // blocks of different forks are added concurrently
+    mutable boost::shared_mutex rwReward;
     MapForkReward forkReward;
-    static CDeFiRewardSet null;
+    uint32 nParallelNum;
 };
 
 } // namespace ibrio
@@ -31,6 +31,7 @@ CDispatcher::CDispatcher()
     pNetChannel = nullptr;
     pDelegatedChannel = nullptr;
     pDataStat = nullptr;
+    fFastRelay = false;
 }
 
 CDispatcher::~CDispatcher()
@@ -99,6 +100,8 @@ bool CDispatcher::HandleInitialize()
         return false;
     }
     strCmd = dynamic_cast<const CBasicConfig*>(Config())->strBlocknotify;
+    const CNetworkConfig* pNetworkConfig = dynamic_cast<const CNetworkConfig*>(Config());
+    fFastRelay = (pNetworkConfig != nullptr && pNetworkConfig->fFastRelay);
     return true;
 }
 
@@ -161,6 +164,11 @@ void CDispatcher::HandleHalt()
 {
 }
 
+// May run concurrently for blocks of different subsidiary forks, net channel adds the blocks
+// waiting on a primary ref block on its ref block workers. CBlockChain::AddNewBlock connects
+// them under the rwAccess read lock and the lock of their fork, primary blocks under the write
+// lock. The tx pool, fork manager, data stat and service state touched afterwards are guarded
+// by their own locks, and the schedule of the fork is locked by the calling worker
 Errno CDispatcher::AddNewBlock(const CBlock& block, uint64 nNonce)
 {
     Errno err = OK;
@@ -170,10 +178,29 @@ Errno CDispatcher::AddNewBlock(const CBlock& block, uint64 nNonce)
         return ERR_MISSING_PREV;
     }
 
+    // Primary block from peer is announced once its header and proof are verified under the
+    // read lock, net channel answers getdata for it until it is stored. The result is reused by
+    // full validation, and the peer which sent it is penalized if full validation rejects it
+    bool fFastRelayBlock = (fFastRelay && nNonce != 0 && block.IsPrimary());
+    CBlockVerify verify;
+    if (fFastRelayBlock)
+    {
+        err = pBlockChain->VerifyBlockHeader(block, verify);
+        if (err != OK)
+        {
+            return err;
+        }
+        pNetChannel->RelayVerifiedBlock(pCoreProtocol->GetGenesisBlockHash(), block, nNonce);
+    }
+
     CBlockChainUpdate updateBlockChain;
     if (!block.IsOrigin())
     {
-        err = pBlockChain->AddNewBlock(block, updateBlockChain);
+        err = pBlockChain->AddNewBlock(block, updateBlockChain, false, &verify);
+        if (fFastRelayBlock)
+        {
+            pNetChannel->CompleteRelayedBlock(block.GetHash(), (err == OK || err == ERR_ALREADY_HAVE));
+        }
         if (err == OK)
         {
             if (!nNonce)
@@ -205,7 +232,10 @@ Errno CDispatcher::AddNewBlock(const CBlock& block, uint64 nNonce)
 
     if (!block.IsOrigin())
     {
-        pNetChannel->BroadcastBlockInv(updateBlockChain.hashFork, block.GetHash());
+        if (!fFastRelayBlock)
+        {
+            pNetChannel->BroadcastBlockInv(updateBlockChain.hashFork, block.GetHash());
+        }
         pDataStat->AddP2pSynSendStatData(updateBlockChain.hashFork, 1, block.vtx.size());
     }
 
@@ -240,6 +270,105 @@ Errno CDispatcher::AddNewBlock(const CBlock& block, uint64 nNonce)
     return OK;
 }
 
+Errno CDispatcher::AddRecoveryBlock(const CBlock& block, const bool fTrustSignature)
+{
+    Errno err = OK;
+    if (!pBlockChain->Exists(block.hashPrev))
+    {
+        StdError("CDispatcher", "AddRecoveryBlock: prev block not exist, block: %s, prev: %s", block.GetHash().GetHex().c_str(), block.hashPrev.GetHex().c_str());
+        return ERR_MISSING_PREV;
+    }
+
+    CBlockChainUpdate updateBlockChain;
+    if (!block.IsOrigin())
+    {
+        err = pBlockChain->AddNewBlock(block, updateBlockChain, fTrustSignature);
+    }
+    else
+    {
+        err = pBlockChain->AddNewOrigin(block, updateBlockChain);
+    }
+
+    if (err != OK || updateBlockChain.IsNull())
+    {
+        return err;
+    }
+
+    // txpool, network and service are synchronized by CompleteRecovery
+    if (block.IsPrimary() && updateBlockChain.hashLastBlock != 0)
+    {
+        pForkManager->SetPrimaryLastBlock(updateBlockChain.hashLastBlock);
+    }
+
+    if (!block.IsVacant())
+    {
+        vector<uint256> vActive, vDeactive;
+        pForkManager->ForkUpdate(updateBlockChain, vActive, vDeactive);
+
+        for (const uint256& hashFork : vActive)
+        {
+            ActivateFork(hashFork, 0);
+        }
+
+        for (const uint256& hashFork : vDeactive)
+        {
+            pNetChannel->UnsubscribeFork(hashFork);
+        }
+    }
+
+    if (block.IsPrimary())
+    {
+        CDelegateRoutine routineDelegate;
+        pConsensus->PrimaryUpdate(updateBlockChain, CTxSetChange(), routineDelegate);
+    }
+
+    return OK;
+}
+
+void CDispatcher::CompleteRecovery()
+{
+    map<uint256, CForkStatus> mapForkStatus;
+    pBlockChain->GetForkStatus(mapForkStatus);
+
+    for (const auto& kv : mapForkStatus)
+    {
+        const CForkStatus& status = kv.second;
+
+        CBlockChainUpdate updateBlockChain;
+        updateBlockChain.hashFork = kv.first;
+        updateBlockChain.hashParent = status.hashParent;
+        updateBlockChain.nOriginHeight = status.nOriginHeight;
+        updateBlockChain.nForkType = status.nForkType;
+        updateBlockChain.hashPrevBlock = status.hashPrevBlock;
+        updateBlockChain.hashLastBlock = status.hashLastBlock;
+        updateBlockChain.nLastBlockTime = status.nLastBlockTime;
+        updateBlockChain.nLastBlockHeight = status.nLastBlockHeight;
+        updateBlockChain.nLastMintType = status.nMintType;
+        updateBlockChain.nMoneySupply = status.nMoneySupply;
+        updateBlockChain.nMoneyDestroy = status.nMoneyDestroy;
+
+        CTxSetChange changeTxSet;
+        if (!pTxPool->SynchronizeBlockChain(updateBlockChain, changeTxSet))
+        {
+            StdError("CDispatcher", "CompleteRecovery: TxPool SynchronizeBlockChain fail, fork: %s", kv.first.GetHex().c_str());
+            continue;
+        }
+
+        pNetChannel->BroadcastBlockInv(kv.first, status.hashLastBlock);
+        pService->NotifyBlockChainUpdate(updateBlockChain);
+    }
+
+    // the delegated channel is skipped by AddRecoveryBlock, it is updated from the consensus data as at start up
+    CDelegateRoutine routine;
+    int nStartHeight = 0;
+    if (pConsensus->LoadConsensusData(nStartHeight, routine) && !routine.vEnrolledWeight.empty())
+    {
+        pDelegatedChannel->PrimaryUpdate(nStartHeight - 1,
+                                         routine.vEnrolledWeight, routine.vDistributeData,
+                                         routine.mapPublishData, routine.hashDistributeOfPublish);
+    }
+}
+
 Errno CDispatcher::AddNewTx(const CTransaction& tx, uint64 nNonce)
 {
     Errno err = OK;
@@ -275,6 +404,7 @@ Errno CDispatcher::AddNewTx(const CTransaction& tx, uint64 nNonce)
     updateTransaction.hashFork = hashFork;
     updateTransaction.txUpdate = tx;
     updateTransaction.nChange = assembledTx.GetChange();
+    updateTransaction.destIn = destIn;
     pService->NotifyTransactionUpdate(updateTransaction);
 
     if (!nNonce)
@@ -290,6 +420,74 @@ Errno CDispatcher::AddNewTx(const CTransaction& tx, uint64 nNonce)
     return OK;
 }
 
+Errno CDispatcher::AddNewTxBatch(const vector<CTransaction>& vTx, size_t& nAdded)
+{
+    nAdded = 0;
+    CBlockStatus status;
+    if (!pBlockChain->GetLastBlockStatus(pCoreProtocol->GetGenesisBlockHash(), status))
+    {
+        StdError("CDispatcher", "AddNewTxBatch: GetLastBlock fail, fork: %s", pCoreProtocol->GetGenesisBlockHash().GetHex().c_str());
+        return ERR_NOT_FOUND;
+    }
+
+    Errno errValidate = OK;
+    size_t nValid = 0;
+    for (; nValid < vTx.size(); nValid++)
+    {
+        errValidate = pCoreProtocol->ValidateTransaction(vTx[nValid], status.nBlockHeight);
+        if (errValidate != OK)
+        {
+            StdError("CDispatcher", "AddNewTxBatch: ValidateTransaction fail, txid: %s", vTx[nValid].GetHash().GetHex().c_str());
+            break;
+        }
+    }
+    if (nValid == 0)
+    {
+        return errValidate;
+    }
+
+    vector<CTransaction> vTxValid(vTx.begin(), vTx.begin() + nValid);
+    uint256 hashFork;
+    vector<pair<CDestination, int64>> vTxIn;
+    Errno errPush = pTxPool->PushBatch(vTxValid, hashFork, vTxIn);
+    if (errPush != OK)
+    {
+        StdError("CDispatcher", "AddNewTxBatch: TxPool PushBatch fail, pushed: %lu, txid: %s",
+                 vTxIn.size(), vTxValid[vTxIn.size()].GetHash().GetHex().c_str());
+    }
+
+    for (size_t i = 0; i < vTxIn.size(); i++)
+    {
+        const CTransaction& tx = vTxValid[i];
+        const CDestination& destIn = vTxIn[i].first;
+        int64 nValueIn = vTxIn[i].second;
+
+        pDataStat->AddP2pSynTxSynStatData(hashFork, false);
+
+        CAssembledTx assembledTx(tx, -1, destIn, nValueIn);
+
+        CTransactionUpdate updateTransaction;
+        updateTransaction.hashFork = hashFork;
+        updateTransaction.txUpdate = tx;
+        updateTransaction.nChange = assembledTx.GetChange();
+        updateTransaction.destIn = destIn;
+        pService->NotifyTransactionUpdate(updateTransaction);
+
+        if (hashFork == pCoreProtocol->GetGenesisBlockHash())
+        {
+            pConsensus->AddNewTx(assembledTx);
+        }
+    }
+    nAdded = vTxIn.size();
+
+    if (nAdded > 0)
+    {
+        pNetChannel->BroadcastTxInv(hashFork);
+    }
+
+    return (errPush != OK ? errPush : errValidate);
+}
+
 bool CDispatcher::AddNewDistribute(const uint256& hashAnchor, const CDestination& dest, const vector<unsigned char>& vchDistribute)
 {
     return pConsensus->AddNewDistribute(hashAnchor, dest, vchDistribute);
@@ -345,6 +543,24 @@ bool CDispatcher::FetchAddressUnspent(const uint256& hashFork, const CDestinatio
     return true;
 }
 
+bool CDispatcher::FetchAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary)
+{
+    uint256 hashLastBlock;
+    if (!pBlockChain->GetAddressUnspentSummary(hashFork, dest, summary, hashLastBlock))
+    {
+        StdLog("CDispatcher", "Fetch address unspent summary: Get address unspent summary fail, fork: %s, dest: %s",
+               hashFork.GetHex().c_str(), CAddress(dest).ToString().c_str());
+        return false;
+    }
+    if (!pTxPool->GetTxpoolAddressUnspentSummary(hashFork, dest, hashLastBlock, summary))
+    {
+        StdLog("CDispatcher", "Fetch address unspent summary: Get txpool address unspent summary fail, fork: %s, dest: %s",
+               hashFork.GetHex().c_str(), CAddress(dest).ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
 ////////////////////////////////
 void CDispatcher::UpdatePrimaryBlock(const CBlock& block, const CBlockChainUpdate& updateBlockChain, const CTxSetChange& changeTxSet, const uint64& nNonce)
 {
@@ -17,7 +17,10 @@ public:
     CDispatcher();
     ~CDispatcher();
     Errno AddNewBlock(const CBlock& block, uint64 nNonce = 0) override;
+    Errno AddRecoveryBlock(const CBlock& block, const bool fTrustSignature) override;
+    void CompleteRecovery() override;
     Errno AddNewTx(const CTransaction& tx, uint64 nNonce = 0) override;
+    Errno AddNewTxBatch(const std::vector<CTransaction>& vTx, std::size_t& nAdded) override;
     bool AddNewDistribute(const uint256& hashAnchor, const CDestination& dest,
                           const std::vector<unsigned char>& vchDistribute) override;
     bool AddNewPublish(const uint256& hashAnchor, const CDestination& dest,
@@ -25,6 +28,7 @@ public:
     void SetConsensus(const CAgreementBlock& agreeBlock) override;
     void CheckAllSubForkLastBlock() override;
     bool FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) override;
+    bool FetchAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary) override;
 
 protected:
     bool HandleInitialize() override;
@@ -48,6 +52,7 @@ protected:
     network::IDelegatedChannel* pDelegatedChannel;
     IDataStat* pDataStat;
     std::string strCmd;
+    bool fFastRelay;
 };
 
 } // namespace ibrio
@@ -158,12 +158,30 @@ bool CBbEntry::Initialize(int argc, char* argv[])
         return false;
     }
 
+    // rebuild address indexes
+    if (config.GetModeType() == EModeType::MODE_SERVER && config.GetConfig()->fReindexAddress)
+    {
+        int64 nMaxBlockRewardTxCount = CBlockChain::GetBlockInvestRewardTxMaxCount();
+        CCheckRepairData reindex(pathData.string(), config.GetConfig()->fTestNet, true, config.GetConfig()->fAddrTxIndex, nMaxBlockRewardTxCount,
+                                 (uint32)std::max(config.GetConfig()->nCheckThreads, 0));
+        if (!reindex.ReindexAddressData())
+        {
+            StdError("Ibrio", "Reindex address fail.");
+        }
+        else
+        {
+            StdLog("Ibrio", "Reindex address complete.");
+        }
+        return false;
+    }
+
     // check and repair data
     if (config.GetModeType() == EModeType::MODE_SERVER
         && (config.GetConfig()->fCheckRepair || config.GetConfig()->fOnlyCheck))
     {
         int64 nMaxBlockRewardTxCount = CBlockChain::GetBlockInvestRewardTxMaxCount();
-        CCheckRepairData check(pathData.string(), config.GetConfig()->fTestNet, config.GetConfig()->fOnlyCheck, config.GetConfig()->fAddrTxIndex, nMaxBlockRewardTxCount);
+        CCheckRepairData check(pathData.string(), config.GetConfig()->fTestNet, config.GetConfig()->fOnlyCheck, config.GetConfig()->fAddrTxIndex, nMaxBlockRewardTxCount,
+                               (uint32)std::max(config.GetConfig()->nCheckThreads, 0));
         if (!check.CheckRepairData())
         {
             if (config.GetConfig()->fOnlyCheck)
@@ -420,7 +438,7 @@ CHttpHostConfig CBbEntry::GetRPCHostConfig()
         mapUsrRPC[pConfig->strRPCUser] = pConfig->strRPCPass;
     }
 
-    return CHttpHostConfig(pConfig->epRPC, pConfig->nRPCMaxConnections, sslRPC, mapUsrRPC,
+    return CHttpHostConfig(pConfig->epRPC, pConfig->nRPCMaxConnections, pConfig->nRPCMaxPipeline, sslRPC, mapUsrRPC,
                            pConfig->vRPCAllowIP, "rpcmod");
 }
 
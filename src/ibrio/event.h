@@ -25,7 +25,8 @@ enum
     EVENT_BLOCKMAKER_ENROLL,
     EVENT_BLOCKMAKER_DISTRIBUTE,
     EVENT_BLOCKMAKER_PUBLISH,
-    EVENT_BLOCKMAKER_AGREE
+    EVENT_BLOCKMAKER_AGREE,
+    EVENT_RPCMOD_SUBSCRIBE
 };
 
 class CBlockMakerEventListener;
@@ -43,6 +44,19 @@ public:
     DECLARE_EVENTHANDLER(CEventBlockMakerAgree);
 };
 
+class CRPCModEventListener;
+#define TYPE_RPCMODEVENT(type, body) \
+    xengine::CEventCategory<type, CRPCModEventListener, body, CNil>
+
+typedef TYPE_RPCMODEVENT(EVENT_RPCMOD_SUBSCRIBE, CSubscribeUpdate) CEventRPCModSubscribe;
+
+class CRPCModEventListener : virtual public xengine::CEventListener
+{
+public:
+    virtual ~CRPCModEventListener() {}
+    DECLARE_EVENTHANDLER(CEventRPCModSubscribe);
+};
+
 } // namespace ibrio
 
 #endif //IBRIO_EVENT_H
@@ -15,7 +15,10 @@
 #define DEFAULT_RPCPORT 6602
 #define DEFAULT_TESTNET_RPCPORT 6604
 #define DEFAULT_RPC_MAX_CONNECTIONS 30
+#define DEFAULT_RPC_MAX_PIPELINE 16
 #define DEFAULT_RPC_CONNECT_TIMEOUT 600 //120
+#define DEFAULT_RPC_CACHE_DEPTH 30
+#define DEFAULT_RPC_CACHE_SIZE 64
 
 // network config
 #define DEFAULT_P2PPORT 6601
@@ -51,6 +51,12 @@ bool CNetworkConfig::PostLoad()
         nConnectTimeout = 1;
     }
 
+    nNetWorkerThreads = nNetThreads;
+    if (nNetWorkerThreads == 0)
+    {
+        nNetWorkerThreads = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+
     return true;
 }
 
@@ -61,6 +67,7 @@ std::string CNetworkConfig::ListConfig() const
     oss << "port: " << nPort << "\n";
     oss << "maxOutBounds: " << nMaxOutBounds << "\n";
     oss << "maxInBounds: " << nMaxInBounds << "\n";
+    oss << "netWorkerThreads: " << nNetWorkerThreads << "\n";
     oss << "dnseed: ";
     for (auto& s : vDNSeed)
     {
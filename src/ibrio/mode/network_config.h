@@ -25,6 +25,7 @@ public:
     unsigned short nPort;
     unsigned int nMaxInBounds;
     unsigned int nMaxOutBounds;
+    unsigned int nNetWorkerThreads;
 };
 
 } // namespace ibrio
@@ -130,6 +130,63 @@ bool CNetChannelPeer::MakeTxInv(const uint256& hashFork, const vector<uint256>&
     return true;
 }
 
+//////////////////////////////
+// CRawBlockCache
+
+std::shared_ptr<const network::CEventPeerRawPayload> CRawBlockCache::Get(const uint256& hashBlock, uint32& nTimeStamp)
+{
+    boost::unique_lock<boost::mutex> lock(mtxCache);
+    map<uint256, CRawBlockEntry>::iterator it = mapBlock.find(hashBlock);
+    if (it == mapBlock.end())
+    {
+        return nullptr;
+    }
+    lstLru.splice(lstLru.end(), lstLru, it->second.itLru);
+    nTimeStamp = it->second.nTimeStamp;
+    return it->second.spPayload;
+}
+
+void CRawBlockCache::Add(const uint256& hashBlock, uint32 nTimeStamp, std::shared_ptr<const network::CEventPeerRawPayload> spPayload)
+{
+    boost::unique_lock<boost::mutex> lock(mtxCache);
+    if (mapBlock.count(hashBlock) || spPayload->vchPayload.size() > nMaxSize)
+    {
+        return;
+    }
+    while (nSize + spPayload->vchPayload.size() > nMaxSize && !lstLru.empty())
+    {
+        map<uint256, CRawBlockEntry>::iterator it = mapBlock.find(lstLru.front());
+        nSize -= it->second.spPayload->vchPayload.size();
+        mapBlock.erase(it);
+        lstLru.pop_front();
+    }
+    CRawBlockEntry& entry = mapBlock[hashBlock];
+    entry.spPayload = spPayload;
+    entry.nTimeStamp = nTimeStamp;
+    entry.itLru = lstLru.insert(lstLru.end(), hashBlock);
+    nSize += spPayload->vchPayload.size();
+}
+
+void CRawBlockCache::Remove(const uint256& hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mtxCache);
+    map<uint256, CRawBlockEntry>::iterator it = mapBlock.find(hashBlock);
+    if (it != mapBlock.end())
+    {
+        nSize -= it->second.spPayload->vchPayload.size();
+        lstLru.erase(it->second.itLru);
+        mapBlock.erase(it);
+    }
+}
+
+void CRawBlockCache::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mtxCache);
+    mapBlock.clear();
+    lstLru.clear();
+    nSize = 0;
+}
+
 //////////////////////////////
 // CNetChannel
 
@@ -216,6 +273,12 @@ void CNetChannel::HandleDeinitialize()
     pDispatcher = nullptr;
     pConsensus = nullptr;
     pForkManager = nullptr;
+
+    rawBlockCache.Clear();
+    {
+        boost::unique_lock<boost::mutex> lock(mtxRelayBlock);
+        mapRelayBlock.clear();
+    }
 }
 
 bool CNetChannel::HandleInvoke()
@@ -231,6 +294,20 @@ bool CNetChannel::HandleInvoke()
         StdError("NetChannel", "HandleInvoke: ForkUpdate SetTimer fail");
         return false;
     }
+
+    size_t nRefBlockThreads = std::min((size_t)MAX_REF_NEXT_BLOCK_THREADS, (size_t)boost::thread::hardware_concurrency());
+    ioRefBlock.reset();
+    spRefBlockGuard.reset(new boost::asio::io_service::work(ioRefBlock));
+    for (size_t i = 0; i < nRefBlockThreads; i++)
+    {
+        std::shared_ptr<CThread> spThread(new CThread(GetOwnKey() + "-refblock", boost::bind(&CNetChannel::RefBlockThreadFunc, this)));
+        if (!ThreadStart(*spThread))
+        {
+            StdError("NetChannel", "HandleInvoke: start ref block thread fail");
+            return false;
+        }
+        vThrRefBlock.push_back(spThread);
+    }
     return network::INetChannel::HandleInvoke();
 }
 
@@ -254,12 +331,26 @@ void CNetChannel::HandleHalt()
     }
 
     network::INetChannel::HandleHalt();
+
+    spRefBlockGuard.reset();
+    ioRefBlock.stop();
+    for (std::shared_ptr<CThread>& spThread : vThrRefBlock)
+    {
+        ThreadExit(*spThread);
+    }
+    vThrRefBlock.clear();
+
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        boost::unique_lock<boost::shared_mutex> wlock(rwSched);
         mapSched.clear();
     }
 }
 
+void CNetChannel::RefBlockThreadFunc()
+{
+    ioRefBlock.run();
+}
+
 int CNetChannel::GetPrimaryChainHeight()
 {
     CBlockStatus status;
@@ -282,8 +373,9 @@ void CNetChannel::BroadcastBlockInv(const uint256& hashFork, const uint256& hash
     set<uint64> setKnownPeer;
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        CSchedule& sched = GetSchedule(hashFork);
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        CSchedule& sched = spSched->sched;
         sched.GetKnownPeer(network::CInv(network::CInv::MSG_BLOCK, hashBlock), setKnownPeer);
     }
     catch (exception& e)
@@ -292,19 +384,38 @@ void CNetChannel::BroadcastBlockInv(const uint256& hashFork, const uint256& hash
         return;
     }
 
-    network::CEventPeerInv eventInv(0, hashFork);
-    eventInv.data.push_back(network::CInv(network::CInv::MSG_BLOCK, hashBlock));
+    DispatchBlockInv(hashFork, hashBlock, setKnownPeer);
+}
+
+void CNetChannel::RelayVerifiedBlock(const uint256& hashFork, const CBlock& block, uint64 nNonce)
+{
+    const uint256 hashBlock = block.GetHash();
     {
-        boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
-        for (map<uint64, CNetChannelPeer>::iterator it = mapPeer.begin(); it != mapPeer.end(); ++it)
+        boost::unique_lock<boost::mutex> lock(mtxRelayBlock);
+        mapRelayBlock[hashBlock] = make_pair(block, nNonce);
+    }
+    BroadcastBlockInv(hashFork, hashBlock);
+}
+
+void CNetChannel::CompleteRelayedBlock(const uint256& hashBlock, bool fValid)
+{
+    uint64 nNonce = 0;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxRelayBlock);
+        map<uint256, pair<CBlock, uint64>>::iterator it = mapRelayBlock.find(hashBlock);
+        if (it == mapRelayBlock.end())
         {
-            uint64 nNonce = (*it).first;
-            if (!setKnownPeer.count(nNonce) && (*it).second.IsSubscribed(hashFork))
-            {
-                eventInv.nNonce = nNonce;
-                pPeerNet->DispatchEvent(&eventInv);
-            }
+            return;
         }
+        nNonce = it->second.second;
+        mapRelayBlock.erase(it);
+    }
+    if (!fValid)
+    {
+        rawBlockCache.Remove(hashBlock);
+        StdLog("NetChannel", "CompleteRelayedBlock: relayed block fails validation, peer: %s, block: %s",
+               GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str());
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "CompleteRelayedBlock");
     }
 }
 
@@ -341,12 +452,12 @@ void CNetChannel::SubscribeFork(const uint256& hashFork, const uint64& nNonce)
     }
 
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        boost::unique_lock<boost::shared_mutex> wlock(rwSched);
         if (mapSched.count(hashFork) > 0)
         {
             return;
         }
-        if (!mapSched.insert(make_pair(hashFork, CSchedule())).second)
+        if (!mapSched.insert(make_pair(hashFork, CNetSchedulePtr(new CNetSchedule()))).second)
         {
             StdLog("NetChannel", "SubscribeFork: mapSched insert fail, hashFork: %s", hashFork.GetHex().c_str());
             return;
@@ -368,10 +479,18 @@ void CNetChannel::SubscribeFork(const uint256& hashFork, const uint64& nNonce)
     }
     if (!vPeerNonce.empty())
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        for (const uint64& nPeer : vPeerNonce)
+        try
         {
-            DispatchGetBlocksEvent(nPeer, hashFork);
+            CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+            boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+            for (const uint64& nPeer : vPeerNonce)
+            {
+                DispatchGetBlocksEvent(nPeer, hashFork);
+            }
+        }
+        catch (exception& e)
+        {
+            StdError("NetChannel", "SubscribeFork: GetNetSchedule fail, error: %s", e.what());
         }
     }
     BroadcastTxInv(hashFork);
@@ -380,7 +499,7 @@ void CNetChannel::SubscribeFork(const uint256& hashFork, const uint64& nNonce)
 void CNetChannel::UnsubscribeFork(const uint256& hashFork)
 {
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        boost::unique_lock<boost::shared_mutex> wlock(rwSched);
         if (mapSched.count(hashFork) == 0)
         {
             return;
@@ -409,12 +528,12 @@ bool CNetChannel::SubmitCachePowBlock(const CConsensusParam& consParam)
 {
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-
         uint256 hashFork = pCoreProtocol->GetGenesisBlockHash();
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
 
         vector<std::pair<uint256, int>> vPowBlockHash;
-        GetSchedule(hashFork).GetSubmitCachePowBlock(consParam, vPowBlockHash);
+        spSched->sched.GetSubmitCachePowBlock(consParam, vPowBlockHash);
         StdDebug("NetChannel", "Submit cache pow block: pow block count: %lu, ispow: %s, ret: %s, prev height: %d, wait time: %ld, prev block: %s",
                  vPowBlockHash.size(), (consParam.fPow ? "true" : "false"), (consParam.ret ? "true" : "false"),
                  consParam.nPrevHeight, consParam.nWaitTime, consParam.hashPrev.GetHex().c_str());
@@ -423,7 +542,7 @@ bool CNetChannel::SubmitCachePowBlock(const CConsensusParam& consParam)
         set<uint64> setMisbehavePeer;
         for (auto& chash : vPowBlockHash)
         {
-            CSchedule& sched = GetSchedule(hashFork); // Resolve unsubscribefork errors
+            CSchedule& sched = spSched->sched;
             const uint256& hashBlock = chash.first;
             if (chash.second == CSchedule::CACHE_POW_BLOCK_TYPE_REMOTE)
             {
@@ -485,7 +604,7 @@ bool CNetChannel::SubmitCachePowBlock(const CConsensusParam& consParam)
                             StdLog("NetChannel", "SubmitCachePowBlock: add local pow block success, block: %s", hashBlock.GetHex().c_str());
                         }
                     }
-                    GetSchedule(hashFork).RemoveCacheLocalPowBlock(hashBlock); // Resolve unsubscribefork errors
+                    sched.RemoveCacheLocalPowBlock(hashBlock);
                 }
                 else
                 {
@@ -514,8 +633,9 @@ bool CNetChannel::IsLocalCachePowBlock(int nHeight, bool& fIsDpos)
     bool ret = false;
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        CSchedule& sched = GetSchedule(pCoreProtocol->GetGenesisBlockHash());
+        CNetSchedulePtr spSched = GetNetSchedule(pCoreProtocol->GetGenesisBlockHash());
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        CSchedule& sched = spSched->sched;
         ret = sched.CheckCacheLocalPowBlock(nHeight);
         if (!ret)
         {
@@ -555,8 +675,9 @@ bool CNetChannel::AddCacheLocalPowBlock(const CBlock& block)
     bool ret = false;
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        CSchedule& sched = GetSchedule(pCoreProtocol->GetGenesisBlockHash());
+        CNetSchedulePtr spSched = GetNetSchedule(pCoreProtocol->GetGenesisBlockHash());
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        CSchedule& sched = spSched->sched;
 
         bool fLongChain = false;
         if (pBlockChain->VerifyPowBlock(block, fLongChain) != OK)
@@ -600,16 +721,22 @@ bool CNetChannel::HandleEvent(network::CEventPeerActive& eventActive)
     StdLog("NetChannel", "CEventPeerActive: peer: %s", GetPeerAddressInfo(nNonce).c_str());
     if ((eventActive.data.nService & network::NODE_NETWORK))
     {
+        try
         {
-            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            CNetSchedulePtr spSched = GetNetSchedule(pCoreProtocol->GetGenesisBlockHash());
+            boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
             DispatchGetBlocksEvent(nNonce, pCoreProtocol->GetGenesisBlockHash());
         }
+        catch (exception& e)
+        {
+            StdError("NetChannel", "CEventPeerActive: GetNetSchedule fail, error: %s", e.what());
+        }
         BroadcastTxInv(pCoreProtocol->GetGenesisBlockHash());
 
         network::CEventPeerSubscribe eventSubscribe(nNonce, pCoreProtocol->GetGenesisBlockHash());
         {
-            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-            for (map<uint256, CSchedule>::iterator it = mapSched.begin(); it != mapSched.end(); ++it)
+            boost::shared_lock<boost::shared_mutex> rlock(rwSched);
+            for (map<uint256, CNetSchedulePtr>::iterator it = mapSched.begin(); it != mapSched.end(); ++it)
             {
                 if ((*it).first != pCoreProtocol->GetGenesisBlockHash())
                 {
@@ -631,16 +758,18 @@ bool CNetChannel::HandleEvent(network::CEventPeerDeactive& eventDeactive)
     uint64 nNonce = eventDeactive.nNonce;
     StdLog("NetChannel", "CEventPeerDeactive: peer: %s", GetPeerAddressInfo(nNonce).c_str());
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        for (map<uint256, CSchedule>::iterator it = mapSched.begin(); it != mapSched.end(); ++it)
+        vector<pair<uint256, CNetSchedulePtr>> vNetSched;
+        ListNetSchedule(vNetSched);
+        for (const auto& vd : vNetSched)
         {
-            CSchedule& sched = (*it).second;
+            boost::recursive_mutex::scoped_lock scoped_lock(vd.second->mtxSched);
+            CSchedule& sched = vd.second->sched;
             set<uint64> setSchedPeer;
             sched.RemovePeer(nNonce, setSchedPeer);
 
             for (const uint64 nNonceSched : setSchedPeer)
             {
-                SchedulePeerInv(nNonceSched, (*it).first, sched);
+                SchedulePeerInv(nNonceSched, vd.first, sched);
             }
         }
     }
@@ -657,6 +786,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerDeactive& eventDeactive)
             mapPeer.erase(nNonce);
         }
     }
+    RemoveCompactBlock(nNonce);
     NotifyPeerUpdate(nNonce, false, eventDeactive.data);
 
     return true;
@@ -685,12 +815,14 @@ bool CNetChannel::HandleEvent(network::CEventPeerSubscribe& eventSubscribe)
         }
         if (!vDispatchHash.empty())
         {
-            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-            for (const uint256& hash : vDispatchHash)
+            vector<pair<uint256, CNetSchedulePtr>> vNetSched;
+            ListNetSchedule(vNetSched);
+            for (const auto& vd : vNetSched)
             {
-                if (mapSched.count(hash))
+                if (count(vDispatchHash.begin(), vDispatchHash.end(), vd.first))
                 {
-                    DispatchGetBlocksEvent(nNonce, hash);
+                    boost::recursive_mutex::scoped_lock scoped_lock(vd.second->mtxSched);
+                    DispatchGetBlocksEvent(nNonce, vd.first);
                 }
             }
         }
@@ -740,8 +872,9 @@ bool CNetChannel::HandleEvent(network::CEventPeerInv& eventInv)
         }
 
         {
-            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-            CSchedule& sched = GetSchedule(hashFork);
+            CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+            boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+            CSchedule& sched = spSched->sched;
 
             vector<uint256> vTxHash;
             int64 nBlockInvAddCount = 0;
@@ -905,31 +1038,17 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetData& eventGetData)
         else if (inv.nType == network::CInv::MSG_BLOCK)
         {
             bool fGetRet = false;
-            network::CEventPeerBlock eventBlock(nNonce, hashFork);
-            if (hashFork == pCoreProtocol->GetGenesisBlockHash())
+            try
             {
-                try
-                {
-                    boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-                    CSchedule& sched = GetSchedule(hashFork);
-                    if (sched.GetCachePowBlock(inv.nHash, eventBlock.data))
-                    {
-                        fGetRet = true;
-                    }
-                }
-                catch (exception& e)
-                {
-                    DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetData: ") + e.what());
-                    return true;
-                }
+                fGetRet = SendPeerBlock(nNonce, hashFork, inv.nHash);
             }
-            if (!fGetRet && pBlockChain->GetBlock(inv.nHash, eventBlock.data))
+            catch (exception& e)
             {
-                fGetRet = true;
+                DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetData: ") + e.what());
+                return true;
             }
             if (fGetRet)
             {
-                pPeerNet->DispatchEvent(&eventBlock);
                 StdTrace("NetChannel", "CEventPeerGetData: get block success, peer: %s, height: %d, block: %s",
                          GetPeerAddressInfo(nNonce).c_str(), CBlock::GetBlockHeightByHash(inv.nHash), inv.nHash.GetHex().c_str());
             }
@@ -1025,10 +1144,11 @@ bool CNetChannel::HandleEvent(network::CEventPeerTx& eventTx)
 
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
 
         set<uint64> setSchedPeer, setMisbehavePeer;
-        CSchedule& sched = GetSchedule(hashFork);
+        CSchedule& sched = spSched->sched;
 
         if (!sched.ReceiveTx(nNonce, txid, tx, setSchedPeer))
         {
@@ -1077,9 +1197,10 @@ bool CNetChannel::HandleEvent(network::CEventPeerBlock& eventBlock)
     uint32 nBlockHeight = block.GetBlockHeight();
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
         set<uint64> setSchedPeer, setMisbehavePeer;
-        CSchedule& sched = GetSchedule(hashFork);
+        CSchedule& sched = spSched->sched;
 
         if (!sched.ReceiveBlock(nNonce, hash, block, setSchedPeer))
         {
@@ -1189,14 +1310,19 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetFail& eventGetFail)
 
     try
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-        CSchedule& sched = GetSchedule(hashFork);
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        CSchedule& sched = spSched->sched;
 
         for (const network::CInv& inv : eventGetFail.data)
         {
             StdTrace("NetChannel", "CEventPeerGetFail: get data fail, peer: %s, inv: [%d] %s",
                      GetPeerAddressInfo(nNonce).c_str(), inv.nType, inv.nHash.GetHex().c_str());
             sched.CancelAssignedInv(nNonce, inv);
+            if (inv.nType == network::CInv::MSG_BLOCK)
+            {
+                RemoveCompactBlock(nNonce, inv.nHash);
+            }
         }
     }
     catch (exception& e)
@@ -1259,8 +1385,9 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
     {
         try
         {
-            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-            CSchedule& sched = GetSchedule(hashFork);
+            CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+            boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+            CSchedule& sched = spSched->sched;
 
             if (eventMsgRsp.data.nRspResult == MSGRSP_RESULT_GETBLOCKS_EMPTY)
             {
@@ -1303,9 +1430,208 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
     return true;
 }
 
-CSchedule& CNetChannel::GetSchedule(const uint256& hashFork)
+bool CNetChannel::HandleEvent(network::CEventPeerCmpctBlock& eventCmpctBlock)
 {
-    map<uint256, CSchedule>::iterator it = mapSched.find(hashFork);
+    uint64 nNonce = eventCmpctBlock.nNonce;
+    uint256& hashFork = eventCmpctBlock.hashFork;
+    network::CEventPeerCompactBlock& cmpct = eventCmpctBlock.data;
+    uint256 hash = cmpct.block.GetHash();
+
+    if (cmpct.GetTxCount() > network::CEventPeerCompactBlock::GetMaxTxCount())
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventCmpctBlock: tx count error");
+        return true;
+    }
+    try
+    {
+        // Compact block is only sent for a getdata, the block must be scheduled from this peer
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        if (!spSched->sched.IsAssignedBlock(nNonce, hash))
+        {
+            StdLog("NetChannel", "CEventPeerCmpctBlock: block is not requested, peer: %s, block: %s",
+                   GetPeerAddressInfo(nNonce).c_str(), hash.GetHex().c_str());
+            return true;
+        }
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventCmpctBlock: ") + e.what());
+        return true;
+    }
+
+    CCompactBlockPending pending;
+    pending.block = cmpct.block;
+    pending.block.vtx.resize(cmpct.GetTxCount());
+    pending.vPrefilled.resize(cmpct.GetTxCount(), false);
+    for (const pair<uint32, CTransaction>& prefilled : cmpct.vPrefilledTx)
+    {
+        if (prefilled.first >= pending.vPrefilled.size() || pending.vPrefilled[prefilled.first])
+        {
+            DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventCmpctBlock: prefilled tx index error");
+            return true;
+        }
+        pending.block.vtx[prefilled.first] = prefilled.second;
+        pending.vPrefilled[prefilled.first] = true;
+    }
+
+    if (!cmpct.vShortTxId.empty())
+    {
+        // Short id shared by more than one tx in pool is marked with zero txid
+        uint256 key = cmpct.GetShortTxIdKey();
+        map<uint64, uint256> mapShortTxId;
+        vector<uint256> vTxPool;
+        pTxPool->ListTx(hashFork, vTxPool);
+        for (const uint256& txid : vTxPool)
+        {
+            auto ret = mapShortTxId.insert(make_pair(network::CEventPeerCompactBlock::GetShortTxId(key, txid), txid));
+            if (!ret.second)
+            {
+                ret.first->second = 0;
+            }
+        }
+
+        size_t nShortTxId = 0;
+        for (size_t i = 0; i < pending.vPrefilled.size(); i++)
+        {
+            if (!pending.vPrefilled[i])
+            {
+                auto it = mapShortTxId.find(cmpct.vShortTxId[nShortTxId++]);
+                if (it == mapShortTxId.end() || it->second == 0 || !pTxPool->Get(it->second, pending.block.vtx[i]))
+                {
+                    pending.vTxIndex.push_back(i);
+                }
+            }
+        }
+    }
+
+    StdTrace("NetChannel", "CEventPeerCmpctBlock: peer: %s, block: %s, tx count: %lu, prefilled: %lu, missing: %lu",
+             GetPeerAddressInfo(nNonce).c_str(), hash.GetHex().c_str(), pending.block.vtx.size(),
+             cmpct.vPrefilledTx.size(), pending.vTxIndex.size());
+
+    if (pending.vTxIndex.empty())
+    {
+        if (pending.block.CalcMerkleTreeRoot() == pending.block.hashMerkle)
+        {
+            return ReceiveCompactBlock(nNonce, hashFork, pending.block);
+        }
+        // Short id collision, fetch all txs which are not prefilled
+        pending.fRequestAll = true;
+        for (size_t i = 0; i < pending.vPrefilled.size(); i++)
+        {
+            if (!pending.vPrefilled[i])
+            {
+                pending.vTxIndex.push_back(i);
+            }
+        }
+        if (pending.vTxIndex.empty())
+        {
+            DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventCmpctBlock: merkle root error");
+            return true;
+        }
+    }
+    RequestCompactBlockTx(nNonce, hashFork, hash, pending);
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    uint64 nNonce = eventGetBlockTxn.nNonce;
+    uint256& hashFork = eventGetBlockTxn.hashFork;
+    const uint256& hashBlock = eventGetBlockTxn.data.hashBlock;
+
+    CBlock block;
+    try
+    {
+        if (!GetPeerBlock(hashFork, hashBlock, block))
+        {
+            StdError("NetChannel", "CEventPeerGetBlockTxn: Get block fail, block hash: %s", hashBlock.GetHex().c_str());
+            network::CEventPeerGetFail eventGetFail(nNonce, hashFork);
+            eventGetFail.data.push_back(network::CInv(network::CInv::MSG_BLOCK, hashBlock));
+            pPeerNet->DispatchEvent(&eventGetFail);
+            return true;
+        }
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetBlockTxn: ") + e.what());
+        return true;
+    }
+
+    network::CEventPeerBlockTxn eventBlockTxn(nNonce, hashFork);
+    eventBlockTxn.data.hashBlock = hashBlock;
+    for (const uint32 nIndex : eventGetBlockTxn.data.vTxIndex)
+    {
+        if (nIndex >= block.vtx.size())
+        {
+            DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventGetBlockTxn: tx index error");
+            return true;
+        }
+        eventBlockTxn.data.vtx.push_back(block.vtx[nIndex]);
+    }
+    pPeerNet->DispatchEvent(&eventBlockTxn);
+    StdTrace("NetChannel", "CEventPeerGetBlockTxn: peer: %s, block: %s, tx count: %lu",
+             GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str(), eventBlockTxn.data.vtx.size());
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn)
+{
+    uint64 nNonce = eventBlockTxn.nNonce;
+    uint256& hashFork = eventBlockTxn.hashFork;
+    const uint256& hashBlock = eventBlockTxn.data.hashBlock;
+
+    CCompactBlockPending pending;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCmpctBlock);
+        auto it = mapCmpctBlock.find(make_pair(nNonce, hashBlock));
+        if (it == mapCmpctBlock.end())
+        {
+            StdLog("NetChannel", "CEventPeerBlockTxn: block is not requested, peer: %s, block: %s",
+                   GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str());
+            return true;
+        }
+        pending = it->second;
+        mapCmpctBlock.erase(it);
+    }
+
+    if (eventBlockTxn.data.vtx.size() != pending.vTxIndex.size())
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventBlockTxn: tx count error");
+        return true;
+    }
+    for (size_t i = 0; i < pending.vTxIndex.size(); i++)
+    {
+        pending.block.vtx[pending.vTxIndex[i]] = eventBlockTxn.data.vtx[i];
+    }
+    if (pending.block.CalcMerkleTreeRoot() == pending.block.hashMerkle)
+    {
+        return ReceiveCompactBlock(nNonce, hashFork, pending.block);
+    }
+    if (pending.fRequestAll)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "eventBlockTxn: merkle root error");
+        return true;
+    }
+
+    // Short id collision, fetch all txs which are not prefilled
+    pending.fRequestAll = true;
+    pending.vTxIndex.clear();
+    for (size_t i = 0; i < pending.vPrefilled.size(); i++)
+    {
+        if (!pending.vPrefilled[i])
+        {
+            pending.vTxIndex.push_back(i);
+        }
+    }
+    RequestCompactBlockTx(nNonce, hashFork, hashBlock, pending);
+    return true;
+}
+
+CNetSchedulePtr CNetChannel::GetNetSchedule(const uint256& hashFork)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwSched);
+    map<uint256, CNetSchedulePtr>::iterator it = mapSched.find(hashFork);
     if (it == mapSched.end())
     {
         throw runtime_error(string("Unknown fork for scheduling, hashFork: ") + hashFork.GetHex());
@@ -1313,6 +1639,17 @@ CSchedule& CNetChannel::GetSchedule(const uint256& hashFork)
     return ((*it).second);
 }
 
+void CNetChannel::ListNetSchedule(vector<pair<uint256, CNetSchedulePtr>>& vNetSched)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwSched);
+    vNetSched.assign(mapSched.begin(), mapSched.end());
+}
+
+CNetScheduleLock CNetChannel::GetSchedule(const uint256& hashFork)
+{
+    return CNetScheduleLock(GetNetSchedule(hashFork));
+}
+
 void CNetChannel::NotifyPeerUpdate(uint64 nNonce, bool fActive, const network::CAddress& addrPeer)
 {
     CNetworkPeerUpdate update;
@@ -1326,7 +1663,8 @@ void CNetChannel::DispatchGetBlocksEvent(uint64 nNonce, const uint256& hashFork)
 {
     try
     {
-        CSchedule& sched = GetSchedule(hashFork);
+        CNetScheduleLock lockSched = GetSchedule(hashFork);
+        CSchedule& sched = lockSched.Get();
         if (sched.CheckAddInvIdleLocation(nNonce, network::CInv::MSG_BLOCK))
         {
             uint256 hashDepth;
@@ -1392,7 +1730,7 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     network::CEventPeerGetData eventGetData(nNonce, hashFork);
     bool fMissingPrev = false;
     bool fEmpty = true;
-    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, 1, fMissingPrev, fEmpty))
+    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, CSchedule::MAX_PEER_BLOCK_INFLIGHT, fMissingPrev, fEmpty))
     {
         if (fMissingPrev)
         {
@@ -1828,21 +2166,38 @@ void CNetChannel::AddNewTx(const uint256& hashFork, const uint256& txid, CSchedu
 
 void CNetChannel::AddRefNextBlock(const vector<pair<uint256, uint256>>& vRefNextBlock)
 {
+    // Blocks of a fork are added in order, different forks are added concurrently
     set<uint256> setHash;
+    vector<pair<uint256, vector<uint256>>> vForkBlock;
+    map<uint256, size_t> mapForkIndex;
     for (int i = 0; i < vRefNextBlock.size(); i++)
     {
         const uint256& hashNextFork = vRefNextBlock[i].first;
         const uint256& hashNextBlock = vRefNextBlock[i].second;
-        if (setHash.find(hashNextBlock) == setHash.end())
+        if (setHash.insert(hashNextBlock).second)
         {
-            setHash.insert(hashNextBlock);
+            map<uint256, size_t>::iterator it = mapForkIndex.find(hashNextFork);
+            if (it == mapForkIndex.end())
+            {
+                it = mapForkIndex.insert(make_pair(hashNextFork, vForkBlock.size())).first;
+                vForkBlock.push_back(make_pair(hashNextFork, vector<uint256>()));
+            }
+            vForkBlock[it->second].second.push_back(hashNextBlock);
+        }
+    }
 
+    auto fnAddForkBlock = [&](const uint32 nIndex) {
+        const uint256& hashNextFork = vForkBlock[nIndex].first;
+        for (const uint256& hashNextBlock : vForkBlock[nIndex].second)
+        {
             StdDebug("NetChannel", "AddRefNextBlock: fork: %s, block: %s",
                      hashNextFork.GetHex().c_str(), hashNextBlock.GetHex().c_str());
 
             try
             {
-                CSchedule& sched = GetSchedule(hashNextFork);
+                CNetSchedulePtr spSched = GetNetSchedule(hashNextFork);
+                boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+                CSchedule& sched = spSched->sched;
 
                 set<uint64> setSchedPeer, setMisbehavePeer;
                 vector<pair<uint256, uint256>> vTemp;
@@ -1854,6 +2209,34 @@ void CNetChannel::AddRefNextBlock(const vector<pair<uint256, uint256>>& vRefNext
                          hashNextFork.GetHex().c_str(), hashNextBlock.GetHex().c_str(), e.what());
             }
         }
+    };
+
+    if (vForkBlock.size() <= 1 || vThrRefBlock.empty() || ioRefBlock.stopped())
+    {
+        for (uint32 i = 0; i < vForkBlock.size(); i++)
+        {
+            fnAddForkBlock(i);
+        }
+        return;
+    }
+
+    // each fork is one task on the ref block workers, wait until all forks are added
+    boost::mutex mtxDone;
+    boost::condition_variable condDone;
+    size_t nDone = 0;
+    for (uint32 i = 0; i < vForkBlock.size(); i++)
+    {
+        ioRefBlock.post([&, i]() {
+            fnAddForkBlock(i);
+            boost::unique_lock<boost::mutex> lock(mtxDone);
+            ++nDone;
+            condDone.notify_one();
+        });
+    }
+    boost::unique_lock<boost::mutex> lock(mtxDone);
+    while (nDone < vForkBlock.size())
+    {
+        condDone.wait(lock);
     }
 }
 
@@ -1861,7 +2244,8 @@ void CNetChannel::PostAddNew(const uint256& hashFork, set<uint64>& setSchedPeer,
 {
     try
     {
-        CSchedule& sched = GetSchedule(hashFork); // Resolve unsubscribefork errors
+        CNetScheduleLock lockSched = GetSchedule(hashFork);
+        CSchedule& sched = lockSched.Get();
         for (const uint64 nNonceSched : setSchedPeer)
         {
             if (!setMisbehavePeer.count(nNonceSched))
@@ -2029,7 +2413,7 @@ void CNetChannel::UpdateValidFork(const set<uint256>& setValidFork)
     vector<uint256> vSubscribeFork;
     vector<uint256> vUnsubscribeFork;
     {
-        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        boost::shared_lock<boost::shared_mutex> rlock(rwSched);
         for (auto& vd : mapSched)
         {
             if (setValidFork.count(vd.first) == 0)
@@ -2110,7 +2494,8 @@ void CNetChannel::InnerBroadcastBlockInv(const uint256& hashFork, const uint256&
     set<uint64> setKnownPeer;
     try
     {
-        CSchedule& sched = GetSchedule(hashFork);
+        CNetScheduleLock lockSched = GetSchedule(hashFork);
+        CSchedule& sched = lockSched.Get();
         sched.GetKnownPeer(network::CInv(network::CInv::MSG_BLOCK, hashBlock), setKnownPeer);
     }
     catch (exception& e)
@@ -2119,8 +2504,12 @@ void CNetChannel::InnerBroadcastBlockInv(const uint256& hashFork, const uint256&
         return;
     }
 
-    network::CEventPeerInv eventInv(0, hashFork);
-    eventInv.data.push_back(network::CInv(network::CInv::MSG_BLOCK, hashBlock));
+    DispatchBlockInv(hashFork, hashBlock, setKnownPeer);
+}
+
+void CNetChannel::DispatchBlockInv(const uint256& hashFork, const uint256& hashBlock, const set<uint64>& setKnownPeer)
+{
+    network::CEventPeerRawInv eventRawInv(0, hashFork);
     {
         boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
         for (map<uint64, CNetChannelPeer>::iterator it = mapPeer.begin(); it != mapPeer.end(); ++it)
@@ -2128,11 +2517,22 @@ void CNetChannel::InnerBroadcastBlockInv(const uint256& hashFork, const uint256&
             uint64 nNonce = (*it).first;
             if (!setKnownPeer.count(nNonce) && (*it).second.IsSubscribed(hashFork))
             {
-                eventInv.nNonce = nNonce;
-                pPeerNet->DispatchEvent(&eventInv);
+                eventRawInv.data.vNonce.push_back(nNonce);
             }
         }
     }
+    if (eventRawInv.data.vNonce.empty())
+    {
+        return;
+    }
+
+    vector<network::CInv> vInv;
+    vInv.push_back(network::CInv(network::CInv::MSG_BLOCK, hashBlock));
+    std::shared_ptr<network::CEventPeerRawPayload> spPayload(new network::CEventPeerRawPayload());
+    spPayload->SetPayload(hashFork, vInv);
+    eventRawInv.data.spPayload = spPayload;
+    eventRawInv.data.nPriority = network::CBbPeer::SEND_PRIORITY_HIGH;
+    pPeerNet->DispatchEvent(&eventRawInv);
 }
 
 void CNetChannel::InnerSubmitCachePowBlock()
@@ -2164,13 +2564,168 @@ void CNetChannel::InnerSubmitCachePowBlock()
 
 void CNetChannel::GetNextRefBlock(const uint256& hashRefBlock, vector<pair<uint256, uint256>>& vNext)
 {
-    for (auto it = mapSched.begin(); it != mapSched.end(); ++it)
+    vector<pair<uint256, CNetSchedulePtr>> vNetSched;
+    ListNetSchedule(vNetSched);
+    for (const auto& vd : vNetSched)
     {
-        if (it->first != pCoreProtocol->GetGenesisBlockHash())
+        if (vd.first != pCoreProtocol->GetGenesisBlockHash())
         {
-            it->second.GetNextRefBlock(hashRefBlock, vNext);
+            boost::recursive_mutex::scoped_lock scoped_lock(vd.second->mtxSched);
+            vd.second->sched.GetNextRefBlock(hashRefBlock, vNext);
         }
     }
 }
 
+bool CNetChannel::GetPeerBlock(const uint256& hashFork, const uint256& hashBlock, CBlock& block)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxRelayBlock);
+        map<uint256, pair<CBlock, uint64>>::iterator it = mapRelayBlock.find(hashBlock);
+        if (it != mapRelayBlock.end())
+        {
+            block = it->second.first;
+            return true;
+        }
+    }
+    if (hashFork == pCoreProtocol->GetGenesisBlockHash())
+    {
+        CNetSchedulePtr spSched = GetNetSchedule(hashFork);
+        boost::recursive_mutex::scoped_lock scoped_lock(spSched->mtxSched);
+        CSchedule& sched = spSched->sched;
+        if (sched.GetCachePowBlock(hashBlock, block))
+        {
+            return true;
+        }
+    }
+    return pBlockChain->GetBlock(hashBlock, block);
+}
+
+bool CNetChannel::IsCompactBlockSend(uint64 nPeerService, int64 nBlockTime, int64 nTime)
+{
+    return ((nPeerService & network::NODE_COMPACTBLOCK) && nBlockTime + MAX_COMPACT_BLOCK_AGE >= nTime);
+}
+
+bool CNetChannel::SendPeerBlock(uint64 nNonce, const uint256& hashFork, const uint256& hashBlock)
+{
+    // Serialized block and its checksum are shared by all peers, the block of a compact
+    // block is decoded from them and only read from the block chain if it is not cached
+    uint64 nPeerService = 0;
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+        map<uint64, CNetChannelPeer>::const_iterator it = mapPeer.find(nNonce);
+        if (it != mapPeer.end())
+        {
+            nPeerService = it->second.nService;
+        }
+    }
+    uint32 nTimeStamp = 0;
+    std::shared_ptr<const network::CEventPeerRawPayload> spPayload = rawBlockCache.Get(hashBlock, nTimeStamp);
+    if (!spPayload || IsCompactBlockSend(nPeerService, nTimeStamp, GetNetTime()))
+    {
+        CBlock block;
+        uint256 hashPayloadFork;
+        if (!spPayload || !spPayload->GetPayload(hashPayloadFork, block))
+        {
+            if (!GetPeerBlock(hashFork, hashBlock, block))
+            {
+                return false;
+            }
+        }
+        if (IsCompactBlockSend(nPeerService, block.GetBlockTime(), GetNetTime()) && SendCompactBlock(nNonce, hashFork, block))
+        {
+            return true;
+        }
+        if (!spPayload)
+        {
+            std::shared_ptr<network::CEventPeerRawPayload> spNewPayload(new network::CEventPeerRawPayload());
+            spNewPayload->SetPayload(hashFork, block);
+            rawBlockCache.Add(hashBlock, block.GetBlockTime(), spNewPayload);
+            spPayload = spNewPayload;
+        }
+    }
+    network::CEventPeerRawBlock eventRawBlock(nNonce, hashFork);
+    eventRawBlock.data = spPayload;
+    return pPeerNet->DispatchEvent(&eventRawBlock);
+}
+
+bool CNetChannel::SendCompactBlock(uint64 nNonce, const uint256& hashFork, const CBlock& block)
+{
+    if (block.vtx.empty())
+    {
+        return false;
+    }
+    network::CEventPeerCmpctBlock eventCmpctBlock(nNonce, hashFork);
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+        map<uint64, CNetChannelPeer>::const_iterator it = mapPeer.find(nNonce);
+        if (it == mapPeer.end() || !(it->second.nService & network::NODE_COMPACTBLOCK))
+        {
+            return false;
+        }
+        // Txs which are not known by the peer are prefilled
+        const CNetChannelPeer& peer = it->second;
+        eventCmpctBlock.data.SetBlock(block, crypto::CryptoGetRand64(),
+                                      [&](const uint256& txid) -> bool { return !peer.IsKnownTx(hashFork, txid); });
+    }
+    if (eventCmpctBlock.data.vShortTxId.empty())
+    {
+        return false;
+    }
+    pPeerNet->DispatchEvent(&eventCmpctBlock);
+    return true;
+}
+
+bool CNetChannel::RequestCompactBlockTx(uint64 nNonce, const uint256& hashFork, const uint256& hashBlock, CCompactBlockPending& pending)
+{
+    network::CEventPeerGetBlockTxn eventGetBlockTxn(nNonce, hashFork);
+    eventGetBlockTxn.data.hashBlock = hashBlock;
+    eventGetBlockTxn.data.vTxIndex = pending.vTxIndex;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCmpctBlock);
+        auto it = mapCmpctBlock.find(make_pair(nNonce, hashBlock));
+        if (it == mapCmpctBlock.end())
+        {
+            size_t nPeerCount = 0;
+            for (auto mt = mapCmpctBlock.lower_bound(make_pair(nNonce, uint256()));
+                 mt != mapCmpctBlock.end() && mt->first.first == nNonce; ++mt)
+            {
+                nPeerCount++;
+            }
+            if (nPeerCount >= MAX_PEER_CMPCT_BLOCK_COUNT || mapCmpctBlock.size() >= MAX_CMPCT_BLOCK_COUNT)
+            {
+                StdLog("NetChannel", "RequestCompactBlockTx: too many pending compact blocks, peer: %s, block: %s, peer count: %lu, total: %lu",
+                       GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str(), nPeerCount, mapCmpctBlock.size());
+                return false;
+            }
+            it = mapCmpctBlock.insert(make_pair(make_pair(nNonce, hashBlock), CCompactBlockPending())).first;
+        }
+        it->second = pending;
+    }
+    StdTrace("NetChannel", "RequestCompactBlockTx: peer: %s, block: %s, tx count: %lu, request all: %s",
+             GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str(), pending.vTxIndex.size(), (pending.fRequestAll ? "true" : "false"));
+    return pPeerNet->DispatchEvent(&eventGetBlockTxn);
+}
+
+bool CNetChannel::ReceiveCompactBlock(uint64 nNonce, const uint256& hashFork, const CBlock& block)
+{
+    network::CEventPeerBlock eventBlock(nNonce, hashFork);
+    eventBlock.data = block;
+    return HandleEvent(eventBlock);
+}
+
+void CNetChannel::RemoveCompactBlock(uint64 nNonce, const uint256& hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mtxCmpctBlock);
+    if (hashBlock != 0)
+    {
+        mapCmpctBlock.erase(make_pair(nNonce, hashBlock));
+        return;
+    }
+    auto it = mapCmpctBlock.lower_bound(make_pair(nNonce, uint256()));
+    while (it != mapCmpctBlock.end() && it->first.first == nNonce)
+    {
+        mapCmpctBlock.erase(it++);
+    }
+}
+
 } // namespace ibrio
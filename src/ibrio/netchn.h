@@ -177,6 +177,11 @@ public:
     {
         return (!!mapSubscribedFork.count(hashFork));
     }
+    bool IsKnownTx(const uint256& hashFork, const uint256& txid) const
+    {
+        std::map<uint256, CNetChannelPeerFork>::const_iterator it = mapSubscribedFork.find(hashFork);
+        return (it != mapSubscribedFork.end() && it->second.IsKnownTx(txid));
+    }
     void ResetTxInvSynStatus(const uint256& hashFork, bool fIsComplete)
     {
         std::map<uint256, CNetChannelPeerFork>::iterator it = mapSubscribedFork.find(hashFork);
@@ -241,6 +246,73 @@ public:
     std::map<uint256, CNetChannelPeerFork> mapSubscribedFork;
 };
 
+class CNetSchedule
+{
+public:
+    boost::recursive_mutex mtxSched;
+    CSchedule sched;
+};
+
+typedef std::shared_ptr<CNetSchedule> CNetSchedulePtr;
+
+class CNetScheduleLock
+{
+public:
+    CNetScheduleLock(const CNetSchedulePtr& spSchedIn)
+      : spSched(spSchedIn), lock(spSchedIn->mtxSched) {}
+    CSchedule& Get()
+    {
+        return spSched->sched;
+    }
+
+protected:
+    CNetSchedulePtr spSched;
+    boost::unique_lock<boost::recursive_mutex> lock;
+};
+
+class CCompactBlockPending
+{
+public:
+    CCompactBlockPending()
+      : fRequestAll(false) {}
+
+public:
+    CBlock block;
+    std::vector<bool> vPrefilled;
+    std::vector<uint32> vTxIndex;
+    bool fRequestAll;
+};
+
+class CRawBlockCache
+{
+    class CRawBlockEntry
+    {
+    public:
+        std::shared_ptr<const network::CEventPeerRawPayload> spPayload;
+        uint32 nTimeStamp;
+        std::list<uint256>::iterator itLru;
+    };
+
+public:
+    CRawBlockCache(std::size_t nMaxSizeIn = MAX_CACHE_SIZE)
+      : nMaxSize(nMaxSizeIn), nSize(0) {}
+    std::shared_ptr<const network::CEventPeerRawPayload> Get(const uint256& hashBlock, uint32& nTimeStamp);
+    void Add(const uint256& hashBlock, uint32 nTimeStamp, std::shared_ptr<const network::CEventPeerRawPayload> spPayload);
+    void Remove(const uint256& hashBlock);
+    void Clear();
+
+protected:
+    enum
+    {
+        MAX_CACHE_SIZE = 64 * 1024 * 1024
+    };
+    boost::mutex mtxCache;
+    std::size_t nMaxSize;
+    std::size_t nSize;
+    std::list<uint256> lstLru;
+    std::map<uint256, CRawBlockEntry> mapBlock;
+};
+
 class CNetChannel : public network::INetChannel
 {
 public:
@@ -252,9 +324,16 @@ public:
     void BroadcastTxInv(const uint256& hashFork) override;
     void SubscribeFork(const uint256& hashFork, const uint64& nNonce) override;
     void UnsubscribeFork(const uint256& hashFork) override;
+    // Compact block is only sent to peers with NODE_COMPACTBLOCK and for recent blocks,
+    // older txs have expired from the known tx set of peer
+    static bool IsCompactBlockSend(uint64 nPeerService, int64 nBlockTime, int64 nTime);
     bool SubmitCachePowBlock(const CConsensusParam& consParam) override;
     bool IsLocalCachePowBlock(int nHeight, bool& fIsDpos) override;
     bool AddCacheLocalPowBlock(const CBlock& block) override;
+    // Primary block relayed before full validation (-fastrelay) is kept for getdata until
+    // it is stored, the peer which sent it is closed if full validation rejects it
+    void RelayVerifiedBlock(const uint256& hashFork, const CBlock& block, uint64 nNonce) override;
+    void CompleteRelayedBlock(const uint256& hashBlock, bool fValid) override;
 
 protected:
     enum
@@ -269,6 +348,16 @@ protected:
         MAX_PEER_SCHED_COUNT = 8
     };
     enum
+    {
+        MAX_COMPACT_BLOCK_AGE = 3600,
+        MAX_PEER_CMPCT_BLOCK_COUNT = CSchedule::MAX_PEER_BLOCK_INFLIGHT,
+        MAX_CMPCT_BLOCK_COUNT = 1024
+    };
+    enum
+    {
+        MAX_REF_NEXT_BLOCK_THREADS = 8
+    };
+    enum
     {
         MSGRSP_SUBTYPE_NON = 0,
         MSGRSP_SUBTYPE_TXINV = 1
@@ -286,6 +375,7 @@ protected:
     void HandleDeinitialize() override;
     bool HandleInvoke() override;
     void HandleHalt() override;
+    void RefBlockThreadFunc();
 
     bool HandleEvent(network::CEventPeerActive& eventActive) override;
     bool HandleEvent(network::CEventPeerDeactive& eventDeactive) override;
@@ -298,8 +388,13 @@ protected:
     bool HandleEvent(network::CEventPeerBlock& eventBlock) override;
     bool HandleEvent(network::CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(network::CEventPeerCmpctBlock& eventCmpctBlock) override;
+    bool HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn) override;
 
-    CSchedule& GetSchedule(const uint256& hashFork);
+    CNetSchedulePtr GetNetSchedule(const uint256& hashFork);
+    void ListNetSchedule(std::vector<std::pair<uint256, CNetSchedulePtr>>& vNetSched);
+    CNetScheduleLock GetSchedule(const uint256& hashFork);
     void NotifyPeerUpdate(uint64 nNonce, bool fActive, const network::CAddress& addrPeer);
     void DispatchGetBlocksEvent(uint64 nNonce, const uint256& hashFork);
     void DispatchAwardEvent(uint64 nNonce, xengine::CEndpointManager::Bonus bonus);
@@ -322,8 +417,15 @@ protected:
     const string GetPeerAddressInfo(uint64 nNonce);
     bool CheckPrevBlock(const uint256& hash, CSchedule& sched, uint256& hashFirst, uint256& hashPrev);
     void InnerBroadcastBlockInv(const uint256& hashFork, const uint256& hashBlock);
+    void DispatchBlockInv(const uint256& hashFork, const uint256& hashBlock, const std::set<uint64>& setKnownPeer);
     void InnerSubmitCachePowBlock();
     void GetNextRefBlock(const uint256& hashRefBlock, std::vector<std::pair<uint256, uint256>>& vNext);
+    bool GetPeerBlock(const uint256& hashFork, const uint256& hashBlock, CBlock& block);
+    bool SendPeerBlock(uint64 nNonce, const uint256& hashFork, const uint256& hashBlock);
+    bool SendCompactBlock(uint64 nNonce, const uint256& hashFork, const CBlock& block);
+    bool RequestCompactBlockTx(uint64 nNonce, const uint256& hashFork, const uint256& hashBlock, CCompactBlockPending& pending);
+    bool ReceiveCompactBlock(uint64 nNonce, const uint256& hashFork, const CBlock& block);
+    void RemoveCompactBlock(uint64 nNonce, const uint256& hashBlock = uint256());
 
     const CBasicConfig* Config()
     {
@@ -340,13 +442,31 @@ protected:
     IConsensus* pConsensus;
     IForkManager* pForkManager;
 
-    mutable boost::recursive_mutex mtxSched;
-    std::map<uint256, CSchedule> mapSched;
+    // Peer events are handled on the event thread, the schedules are also used by rpc threads
+    // (getwork, submitwork), the dispatcher (cached pow blocks) and the AddRefNextBlock workers,
+    // which connect subsidiary fork blocks in parallel. Each fork schedule has its own lock,
+    // rwSched only guards the registry and is never held while a fork lock is acquired.
+    // A subsidiary fork lock may be taken while the primary fork lock is held, never the reverse.
+    mutable boost::shared_mutex rwSched;
+    std::map<uint256, CNetSchedulePtr> mapSched;
 
     mutable boost::shared_mutex rwNetPeer;
     std::map<uint64, CNetChannelPeer> mapPeer;
     std::map<uint256, std::set<uint64>> mapUnsync;
 
+    CRawBlockCache rawBlockCache;
+
+    // Workers of AddRefNextBlock, started once and shared by all primary blocks
+    boost::asio::io_service ioRefBlock;
+    std::shared_ptr<boost::asio::io_service::work> spRefBlockGuard;
+    std::vector<std::shared_ptr<xengine::CThread>> vThrRefBlock;
+
+    boost::mutex mtxRelayBlock;
+    std::map<uint256, std::pair<CBlock, uint64>> mapRelayBlock;
+
+    mutable boost::mutex mtxCmpctBlock;
+    std::map<std::pair<uint64, uint256>, CCompactBlockPending> mapCmpctBlock;
+
     mutable boost::mutex mtxPushTx;
     uint32 nTimerPushTx;
     uint32 nTimerForkUpdate;
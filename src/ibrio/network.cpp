@@ -36,7 +36,7 @@ bool CNetwork::HandleInitialize()
         return false;
     }
 
-    Configure(NetworkConfig()->nMagicNum, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED,
+    Configure(NetworkConfig()->nMagicNum, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED | network::NODE_COMPACTBLOCK | network::NODE_SNAPPY,
               FormatSubVersion(), !NetworkConfig()->vConnectTo.empty(), pCoreProtocol->GetGenesisBlockHash());
 
     CPeerNetConfig config;
@@ -80,6 +80,7 @@ bool CNetwork::HandleInitialize()
         }
     }
     config.nMaxOutBounds = NetworkConfig()->nMaxOutBounds;
+    config.nWorkerThreads = NetworkConfig()->nNetWorkerThreads;
     config.nPortDefault = (NetworkConfig()->fTestNet ? DEFAULT_TESTNET_P2PPORT : DEFAULT_P2PPORT);
     for (const string& conn : NetworkConfig()->vConnectTo)
     {
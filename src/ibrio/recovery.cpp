@@ -11,6 +11,7 @@
 #include "purger.h"
 #include "timeseries.h"
 
+using namespace std;
 using namespace boost::filesystem;
 
 namespace ibrio
@@ -19,21 +20,22 @@ namespace ibrio
 class CRecoveryWalker : public storage::CTSWalker<CBlockEx>
 {
 public:
-    CRecoveryWalker(IDispatcher* pDispatcherIn, const size_t nSizeIn)
-      : pDispatcher(pDispatcherIn), nSize(nSizeIn), nNextSize(nSizeIn / 100), nWalkedFileSize(0) {}
+    CRecoveryWalker(IDispatcher* pDispatcherIn, const size_t nSizeIn, const bool fBulkIn = false, const set<uint256>& setTrustBlockIn = set<uint256>())
+      : pDispatcher(pDispatcherIn), nSize(nSizeIn), nNextSize(nSizeIn / 100), nWalkedFileSize(0), fBulk(fBulkIn), setTrustBlock(setTrustBlockIn) {}
     bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
     {
         if (!t.IsGenesis())
         {
-            Errno err = pDispatcher->AddNewBlock(t);
+            const uint256 hash = t.GetHash();
+            Errno err = fBulk ? pDispatcher->AddRecoveryBlock(t, setTrustBlock.count(hash) != 0) : pDispatcher->AddNewBlock(t);
             if (err == OK)
             {
-                xengine::StdTrace("Recovery", "Recovery block [%s]", t.GetHash().ToString().c_str());
+                xengine::StdTrace("Recovery", "Recovery block [%s]", hash.ToString().c_str());
             }
             else if (err != ERR_ALREADY_HAVE)
             {
-                printf("...... block: %s, file: %u, offset: %u\n", t.GetHash().ToString().c_str(), nFile, nOffset);
-                xengine::StdError("Recovery", "Recovery block [%s] error: %s", t.GetHash().ToString().c_str(), ErrorString(err));
+                printf("...... block: %s, file: %u, offset: %u\n", hash.ToString().c_str(), nFile, nOffset);
+                xengine::StdError("Recovery", "Recovery block [%s] error: %s", hash.ToString().c_str(), ErrorString(err));
                 return false;
             }
         }
@@ -52,10 +54,31 @@ class CRecoveryWalker : public storage::CTSWalker<CBlockEx>
     const size_t nSize;
     size_t nNextSize;
     size_t nWalkedFileSize;
+    const bool fBulk;
+    const set<uint256> setTrustBlock;
+};
+
+class CRecoveryChainWalker : public storage::CTSWalker<CBlockEx>
+{
+public:
+    CRecoveryChainWalker(const int nMaxHeightIn)
+      : nMaxHeight(nMaxHeightIn) {}
+    bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
+    {
+        if (t.IsPrimary() && t.GetBlockHeight() <= nMaxHeight)
+        {
+            mapPrimaryBlock.insert(make_pair(t.GetHash(), make_pair(t.hashPrev, t.GetBlockHeight())));
+        }
+        return true;
+    }
+
+public:
+    const int nMaxHeight;
+    map<uint256, pair<uint256, int>> mapPrimaryBlock;
 };
 
 CRecovery::CRecovery()
-  : pDispatcher(nullptr)
+  : pDispatcher(nullptr), pBlockChain(nullptr)
 {
 }
 
@@ -71,8 +94,29 @@ bool CRecovery::HandleInitialize()
         return false;
     }
 
+    if (!GetObject("blockchain", pBlockChain))
+    {
+        Error("Failed to request blockchain");
+        return false;
+    }
+
     if (!StorageConfig()->strRecoveryDir.empty())
     {
+        const string& strCheckPoint = StorageConfig()->strRecoveryCheckPoint;
+        if (!strCheckPoint.empty())
+        {
+            if (!StorageConfig()->fRecoveryBulk)
+            {
+                Error("Recovery checkpoint requires bulk import mode");
+                return false;
+            }
+            if (hashCheckPoint.SetHex(strCheckPoint) != strCheckPoint.size())
+            {
+                Error("Recovery checkpoint [%s] is invalid", strCheckPoint.c_str());
+                return false;
+            }
+        }
+
         Warn("Clear old database except wallet address");
 
         CProofOfWorkParam param(StorageConfig()->fTestNet);
@@ -92,6 +136,7 @@ bool CRecovery::HandleInitialize()
 void CRecovery::HandleDeinitialize()
 {
     pDispatcher = nullptr;
+    pBlockChain = nullptr;
 }
 
 bool CRecovery::HandleInvoke()
@@ -114,11 +159,32 @@ bool CRecovery::HandleInvoke()
             return false;
         }
 
+        uint32 nThreads = std::max(boost::thread::hardware_concurrency(), 1u);
+        set<uint256> setTrustBlock;
+        if (hashCheckPoint != 0 && !GetTrustBlock(tsBlock, nThreads, setTrustBlock))
+        {
+            Error("Recovery checkpoint [%s] check fail", hashCheckPoint.ToString().c_str());
+            return false;
+        }
+
         size_t nSize = tsBlock.GetSize();
-        CRecoveryWalker walker(pDispatcher, nSize);
+        CRecoveryWalker walker(pDispatcher, nSize, StorageConfig()->fRecoveryBulk, setTrustBlock);
         uint32 nLastFile;
         uint32 nLastPos;
-        if (!tsBlock.WalkThrough(walker, nLastFile, nLastPos, false))
+        if (StorageConfig()->fRecoveryBulk)
+        {
+            Log("Recovery in bulk import mode, checkpoint: %s, trusted blocks: %lu",
+                (hashCheckPoint == 0 ? "none" : hashCheckPoint.ToString().c_str()), setTrustBlock.size());
+
+            bool fRet = tsBlock.ParallelWalkThrough(walker, nLastFile, nLastPos, false, nThreads);
+            pDispatcher->CompleteRecovery();
+            if (!fRet)
+            {
+                Error("Recovery walkthrough fail");
+                return false;
+            }
+        }
+        else if (!tsBlock.WalkThrough(walker, nLastFile, nLastPos, false))
         {
             Error("Recovery walkthrough fail");
             return false;
@@ -130,4 +196,60 @@ bool CRecovery::HandleInvoke()
     return true;
 }
 
+bool CRecovery::GetTrustBlock(storage::CTimeSeriesCached& tsBlock, const uint32 nThreads, set<uint256>& setTrustBlock)
+{
+    CProofOfWorkParam param(StorageConfig()->fTestNet);
+
+    IBlockChain::CCheckPoint point;
+    for (const IBlockChain::CCheckPoint& cp : pBlockChain->CheckPoints(param.hashGenesisBlock))
+    {
+        if (cp.nBlockHash == hashCheckPoint)
+        {
+            point = cp;
+            break;
+        }
+    }
+    if (point.IsNull())
+    {
+        Error("Recovery checkpoint [%s] is not in the checkpoint table", hashCheckPoint.ToString().c_str());
+        return false;
+    }
+
+    // only the primary chain up to the checkpoint is trusted, side chains are fully verified
+    CRecoveryChainWalker walker(point.nHeight);
+    uint32 nLastFile;
+    uint32 nLastPos;
+    if (!tsBlock.ParallelWalkThrough(walker, nLastFile, nLastPos, false, nThreads))
+    {
+        Error("Recovery checkpoint walkthrough fail");
+        return false;
+    }
+
+    uint256 hash = hashCheckPoint;
+    for (int nHeight = point.nHeight; nHeight > 0; nHeight--)
+    {
+        auto it = walker.mapPrimaryBlock.find(hash);
+        if (it == walker.mapPrimaryBlock.end() || it->second.second != nHeight)
+        {
+            Error("Recovery checkpoint [%s] not reached, missing block [%s] at height %d",
+                  hashCheckPoint.ToString().c_str(), hash.ToString().c_str(), nHeight);
+            return false;
+        }
+        if (!pBlockChain->VerifyCheckPoint(param.hashGenesisBlock, nHeight, hash))
+        {
+            Error("Recovery checkpoint [%s] mismatch, block [%s] at height %d",
+                  hashCheckPoint.ToString().c_str(), hash.ToString().c_str(), nHeight);
+            return false;
+        }
+        setTrustBlock.insert(hash);
+        hash = it->second.first;
+    }
+    if (hash != param.hashGenesisBlock)
+    {
+        Error("Recovery checkpoint [%s] is not on the genesis chain", hashCheckPoint.ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
 } // namespace ibrio
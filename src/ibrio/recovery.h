@@ -6,6 +6,7 @@
 #define IBRIO_RECOVERY_H
 
 #include "base.h"
+#include "timeseries.h"
 
 namespace ibrio
 {
@@ -20,9 +21,13 @@ protected:
     bool HandleInitialize() override;
     void HandleDeinitialize() override;
     bool HandleInvoke() override;
+    // Blocks on the primary chain from the genesis to the checkpoint, which must be in the checkpoint table
+    bool GetTrustBlock(storage::CTimeSeriesCached& tsBlock, const uint32 nThreads, std::set<uint256>& setTrustBlock);
 
 protected:
     IDispatcher* pDispatcher;
+    IBlockChain* pBlockChain;
+    uint256 hashCheckPoint;
 };
 
 } // namespace ibrio
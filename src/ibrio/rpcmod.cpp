@@ -32,6 +32,9 @@ using namespace ibrio;
 namespace fs = boost::filesystem;
 
 #define UNLOCKKEY_RELEASE_DEFAULT_TIME 60
+#define SUBSCRIBE_QUEUE_SIZE 1024
+#define SUBSCRIBE_MAX_ADDRESS 1024
+#define SENDFROMBATCH_MAX_TRANSFER 10000
 
 const char* GetGitVersion();
 
@@ -57,6 +60,29 @@ static int64 AmountFromValue(const double dAmount, const bool fZero = false)
     return nAmount;
 }
 
+///////////////////////////////
+// CSubscribeEventData
+
+class CSubscribeEventData : public CHttpSSEData
+{
+public:
+    CSubscribeEventData() {}
+    CSubscribeEventData(const Object& obj)
+      : strData(write_string(Value(obj), false, RPC_DOUBLE_PRECISION)) {}
+    bool operator==(const CHttpSSEData& data) const override
+    {
+        const CSubscribeEventData* p = dynamic_cast<const CSubscribeEventData*>(&data);
+        return (p != nullptr && p->strData == strData);
+    }
+    std::string ToString() override
+    {
+        return strData;
+    }
+
+protected:
+    std::string strData;
+};
+
 static CBlockData BlockToJSON(const uint256& hashBlock, const CBlock& block, const uint256& hashFork, int nHeight)
 {
     CBlockData data;
@@ -250,6 +276,8 @@ CRPCMod::CRPCMod()
         //
         ("sendfrom", &CRPCMod::RPCSendFrom)
         //
+        ("sendfrombatch", &CRPCMod::RPCSendFromBatch)
+        //
         ("createtransaction", &CRPCMod::RPCCreateTransaction)
         //
         ("signtransaction", &CRPCMod::RPCSignTransaction)
@@ -307,6 +335,7 @@ CRPCMod::CRPCMod()
         ("querystat", &CRPCMod::RPCQueryStat);
     mapRPCFunc = temp_map;
     fWriteRPCLog = true;
+    nCacheDepth = 0;
 }
 
 CRPCMod::~CRPCMod()
@@ -344,6 +373,8 @@ bool CRPCMod::HandleInitialize()
         return false;
     }
     fWriteRPCLog = RPCServerConfig()->fRPCLogEnable;
+    nCacheDepth = (RPCServerConfig()->nRPCCacheSize != 0 ? RPCServerConfig()->nRPCCacheDepth : 0);
+    cacheResult.SetMaxSize((size_t)RPCServerConfig()->nRPCCacheSize * 1024 * 1024);
 
     return true;
 }
@@ -359,6 +390,12 @@ void CRPCMod::HandleDeinitialize()
 
 bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
 {
+    if (eventHttpReq.data.mapHeader["method"] == "GET" && eventHttpReq.data.mapHeader["url"] == "/subscribe")
+    {
+        HandleSubscribe(eventHttpReq);
+        return true;
+    }
+
     auto lmdMask = [](const string& data) -> string
     {
         //remove all sensible information such as private key
@@ -474,10 +511,302 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
 
 bool CRPCMod::HandleEvent(CEventHttpBroken& eventHttpBroken)
 {
-    (void)eventHttpBroken;
+    mapSubscriber.erase(eventHttpBroken.nNonce);
+    return true;
+}
+
+bool CRPCMod::HandleEvent(CEventRPCModSubscribe& eventSubscribe)
+{
+    const CSubscribeUpdate& update = eventSubscribe.data;
+    UpdateCachedResult(update);
+    if (mapSubscriber.empty())
+    {
+        return true;
+    }
+
+    CSubscribeEventData dataBlock;
+    vector<CSubscribeEventData> vDataTx;
+    if (update.IsBlock())
+    {
+        Object obj;
+        obj.push_back(Pair("fork", update.hashFork.GetHex()));
+        obj.push_back(Pair("hash", update.hashBlock.GetHex()));
+        obj.push_back(Pair("prev", update.hashPrevBlock.GetHex()));
+        obj.push_back(Pair("height", update.nHeight));
+        obj.push_back(Pair("time", update.nTime));
+        obj.push_back(Pair("type", GetBlockTypeStr(update.nType, update.nMintType)));
+        Array arrTx;
+        for (const CSubscribeTx& tx : update.vTx)
+        {
+            arrTx.push_back(tx.txid.GetHex());
+        }
+        obj.push_back(Pair("tx", arrTx));
+        dataBlock = CSubscribeEventData(obj);
+    }
+    else
+    {
+        for (const CSubscribeTx& tx : update.vTx)
+        {
+            Object obj;
+            obj.push_back(Pair("fork", update.hashFork.GetHex()));
+            obj.push_back(Pair("txid", tx.txid.GetHex()));
+            obj.push_back(Pair("type", CTransaction::GetTypeStringStatic(tx.nType)));
+            obj.push_back(Pair("from", CAddress(tx.destIn).ToString()));
+            obj.push_back(Pair("to", CAddress(tx.destTo).ToString()));
+            obj.push_back(Pair("amount", ValueFromToken(tx.nAmount)));
+            obj.push_back(Pair("fee", ValueFromToken(tx.nTxFee)));
+            vDataTx.push_back(CSubscribeEventData(obj));
+        }
+    }
+
+    auto fnAddressData = [&](const CSubscribeTx& tx, const CDestination& dest, const bool fCredit) -> CSubscribeEventData {
+        Object obj;
+        obj.push_back(Pair("fork", update.hashFork.GetHex()));
+        obj.push_back(Pair("address", CAddress(dest).ToString()));
+        obj.push_back(Pair("txid", tx.txid.GetHex()));
+        obj.push_back(Pair("type", (fCredit ? "credit" : "debit")));
+        obj.push_back(Pair("amount", ValueFromToken(fCredit ? tx.nAmount : tx.nAmount + tx.nTxFee)));
+        obj.push_back(Pair("height", update.nHeight));
+        if (update.IsBlock())
+        {
+            obj.push_back(Pair("block", update.hashBlock.GetHex()));
+        }
+        return CSubscribeEventData(obj);
+    };
+
+    for (auto& kv : mapSubscriber)
+    {
+        CSubscriber& subscriber = *kv.second;
+        if (!subscriber.setFork.count(update.hashFork))
+        {
+            continue;
+        }
+
+        bool fUpdated = false;
+        if (update.IsBlock())
+        {
+            fUpdated |= subscriber.stream.UpdateEventData("block", dataBlock);
+        }
+        else
+        {
+            for (CSubscribeEventData& data : vDataTx)
+            {
+                fUpdated |= subscriber.stream.UpdateEventData("tx", data);
+            }
+        }
+
+        if (!subscriber.setDest.empty())
+        {
+            for (const CSubscribeTx& tx : update.vTx)
+            {
+                if (subscriber.setDest.count(tx.destIn))
+                {
+                    CSubscribeEventData data = fnAddressData(tx, tx.destIn, false);
+                    fUpdated |= subscriber.stream.UpdateEventData("address", data);
+                }
+                if (subscriber.setDest.count(tx.destTo))
+                {
+                    CSubscribeEventData data = fnAddressData(tx, tx.destTo, true);
+                    fUpdated |= subscriber.stream.UpdateEventData("address", data);
+                }
+            }
+        }
+
+        if (fUpdated && subscriber.fPending)
+        {
+            SubscribeReply(kv.first, subscriber);
+        }
+    }
+    return true;
+}
+
+void CRPCMod::HandleSubscribe(CEventHttpReq& eventHttpReq)
+{
+    uint64 nNonce = eventHttpReq.nNonce;
+    CHttpReq& req = eventHttpReq.data;
+
+    auto it = mapSubscriber.find(nNonce);
+    if (it == mapSubscriber.end())
+    {
+        // the subscription is fixed by the first request of the connection
+        std::shared_ptr<CSubscriber> spSubscriber(new CSubscriber());
+        try
+        {
+            vector<string> vEvent;
+            string strEventList = (req.mapQuery.count("event") ? req.mapQuery["event"] : string("block,tx,address"));
+            boost::split(vEvent, strEventList, boost::is_any_of(","));
+            for (const string& strEvent : vEvent)
+            {
+                if (strEvent != "block" && strEvent != "tx" && strEvent != "address")
+                {
+                    throw CRPCException(RPC_INVALID_PARAMETER, "Invalid event: " + strEvent);
+                }
+                spSubscriber->stream.RegisterEvent(strEvent, new CHttpSSEQueGenerator<CSubscribeEventData>(SUBSCRIBE_QUEUE_SIZE));
+            }
+
+            vector<string> vFork;
+            if (req.mapQuery.count("fork"))
+            {
+                boost::split(vFork, req.mapQuery["fork"], boost::is_any_of(","));
+            }
+            else
+            {
+                vFork.push_back(string());
+            }
+            for (const string& strFork : vFork)
+            {
+                uint256 hashFork;
+                if (!GetForkHashOfDef(strFork, hashFork) || !pService->HaveFork(hashFork))
+                {
+                    throw CRPCException(RPC_INVALID_PARAMETER, "Invalid fork: " + strFork);
+                }
+                spSubscriber->setFork.insert(hashFork);
+            }
+
+            if (req.mapQuery.count("address"))
+            {
+                vector<string> vAddress;
+                boost::split(vAddress, req.mapQuery["address"], boost::is_any_of(","));
+                if (vAddress.size() > SUBSCRIBE_MAX_ADDRESS)
+                {
+                    throw CRPCException(RPC_INVALID_PARAMETER, "Too many addresses");
+                }
+                for (const string& strAddress : vAddress)
+                {
+                    CAddress address(strAddress);
+                    if (address.IsNull())
+                    {
+                        throw CRPCException(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + strAddress);
+                    }
+                    spSubscriber->setDest.insert(static_cast<CDestination&>(address));
+                }
+            }
+        }
+        catch (CRPCException& e)
+        {
+            CRPCResp resp(e.valData, MakeCRPCErrorPtr(e));
+            JsonReply(nNonce, resp.Serialize());
+            return;
+        }
+        it = mapSubscriber.insert(make_pair(nNonce, spSubscriber)).first;
+    }
+
+    CSubscriber& subscriber = *it->second;
+    if (req.mapHeader.count("last-event-id"))
+    {
+        subscriber.nLastEventId = strtoull(req.mapHeader["last-event-id"].c_str(), nullptr, 10);
+    }
+    subscriber.fPending = true;
+    SubscribeReply(nNonce, subscriber);
+}
+
+void CRPCMod::SubscribeReply(uint64 nNonce, CSubscriber& subscriber)
+{
+    // a request without new events is held until the next update
+    CEventHttpRsp eventHttpRsp(nNonce);
+    if (subscriber.stream.ConstructResponse(subscriber.nLastEventId, eventHttpRsp.data))
+    {
+        eventHttpRsp.data.mapHeader["server"] = "ibrio-rpc";
+        subscriber.nLastEventId = subscriber.stream.GetEventId();
+        subscriber.fPending = false;
+        pHttpServer->DispatchEvent(&eventHttpRsp);
+    }
+}
+
+bool CRPCMod::RetrieveCachedResult(const string& strKey, CRPCResultPtr& spResult)
+{
+    CCachedResult cached;
+    if (nCacheDepth == 0 || !cacheResult.Retrieve(strKey, cached))
+    {
+        return false;
+    }
+
+    auto spCommon = std::make_shared<CRPCCommonResult>();
+    spCommon->val = cached.val;
+    if (cached.fConfirmations)
+    {
+        // confirmations move with the tip, patch them on every hit
+        int nDepth = GetConfirmations(cached.hashFork, cached.nHeight);
+        std::function<void(Value&)> fnPatch = [&](Value& val) {
+            if (val.type() == obj_type)
+            {
+                for (Pair& pair : val.get_obj())
+                {
+                    if (pair.name_ == "confirmations")
+                    {
+                        pair.value_ = nDepth;
+                    }
+                    else
+                    {
+                        fnPatch(pair.value_);
+                    }
+                }
+            }
+            else if (val.type() == array_type)
+            {
+                for (Value& v : val.get_array())
+                {
+                    fnPatch(v);
+                }
+            }
+        };
+        fnPatch(spCommon->val);
+    }
+    spResult = spCommon;
     return true;
 }
 
+void CRPCMod::AddCachedResult(const string& strKey, CRPCResultPtr spResult, const uint256& hashFork, const int nHeight, const bool fConfirmations)
+{
+    // only results deep enough to be immutable are cached
+    if (nCacheDepth == 0 || nHeight < 0 || nHeight + (int)nCacheDepth > pService->GetForkHeight(hashFork))
+    {
+        return;
+    }
+
+    CCachedResult cached;
+    cached.hashFork = hashFork;
+    cached.nHeight = nHeight;
+    cached.fConfirmations = fConfirmations;
+    cached.val = spResult->ToJSON();
+    // a block detail can be many MB, so the cache is bounded by the serialized size of the results
+    cacheResult.AddNew(strKey, cached, write_string(cached.val, false, RPC_DOUBLE_PRECISION).size());
+
+    int& nCachedHeight = mapCachedHeight[hashFork];
+    if (nCachedHeight < nHeight)
+    {
+        nCachedHeight = nHeight;
+    }
+}
+
+void CRPCMod::UpdateCachedResult(const CSubscribeUpdate& update)
+{
+    if (!update.IsBlock())
+    {
+        return;
+    }
+
+    // a block at or below a cached height means the fork was reorganized
+    auto it = mapCachedHeight.find(update.hashFork);
+    if (it != mapCachedHeight.end() && update.nHeight <= it->second)
+    {
+        StdLog("CRPCMod", "Clear cached results: fork: %s, height: %d, cached height: %d",
+               update.hashFork.GetHex().c_str(), update.nHeight, it->second);
+        cacheResult.Clear();
+        mapCachedHeight.clear();
+    }
+}
+
+int CRPCMod::GetConfirmations(const uint256& hashFork, const int nHeight)
+{
+    int nDepth = nHeight < 0 ? 0 : pService->GetForkHeight(hashFork) - nHeight;
+    if (hashFork != pCoreProtocol->GetGenesisBlockHash())
+    {
+        nDepth = nDepth * 30;
+    }
+    return nDepth;
+}
+
 void CRPCMod::JsonReply(uint64 nNonce, const std::string& result)
 {
     CEventHttpRsp eventHttpRsp(nNonce);
@@ -868,6 +1197,13 @@ CRPCResultPtr CRPCMod::RPCGetBlockHash(CRPCParamPtr param)
         throw CRPCException(RPC_INVALID_PARAMETER, "Unknown fork");
     }
 
+    string strKey = string("getblockhash:") + hashFork.GetHex() + ":" + to_string(nHeight);
+    CRPCResultPtr spCached;
+    if (RetrieveCachedResult(strKey, spCached))
+    {
+        return spCached;
+    }
+
     vector<uint256> vBlockHash;
     if (!pService->GetBlockHash(hashFork, nHeight, vBlockHash))
     {
@@ -880,6 +1216,7 @@ CRPCResultPtr CRPCMod::RPCGetBlockHash(CRPCParamPtr param)
         spResult->vecHash.push_back(hash.GetHex());
     }
 
+    AddCachedResult(strKey, spResult, hashFork, nHeight, false);
     return spResult;
 }
 
@@ -891,6 +1228,13 @@ CRPCResultPtr CRPCMod::RPCGetBlock(CRPCParamPtr param)
     uint256 hashBlock;
     hashBlock.SetHex(spParam->strBlock);
 
+    string strKey = string("getblock:") + hashBlock.GetHex();
+    CRPCResultPtr spCached;
+    if (RetrieveCachedResult(strKey, spCached))
+    {
+        return spCached;
+    }
+
     CBlock block;
     uint256 fork;
     int height;
@@ -899,7 +1243,9 @@ CRPCResultPtr CRPCMod::RPCGetBlock(CRPCParamPtr param)
         throw CRPCException(RPC_INVALID_PARAMETER, "Unknown block");
     }
 
-    return MakeCGetBlockResultPtr(BlockToJSON(hashBlock, block, fork, height));
+    auto spResult = MakeCGetBlockResultPtr(BlockToJSON(hashBlock, block, fork, height));
+    AddCachedResult(strKey, spResult, fork, height, false);
+    return spResult;
 }
 
 CRPCResultPtr CRPCMod::RPCGetBlockDetail(CRPCParamPtr param)
@@ -910,6 +1256,13 @@ CRPCResultPtr CRPCMod::RPCGetBlockDetail(CRPCParamPtr param)
     uint256 hashBlock;
     hashBlock.SetHex(spParam->strBlock);
 
+    string strKey = string("getblockdetail:") + hashBlock.GetHex();
+    CRPCResultPtr spCached;
+    if (RetrieveCachedResult(strKey, spCached))
+    {
+        return spCached;
+    }
+
     CBlockEx block;
     uint256 fork;
     int height;
@@ -931,11 +1284,7 @@ CRPCResultPtr CRPCMod::RPCGetBlockDetail(CRPCParamPtr param)
     }
     data.strFork = fork.GetHex();
     data.nHeight = height;
-    int nDepth = height < 0 ? 0 : pService->GetForkHeight(fork) - height;
-    if (fork != pCoreProtocol->GetGenesisBlockHash())
-    {
-        nDepth = nDepth * 30;
-    }
+    int nDepth = GetConfirmations(fork, height);
     data.txmint = TxToJSON(block.txMint.GetHash(), block.txMint, fork, hashBlock, nDepth, CAddress().ToString());
     if (block.IsProofOfWork())
     {
@@ -952,7 +1301,10 @@ CRPCResultPtr CRPCMod::RPCGetBlockDetail(CRPCParamPtr param)
         const CTransaction& tx = block.vtx[i];
         data.vecTx.push_back(TxToJSON(tx.GetHash(), tx, fork, hashBlock, nDepth, CAddress(block.vTxContxt[i].destIn).ToString()));
     }
-    return MakeCgetblockdetailResultPtr(data);
+
+    auto spResult = MakeCgetblockdetailResultPtr(data);
+    AddCachedResult(strKey, spResult, fork, height, true);
+    return spResult;
 }
 
 CRPCResultPtr CRPCMod::RPCGetTxPool(CRPCParamPtr param)
@@ -1027,6 +1379,13 @@ CRPCResultPtr CRPCMod::RPCGetTransaction(CRPCParamPtr param)
         throw CRPCException(RPC_INVALID_PARAMETER, "Invalid txid");
     }
 
+    string strKey = string("gettransaction:") + txid.GetHex() + (spParam->fSerialized ? ":serialized" : "");
+    CRPCResultPtr spCached;
+    if (RetrieveCachedResult(strKey, spCached))
+    {
+        return spCached;
+    }
+
     CTransaction tx;
     uint256 hashFork;
     int nHeight;
@@ -1044,16 +1403,14 @@ CRPCResultPtr CRPCMod::RPCGetTransaction(CRPCParamPtr param)
         CBufStream ss;
         ss << tx;
         spResult->strSerialization = ToHexString((const unsigned char*)ss.GetData(), ss.GetSize());
+        AddCachedResult(strKey, spResult, hashFork, nHeight, false);
         return spResult;
     }
 
-    int nDepth = nHeight < 0 ? 0 : pService->GetForkHeight(hashFork) - nHeight;
-    if (hashFork != pCoreProtocol->GetGenesisBlockHash())
-    {
-        nDepth = nDepth * 30;
-    }
+    int nDepth = GetConfirmations(hashFork, nHeight);
 
     spResult->transaction = TxToJSON(txid, tx, hashFork, hashBlock, nDepth, CAddress(destIn).ToString());
+    AddCachedResult(strKey, spResult, hashFork, nHeight, true);
     return spResult;
 }
 
@@ -1738,9 +2095,9 @@ CRPCResultPtr CRPCMod::RPCGetBalance(CRPCParamPtr param)
 
 CRPCResultPtr CRPCMod::RPCListTransaction(CRPCParamPtr param)
 {
-    if (!BasicConfig()->fAddrTxIndex)
+    if (!BasicConfig()->fAddrTxIndex && !BasicConfig()->fWalletIndex)
     {
-        throw CRPCException(RPC_INVALID_REQUEST, "If you need this function, please set config 'addrtxindex=true' and restart");
+        throw CRPCException(RPC_INVALID_REQUEST, "If you need this function, please set config 'addrtxindex=true' or 'walletindex=true' and restart");
     }
 
     auto spParam = CastParamPtr<CListTransactionParam>(param);
@@ -2076,6 +2433,90 @@ CRPCResultPtr CRPCMod::RPCSendFrom(CRPCParamPtr param)
     return MakeCSendFromResultPtr(txNew.GetHash().GetHex());
 }
 
+CRPCResultPtr CRPCMod::RPCSendFromBatch(CRPCParamPtr param)
+{
+    //sendfrombatch <"from"> <[transfers]> ($txfee$) (-f="fork") (-fd="fromdata")
+    auto spParam = CastParamPtr<CSendFromBatchParam>(param);
+    CAddress from(spParam->strFrom);
+    if (from.IsNull())
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid from address");
+    }
+
+    if (spParam->vecTransfers.size() == 0 || spParam->vecTransfers.size() > SENDFROMBATCH_MAX_TRANSFER)
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid transfers");
+    }
+    vector<pair<CDestination, int64>> vSendTo;
+    vSendTo.reserve(spParam->vecTransfers.size());
+    for (const CTransferData& transfer : spParam->vecTransfers)
+    {
+        CAddress to(transfer.strTo);
+        if (to.IsNull())
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Invalid to address");
+        }
+        int64 nAmount = AmountFromValue(transfer.dAmount);
+        if (nAmount == -1)
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Invalid amount");
+        }
+        vSendTo.push_back(make_pair(static_cast<CDestination>(to), nAmount));
+    }
+
+    uint256 hashFork;
+    if (!GetForkHashOfDef(spParam->strFork, hashFork))
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid fork");
+    }
+    if (!pService->HaveFork(hashFork))
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Unknown fork");
+    }
+
+    int64 nTxFee = CalcMinTxFee(0, MIN_TX_FEE);
+    if (spParam->dTxfee.IsValid())
+    {
+        int64 nUserTxFee = AmountFromValue(spParam->dTxfee);
+        if (nUserTxFee > nTxFee)
+        {
+            nTxFee = nUserTxFee;
+        }
+    }
+
+    vector<uint8> vchFromData;
+    if (from.IsTemplate() && spParam->strFromdata.IsValid())
+    {
+        vchFromData = ParseHexString(spParam->strFromdata);
+    }
+
+    vector<CTransaction> vTxNew;
+    auto strErr = pService->CreateTransactionBatch(hashFork, from, vSendTo, nTxFee, vchFromData, vTxNew);
+    if (strErr)
+    {
+        throw CRPCException(RPC_WALLET_ERROR, std::string("Failed to create transaction: ") + *strErr);
+    }
+
+    size_t nSent = 0;
+    Errno err = pService->SendTransactionBatch(vTxNew, nSent);
+    if (nSent == 0)
+    {
+        throw CRPCException(RPC_TRANSACTION_REJECTED, string("Tx rejected : ")
+                                                          + ErrorString(err));
+    }
+    if (err != OK)
+    {
+        StdWarn("[SendFromBatch]", "Submitted %lu of %lu transactions, err: %s", nSent, vTxNew.size(), ErrorString(err));
+    }
+
+    auto spResult = MakeCSendFromBatchResultPtr();
+    for (size_t i = 0; i < nSent; i++)
+    {
+        spResult->vecTransaction.push_back(vTxNew[i].GetHash().GetHex());
+    }
+    return spResult;
+}
+
 CRPCResultPtr CRPCMod::RPCCreateTransaction(CRPCParamPtr param)
 {
     auto spParam = CastParamPtr<CCreateTransactionParam>(param);
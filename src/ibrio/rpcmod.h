@@ -9,13 +9,14 @@
 #include <boost/function.hpp>
 
 #include "base.h"
+#include "event.h"
 #include "rpc/rpc.h"
 #include "xengine.h"
 
 namespace ibrio
 {
 
-class CRPCMod : public xengine::IIOModule, virtual public xengine::CHttpEventListener
+class CRPCMod : public xengine::IIOModule, virtual public xengine::CHttpEventListener, virtual public CRPCModEventListener
 {
 public:
     typedef rpc::CRPCResultPtr (CRPCMod::*RPCFunc)(rpc::CRPCParamPtr param);
@@ -23,6 +24,35 @@ public:
     ~CRPCMod();
     bool HandleEvent(xengine::CEventHttpReq& eventHttpReq) override;
     bool HandleEvent(xengine::CEventHttpBroken& eventHttpBroken) override;
+    bool HandleEvent(CEventRPCModSubscribe& eventSubscribe) override;
+
+protected:
+    class CSubscriber
+    {
+    public:
+        CSubscriber()
+          : stream("subscribe"), nLastEventId(0), fPending(false) {}
+
+    public:
+        std::set<uint256> setFork;
+        std::set<CDestination> setDest;
+        xengine::CHttpEventStream stream;
+        uint64 nLastEventId;
+        bool fPending;
+    };
+
+    class CCachedResult
+    {
+    public:
+        CCachedResult()
+          : nHeight(-1), fConfirmations(false) {}
+
+    public:
+        uint256 hashFork;
+        int nHeight;
+        bool fConfirmations;
+        json_spirit::Value val;
+    };
 
 protected:
     bool HandleInitialize() override;
@@ -41,6 +71,12 @@ protected:
     }
 
     void JsonReply(uint64 nNonce, const std::string& result);
+    void HandleSubscribe(xengine::CEventHttpReq& eventHttpReq);
+    void SubscribeReply(uint64 nNonce, CSubscriber& subscriber);
+    bool RetrieveCachedResult(const std::string& strKey, rpc::CRPCResultPtr& spResult);
+    void AddCachedResult(const std::string& strKey, rpc::CRPCResultPtr spResult, const uint256& hashFork, const int nHeight, const bool fConfirmations);
+    void UpdateCachedResult(const CSubscribeUpdate& update);
+    int GetConfirmations(const uint256& hashFork, const int nHeight);
 
     int GetInt(const rpc::CRPCInt64& i, int valDefault)
     {
@@ -121,6 +157,7 @@ private:
     rpc::CRPCResultPtr RPCGetBalance(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCListTransaction(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSendFrom(rpc::CRPCParamPtr param);
+    rpc::CRPCResultPtr RPCSendFromBatch(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCCreateTransaction(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSignTransaction(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSignMessage(rpc::CRPCParamPtr param);
@@ -161,6 +198,10 @@ protected:
 private:
     std::map<std::string, RPCFunc> mapRPCFunc;
     bool fWriteRPCLog;
+    std::map<uint64, std::shared_ptr<CSubscriber>> mapSubscriber;
+    xengine::CCache<std::string, CCachedResult> cacheResult;
+    std::map<uint256, int> mapCachedHeight;
+    unsigned int nCacheDepth;
 };
 
 } // namespace ibrio
@@ -130,6 +130,10 @@ void CSchedule::RemovePeer(uint64 nPeerNonce, set<uint64>& setSchedPeer)
                     state.nAssigned = 0;
                     state.objReceived = CNil();
                     setSchedPeer.insert(state.setKnownPeer.begin(), state.setKnownPeer.end());
+                    if (inv.nType == network::CInv::MSG_BLOCK)
+                    {
+                        AddDownloadBlock(inv.nHash);
+                    }
                 }
             }
         }
@@ -156,6 +160,10 @@ bool CSchedule::AddNewInv(const network::CInv& inv, uint64 nPeerNonce)
         if (state.nRecvInvTime == 0)
         {
             state.nRecvInvTime = GetTime();
+            if (inv.nType == network::CInv::MSG_BLOCK)
+            {
+                AddDownloadBlock(inv.nHash);
+            }
         }
         mapPeer[nPeerNonce].AddNewInv(inv);
         return true;
@@ -190,6 +198,7 @@ void CSchedule::RemoveInvState(const network::CInv& inv)
     {
         RemoveHeightBlock(CBlock::GetBlockHeightByHash(inv.nHash), inv.nHash);
         RemoveRefBlock(inv.nHash);
+        RemoveDownloadBlock(inv.nHash);
     }
     mapState.erase(inv);
 }
@@ -207,6 +216,7 @@ bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBloc
             state.nClearObjTime = GetTime() + MAX_OBJ_WAIT_TIME;
             setSchedPeer.insert(state.setKnownPeer.begin(), state.setKnownPeer.end());
             mapPeer[nPeerNonce].Completed((*it).first);
+            RemoveDownloadBlock(hash);
             if (block.IsPrimary() && block.IsProofOfWork())
             {
                 mapHeightBlock[block.GetBlockHeight()].push_back(make_pair(hash, CACHE_POW_BLOCK_TYPE_REMOTE));
@@ -217,6 +227,12 @@ bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBloc
     return false;
 }
 
+bool CSchedule::IsAssignedBlock(uint64 nPeerNonce, const uint256& hash)
+{
+    map<network::CInv, CInvState>::iterator it = mapState.find(network::CInv(network::CInv::MSG_BLOCK, hash));
+    return (it != mapState.end() && it->second.nAssigned == nPeerNonce && !it->second.IsReceived());
+}
+
 bool CSchedule::ReceiveTx(uint64 nPeerNonce, const uint256& txid, const CTransaction& tx, set<uint64>& setSchedPeer)
 {
     map<network::CInv, CInvState>::iterator it = mapState.find(network::CInv(network::CInv::MSG_TX, txid));
@@ -319,9 +335,11 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
     {
         CInvPeer& peer = (*it).second;
         fEmpty = peer.Empty(network::CInv::MSG_BLOCK);
-        if (!peer.IsAssigned())
+        size_t nInFlight = peer.GetAssigned(network::CInv::MSG_BLOCK).size();
+        if (peer.GetAssigned(network::CInv::MSG_TX).empty() && nInFlight < MAX_PEER_BLOCK_INFLIGHT)
         {
             bool fReceivedAll;
+            nMaxCount = min(nMaxCount, (size_t)(MAX_PEER_BLOCK_INFLIGHT - nInFlight));
             if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, nMaxCount, fReceivedAll))
             {
                 if (fReceivedAll && peer.CheckNextGetBlocksTime() && CheckAddInvIdleLocation(nPeerNonce, network::CInv::MSG_BLOCK))
@@ -749,6 +767,15 @@ void CSchedule::SetPowBlockVerifyState(const uint256& hash, bool fVerifyPowBlock
     }
 }
 
+uint32 CSchedule::GetDownloadWindowHeight()
+{
+    if (mapDownloadBlock.empty())
+    {
+        return std::numeric_limits<uint32>::max();
+    }
+    return mapDownloadBlock.begin()->first + MAX_BLOCK_DOWNLOAD_WINDOW;
+}
+
 void CSchedule::RemoveOrphan(const network::CInv& inv)
 {
     if (inv.nType == network::CInv::MSG_TX)
@@ -761,6 +788,46 @@ void CSchedule::RemoveOrphan(const network::CInv& inv)
     }
 }
 
+void CSchedule::AddDownloadBlock(const uint256& hash)
+{
+    mapDownloadBlock[CBlock::GetBlockHeightByHash(hash)].insert(hash);
+}
+
+void CSchedule::RemoveDownloadBlock(const uint256& hash)
+{
+    auto it = mapDownloadBlock.find(CBlock::GetBlockHeightByHash(hash));
+    if (it != mapDownloadBlock.end())
+    {
+        it->second.erase(hash);
+        if (it->second.empty())
+        {
+            mapDownloadBlock.erase(it);
+        }
+    }
+}
+
+bool CSchedule::TakeOverStalledBlock(uint64 nPeerNonce, CInvPeer& peer, const network::CInv& inv, CInvState& state, int64 nCurTime)
+{
+    if (state.nAssigned == 0 || state.nAssigned == nPeerNonce || state.IsReceived()
+        || nCurTime - state.nAssignTime < MAX_BLOCK_STALL_TIME
+        || state.nGetDataCount >= MAX_REGETDATA_COUNT)
+    {
+        return false;
+    }
+    StdLog("Schedule", "TakeOverStalledBlock: block stalled, peer nonce: %ld, stalled peer nonce: %ld, block: %s, waittime: %ld",
+           nPeerNonce, state.nAssigned, inv.nHash.GetHex().c_str(), nCurTime - state.nAssignTime);
+    map<uint64, CInvPeer>::iterator it = mapPeer.find(state.nAssigned);
+    if (it != mapPeer.end())
+    {
+        (*it).second.Completed(inv);
+    }
+    state.nAssigned = nPeerNonce;
+    state.nAssignTime = nCurTime;
+    state.nGetDataCount++;
+    peer.Assign(inv);
+    return true;
+}
+
 bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                                  vector<network::CInv>& vInv, size_t nMaxCount, bool& fReceivedAll)
 {
@@ -794,6 +861,7 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                         continue;
                     }
                     state.nAssigned = nPeerNonce;
+                    state.nAssignTime = nCurTime;
                     vInv.push_back(inv);
                     peer.Assign(inv);
                     state.nGetDataCount++;
@@ -812,6 +880,7 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
     }
     if (vInv.size() < nMaxCount)
     {
+        uint32 nWindowHeight = (type == network::CInv::MSG_BLOCK ? GetDownloadWindowHeight() : 0);
         for (const uint256& hash : listKnown)
         {
             network::CInv inv(type, hash);
@@ -819,7 +888,20 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
             if (it != mapState.end())
             {
                 CInvState& state = it->second;
-                if (state.nAssigned == 0)
+                if (type == network::CInv::MSG_BLOCK && !state.IsReceived()
+                    && CBlock::GetBlockHeightByHash(hash) > nWindowHeight)
+                {
+                    continue;
+                }
+                if (type == network::CInv::MSG_BLOCK && TakeOverStalledBlock(nPeerNonce, peer, inv, state, nCurTime))
+                {
+                    vInv.push_back(inv);
+                    if (vInv.size() >= nMaxCount)
+                    {
+                        break;
+                    }
+                }
+                else if (state.nAssigned == 0)
                 {
                     if (state.nGetDataCount >= MAX_REGETDATA_COUNT
                         || (state.nGetDataCount >= 1 && nCurTime - state.nRecvInvTime >= MAX_INV_WAIT_TIME)
@@ -831,6 +913,7 @@ bool CSchedule::ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                         continue;
                     }
                     state.nAssigned = nPeerNonce;
+                    state.nAssignTime = nCurTime;
                     vInv.push_back(inv);
                     peer.Assign(inv);
                     state.nGetDataCount++;
@@ -202,7 +202,7 @@ class CSchedule
     public:
         CInvState()
           : nAssigned(0), objReceived(CNil()), nRecvInvTime(0), nRecvObjTime(0), nClearObjTime(0),
-            nGetDataCount(0), fRepeatMintBlock(false), fVerifyPowBlock(false) {}
+            nAssignTime(0), nGetDataCount(0), fRepeatMintBlock(false), fVerifyPowBlock(false) {}
         bool IsReceived()
         {
             return (objReceived.type() != typeid(CNil));
@@ -215,6 +215,7 @@ class CSchedule
         int64 nRecvInvTime;
         int64 nRecvObjTime;
         int64 nClearObjTime;
+        int64 nAssignTime;
         int nGetDataCount;
         bool fRepeatMintBlock;
         bool fVerifyPowBlock;
@@ -235,7 +236,10 @@ public:
         MAX_SUB_BLOCK_DELAYED_TIME = 120,
         MAX_CERTTX_DELAYED_TIME = 180,
         MAX_SUBMIT_POW_TIMEOUT = 10,
-        MAX_MINTTX_DELAYED_TIME = 180
+        MAX_MINTTX_DELAYED_TIME = 180,
+        MAX_PEER_BLOCK_INFLIGHT = 16,
+        MAX_BLOCK_DOWNLOAD_WINDOW = 512,
+        MAX_BLOCK_STALL_TIME = 120
     };
 
     enum
@@ -253,6 +257,7 @@ public:
     bool AddNewInv(const network::CInv& inv, uint64 nPeerNonce);
     bool RemoveInv(const network::CInv& inv, std::set<uint64>& setKnownPeer);
     bool ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, std::set<uint64>& setSchedPeer);
+    bool IsAssignedBlock(uint64 nPeerNonce, const uint256& hash);
     void RemoveInvState(const network::CInv& inv);
     bool ReceiveTx(uint64 nPeerNonce, const uint256& txid, const CTransaction& tx, std::set<uint64>& setSchedPeer);
     CBlock* GetBlock(const uint256& hash, uint64& nNonceSender);
@@ -288,9 +293,13 @@ public:
     void RemoveHeightBlock(int nHeight, const uint256& hash);
     bool GetPowBlockState(const uint256& hash, bool& fVerifyPowBlockOut);
     void SetPowBlockVerifyState(const uint256& hash, bool fVerifyPowBlockIn);
+    uint32 GetDownloadWindowHeight();
 
 protected:
     void RemoveOrphan(const network::CInv& inv);
+    void AddDownloadBlock(const uint256& hash);
+    void RemoveDownloadBlock(const uint256& hash);
+    bool TakeOverStalledBlock(uint64 nPeerNonce, CInvPeer& peer, const network::CInv& inv, CInvState& state, int64 nCurTime);
     bool ScheduleKnownInv(uint64 nPeerNonce, CInvPeer& peer, uint32 type,
                           std::vector<network::CInv>& vInv, std::size_t nMaxCount, bool& fReceivedAll);
 
@@ -303,6 +312,7 @@ protected:
     std::map<uint256, std::map<uint256, uint256>> mapRefBlock;
     std::map<int, std::vector<std::pair<uint256, int>>> mapHeightBlock;
     std::map<int, CBlock> mapKcPowBlock;
+    std::map<uint32, std::set<uint256>> mapDownloadBlock;
 };
 
 } // namespace ibrio
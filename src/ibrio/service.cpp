@@ -18,11 +18,14 @@ extern void Shutdown();
 namespace ibrio
 {
 
+#define READ_SNAPSHOT_RETRY (3)
+#define READ_SNAPSHOT_SYNC_TIME (3000)
+
 //////////////////////////////
 // CService
 
 CService::CService()
-  : pCoreProtocol(nullptr), pBlockChain(nullptr), pTxPool(nullptr), pDispatcher(nullptr), pWallet(nullptr), pNetwork(nullptr), pForkManager(nullptr), pNetChannel(nullptr)
+  : pCoreProtocol(nullptr), pBlockChain(nullptr), pTxPool(nullptr), pDispatcher(nullptr), pWallet(nullptr), pNetwork(nullptr), pForkManager(nullptr), pNetChannel(nullptr), pRPCMod(nullptr)
 {
 }
 
@@ -80,6 +83,12 @@ bool CService::HandleInitialize()
         return false;
     }
 
+    // subscriptions are pushed only when the rpc module is attached
+    if (!GetObject("rpcmod", pRPCMod))
+    {
+        pRPCMod = nullptr;
+    }
+
     return true;
 }
 
@@ -93,6 +102,7 @@ void CService::HandleDeinitialize()
     pNetwork = nullptr;
     pForkManager = nullptr;
     pNetChannel = nullptr;
+    pRPCMod = nullptr;
 }
 
 bool CService::HandleInvoke()
@@ -155,6 +165,40 @@ void CService::NotifyBlockChainUpdate(const CBlockChainUpdate& update)
             ++mt;
         }
     }
+
+    pWallet->UpdateWalletIndex(update);
+
+    if (pRPCMod != nullptr)
+    {
+        for (auto it = update.vBlockAddNew.rbegin(); it != update.vBlockAddNew.rend(); ++it)
+        {
+            const CBlockEx& block = *it;
+            CEventRPCModSubscribe* pEvent = new CEventRPCModSubscribe(0);
+            if (pEvent == nullptr)
+            {
+                break;
+            }
+            CSubscribeUpdate& data = pEvent->data;
+            data.hashFork = update.hashFork;
+            data.hashBlock = block.hashBlock;
+            data.hashPrevBlock = block.hashPrev;
+            data.nHeight = block.GetBlockHeight();
+            data.nTime = block.GetBlockTime();
+            data.nType = block.nType;
+            data.nMintType = block.txMint.nType;
+            data.vTx.reserve(block.vtx.size() + 1);
+            if (!block.txMint.IsNull())
+            {
+                data.vTx.push_back(CSubscribeTx(block.txMint.GetHash(), block.txMint, CDestination()));
+            }
+            for (size_t i = 0; i < block.vtx.size(); i++)
+            {
+                const CTransaction& tx = block.vtx[i];
+                data.vTx.push_back(CSubscribeTx(tx.GetHash(), tx, (i < block.vTxContxt.size() ? block.vTxContxt[i].destIn : CDestination())));
+            }
+            pRPCMod->PostEvent(pEvent);
+        }
+    }
 }
 
 void CService::NotifyNetworkPeerUpdate(const CNetworkPeerUpdate& update)
@@ -164,7 +208,17 @@ void CService::NotifyNetworkPeerUpdate(const CNetworkPeerUpdate& update)
 
 void CService::NotifyTransactionUpdate(const CTransactionUpdate& update)
 {
-    (void)update;
+    if (pRPCMod != nullptr)
+    {
+        CEventRPCModSubscribe* pEvent = new CEventRPCModSubscribe(0);
+        if (pEvent != nullptr)
+        {
+            pEvent->data.hashFork = update.hashFork;
+            pEvent->data.nTime = update.txUpdate.GetTxTime();
+            pEvent->data.vTx.push_back(CSubscribeTx(update.txUpdate.GetHash(), update.txUpdate, update.destIn));
+            pRPCMod->PostEvent(pEvent);
+        }
+    }
 }
 
 void CService::Stop()
@@ -404,49 +458,18 @@ bool CService::GetTransaction(const uint256& txid, CTransaction& tx, uint256& ha
     }
     else
     {
-        if (!pBlockChain->GetTransaction(txid, tx, hashFork, nHeight))
+        int nTxHeight = 0;
+        if (!pBlockChain->GetTxLocation(txid, hashFork, nTxHeight))
         {
-            StdLog("CService", "GetTransaction: BlockChain GetTransaction fail, txid: %s", txid.GetHex().c_str());
+            StdLog("CService", "GetTransaction: BlockChain GetTxLocation fail, txid: %s", txid.GetHex().c_str());
             return false;
         }
 
-        std::vector<uint256> vHashBlock;
-        if (!GetBlockHash(hashFork, nHeight, vHashBlock))
-        {
-            StdLog("CService", "GetTransaction: GetBlockHash fail, txid: %s, fork: %s, height: %d",
-                   txid.GetHex().c_str(), hashFork.GetHex().c_str(), nHeight);
-            return false;
-        }
-        for (const auto& hash : vHashBlock)
-        {
-            CBlockEx block;
-            uint256 tempHashFork;
-            int tempHeight = 0;
-            if (!GetBlockEx(hash, block, tempHashFork, tempHeight))
-            {
-                StdLog("CService", "GetTransaction: GetBlockEx fail, txid: %s, block: %s",
-                       txid.GetHex().c_str(), hash.GetHex().c_str());
-                return false;
-            }
-            if (txid == block.txMint.GetHash())
-            {
-                hashBlock = hash;
-                break;
-            }
-            for (int i = 0; i < block.vtx.size(); i++)
-            {
-                if (txid == block.vtx[i].GetHash())
-                {
-                    hashBlock = hash;
-                    destIn = block.vTxContxt[i].destIn;
-                    break;
-                }
-            }
-            if (hashBlock != 0)
-            {
-                break;
-            }
-        }
+        // the tx index and the blocks at the tx height are read in one snapshot of the fork
+        CReadSnapshot snapshot;
+        return ReadInSnapshot(hashFork, snapshot, [&](const CReadSnapshot&) -> bool {
+            return GetChainTransaction(txid, tx, hashFork, nHeight, hashBlock, destIn);
+        });
     }
     return true;
 }
@@ -493,7 +516,7 @@ Errno CService::ListForkAddressUnspent(const uint256& hashFork, const CDestinati
     if (nAmount <= 0)
     {
         map<CTxOutPoint, CUnspentOut> mapUnspent;
-        if (!pDispatcher->FetchAddressUnspent(hashFork, dest, mapUnspent))
+        if (!FetchAddressUnspent(hashFork, dest, mapUnspent))
         {
             StdError("CService", "ListForkAddressUnspent: Fetch address unspent fail, fork: %s", hashFork.GetHex().c_str());
             strErr = "Fetch address unspent fail";
@@ -748,36 +771,30 @@ bool CService::GetDeFiRelation(const uint256& hashFork, const CDestination& dest
 
 bool CService::GetBalanceByUnspent(const CDestination& dest, const uint256& hashFork, CWalletBalance& balance)
 {
-    int32 nForkHeight;
-    uint256 hashLastBlock;
-    if (!GetForkLastBlock(hashFork, nForkHeight, hashLastBlock))
+    // the unspent summary and the fork last block are read in one snapshot of the fork
+    CReadSnapshot snapshot;
+    CUnspentSummary summary;
+    if (!ReadInSnapshot(hashFork, snapshot, [&](const CReadSnapshot&) -> bool {
+            return FetchAddressUnspentSummary(hashFork, dest, summary);
+        }))
     {
-        StdError("CService", "GetBalanceByUnspent: GetForkLastBlock fail, fork: %s", hashFork.GetHex().c_str());
+        StdError("CService", "GetBalanceByUnspent: Fetch address unspent summary fail, fork: %s", hashFork.GetHex().c_str());
         return false;
     }
+    const int32 nForkHeight = snapshot.nBlockHeight;
+    const uint256& hashLastBlock = snapshot.hashBlock;
 
-    map<CTxOutPoint, CUnspentOut> mapUnspent;
-    if (!pDispatcher->FetchAddressUnspent(hashFork, dest, mapUnspent))
+    balance.SetNull();
+    int64 nTotalValue = summary.nTotal;
+    if (summary.nCount > 0 && dest.IsTemplate() && dest.GetTemplateId().GetType() == TEMPLATE_VOTE
+        && !pBlockChain->VerifyDestInvestRedeem(hashLastBlock, dest, true))
     {
-        StdError("CService", "GetBalanceByUnspent: Fetch address unspent fail, fork: %s", hashFork.GetHex().c_str());
-        return false;
+        balance.nLocked = nTotalValue;
     }
-
-    balance.SetNull();
-    int64 nTotalValue = 0;
-    for (const auto& vd : mapUnspent)
+    else
     {
-        nTotalValue += vd.second.nAmount;
-        if (vd.second.IsLocked(nForkHeight)
-            || (dest.IsTemplate() && dest.GetTemplateId().GetType() == TEMPLATE_VOTE
-                && !pBlockChain->VerifyDestInvestRedeem(hashLastBlock, dest, true)))
-        {
-            balance.nLocked += vd.second.nAmount;
-        }
-        else if (vd.second.nHeight < 0)
-        {
-            balance.nUnconfirmed += vd.second.nAmount;
-        }
+        balance.nLocked = summary.GetLocked(nForkHeight);
+        balance.nUnconfirmed = summary.nUnconfirmed - summary.GetUnconfirmedLocked(nForkHeight);
     }
 
     // locked fork template
@@ -799,15 +816,7 @@ bool CService::GetBalanceByUnspent(const CDestination& dest, const uint256& hash
             nLockedCoin = pForkManager->ForkLockedCoin(hashForkLocked, hashLastBlock);
             if (nLockedCoin < 0)
             {
-                nLockedCoin = 0;
-                for (const auto& vd : mapUnspent)
-                {
-                    if (vd.second.nHeight < 0)
-                    {
-                        nLockedCoin = CTemplateFork::CreatedCoin();
-                        break;
-                    }
-                }
+                nLockedCoin = (summary.nUnconfirmed > 0 ? CTemplateFork::CreatedCoin() : 0);
             }
         }
         balance.nLocked += nLockedCoin;
@@ -822,6 +831,16 @@ bool CService::GetBalanceByUnspent(const CDestination& dest, const uint256& hash
 }
 
 bool CService::ListTransaction(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
+{
+    // a tx moved from txpool to a new block must be listed once, so the chain and txpool are read in one snapshot
+    CReadSnapshot snapshot;
+    return ReadInSnapshot(hashFork, snapshot, [&](const CReadSnapshot&) -> bool {
+        vTx.clear();
+        return ReadTransactionList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx);
+    });
+}
+
+bool CService::ReadTransactionList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
 {
     if (nPrevHeight < -1 || nPrevTxSeq == -1)
     {
@@ -840,7 +859,7 @@ bool CService::ListTransaction(const uint256& hashFork, const CDestination& dest
             }
             if (nCount <= 0 || vTxCache.size() < nCount)
             {
-                if (pBlockChain->GetAddressTxList(hashFork, dest, -2, -1, -1, ((nCount > 0) ? (nCount - vTxCache.size()) : 0), vTx) < 0)
+                if (GetAddressTxList(hashFork, dest, -2, -1, -1, ((nCount > 0) ? (nCount - vTxCache.size()) : 0), vTx) < 0)
                 {
                     return false;
                 }
@@ -857,7 +876,7 @@ bool CService::ListTransaction(const uint256& hashFork, const CDestination& dest
         else
         {
             // positive sequence
-            int64 nGetEndOffset = pBlockChain->GetAddressTxList(hashFork, dest, -2, -1, nOffset, nCount, vTx);
+            int64 nGetEndOffset = GetAddressTxList(hashFork, dest, -2, -1, nOffset, nCount, vTx);
             if (nGetEndOffset < 0)
             {
                 return false;
@@ -894,7 +913,7 @@ bool CService::ListTransaction(const uint256& hashFork, const CDestination& dest
     else
     {
         // nPrevHeight and nPrevTxSeq is valid
-        if (pBlockChain->GetAddressTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx) < 0)
+        if (GetAddressTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx) < 0)
         {
             return false;
         }
@@ -985,22 +1004,138 @@ boost::optional<std::string> CService::CreateTransactionByUnspent(const uint256&
     return boost::optional<std::string>{};
 }
 
-Errno CService::SelectCoinsByUnspent(const CDestination& dest, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock,
-                                     int64 nTxTime, int64 nTargetValue, size_t nMaxInput, vector<CTxUnspent>& vCoins, string& strErr)
+boost::optional<std::string> CService::CreateTransactionBatch(const uint256& hashFork, const CDestination& destFrom,
+                                                              const vector<pair<CDestination, int64>>& vSendTo, const int64 nTxFee,
+                                                              const vector<uint8>& vchFromData, vector<CTransaction>& vTxNew)
 {
+    vTxNew.clear();
+    int nForkHeight = 0;
+    uint256 hashLastBlock;
+    {
+        boost::shared_lock<boost::shared_mutex> rlock(rwForkStatus);
+        map<uint256, CForkStatus>::iterator it = mapForkStatus.find(hashFork);
+        if (it == mapForkStatus.end())
+        {
+            StdError("CService", "CreateTransactionBatch: find fork fail, fork: %s", hashFork.GetHex().c_str());
+            return std::string("find fork fail, fork: ") + hashFork.GetHex();
+        }
+        nForkHeight = it->second.nLastBlockHeight;
+        hashLastBlock = it->second.hashLastBlock;
+    }
+
+    CTemplateId tid;
+    if (destFrom.GetTemplateId(tid) && tid.GetType() == TEMPLATE_FORK)
+    {
+        return std::string("Batch is not supported by fork template address");
+    }
+    uint16 nDestTemplateType = (destFrom.IsTemplate() ? destFrom.GetTemplateId().GetType() : 0);
+
+    // one unspent lookup for the whole batch, the later transactions spend the change of the previous one
     map<CTxOutPoint, CUnspentOut> mapUnspent;
-    if (!pDispatcher->FetchAddressUnspent(hashFork, dest, mapUnspent))
+    if (!FetchAddressUnspent(hashFork, destFrom, mapUnspent))
+    {
+        StdError("CService", "CreateTransactionBatch: Fetch address unspent fail, dest: %s", CAddress(destFrom).ToString().c_str());
+        return std::string("Fetch address unspent fail");
+    }
+
+    int64 nTimeStamp = GetNetTime();
+    multimap<int64, CTxOutPoint> mapCoin;
+    for (const auto& vd : mapUnspent)
+    {
+        const CUnspentOut& out = vd.second;
+        if (out.IsLocked(nForkHeight) || out.GetTxTime() > nTimeStamp
+            || (out.nTxType == CTransaction::TX_CERT && vd.first.n == 0)
+            || (out.nTxType == CTransaction::TX_DEFI_REWARD && nDestTemplateType == TEMPLATE_DEXMATCH))
+        {
+            continue;
+        }
+        mapCoin.insert(make_pair(out.nAmount, vd.first));
+    }
+
+    CTxOutPoint outChange;
+    int64 nChange = 0;
+    vTxNew.reserve(vSendTo.size());
+    for (const auto& sendTo : vSendTo)
     {
-        StdError("CService", "SelectCoinsByUnspent: Fetch address unspent fail, dest: %s", CAddress(dest).ToString().c_str());
-        strErr = "Fetch address unspent fail";
-        return ERR_WALLET_NOT_FOUND;
+        CTransaction txNew;
+        txNew.hashAnchor = hashFork;
+        txNew.nType = CTransaction::TX_TOKEN;
+        txNew.nTimeStamp = nTimeStamp;
+        txNew.nLockUntil = 0;
+        txNew.sendTo = sendTo.first;
+        txNew.nAmount = sendTo.second;
+        txNew.nTxFee = nTxFee;
+
+        int64 nTargetValue = txNew.nAmount + txNew.nTxFee;
+        int64 nValueIn = 0;
+        if (nChange > 0)
+        {
+            txNew.vInput.emplace_back(CTxIn(outChange));
+            nValueIn += nChange;
+        }
+        while (nValueIn < nTargetValue && !mapCoin.empty() && txNew.vInput.size() < MAX_TX_INPUT_COUNT)
+        {
+            multimap<int64, CTxOutPoint>::iterator it = mapCoin.lower_bound(nTargetValue - nValueIn);
+            if (it == mapCoin.end())
+            {
+                --it;
+            }
+            txNew.vInput.emplace_back(CTxIn(it->second));
+            nValueIn += it->first;
+            mapCoin.erase(it);
+        }
+        if (nValueIn < nTargetValue)
+        {
+            StdLog("CService", "CreateTransactionBatch: Not enough funds at transfer %lu, balance: %ld, need: %ld, dest: %s",
+                   vTxNew.size(), nValueIn, nTargetValue, CAddress(destFrom).ToString().c_str());
+            string strErr = string("Not enough funds in wallet or account at transfer ") + to_string(vTxNew.size())
+                            + string(", balance: ") + to_string(nValueIn) + string(", need: ") + to_string(nTargetValue);
+            vTxNew.clear();
+            return strErr;
+        }
+
+        // the change input of the next transaction refers to the signed txid
+        bool fCompleted = false;
+        if (!pWallet->SignTransaction(destFrom, txNew, vchFromData, vector<uint8>(), vector<uint8>(), hashFork, nForkHeight, fCompleted) || !fCompleted)
+        {
+            StdError("CService", "CreateTransactionBatch: Sign transaction fail, destIn: %s", CAddress(destFrom).ToString().c_str());
+            vTxNew.clear();
+            return std::string("Failed to sign transaction");
+        }
+
+        nChange = nValueIn - nTargetValue;
+        outChange = CTxOutPoint(txNew.GetHash(), 1);
+        vTxNew.push_back(txNew);
     }
 
+    return boost::optional<std::string>{};
+}
+
+Errno CService::SendTransactionBatch(vector<CTransaction>& vTx, size_t& nSent)
+{
+    return pDispatcher->AddNewTxBatch(vTx, nSent);
+}
+
+Errno CService::SelectCoinsByUnspent(const CDestination& dest, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock,
+                                     int64 nTxTime, int64 nTargetValue, size_t nMaxInput, vector<CTxUnspent>& vCoins, string& strErr)
+{
+    map<CTxOutPoint, CUnspentOut> mapUnspent;
+    bool fFetched = false;
+
     // locked fork template
     CTemplateId tid;
-    if (dest.GetTemplateId(tid) && tid.GetType() == TEMPLATE_FORK
-        && hashFork == pCoreProtocol->GetGenesisBlockHash())
+    bool fLockedFork = (dest.GetTemplateId(tid) && tid.GetType() == TEMPLATE_FORK
+                        && hashFork == pCoreProtocol->GetGenesisBlockHash());
+    if (fLockedFork)
     {
+        if (!FetchAddressUnspent(hashFork, dest, mapUnspent))
+        {
+            StdError("CService", "SelectCoinsByUnspent: Fetch address unspent fail, dest: %s", CAddress(dest).ToString().c_str());
+            strErr = "Fetch address unspent fail";
+            return ERR_WALLET_NOT_FOUND;
+        }
+        fFetched = true;
+
         int64 nLockedCoin = 0;
         CTemplatePtr ptr = GetTemplate(tid);
         if (!ptr)
@@ -1043,45 +1178,142 @@ Errno CService::SelectCoinsByUnspent(const CDestination& dest, const uint256& ha
 
     multimap<int64, CTxUnspent> mapValue;
 
-    for (const auto& vd : mapUnspent)
-    {
-        const CUnspentOut& out = vd.second;
+    auto fnEligible = [&](const CTxOutPoint& txout, const CUnspentOut& out) -> bool {
         if (out.IsLocked(nForkHeight) || out.GetTxTime() > nTxTime
-            || (out.nTxType == CTransaction::TX_CERT && vd.first.n == 0))
+            || (out.nTxType == CTransaction::TX_CERT && txout.n == 0))
         {
-            continue;
+            return false;
         }
-        if (out.nTxType == CTransaction::TX_DEFI_REWARD && nDestTemplateType == TEMPLATE_DEXMATCH)
+        return !(out.nTxType == CTransaction::TX_DEFI_REWARD && nDestTemplateType == TEMPLATE_DEXMATCH);
+    };
+    auto fnCoin = [&](const CTxOutPoint& txout, const CUnspentOut& out) -> pair<int64, CTxUnspent> {
+        return make_pair(out.nAmount, CTxUnspent(txout, CTxOut(dest, out.nAmount, out.nTxTime, out.nLockUntil), out.nTxType, out.nHeight));
+    };
+    auto fnAddLower = [&](const pair<int64, CTxUnspent>& coin) -> bool {
+        mapValue.insert(coin);
+        nTotalLower += coin.first;
+        while (mapValue.size() > nMaxInput)
         {
-            continue;
+            multimap<int64, CTxUnspent>::iterator mi = mapValue.begin();
+            nTotalLower -= (*mi).first;
+            mapValue.erase(mi);
         }
+        return (nTotalLower >= nTargetValue);
+    };
 
-        int64 nValue = out.nAmount;
-        pair<int64, CTxUnspent> coin = make_pair(nValue, CTxUnspent(vd.first, CTxOut(dest, out.nAmount, out.nTxTime, out.nLockUntil), vd.second.nTxType, vd.second.nHeight));
+    // walk the amount ordered index instead of loading every unspent of dest
+    map<CTxOutPoint, CUnspentOut> mapChange;
+    bool fIndexed = (!fLockedFork && pTxPool->GetTxpoolAddressUnspentChange(hashFork, dest, hashLastBlock, mapChange));
+    if (fIndexed)
+    {
+        // coins created by txpool are not in the index, coins spent by txpool are skipped in the walks
+        for (const auto& vd : mapChange)
+        {
+            if (vd.second.IsNull() || !fnEligible(vd.first, vd.second))
+            {
+                continue;
+            }
+            pair<int64, CTxUnspent> coin = fnCoin(vd.first, vd.second);
+            if (coin.first == nTargetValue)
+            {
+                vCoins.push_back(coin.second);
+                return OK;
+            }
+            else if (coin.first < nTargetValue)
+            {
+                fnAddLower(coin);
+            }
+            else if (coin.first < coinLowestLarger.first)
+            {
+                coinLowestLarger = coin;
+            }
+        }
 
-        if (nValue == nTargetValue)
+        // the lowest larger coin is the first eligible one from the target up
+        uint256 hashLastBlockOut;
+        fIndexed = pBlockChain->WalkAddressUnspentByAmount(
+                       hashFork, dest, nTargetValue, false,
+                       [&](const CTxOutPoint& txout, const CUnspentOut& out) -> bool {
+                           if (mapChange.count(txout) || !fnEligible(txout, out))
+                           {
+                               return true;
+                           }
+                           if (out.nAmount < coinLowestLarger.first)
+                           {
+                               coinLowestLarger = fnCoin(txout, out);
+                           }
+                           return false;
+                       },
+                       hashLastBlockOut)
+                   && hashLastBlockOut == hashLastBlock;
+        if (fIndexed && coinLowestLarger.first == nTargetValue)
         {
-            vCoins.push_back(coin.second);
+            vCoins.push_back(coinLowestLarger.second);
             return OK;
         }
-        else if (nValue < nTargetValue)
+
+        // the lower coins are taken from the largest down, smaller ones can not help once nMaxInput is reached
+        if (fIndexed && nTotalLower < nTargetValue && nTargetValue > 1)
+        {
+            fIndexed = pBlockChain->WalkAddressUnspentByAmount(
+                           hashFork, dest, nTargetValue - 1, true,
+                           [&](const CTxOutPoint& txout, const CUnspentOut& out) -> bool {
+                               if (mapChange.count(txout) || !fnEligible(txout, out))
+                               {
+                                   return true;
+                               }
+                               if (mapValue.size() >= nMaxInput && out.nAmount <= mapValue.begin()->first)
+                               {
+                                   return false;
+                               }
+                               return !fnAddLower(fnCoin(txout, out));
+                           },
+                           hashLastBlockOut)
+                       && hashLastBlockOut == hashLastBlock;
+        }
+
+        if (!fIndexed)
+        {
+            mapValue.clear();
+            nTotalLower = 0;
+            coinLowestLarger = pair<int64, CTxUnspent>();
+            coinLowestLarger.first = std::numeric_limits<int64>::max();
+        }
+    }
+
+    if (!fIndexed)
+    {
+        if (!fFetched && !FetchAddressUnspent(hashFork, dest, mapUnspent))
+        {
+            StdError("CService", "SelectCoinsByUnspent: Fetch address unspent fail, dest: %s", CAddress(dest).ToString().c_str());
+            strErr = "Fetch address unspent fail";
+            return ERR_WALLET_NOT_FOUND;
+        }
+
+        for (const auto& vd : mapUnspent)
         {
-            mapValue.insert(coin);
-            nTotalLower += nValue;
-            while (mapValue.size() > nMaxInput)
+            if (!fnEligible(vd.first, vd.second))
             {
-                multimap<int64, CTxUnspent>::iterator mi = mapValue.begin();
-                nTotalLower -= (*mi).first;
-                mapValue.erase(mi);
+                continue;
             }
-            if (nTotalLower >= nTargetValue)
+
+            pair<int64, CTxUnspent> coin = fnCoin(vd.first, vd.second);
+            if (coin.first == nTargetValue)
             {
-                break;
+                vCoins.push_back(coin.second);
+                return OK;
+            }
+            else if (coin.first < nTargetValue)
+            {
+                if (fnAddLower(coin))
+                {
+                    break;
+                }
+            }
+            else if (coin.first < coinLowestLarger.first)
+            {
+                coinLowestLarger = coin;
             }
-        }
-        else if (nValue < coinLowestLarger.first)
-        {
-            coinLowestLarger = coin;
         }
     }
 
@@ -1127,6 +1359,157 @@ Errno CService::SelectCoinsByUnspent(const CDestination& dest, const uint256& ha
     return OK;
 }
 
+bool CService::GetChainTransaction(const uint256& txid, CTransaction& tx, uint256& hashFork, int& nHeight, uint256& hashBlock, CDestination& destIn)
+{
+    hashBlock = 0;
+    if (!pBlockChain->GetTransaction(txid, tx, hashFork, nHeight))
+    {
+        StdLog("CService", "GetChainTransaction: BlockChain GetTransaction fail, txid: %s", txid.GetHex().c_str());
+        return false;
+    }
+
+    std::vector<uint256> vHashBlock;
+    if (!GetBlockHash(hashFork, nHeight, vHashBlock))
+    {
+        StdLog("CService", "GetChainTransaction: GetBlockHash fail, txid: %s, fork: %s, height: %d",
+               txid.GetHex().c_str(), hashFork.GetHex().c_str(), nHeight);
+        return false;
+    }
+    for (const auto& hash : vHashBlock)
+    {
+        CBlockEx block;
+        uint256 tempHashFork;
+        int tempHeight = 0;
+        if (!GetBlockEx(hash, block, tempHashFork, tempHeight))
+        {
+            StdLog("CService", "GetChainTransaction: GetBlockEx fail, txid: %s, block: %s",
+                   txid.GetHex().c_str(), hash.GetHex().c_str());
+            return false;
+        }
+        if (txid == block.txMint.GetHash())
+        {
+            hashBlock = hash;
+            break;
+        }
+        for (int i = 0; i < block.vtx.size(); i++)
+        {
+            if (txid == block.vtx[i].GetHash())
+            {
+                hashBlock = hash;
+                destIn = block.vTxContxt[i].destIn;
+                break;
+            }
+        }
+        if (hashBlock != 0)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CService::FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, map<CTxOutPoint, CUnspentOut>& mapUnspent)
+{
+    uint256 hashLastBlock;
+    if (pWallet->GetWalletUnspent(hashFork, dest, mapUnspent, hashLastBlock))
+    {
+        uint256 hashForkLastBlock;
+        {
+            boost::shared_lock<boost::shared_mutex> rlock(rwForkStatus);
+            map<uint256, CForkStatus>::iterator it = mapForkStatus.find(hashFork);
+            if (it != mapForkStatus.end())
+            {
+                hashForkLastBlock = it->second.hashLastBlock;
+            }
+        }
+        if (hashLastBlock == hashForkLastBlock && pTxPool->GetTxpoolAddressUnspent(hashFork, dest, hashLastBlock, mapUnspent))
+        {
+            return true;
+        }
+        mapUnspent.clear();
+    }
+    return pDispatcher->FetchAddressUnspent(hashFork, dest, mapUnspent);
+}
+
+bool CService::FetchAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary)
+{
+    if (pDispatcher->FetchAddressUnspentSummary(hashFork, dest, summary))
+    {
+        return true;
+    }
+
+    map<CTxOutPoint, CUnspentOut> mapUnspent;
+    if (!FetchAddressUnspent(hashFork, dest, mapUnspent))
+    {
+        return false;
+    }
+    summary.SetNull();
+    for (const auto& vd : mapUnspent)
+    {
+        summary.Add(vd.second, vd.second.nHeight < 0);
+    }
+    return true;
+}
+
+bool CService::GetReadSnapshot(const uint256& hashFork, CReadSnapshot& snapshot)
+{
+    // txpool is synchronized right after the block is committed, and signals when it is done.
+    // Syncing a large block may take a while, so wait up to READ_SNAPSHOT_SYNC_TIME in total,
+    // taking a new snapshot if the fork moves on.
+    const int64 nDeadline = GetTimeMillis() + READ_SNAPSHOT_SYNC_TIME;
+    int64 nWaitMillis = READ_SNAPSHOT_SYNC_TIME;
+    for (int i = 0; i < READ_SNAPSHOT_RETRY; i++)
+    {
+        if (!pBlockChain->GetReadSnapshot(hashFork, snapshot))
+        {
+            return false;
+        }
+        if (pTxPool->WaitLastBlock(hashFork, snapshot.hashBlock, nWaitMillis))
+        {
+            return true;
+        }
+        nWaitMillis = nDeadline - GetTimeMillis();
+        if (nWaitMillis <= 0)
+        {
+            break;
+        }
+    }
+
+    // still read the chain in the snapshot, only the txpool part may lag behind the last block
+    StdLog("CService", "GetReadSnapshot: TxPool is not synchronized to the last block, fork: %s, last block: %s",
+           hashFork.GetHex().c_str(), snapshot.hashBlock.GetHex().c_str());
+    return true;
+}
+
+bool CService::ReadInSnapshot(const uint256& hashFork, CReadSnapshot& snapshot, const boost::function<bool(const CReadSnapshot&)>& fnRead)
+{
+    for (int i = 0; i < READ_SNAPSHOT_RETRY; i++)
+    {
+        if (!GetReadSnapshot(hashFork, snapshot))
+        {
+            StdLog("CService", "ReadInSnapshot: Get read snapshot fail, fork: %s", hashFork.GetHex().c_str());
+            return false;
+        }
+        bool fRead = fnRead(snapshot);
+        if (pBlockChain->VerifyReadSnapshot(snapshot))
+        {
+            return fRead;
+        }
+    }
+    StdLog("CService", "ReadInSnapshot: Fork committed during every read, fork: %s, last block: %s",
+           hashFork.GetHex().c_str(), snapshot.hashBlock.GetHex().c_str());
+    return false;
+}
+
+int64 CService::GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
+{
+    if (!Config()->fAddrTxIndex)
+    {
+        return pWallet->GetWalletTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx);
+    }
+    return pBlockChain->GetAddressTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx);
+}
+
 bool CService::SignOfflineTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchDestInData, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, bool& fCompleted)
 {
     uint256 hashFork;
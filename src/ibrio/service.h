@@ -82,6 +82,10 @@ public:
     boost::optional<std::string> CreateTransactionByUnspent(const uint256& hashFork, const CDestination& destFrom,
                                                             const CDestination& destSendTo, const uint16 nType, const int64 nAmount, const int64 nTxFee, const int nLockHeight,
                                                             const std::vector<unsigned char>& vchData, CTransaction& txNew) override;
+    boost::optional<std::string> CreateTransactionBatch(const uint256& hashFork, const CDestination& destFrom,
+                                                        const std::vector<std::pair<CDestination, int64>>& vSendTo, const int64 nTxFee,
+                                                        const std::vector<uint8>& vchFromData, std::vector<CTransaction>& vTxNew) override;
+    Errno SendTransactionBatch(std::vector<CTransaction>& vTx, std::size_t& nSent) override;
     bool SignOfflineTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchDestInData, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, bool& fCompleted) override;
     Errno SendOfflineSignedTransaction(CTransaction& tx) override;
     bool AesEncrypt(const crypto::CPubKey& pubkeyLocal, const crypto::CPubKey& pubkeyRemote, const std::vector<uint8>& vMessage, std::vector<uint8>& vCiphertext) override;
@@ -104,6 +108,13 @@ protected:
 
     Errno SelectCoinsByUnspent(const CDestination& dest, const uint256& hashFork, int nForkHeight, const uint256& hashLastBlock,
                                int64 nTxTime, int64 nTargetValue, size_t nMaxInput, vector<CTxUnspent>& vCoins, std::string& strErr);
+    bool FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent);
+    bool FetchAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary);
+    bool GetReadSnapshot(const uint256& hashFork, CReadSnapshot& snapshot);
+    bool ReadInSnapshot(const uint256& hashFork, CReadSnapshot& snapshot, const boost::function<bool(const CReadSnapshot&)>& fnRead);
+    bool GetChainTransaction(const uint256& txid, CTransaction& tx, uint256& hashFork, int& nHeight, uint256& hashBlock, CDestination& destIn);
+    bool ReadTransactionList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx);
+    int64 GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx);
 
 protected:
     ICoreProtocol* pCoreProtocol;
@@ -114,6 +125,7 @@ protected:
     CNetwork* pNetwork;
     IForkManager* pForkManager;
     network::INetChannel* pNetChannel;
+    xengine::IIOModule* pRPCMod;
     mutable boost::shared_mutex rwForkStatus;
     std::map<uint256, CForkStatus> mapForkStatus;
 };
@@ -97,6 +97,30 @@ public:
     std::multimap<int, uint256> mapSubline;
 };
 
+// Read snapshot of a fork, the reads made after it are consistent if no block is committed to the fork meanwhile
+class CReadSnapshot
+{
+public:
+    CReadSnapshot()
+      : nBlockHeight(-1), nBlockTime(0), nCommitSeq(0) {}
+    bool IsNull() const
+    {
+        return (hashBlock == 0);
+    }
+    // the reads are consistent if no block was committed to the fork since the snapshot was taken
+    bool IsValid(const uint64 nCommitSeqNow) const
+    {
+        return (nCommitSeqNow == nCommitSeq && (nCommitSeq & 1) == 0);
+    }
+
+public:
+    uint256 hashFork;
+    uint256 hashBlock;
+    int nBlockHeight;
+    int64 nBlockTime;
+    uint64 nCommitSeq;
+};
+
 class CWalletBalance
 {
 public:
@@ -202,6 +226,57 @@ public:
     uint256 hashFork;
     int64 nChange;
     CTransaction txUpdate;
+    CDestination destIn;
+};
+
+class CSubscribeTx
+{
+public:
+    CSubscribeTx() {}
+    CSubscribeTx(const uint256& txidIn, const CTransaction& tx, const CDestination& destInIn)
+      : txid(txidIn), nType(tx.nType), destIn(destInIn), destTo(tx.sendTo), nAmount(tx.nAmount), nTxFee(tx.nTxFee) {}
+
+public:
+    uint256 txid;
+    uint16 nType;
+    CDestination destIn;
+    CDestination destTo;
+    int64 nAmount;
+    int64 nTxFee;
+};
+
+class CSubscribeUpdate
+{
+public:
+    CSubscribeUpdate()
+    {
+        SetNull();
+    }
+    void SetNull()
+    {
+        hashFork = 0;
+        hashBlock = 0;
+        hashPrevBlock = 0;
+        nHeight = -1;
+        nTime = 0;
+        nType = 0;
+        nMintType = 0;
+        vTx.clear();
+    }
+    bool IsBlock() const
+    {
+        return (hashBlock != 0);
+    }
+
+public:
+    uint256 hashFork;
+    uint256 hashBlock;
+    uint256 hashPrevBlock;
+    int nHeight;
+    int64 nTime;
+    uint16 nType;
+    uint16 nMintType;
+    std::vector<CSubscribeTx> vTx;
 };
 
 class CDelegateRoutine
@@ -274,6 +349,35 @@ public:
     std::vector<CDestination> vBallot;
 };
 
+// Result of block header and proof verification, which lets AddNewBlock skip verifying them again
+class CBlockVerify
+{
+public:
+    CBlockVerify()
+    {
+        SetNull();
+    }
+    void SetNull()
+    {
+        hashBlock = 0;
+        nReward = 0;
+        agreement.Clear();
+        nEnrollTrust = 0;
+        pIndexRef = nullptr;
+    }
+    bool IsVerified(const uint256& hash) const
+    {
+        return (hashBlock != 0 && hashBlock == hash);
+    }
+
+public:
+    uint256 hashBlock;
+    int64 nReward;
+    CDelegateAgreement agreement;
+    std::size_t nEnrollTrust;
+    CBlockIndex* pIndexRef;
+};
+
 class CAgreementBlock
 {
 public:
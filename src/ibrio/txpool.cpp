@@ -571,6 +571,22 @@ bool CTxPoolView::GetAddressUnspent(const CDestination& dest, const uint256& has
     return true;
 }
 
+bool CTxPoolView::GetAddressUnspentChange(const CDestination& dest, const uint256& hashChainLastBlock, map<CTxOutPoint, CUnspentOut>& mapChange)
+{
+    if (hashChainLastBlock != hashLastBlock)
+    {
+        StdError("CTxPoolView", "Get address unspent change fail, last block error, chain last block: %s, txpool last block: %s",
+                 hashChainLastBlock.GetHex().c_str(), hashLastBlock.GetHex().c_str());
+        return false;
+    }
+    map<CDestination, CAddrUnspent>::const_iterator it = mapAddressUnspent.find(dest);
+    if (it != mapAddressUnspent.end())
+    {
+        mapChange = it->second.mapTxUnspent;
+    }
+    return true;
+}
+
 //////////////////////////////
 // CCertTxDestCache
 
@@ -737,6 +753,32 @@ size_t CTxPool::Count(const uint256& fork) const
 Errno CTxPool::Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn)
 {
     boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+    return PushTx(tx, hashFork, destIn, nValueIn);
+}
+
+Errno CTxPool::PushBatch(const vector<CTransaction>& vTx, uint256& hashFork, vector<pair<CDestination, int64>>& vTxIn)
+{
+    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+    vTxIn.clear();
+    vTxIn.reserve(vTx.size());
+    for (const CTransaction& tx : vTx)
+    {
+        CDestination destIn;
+        int64 nValueIn = 0;
+        Errno err = PushTx(tx, hashFork, destIn, nValueIn);
+        if (err != OK)
+        {
+            StdLog("CTxPool", "PushBatch: stop at tx %lu of %lu, err: [%d] %s",
+                   vTxIn.size(), vTx.size(), err, ErrorString(err));
+            return err;
+        }
+        vTxIn.push_back(make_pair(destIn, nValueIn));
+    }
+    return OK;
+}
+
+Errno CTxPool::PushTx(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn)
+{
     uint256 txid = tx.GetHash();
 
     if (mapTx.count(txid))
@@ -1298,6 +1340,7 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
 
     mapTxCache[update.hashFork].AddNew(update.hashLastBlock, vtx);
     mapPoolView[update.hashFork].SetLastBlock(update.hashLastBlock, update.nLastBlockTime);
+    NotifyLastBlock(update.hashFork, update.hashLastBlock);
 
     for (const auto& vd : vArrangeTxRemove)
     {
@@ -1369,6 +1412,59 @@ bool CTxPool::GetTxpoolAddressUnspent(const uint256& hashFork, const CDestinatio
     return true;
 }
 
+bool CTxPool::GetTxpoolAddressUnspentChange(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, map<CTxOutPoint, CUnspentOut>& mapChange)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    if (!mapPoolView[hashFork].GetAddressUnspentChange(dest, hashLastBlock, mapChange))
+    {
+        StdError("CTxPool", "Fetch address unspent change: Get txpool address unspent change fail, fork: %s, dest: %s",
+                 hashFork.GetHex().c_str(), CAddress(dest).ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CTxPool::GetTxpoolAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, CUnspentSummary& summary)
+{
+    map<CTxOutPoint, CUnspentOut> mapChange;
+    if (!GetTxpoolAddressUnspentChange(hashFork, dest, hashLastBlock, mapChange))
+    {
+        return false;
+    }
+
+    // outputs created by txpool are added, outputs on chain spent by txpool are removed
+    vector<CTxIn> vSpent;
+    for (const auto& vd : mapChange)
+    {
+        if (vd.second.IsNull())
+        {
+            vSpent.push_back(CTxIn(vd.first));
+        }
+        else
+        {
+            summary.Add(vd.second, true);
+        }
+    }
+    if (!vSpent.empty())
+    {
+        vector<CTxOut> vOutput;
+        if (!pBlockChain->GetTxUnspent(hashFork, vSpent, vOutput))
+        {
+            StdError("CTxPool", "Fetch address unspent summary: Get tx unspent fail, fork: %s, dest: %s",
+                     hashFork.GetHex().c_str(), CAddress(dest).ToString().c_str());
+            return false;
+        }
+        for (const CTxOut& output : vOutput)
+        {
+            if (!output.IsNull() && output.destTo == dest)
+            {
+                summary.Remove(CUnspentOut(output, 0, 0));
+            }
+        }
+    }
+    return true;
+}
+
 bool CTxPool::LoadData()
 {
     boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
@@ -1423,6 +1519,7 @@ bool CTxPool::LoadData()
         mapTxCache[hashFork].AddNew(forkStatus.hashLastBlock, vtx);
 
         mapPoolView[hashFork].SetLastBlock(forkStatus.hashLastBlock, forkStatus.nLastBlockTime);
+        NotifyLastBlock(hashFork, forkStatus.hashLastBlock);
     }
     return true;
 }
@@ -1670,6 +1767,51 @@ void CTxPool::RemovePooledTx(const uint256& txid)
     }
 }
 
+bool CTxPool::GetLastBlock(const uint256& hashFork, uint256& hashLastBlock)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
+    if (it == mapPoolView.end())
+    {
+        return false;
+    }
+    hashLastBlock = it->second.hashLastBlock;
+    return true;
+}
+
+bool CTxPool::WaitLastBlock(const uint256& hashFork, const uint256& hashBlock, const int64 nWaitMillis)
+{
+    boost::system_time const timeout = boost::get_system_time() + boost::posix_time::milliseconds(nWaitMillis);
+    boost::unique_lock<boost::mutex> lock(mtxLastBlock);
+    while (true)
+    {
+        map<uint256, uint256>::const_iterator it = mapLastBlock.find(hashFork);
+        if (it == mapLastBlock.end() || it->second == hashBlock)
+        {
+            return true;
+        }
+        // view is at the same or a higher height on another block, it never reaches hashBlock
+        if (CBlock::GetBlockHeightByHash(it->second) >= CBlock::GetBlockHeightByHash(hashBlock))
+        {
+            return false;
+        }
+        if (!condLastBlock.timed_wait(lock, timeout))
+        {
+            it = mapLastBlock.find(hashFork);
+            return (it == mapLastBlock.end() || it->second == hashBlock);
+        }
+    }
+}
+
+void CTxPool::NotifyLastBlock(const uint256& hashFork, const uint256& hashBlock)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxLastBlock);
+        mapLastBlock[hashFork] = hashBlock;
+    }
+    condLastBlock.notify_all();
+}
+
 int CTxPool::GetDestTxpoolTxCount(const CDestination& dest)
 {
     boost::shared_lock<boost::shared_mutex> wlock(rwPooledTxAccess);
@@ -317,6 +317,7 @@ public:
     }
     void InvalidateSpent(const CTxOutPoint& out, CTxPoolView& viewInvolvedTx);
     bool GetAddressUnspent(const CDestination& dest, const uint256& hashChainLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapUnspent);
+    bool GetAddressUnspentChange(const CDestination& dest, const uint256& hashChainLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapChange);
     void GetBlockTxList(std::vector<CTransaction>& vtx, int64& nTotalTxFee, const int64 nBlockTime, const std::size_t nMaxSize, const uint256& hashFork, const int nHeight,
                         std::map<CDestination, int>& mapVoteCert, const std::map<CDestination, int64>& mapVote, const int64 nMinEnrollAmount, const bool fIsDposHeight,
                         std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove, ICoreProtocol* pCorePro, const uint256& hashLastBlock);
@@ -440,6 +441,7 @@ public:
     void Clear() override;
     std::size_t Count(const uint256& fork) const override;
     Errno Push(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn) override;
+    Errno PushBatch(const std::vector<CTransaction>& vTx, uint256& hashFork, std::vector<std::pair<CDestination, int64>>& vTxIn) override;
     //void Pop(const uint256& txid) override;
     bool Get(const uint256& txid, CTransaction& tx) const override;
     bool Get(const uint256& txid, CAssembledTx& tx) const override;
@@ -457,7 +459,12 @@ public:
     void AddDestDelegate(const CDestination& destDeleage) override;
     //bool FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) override;
     bool GetTxpoolAddressUnspent(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) override;
+    bool GetTxpoolAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, CUnspentSummary& summary) override;
+    bool GetTxpoolAddressUnspentChange(const uint256& hashFork, const CDestination& dest, const uint256& hashLastBlock, std::map<CTxOutPoint, CUnspentOut>& mapChange) override;
     int GetDestTxpoolTxCount(const CDestination& dest) override;
+    bool GetLastBlock(const uint256& hashFork, uint256& hashLastBlock) override;
+    // wait until the fork view is synchronized to hashBlock, return false on timeout or when the view has passed it
+    bool WaitLastBlock(const uint256& hashFork, const uint256& hashBlock, const int64 nWaitMillis) override;
 
 protected:
     bool HandleInitialize() override;
@@ -466,6 +473,7 @@ protected:
     void HandleHalt() override;
     bool LoadData();
     bool SaveData();
+    Errno PushTx(const CTransaction& tx, uint256& hashFork, CDestination& destIn, int64& nValueIn);
     Errno AddNew(CTxPoolView& txView, const uint256& txid, const CTransaction& tx, const uint256& hashFork, int nForkHeight);
     void RemoveTx(const uint256& txid);
     std::map<uint256, CPooledTx>::iterator AddPooledTx(const uint256& txid, const CPooledTx& tx);
@@ -482,6 +490,7 @@ protected:
                              std::vector<CTransaction>& vtx, int64& nTotalTxFee, int nHeight, std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove);
 
     void ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent);
+    void NotifyLastBlock(const uint256& hashFork, const uint256& hashBlock);
 
 protected:
     storage::CTxPoolData datTxPool;
@@ -494,6 +503,10 @@ protected:
     std::map<CDestination, std::pair<int64, int>> mapTxAmount;
     uint64 nLastSequenceNumber;
     std::map<uint256, CTxCache> mapTxCache;
+    // last block of each fork view, guarded by mtxLastBlock so waiters do not take rwAccess
+    boost::mutex mtxLastBlock;
+    boost::condition_variable condLastBlock;
+    std::map<uint256, uint256> mapLastBlock;
     CCertTxDestCache certTxDest;
 };
 
@@ -47,12 +47,42 @@ class CDBAddrWalker : public storage::CWalletDBAddrWalker
     CWallet* pWallet;
 };
 
+//////////////////////////////
+// CDBIndexWalker
+
+class CDBIndexWalker : public storage::CWalletDBIndexWalker
+{
+public:
+    CDBIndexWalker(CWallet* pWalletIn)
+      : pWallet(pWalletIn) {}
+    bool WalkFork(const uint256& hashFork, const uint256& hashLastBlock, const int nExtendedSeq) override
+    {
+        return pWallet->LoadIndexFork(hashFork, hashLastBlock, nExtendedSeq);
+    }
+    bool WalkDest(const uint256& hashFork, const CDestination& dest) override
+    {
+        return pWallet->LoadIndexDest(hashFork, dest);
+    }
+    bool WalkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& out, const CUnspentOut& unspent) override
+    {
+        return pWallet->LoadIndexUnspent(hashFork, dest, out, unspent);
+    }
+    bool WalkTx(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo) override
+    {
+        return pWallet->LoadIndexTx(hashFork, txIndex, txInfo);
+    }
+
+protected:
+    CWallet* pWallet;
+};
+
 //////////////////////////////
 // CWallet
 
 CWallet::CWallet()
 {
     pBlockChain = nullptr;
+    fWalletIndex = false;
 }
 
 CWallet::~CWallet()
@@ -76,7 +106,9 @@ void CWallet::HandleDeinitialize()
 
 bool CWallet::HandleInvoke()
 {
-    if (!dbWallet.Initialize(Config()->pathData / "wallet"))
+    fWalletIndex = Config()->fWalletIndex;
+
+    if (!dbWallet.Initialize(Config()->pathData / "wallet", fWalletIndex))
     {
         Error("Failed to initialize wallet database");
         return false;
@@ -540,6 +572,237 @@ void CWallet::RemoveMemKey(const crypto::CPubKey& pubkey)
     mapMemSignKey.erase(pubkey);
 }
 
+bool CWallet::UpdateWalletIndex(const CBlockChainUpdate& update)
+{
+    if (!fWalletIndex || update.vBlockAddNew.empty())
+    {
+        return true;
+    }
+
+    set<CDestination> setDest;
+    GetDestinations(setDest);
+
+    boost::unique_lock<boost::shared_mutex> wlock(rwWalletIndex);
+
+    CWalletIndexFork& fork = mapWalletIndex[update.hashFork];
+    storage::CWalletIndexChange change;
+    set<CDestination> setResync;
+
+    // vBlockAddNew and vBlockRemove are ordered from the newest block
+    const CBlockEx& blockOldest = (update.vBlockRemove.empty() ? update.vBlockAddNew.back() : update.vBlockRemove.back());
+    bool fContinuous = (fork.hashLastBlock == blockOldest.hashPrev);
+
+    for (auto it = fork.mapUnspent.begin(); it != fork.mapUnspent.end();)
+    {
+        const CDestination dest = (it++)->first;
+        if (!setDest.count(dest))
+        {
+            RemoveIndexDest(fork, dest, change);
+        }
+        else if (!fContinuous)
+        {
+            setResync.insert(dest);
+        }
+    }
+    for (const CDestination& dest : setDest)
+    {
+        if (!fork.mapUnspent.count(dest))
+        {
+            setResync.insert(dest);
+        }
+    }
+
+    if (!update.vBlockRemove.empty())
+    {
+        // unspent of the undo destinations is reloaded from address unspent db
+        set<uint256> setTxRemove;
+        for (const CBlockEx& block : update.vBlockRemove)
+        {
+            setTxRemove.insert(block.txMint.GetHash());
+            setResync.insert(block.txMint.sendTo);
+            for (int i = 0; i < block.vtx.size(); i++)
+            {
+                setTxRemove.insert(block.vtx[i].GetHash());
+                setResync.insert(block.vtx[i].sendTo);
+                setResync.insert(block.vTxContxt[i].destIn);
+            }
+        }
+        int nHeightRemove = update.vBlockRemove.back().GetBlockHeight();
+        for (auto it = fork.mapTx.begin(); it != fork.mapTx.end();)
+        {
+            if (it->first.GetHeight() >= nHeightRemove && setTxRemove.count(it->first.txid))
+            {
+                change.mapTx[it->first] = CAddrTxInfo();
+                fork.mapTx.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    int nExtendedSeq = fork.nExtendedSeq;
+    if (!fContinuous || !update.vBlockRemove.empty())
+    {
+        nExtendedSeq = GetExtendedSequence(update.vBlockAddNew.back().hashPrev);
+    }
+
+    for (auto it = update.vBlockAddNew.rbegin(); it != update.vBlockAddNew.rend(); ++it)
+    {
+        const CBlockEx& block = *it;
+        int nHeight = block.GetBlockHeight();
+        nExtendedSeq = (block.IsExtended() ? nExtendedSeq + 1 : 0);
+
+        if (!block.txMint.sendTo.IsNull())
+        {
+            AddIndexTx(fork, block.txMint, CTxContxt(), nHeight, nExtendedSeq, 0, setDest, setResync, change);
+        }
+        for (int i = 0; i < block.vtx.size(); i++)
+        {
+            AddIndexTx(fork, block.vtx[i], block.vTxContxt[i], nHeight, nExtendedSeq, i + 1, setDest, setResync, change);
+        }
+    }
+
+    for (const CDestination& dest : setResync)
+    {
+        if (setDest.count(dest) && !ResyncIndexUnspent(update.hashFork, fork, dest, update.hashLastBlock, change))
+        {
+            // retry on the next update
+            RemoveIndexDest(fork, dest, change);
+        }
+    }
+
+    fork.hashLastBlock = update.hashLastBlock;
+    fork.nExtendedSeq = nExtendedSeq;
+    change.hashLastBlock = fork.hashLastBlock;
+    change.nExtendedSeq = fork.nExtendedSeq;
+
+    if (!dbWallet.UpdateIndex(update.hashFork, change))
+    {
+        // force reloading unspent on the next update
+        fork.hashLastBlock = 0;
+        StdError("CWallet", "UpdateWalletIndex: Update index fail, fork: %s", update.hashFork.GetHex().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CWallet::GetWalletUnspent(const uint256& hashFork, const CDestination& dest, map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut)
+{
+    if (!fWalletIndex)
+    {
+        return false;
+    }
+
+    boost::shared_lock<boost::shared_mutex> rlock(rwWalletIndex);
+    auto it = mapWalletIndex.find(hashFork);
+    if (it == mapWalletIndex.end() || it->second.hashLastBlock == 0)
+    {
+        return false;
+    }
+    auto mt = it->second.mapUnspent.find(dest);
+    if (mt == it->second.mapUnspent.end())
+    {
+        return false;
+    }
+    mapUnspent.insert(mt->second.begin(), mt->second.end());
+    hashLastBlockOut = it->second.hashLastBlock;
+    return true;
+}
+
+int64 CWallet::GetWalletTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
+{
+    if (!fWalletIndex || dest.IsNull())
+    {
+        return -1;
+    }
+
+    boost::shared_lock<boost::shared_mutex> rlock(rwWalletIndex);
+    auto it = mapWalletIndex.find(hashFork);
+    if (it == mapWalletIndex.end() || !it->second.mapUnspent.count(dest))
+    {
+        return -1;
+    }
+    const map<CAddrTxIndex, CAddrTxInfo>& mapTx = it->second.mapTx;
+
+    const bool fFromPrev = (nPrevHeight >= -1 && nPrevTxSeq != -1);
+    const int64 nPrevHeightSeq = (((int64)nPrevHeight << 32) | (nPrevTxSeq & 0xFFFFFFFFL));
+    vector<map<CAddrTxIndex, CAddrTxInfo>::const_iterator> vIt;
+    for (auto mt = mapTx.lower_bound(CAddrTxIndex(dest, (int64)0, uint256())); mt != mapTx.end() && mt->first.dest == dest; ++mt)
+    {
+        if (!fFromPrev || mt->first.nHeightSeq > nPrevHeightSeq)
+        {
+            vIt.push_back(mt);
+        }
+    }
+
+    // the page is [nBegin, nEnd) in positive sequence
+    const int64 nTotal = vIt.size();
+    int64 nBegin, nEnd, nEndPos;
+    if (fFromPrev)
+    {
+        nBegin = 0;
+        nEnd = (nCount > 0 ? std::min(nCount, nTotal) : nTotal);
+        nEndPos = nEnd;
+    }
+    else if (nOffset < 0)
+    {
+        nBegin = (nCount >= 0 ? std::max(nTotal - nCount, (int64)0) : 0);
+        nEnd = nTotal;
+        nEndPos = nTotal;
+    }
+    else
+    {
+        nBegin = std::min(nOffset, nTotal);
+        nEnd = (nCount > 0 ? std::min(nOffset + nCount, nTotal) : nTotal);
+        nEndPos = std::max(nBegin, nEnd);
+    }
+
+    for (int64 i = nBegin; i < nEnd; i++)
+    {
+        const CAddrTxIndex& txIndex = vIt[i]->first;
+        const CAddrTxInfo& txInfo = vIt[i]->second;
+        if (txInfo.nDirection == CAddrTxInfo::TXI_DIRECTION_TO)
+        {
+            vTx.push_back(CTxInfo(txIndex.txid, hashFork, txInfo.nTxType, txInfo.nTimeStamp, txInfo.nLockUntil, txIndex.GetHeight(),
+                                  txIndex.GetSeq(), txInfo.destPeer, txIndex.dest, txInfo.nAmount, txInfo.nTxFee, 0));
+        }
+        else
+        {
+            vTx.push_back(CTxInfo(txIndex.txid, hashFork, txInfo.nTxType, txInfo.nTimeStamp, txInfo.nLockUntil, txIndex.GetHeight(),
+                                  txIndex.GetSeq(), txIndex.dest, txInfo.destPeer, txInfo.nAmount, txInfo.nTxFee, 0));
+        }
+    }
+    return nEndPos;
+}
+
+bool CWallet::LoadIndexFork(const uint256& hashFork, const uint256& hashLastBlock, const int nExtendedSeq)
+{
+    CWalletIndexFork& fork = mapWalletIndex[hashFork];
+    fork.hashLastBlock = hashLastBlock;
+    fork.nExtendedSeq = nExtendedSeq;
+    return true;
+}
+
+bool CWallet::LoadIndexDest(const uint256& hashFork, const CDestination& dest)
+{
+    mapWalletIndex[hashFork].mapUnspent[dest];
+    return true;
+}
+
+bool CWallet::LoadIndexUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& out, const CUnspentOut& unspent)
+{
+    mapWalletIndex[hashFork].mapUnspent[dest].insert(make_pair(out, unspent));
+    return true;
+}
+
+bool CWallet::LoadIndexTx(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo)
+{
+    mapWalletIndex[hashFork].mapTx.insert(make_pair(txIndex, txInfo));
+    return true;
+}
+
 bool CWallet::GetSendToDestRecorded(const CTransaction& tx, const int nHeight, const vector<uint8>& vchSendToData, vector<uint8>& vchDestData)
 {
     CTemplateId tid;
@@ -565,24 +828,170 @@ bool CWallet::GetSendToDestRecorded(const CTransaction& tx, const int nHeight, c
     return true;
 }
 
-bool CWallet::LoadDB()
+int CWallet::GetExtendedSequence(const uint256& hashBlock)
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwKeyStore);
+    int nSeq = 0;
+    uint256 hash = hashBlock;
+    CBlock block;
+    while (hash != 0 && pBlockChain->GetBlock(hash, block) && block.IsExtended())
+    {
+        nSeq++;
+        hash = block.hashPrev;
+    }
+    return nSeq;
+}
+
+void CWallet::AddIndexTx(CWalletIndexFork& fork, const CTransaction& tx, const CTxContxt& txContxt, const int nHeight, const int nBlockSeq, const int nTxSeq,
+                         const set<CDestination>& setDest, const set<CDestination>& setResync, storage::CWalletIndexChange& change)
+{
+    const uint256 txid = tx.GetHash();
+    const CDestination& destIn = txContxt.destIn;
+
+    auto fnAddTx = [&](const CDestination& dest, const int nDirection, const CDestination& destPeer) {
+        if (setDest.count(dest))
+        {
+            CAddrTxIndex txIndex(dest, nHeight, nBlockSeq, nTxSeq, txid);
+            CAddrTxInfo txInfo(nDirection, destPeer, tx);
+            fork.mapTx[txIndex] = txInfo;
+            change.mapTx[txIndex] = txInfo;
+        }
+    };
+    if (tx.IsRewardTx())
+    {
+        fnAddTx(tx.sendTo, CAddrTxInfo::TXI_DIRECTION_TO, CDestination());
+    }
+    else if (tx.sendTo == destIn)
+    {
+        fnAddTx(destIn, CAddrTxInfo::TXI_DIRECTION_TWO, tx.sendTo);
+    }
+    else
+    {
+        if (!destIn.IsNull())
+        {
+            fnAddTx(destIn, CAddrTxInfo::TXI_DIRECTION_FROM, tx.sendTo);
+        }
+        fnAddTx(tx.sendTo, CAddrTxInfo::TXI_DIRECTION_TO, destIn);
+    }
+
+    // same unspent changes as CBlockView::AddTx
+    auto fnUnspent = [&](const CDestination& dest) -> map<CTxOutPoint, CUnspentOut>* {
+        if (setResync.count(dest))
+        {
+            return nullptr;
+        }
+        auto it = fork.mapUnspent.find(dest);
+        return (it != fork.mapUnspent.end() ? &it->second : nullptr);
+    };
+    map<CTxOutPoint, CUnspentOut>* pUnspentIn = fnUnspent(destIn);
+    if (pUnspentIn != nullptr)
+    {
+        for (const CTxIn& txin : tx.vInput)
+        {
+            pUnspentIn->erase(txin.prevout);
+            change.mapUnspent[make_pair(destIn, txin.prevout)] = CUnspentOut();
+        }
+    }
+    CTxOut output0(tx);
+    map<CTxOutPoint, CUnspentOut>* pUnspentTo = fnUnspent(tx.sendTo);
+    if (!output0.IsNull() && pUnspentTo != nullptr)
+    {
+        CUnspentOut unspent(output0, tx.nType, nHeight);
+        (*pUnspentTo)[CTxOutPoint(txid, 0)] = unspent;
+        change.mapUnspent[make_pair(tx.sendTo, CTxOutPoint(txid, 0))] = unspent;
+    }
+    CTxOut output1(tx, destIn, txContxt.GetValueIn());
+    if (!output1.IsNull() && pUnspentIn != nullptr)
+    {
+        CUnspentOut unspent(output1, tx.nType, nHeight);
+        (*pUnspentIn)[CTxOutPoint(txid, 1)] = unspent;
+        change.mapUnspent[make_pair(destIn, CTxOutPoint(txid, 1))] = unspent;
+    }
+}
 
-    CDBAddrWalker walker(this);
-    if (!dbWallet.WalkThroughAddress(walker))
+bool CWallet::ResyncIndexUnspent(const uint256& hashFork, CWalletIndexFork& fork, const CDestination& dest, const uint256& hashLastBlock, storage::CWalletIndexChange& change)
+{
+    map<CTxOutPoint, CUnspentOut> mapUnspent;
+    uint256 hashUnspentBlock;
+    if (!pBlockChain->GetAddressUnspent(hashFork, dest, mapUnspent, hashUnspentBlock) || hashUnspentBlock != hashLastBlock)
     {
-        StdLog("CWallet", "LoadDB: WalkThroughAddress fail.");
+        StdLog("CWallet", "ResyncIndexUnspent: Get address unspent fail, fork: %s, dest: %s",
+               hashFork.GetHex().c_str(), CAddress(dest).ToString().c_str());
         return false;
     }
+
+    map<CTxOutPoint, CUnspentOut>& mapIndex = fork.mapUnspent[dest];
+    for (const auto& vd : mapIndex)
+    {
+        if (!mapUnspent.count(vd.first))
+        {
+            change.mapUnspent[make_pair(dest, vd.first)] = CUnspentOut();
+        }
+    }
+    for (const auto& vd : mapUnspent)
+    {
+        auto it = mapIndex.find(vd.first);
+        if (it == mapIndex.end() || it->second != vd.second)
+        {
+            change.mapUnspent[make_pair(dest, vd.first)] = vd.second;
+        }
+    }
+    mapIndex.swap(mapUnspent);
+    change.mapDest[dest] = true;
+    return true;
+}
+
+void CWallet::RemoveIndexDest(CWalletIndexFork& fork, const CDestination& dest, storage::CWalletIndexChange& change)
+{
+    auto it = fork.mapUnspent.find(dest);
+    if (it != fork.mapUnspent.end())
+    {
+        for (const auto& vd : it->second)
+        {
+            change.mapUnspent[make_pair(dest, vd.first)] = CUnspentOut();
+        }
+        fork.mapUnspent.erase(it);
+    }
+    change.mapDest[dest] = false;
+}
+
+bool CWallet::LoadDB()
+{
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwKeyStore);
+
+        CDBAddrWalker walker(this);
+        if (!dbWallet.WalkThroughAddress(walker))
+        {
+            StdLog("CWallet", "LoadDB: WalkThroughAddress fail.");
+            return false;
+        }
+    }
+
+    if (fWalletIndex)
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwWalletIndex);
+
+        CDBIndexWalker walker(this);
+        if (!dbWallet.WalkThroughIndex(walker))
+        {
+            StdLog("CWallet", "LoadDB: WalkThroughIndex fail.");
+            return false;
+        }
+    }
     return true;
 }
 
 void CWallet::Clear()
 {
-    boost::unique_lock<boost::shared_mutex> wlock(rwKeyStore);
-    mapKeyStore.clear();
-    mapTemplatePtr.clear();
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwKeyStore);
+        mapKeyStore.clear();
+        mapTemplatePtr.clear();
+    }
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwWalletIndex);
+        mapWalletIndex.clear();
+    }
 }
 
 bool CWallet::InsertKey(const crypto::CKey& key)
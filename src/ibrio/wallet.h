@@ -53,6 +53,19 @@ public:
     std::multimap<int, uint256> mapSubline;
 };
 
+class CWalletIndexFork
+{
+public:
+    CWalletIndexFork()
+      : nExtendedSeq(0) {}
+
+public:
+    uint256 hashLastBlock;
+    int nExtendedSeq;
+    std::map<CDestination, std::map<CTxOutPoint, CUnspentOut>> mapUnspent;
+    std::map<CAddrTxIndex, CAddrTxInfo> mapTx;
+};
+
 class CWallet : public IWallet
 {
 public:
@@ -91,6 +104,14 @@ public:
     /* Update */
     bool AddMemKey(const uint256& secret, crypto::CPubKey& pubkey) override;
     void RemoveMemKey(const crypto::CPubKey& pubkey) override;
+    /* Wallet index */
+    bool UpdateWalletIndex(const CBlockChainUpdate& update) override;
+    bool GetWalletUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) override;
+    int64 GetWalletTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) override;
+    bool LoadIndexFork(const uint256& hashFork, const uint256& hashLastBlock, const int nExtendedSeq);
+    bool LoadIndexDest(const uint256& hashFork, const CDestination& dest);
+    bool LoadIndexUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& out, const CUnspentOut& unspent);
+    bool LoadIndexTx(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo);
 
 protected:
     bool HandleInitialize() override;
@@ -110,6 +131,11 @@ protected:
                          std::set<crypto::CPubKey>& setSignedKey, bool& fCompleted);
     void UpdateAutoLock(const std::set<crypto::CPubKey>& setSignedKey);
     bool GetSendToDestRecorded(const CTransaction& tx, const int nHeight, const std::vector<uint8>& vchSendToData, std::vector<uint8>& vchDestData);
+    int GetExtendedSequence(const uint256& hashBlock);
+    void AddIndexTx(CWalletIndexFork& fork, const CTransaction& tx, const CTxContxt& txContxt, const int nHeight, const int nBlockSeq, const int nTxSeq,
+                    const std::set<CDestination>& setDest, const std::set<CDestination>& setResync, storage::CWalletIndexChange& change);
+    bool ResyncIndexUnspent(const uint256& hashFork, CWalletIndexFork& fork, const CDestination& dest, const uint256& hashLastBlock, storage::CWalletIndexChange& change);
+    void RemoveIndexDest(CWalletIndexFork& fork, const CDestination& dest, storage::CWalletIndexChange& change);
 
 protected:
     storage::CWalletDB dbWallet;
@@ -118,6 +144,9 @@ protected:
     std::map<crypto::CPubKey, CWalletKeyStore> mapKeyStore;
     std::map<CTemplateId, CTemplatePtr> mapTemplatePtr;
     std::map<crypto::CPubKey, uint256> mapMemSignKey;
+    bool fWalletIndex;
+    mutable boost::shared_mutex rwWalletIndex;
+    std::map<uint256, CWalletIndexFork> mapWalletIndex;
 };
 
 // dummy wallet for on wallet server
@@ -227,6 +256,19 @@ public:
     virtual void RemoveMemKey(const crypto::CPubKey& pubkey) override
     {
     }
+    /* Wallet index */
+    virtual bool UpdateWalletIndex(const CBlockChainUpdate& update) override
+    {
+        return true;
+    }
+    virtual bool GetWalletUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) override
+    {
+        return false;
+    }
+    virtual int64 GetWalletTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) override
+    {
+        return -1;
+    }
 };
 
 } // namespace ibrio
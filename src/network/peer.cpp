@@ -7,6 +7,9 @@
 #include "crypto.h"
 #include "peernet.h"
 
+// Payloads at least this large are verified on a worker thread of peer net
+#define MESSAGE_PAYLOAD_ASYNC_VERIFY_SIZE (64 * 1024)
+
 using namespace std;
 using namespace xengine;
 
@@ -15,12 +18,79 @@ namespace ibrio
 namespace network
 {
 
+//////////////////////////////
+// CPeerSendQueue
+
+CPeerSendQueue::CPeerSendQueue()
+{
+    Clear();
+}
+
+void CPeerSendQueue::Clear()
+{
+    for (int i = 0; i < SEND_PRIORITY_COUNT; i++)
+    {
+        queSend[i].clear();
+        nSendQueueSize[i] = 0;
+    }
+}
+
+bool CPeerSendQueue::IsEmpty() const
+{
+    for (int i = 0; i < SEND_PRIORITY_COUNT; i++)
+    {
+        if (!queSend[i].empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CPeerSendQueue::GetSize() const
+{
+    size_t nSize = 0;
+    for (int i = 0; i < SEND_PRIORITY_COUNT; i++)
+    {
+        nSize += nSendQueueSize[i];
+    }
+    return nSize;
+}
+
+bool CPeerSendQueue::Check(size_t nBufferSize, size_t nMessageSize, int nPriority) const
+{
+    return (nBufferSize + GetSize() + nMessageSize <= MAX_SEND_QUEUE_SIZE
+            && (nPriority != SEND_PRIORITY_LOW || nSendQueueSize[SEND_PRIORITY_LOW] + nMessageSize <= MAX_SEND_LOW_QUEUE_SIZE));
+}
+
+void CPeerSendQueue::Push(const CSendMessage& msg, int nPriority)
+{
+    queSend[nPriority].push_back(msg);
+    nSendQueueSize[nPriority] += msg.GetSize();
+}
+
+bool CPeerSendQueue::Pop(CSendMessage& msg)
+{
+    // Control messages (handshake, ping/pong) go first, so a data burst does not delay keepalives
+    for (int i = 0; i < SEND_PRIORITY_COUNT; i++)
+    {
+        if (!queSend[i].empty())
+        {
+            msg = queSend[i].front();
+            nSendQueueSize[i] -= msg.GetSize();
+            queSend[i].pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
 //////////////////////////////
 // CBbPeer
 
 CBbPeer::CBbPeer(CPeerNet* pPeerNetIn, CIOClient* pClientIn, uint64 nNonceIn,
                  bool fInBoundIn, uint32 nMsgMagicIn, uint32 nHsTimerIdIn)
-  : CPeer(pPeerNetIn, pClientIn, nNonceIn, fInBoundIn), nMsgMagic(nMsgMagicIn), nHsTimerId(nHsTimerIdIn), nPingTimerId(0), nPingMillisTime(0), nPingSeq(0)
+  : CPeer(pPeerNetIn, pClientIn, nNonceIn, fInBoundIn), nMsgMagic(nMsgMagicIn), nHsTimerId(nHsTimerIdIn), nPingTimerId(0), nPingMillisTime(0), nPingSeq(0), nInvTimerId(0), fSendOverflow(false)
 {
 }
 
@@ -43,6 +113,9 @@ void CBbPeer::Activate()
     nPingMillisTime = 0;
     nPingSeq = 0;
 
+    queSend.Clear();
+    fSendOverflow = false;
+
     Read(MESSAGE_HEADER_SIZE, boost::bind(&CBbPeer::HandshakeReadHeader, this));
     if (!fInBound)
     {
@@ -55,51 +128,153 @@ bool CBbPeer::IsHandshaked()
     return (nHsTimerId == 0);
 }
 
-bool CBbPeer::SendMessage(int nChannel, int nCommand, CBufStream& ssPayload)
+bool CBbPeer::SendMessage(int nChannel, int nCommand, CBufStream& ssPayload, int nPriority)
 {
+    if (nChannel == PROTO_CHN_NETWORK)
+    {
+        nPriority = SEND_PRIORITY_CONTROL;
+    }
+    const uint8* pPayload = (const uint8*)ssPayload.GetData();
+    size_t nPayloadSize = ssPayload.GetSize();
+    vector<uint8> vchSnappy;
+    if (IsSnappyEnabled(nChannel, nPayloadSize) && CompressPayload(pPayload, nPayloadSize, vchSnappy))
+    {
+        nCommand |= MESSAGE_COMMAND_SNAPPY;
+        pPayload = vchSnappy.data();
+        nPayloadSize = vchSnappy.size();
+    }
+
+    uint32 nPayloadChecksum = ibrio::crypto::CryptoHash(pPayload, nPayloadSize).Get32();
     CPeerMessageHeader hdrSend;
-    hdrSend.nMagic = nMsgMagic;
-    hdrSend.nType = CPeerMessageHeader::GetMessageType(nChannel, nCommand);
-    hdrSend.nPayloadSize = ssPayload.GetSize();
-    hdrSend.nPayloadChecksum = ibrio::crypto::CryptoHash(ssPayload.GetData(), ssPayload.GetSize()).Get32();
-    hdrSend.nHeaderChecksum = hdrSend.GetHeaderChecksum();
+    if (!MakeMessageHeader(nChannel, nCommand, nPayloadSize, nPayloadChecksum, hdrSend)
+        || !CheckSendQueue(nPayloadSize, nPriority))
+    {
+        return false;
+    }
+
+    if (queSend.IsEmpty() && WriteStream().GetSize() < SEND_BATCH_SIZE)
+    {
+        WriteMessage(hdrSend, pPayload, nPayloadSize);
+        Write();
+        return true;
+    }
 
-    if (!hdrSend.Verify())
+    std::shared_ptr<CEventPeerRawPayload> spPayload(new CEventPeerRawPayload());
+    spPayload->vchPayload.assign(pPayload, pPayload + nPayloadSize);
+    spPayload->nChecksum = nPayloadChecksum;
+
+    CSendMessage msg;
+    msg.hdrSend = hdrSend;
+    msg.spPayload = spPayload;
+    queSend.Push(msg, nPriority);
+    FlushSendQueue();
+    return true;
+}
+
+bool CBbPeer::SendMessage(int nChannel, int nCommand, std::shared_ptr<const CEventPeerRawPayload> spPayload, int nPriority)
+{
+    if (!spPayload)
+    {
+        return false;
+    }
+    if (nChannel == PROTO_CHN_NETWORK)
+    {
+        nPriority = SEND_PRIORITY_CONTROL;
+    }
+
+    CSendMessage msg;
+    msg.spPayload = spPayload;
+    uint32 nPayloadChecksum = spPayload->nChecksum;
+    if (!spPayload->vchSnappy.empty() && IsSnappyEnabled(nChannel, spPayload->vchPayload.size()))
+    {
+        msg.fSnappy = true;
+        nCommand |= MESSAGE_COMMAND_SNAPPY;
+        nPayloadChecksum = spPayload->nSnappyChecksum;
+    }
+
+    size_t nPayloadSize = msg.GetPayload().size();
+    if (!MakeMessageHeader(nChannel, nCommand, nPayloadSize, nPayloadChecksum, msg.hdrSend)
+        || !CheckSendQueue(nPayloadSize, nPriority))
     {
         return false;
     }
 
-    WriteStream() << hdrSend << ssPayload;
-    Write();
+    queSend.Push(msg, nPriority);
+    FlushSendQueue();
     return true;
 }
 
-uint32 CBbPeer::Request(const CInv& inv, uint32 nTimerId)
+void CBbPeer::FlushSendQueue()
+{
+    CSendMessage msg;
+    while (WriteStream().GetSize() < SEND_BATCH_SIZE && queSend.Pop(msg))
+    {
+        const vector<uint8>& vchPayload = msg.GetPayload();
+        WriteMessage(msg.hdrSend, vchPayload.data(), vchPayload.size());
+    }
+
+    if (WriteStream().GetSize() > 0)
+    {
+        Write();
+    }
+}
+
+bool CBbPeer::MakeMessageHeader(int nChannel, int nCommand, size_t nPayloadSize, uint32 nPayloadChecksum, CPeerMessageHeader& hdrSend)
+{
+    hdrSend.nMagic = nMsgMagic;
+    hdrSend.nType = CPeerMessageHeader::GetMessageType(nChannel, nCommand);
+    hdrSend.nPayloadSize = nPayloadSize;
+    hdrSend.nPayloadChecksum = nPayloadChecksum;
+    hdrSend.nHeaderChecksum = hdrSend.GetHeaderChecksum();
+
+    return (nPayloadSize <= MESSAGE_PAYLOAD_MAX_SIZE && hdrSend.Verify());
+}
+
+bool CBbPeer::IsSnappyEnabled(int nChannel, size_t nPayloadSize)
 {
-    uint32 nPrevTimerId = 0;
-    map<CInv, uint32>::iterator it = mapRequest.find(inv);
-    if (it != mapRequest.end())
+    return (nChannel == PROTO_CHN_DATA && (nService & NODE_SNAPPY) && nPayloadSize >= MESSAGE_PAYLOAD_SNAPPY_SIZE);
+}
+
+bool CBbPeer::CheckSendQueue(size_t nSize, int nPriority)
+{
+    // Slow peer which can not keep up with its outbound data is dropped by peer net,
+    // instead of letting the send buffer grow without bound
+    if (fSendOverflow || !queSend.Check(WriteStream().GetSize(), MESSAGE_HEADER_SIZE + nSize, nPriority))
     {
-        nPrevTimerId = (*it).second;
-        (*it).second = nTimerId;
+        fSendOverflow = true;
+        return false;
     }
-    else
+    return true;
+}
+
+void CBbPeer::WriteMessage(const CPeerMessageHeader& hdrSend, const uint8* pPayload, size_t nPayloadSize)
+{
+    CBufStream& ssWrite = WriteStream();
+    ssWrite << hdrSend;
+    if (nPayloadSize > 0)
     {
-        mapRequest.insert(make_pair(inv, nTimerId));
+        ssWrite.Write((const char*)pPayload, nPayloadSize);
     }
-    return nPrevTimerId;
 }
 
-uint32 CBbPeer::Responded(const CInv& inv)
+void CBbPeer::Request(const CInv& inv, int64 nTimeout)
 {
-    uint32 nTimerId = 0;
-    std::map<CInv, uint32>::iterator it = mapRequest.find(inv);
-    if (it != mapRequest.end())
+    mapRequest[inv] = nTimeout;
+}
+
+bool CBbPeer::Responded(const CInv& inv)
+{
+    return (mapRequest.erase(inv) > 0);
+}
+
+int64 CBbPeer::GetRequestTimeout() const
+{
+    int64 nTimeout = 0;
+    for (const auto& kv : mapRequest)
     {
-        nTimerId = (*it).second;
-        mapRequest.erase(it);
+        nTimeout = std::max(nTimeout, kv.second);
     }
-    return nTimerId;
+    return nTimeout;
 }
 
 void CBbPeer::AskFor(const uint256& hashFork, const vector<CInv>& vInv)
@@ -259,12 +434,38 @@ bool CBbPeer::HandshakeCompleted()
 bool CBbPeer::HandleReadCompleted()
 {
     CBufStream& ss = ReadStream();
+    if (ss.GetSize() >= MESSAGE_PAYLOAD_ASYNC_VERIFY_SIZE)
+    {
+        // No further read is issued until the payload has been verified,
+        // so the messages of this peer are still handled in order
+        return (static_cast<CBbPeerNet*>(pPeerNet))->VerifyPeerPayload(this, ss, hdrRecv.nPayloadChecksum);
+    }
     uint256 hash = ibrio::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-    if (hdrRecv.nPayloadChecksum == hash.Get32())
+    return HandlePayloadVerified(hdrRecv.nPayloadChecksum == hash.Get32());
+}
+
+bool CBbPeer::HandlePayloadVerified(bool fValid)
+{
+    CBufStream& ss = ReadStream();
+    if (fValid)
     {
         try
         {
-            if ((dynamic_cast<CBbPeerNet*>(pPeerNet))->HandlePeerRecvMessage(this, hdrRecv.GetChannel(), hdrRecv.GetCommand(), ss))
+            int nChannel = hdrRecv.GetChannel();
+            int nCommand = hdrRecv.GetCommand();
+            CBufStream ssUncompressed;
+            CBufStream* pss = &ss;
+            if (nChannel == PROTO_CHN_DATA && (nCommand & MESSAGE_COMMAND_SNAPPY))
+            {
+                if (!UncompressPayload((const uint8*)ss.GetData(), ss.GetSize(), ssUncompressed))
+                {
+                    StdError("CBbPeer", "Uncompress payload fail, command: %d", nCommand);
+                    return false;
+                }
+                nCommand &= ~MESSAGE_COMMAND_SNAPPY;
+                pss = &ssUncompressed;
+            }
+            if ((dynamic_cast<CBbPeerNet*>(pPeerNet))->HandlePeerRecvMessage(this, nChannel, nCommand, *pss))
             {
                 Read(MESSAGE_HEADER_SIZE, boost::bind(&CBbPeer::HandleReadHeader, this));
                 return true;
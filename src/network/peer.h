@@ -7,6 +7,7 @@
 
 #include <boost/bind.hpp>
 
+#include "peerevent.h"
 #include "proto.h"
 #include "xengine.h"
 
@@ -16,27 +17,101 @@ namespace ibrio
 namespace network
 {
 
+class CSendMessage
+{
+public:
+    CSendMessage()
+      : fSnappy(false) {}
+    const std::vector<uint8>& GetPayload() const
+    {
+        return (fSnappy ? spPayload->vchSnappy : spPayload->vchPayload);
+    }
+    std::size_t GetSize() const
+    {
+        return MESSAGE_HEADER_SIZE + GetPayload().size();
+    }
+
+public:
+    CPeerMessageHeader hdrSend;
+    std::shared_ptr<const CEventPeerRawPayload> spPayload;
+    bool fSnappy;
+};
+
+class CPeerSendQueue
+{
+public:
+    enum
+    {
+        SEND_PRIORITY_CONTROL = 0,
+        SEND_PRIORITY_HIGH = 1,
+        SEND_PRIORITY_LOW = 2,
+        SEND_PRIORITY_COUNT = 3
+    };
+    enum
+    {
+        MAX_SEND_QUEUE_SIZE = 128 * 1024 * 1024,
+        MAX_SEND_LOW_QUEUE_SIZE = 16 * 1024 * 1024
+    };
+
+public:
+    CPeerSendQueue();
+    void Clear();
+    bool IsEmpty() const;
+    std::size_t GetSize() const;
+    bool Check(std::size_t nBufferSize, std::size_t nMessageSize, int nPriority) const;
+    void Push(const CSendMessage& msg, int nPriority);
+    bool Pop(CSendMessage& msg);
+
+protected:
+    std::deque<CSendMessage> queSend[SEND_PRIORITY_COUNT];
+    std::size_t nSendQueueSize[SEND_PRIORITY_COUNT];
+};
+
 class CBbPeer : public xengine::CPeer
 {
+public:
+    enum
+    {
+        SEND_PRIORITY_CONTROL = CPeerSendQueue::SEND_PRIORITY_CONTROL,
+        SEND_PRIORITY_HIGH = CPeerSendQueue::SEND_PRIORITY_HIGH,
+        SEND_PRIORITY_LOW = CPeerSendQueue::SEND_PRIORITY_LOW
+    };
+    enum
+    {
+        SEND_BATCH_SIZE = 256 * 1024
+    };
+
 public:
     CBbPeer(xengine::CPeerNet* pPeerNetIn, xengine::CIOClient* pClientIn, uint64 nNonceIn,
             bool fInBoundIn, uint32 nMsgMagicIn, uint32 nHsTimerIdIn);
     ~CBbPeer();
     void Activate() override;
     bool IsHandshaked();
-    bool SendMessage(int nChannel, int nCommand, xengine::CBufStream& ssPayload);
+    bool SendMessage(int nChannel, int nCommand, xengine::CBufStream& ssPayload, int nPriority = SEND_PRIORITY_HIGH);
+    bool SendMessage(int nChannel, int nCommand, std::shared_ptr<const CEventPeerRawPayload> spPayload, int nPriority = SEND_PRIORITY_HIGH);
     bool SendMessage(int nChannel, int nCommand)
     {
         xengine::CBufStream ssPayload;
         return SendMessage(nChannel, nCommand, ssPayload);
     }
-    uint32 Request(const CInv& inv, uint32 nTimerId);
-    uint32 Responded(const CInv& inv);
+    void Request(const CInv& inv, int64 nTimeout);
+    bool Responded(const CInv& inv);
+    int64 GetRequestTimeout() const;
     void AskFor(const uint256& hashFork, const std::vector<CInv>& vInv);
     bool FetchAskFor(uint256& hashFork, CInv& inv);
     bool PingTimer(uint32 nTimerId) override;
+    bool HandlePayloadVerified(bool fValid);
+    void FlushSendQueue();
+    bool IsSendQueueOverflow() const
+    {
+        return fSendOverflow;
+    }
 
 protected:
+    bool MakeMessageHeader(int nChannel, int nCommand, std::size_t nPayloadSize, uint32 nPayloadChecksum, CPeerMessageHeader& hdrSend);
+    bool IsSnappyEnabled(int nChannel, std::size_t nPayloadSize);
+    bool CheckSendQueue(std::size_t nSize, int nPriority);
+    void WriteMessage(const CPeerMessageHeader& hdrSend, const uint8* pPayload, std::size_t nPayloadSize);
     void SendHello();
     void SendHelloAck();
     void SendPing();
@@ -61,14 +136,18 @@ public:
     uint32 nPingTimerId;
     int64 nPingMillisTime;
     uint32 nPingSeq;
+    uint32 nInvTimerId;
 
 protected:
     uint32 nMsgMagic;
     uint32 nHsTimerId;
     CPeerMessageHeader hdrRecv;
 
-    std::map<CInv, uint32> mapRequest;
+    std::map<CInv, int64> mapRequest;
     std::queue<std::pair<uint256, CInv>> queAskFor;
+
+    CPeerSendQueue queSend;
+    bool fSendOverflow;
 };
 
 class CBbPeerInfo : public xengine::CPeerInfo
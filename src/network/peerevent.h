@@ -6,6 +6,8 @@
 #define NETWORK_PEEREVENT_H
 
 #include "block.h"
+#include "crypto.h"
+#include "param.h"
 #include "proto.h"
 #include "transaction.h"
 #include "xengine.h"
@@ -36,6 +38,11 @@ enum
     EVENT_PEER_GETDELEGATED,
     EVENT_PEER_DISTRIBUTE,
     EVENT_PEER_PUBLISH,
+    EVENT_PEER_CMPCTBLOCK,
+    EVENT_PEER_GETBLOCKTXN,
+    EVENT_PEER_BLOCKTXN,
+    EVENT_PEER_RAWBLOCK,
+    EVENT_PEER_RAWINV,
     EVENT_PEER_MAX,
 };
 
@@ -196,6 +203,164 @@ public:
     std::vector<unsigned char> vchData;
 };
 
+class CEventPeerCompactBlock
+{
+    friend class xengine::CStream;
+
+public:
+    CEventPeerCompactBlock()
+      : nSalt(0) {}
+    // Txs accepted by fnPrefill are sent in full, the others as salted short ids
+    void SetBlock(const CBlock& blockIn, uint64 nSaltIn, std::function<bool(const uint256&)> fnPrefill)
+    {
+        block = blockIn;
+        block.vtx.clear();
+        nSalt = nSaltIn;
+        vShortTxId.clear();
+        vPrefilledTx.clear();
+        uint256 key = GetShortTxIdKey();
+        for (std::size_t i = 0; i < blockIn.vtx.size(); i++)
+        {
+            const CTransaction& tx = blockIn.vtx[i];
+            uint256 txid = tx.GetHash();
+            if (fnPrefill(txid))
+            {
+                vPrefilledTx.push_back(std::make_pair((uint32)i, tx));
+            }
+            else
+            {
+                vShortTxId.push_back(GetShortTxId(key, txid));
+            }
+        }
+    }
+    std::size_t GetTxCount() const
+    {
+        return (vShortTxId.size() + vPrefilledTx.size());
+    }
+    // A block holds no more txs than the smallest tx fits in the block size limit
+    static std::size_t GetMaxTxCount()
+    {
+        static const std::size_t nMaxTxCount = MAX_BLOCK_SIZE / xengine::GetSerializeSize(CTransaction());
+        return nMaxTxCount;
+    }
+    uint256 GetShortTxIdKey() const
+    {
+        return ibrio::crypto::CryptoHash(block.GetHash(), uint256(nSalt));
+    }
+    static uint64 GetShortTxId(const uint256& key, const uint256& txid)
+    {
+        return ibrio::crypto::CryptoShortHash(txid.begin(), txid.size(), key);
+    }
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(block, opt);
+        s.Serialize(nSalt, opt);
+        s.Serialize(vShortTxId, opt);
+        s.Serialize(vPrefilledTx, opt);
+    }
+
+public:
+    CBlock block;
+    uint64 nSalt;
+    std::vector<uint64> vShortTxId;
+    std::vector<std::pair<uint32, CTransaction>> vPrefilledTx;
+};
+
+class CEventPeerBlockTxRequest
+{
+    friend class xengine::CStream;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vTxIndex, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    std::vector<uint32> vTxIndex;
+};
+
+class CEventPeerBlockTx
+{
+    friend class xengine::CStream;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vtx, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    std::vector<CTransaction> vtx;
+};
+
+// Serialized payload of data channel message and its checksum, sent as it is.
+// Large payload also keeps its snappy compressed copy for peers with NODE_SNAPPY
+class CEventPeerRawPayload
+{
+public:
+    CEventPeerRawPayload()
+      : nChecksum(0), nSnappyChecksum(0) {}
+    template <typename T>
+    void SetPayload(const uint256& hashFork, const T& t)
+    {
+        xengine::CBufStream ss;
+        ss << hashFork << t;
+        vchPayload.assign((const uint8*)ss.GetData(), (const uint8*)ss.GetData() + ss.GetSize());
+        nChecksum = ibrio::crypto::CryptoHash(vchPayload.data(), vchPayload.size()).Get32();
+
+        vchSnappy.clear();
+        nSnappyChecksum = 0;
+        if (vchPayload.size() >= MESSAGE_PAYLOAD_SNAPPY_SIZE && CompressPayload(vchPayload.data(), vchPayload.size(), vchSnappy))
+        {
+            nSnappyChecksum = ibrio::crypto::CryptoHash(vchSnappy.data(), vchSnappy.size()).Get32();
+        }
+    }
+    template <typename T>
+    bool GetPayload(uint256& hashFork, T& t) const
+    {
+        try
+        {
+            xengine::CBufStream ss;
+            ss.Write((const char*)vchPayload.data(), vchPayload.size());
+            ss >> hashFork >> t;
+        }
+        catch (...)
+        {
+            return false;
+        }
+        return true;
+    }
+
+public:
+    std::vector<uint8> vchPayload;
+    uint32 nChecksum;
+    std::vector<uint8> vchSnappy;
+    uint32 nSnappyChecksum;
+};
+
+// Inv payload serialized once and sent to each listed peer
+class CEventPeerRawBroadcast
+{
+public:
+    CEventPeerRawBroadcast()
+      : nPriority(0) {}
+
+public:
+    std::vector<uint64> vNonce;
+    std::shared_ptr<const CEventPeerRawPayload> spPayload;
+    int nPriority;
+};
+
 class CBbPeerEventListener;
 
 #define TYPE_PEEREVENT(type, body) \
@@ -218,6 +383,11 @@ typedef TYPE_PEERDATAEVENT(EVENT_PEER_TX, CTransaction) CEventPeerTx;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK, CBlock) CEventPeerBlock;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETFAIL, std::vector<CInv>) CEventPeerGetFail;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_MSGRSP, CMsgRsp) CEventPeerMsgRsp;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_CMPCTBLOCK, CEventPeerCompactBlock) CEventPeerCmpctBlock;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETBLOCKTXN, CEventPeerBlockTxRequest) CEventPeerGetBlockTxn;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCKTXN, CEventPeerBlockTx) CEventPeerBlockTxn;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_RAWBLOCK, std::shared_ptr<const CEventPeerRawPayload>) CEventPeerRawBlock;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_RAWINV, CEventPeerRawBroadcast) CEventPeerRawInv;
 
 typedef TYPE_PEERDELEGATEDEVENT(EVENT_PEER_BULLETIN, CEventPeerDelegatedBulletin) CEventPeerBulletin;
 typedef TYPE_PEERDELEGATEDEVENT(EVENT_PEER_GETDELEGATED, CEventPeerDelegatedGetData) CEventPeerGetDelegated;
@@ -239,6 +409,11 @@ public:
     DECLARE_EVENTHANDLER(CEventPeerBlock);
     DECLARE_EVENTHANDLER(CEventPeerGetFail);
     DECLARE_EVENTHANDLER(CEventPeerMsgRsp);
+    DECLARE_EVENTHANDLER(CEventPeerCmpctBlock);
+    DECLARE_EVENTHANDLER(CEventPeerGetBlockTxn);
+    DECLARE_EVENTHANDLER(CEventPeerBlockTxn);
+    DECLARE_EVENTHANDLER(CEventPeerRawBlock);
+    DECLARE_EVENTHANDLER(CEventPeerRawInv);
     DECLARE_EVENTHANDLER(CEventPeerBulletin);
     DECLARE_EVENTHANDLER(CEventPeerGetDelegated);
     DECLARE_EVENTHANDLER(CEventPeerDistribute);
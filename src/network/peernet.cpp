@@ -27,6 +27,11 @@ namespace ibrio
 namespace network
 {
 
+static void VerifyPayloadChecksum(std::shared_ptr<vector<uint8>> spPayload, uint32 nPayloadChecksum, std::shared_ptr<bool> spValid)
+{
+    *spValid = (ibrio::crypto::CryptoHash(spPayload->data(), spPayload->size()).Get32() == nPayloadChecksum);
+}
+
 //////////////////////////////
 // CBbPeerNet
 
@@ -88,7 +93,7 @@ bool CBbPeerNet::HandleEvent(CEventPeerInv& eventInv)
 {
     CBufStream ssPayload;
     ssPayload << eventInv;
-    return SendDataMessage(eventInv.nNonce, PROTO_CMD_INV, ssPayload);
+    return SendDataMessage(eventInv.nNonce, PROTO_CMD_INV, ssPayload, GetInvPriority(eventInv.data));
 }
 
 bool CBbPeerNet::HandleEvent(CEventPeerGetData& eventGetData)
@@ -119,7 +124,7 @@ bool CBbPeerNet::HandleEvent(CEventPeerTx& eventTx)
 {
     CBufStream ssPayload;
     ssPayload << eventTx;
-    return SendDataMessage(eventTx.nNonce, PROTO_CMD_TX, ssPayload);
+    return SendDataMessage(eventTx.nNonce, PROTO_CMD_TX, ssPayload, CBbPeer::SEND_PRIORITY_LOW);
 }
 
 bool CBbPeerNet::HandleEvent(CEventPeerBlock& eventBlock)
@@ -143,6 +148,61 @@ bool CBbPeerNet::HandleEvent(CEventPeerMsgRsp& eventMsgRsp)
     return SendDataMessage(eventMsgRsp.nNonce, PROTO_CMD_MSGRSP, ssPayload);
 }
 
+bool CBbPeerNet::HandleEvent(CEventPeerCmpctBlock& eventCmpctBlock)
+{
+    CBufStream ssPayload;
+    ssPayload << eventCmpctBlock;
+    return SendDataMessage(eventCmpctBlock.nNonce, PROTO_CMD_CMPCTBLOCK, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventGetBlockTxn;
+    vector<CInv> vInv;
+    vInv.push_back(CInv(CInv::MSG_BLOCK, eventGetBlockTxn.data.hashBlock));
+    if (SendDataMessage(eventGetBlockTxn.nNonce, PROTO_CMD_GETBLOCKTXN, ssPayload))
+    {
+        if (SetInvTimer(eventGetBlockTxn.nNonce, vInv))
+        {
+            return true;
+        }
+    }
+    CEventPeerGetFail* pEvent = new CEventPeerGetFail(eventGetBlockTxn.nNonce, eventGetBlockTxn.hashFork);
+    pEvent->data = vInv;
+    pNetChannel->PostEvent(pEvent);
+    return false;
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerBlockTxn& eventBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventBlockTxn;
+    return SendDataMessage(eventBlockTxn.nNonce, PROTO_CMD_BLOCKTXN, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerRawBlock& eventRawBlock)
+{
+    if (!eventRawBlock.data)
+    {
+        return false;
+    }
+    return SendDataMessage(eventRawBlock.nNonce, PROTO_CMD_BLOCK, eventRawBlock.data);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerRawInv& eventRawInv)
+{
+    if (!eventRawInv.data.spPayload)
+    {
+        return false;
+    }
+    for (const uint64 nNonce : eventRawInv.data.vNonce)
+    {
+        SendDataMessage(nNonce, PROTO_CMD_INV, eventRawInv.data.spPayload, eventRawInv.data.nPriority);
+    }
+    return true;
+}
+
 bool CBbPeerNet::HandleEvent(CEventPeerBulletin& eventBulletin)
 {
     CBufStream ssPayload;
@@ -252,14 +312,34 @@ CAddress CBbPeerNet::GetGateWayAddress(const CNetHost& gateWayAddr)
     return CAddress(nService, defaultGateWay.ToEndPoint());
 }
 
-bool CBbPeerNet::SendDataMessage(uint64 nNonce, int nCommand, CBufStream& ssPayload)
+bool CBbPeerNet::SendDataMessage(uint64 nNonce, int nCommand, CBufStream& ssPayload, int nPriority)
 {
     CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
     if (pBbPeer == nullptr)
     {
         return false;
     }
-    return pBbPeer->SendMessage(PROTO_CHN_DATA, nCommand, ssPayload);
+    if (!pBbPeer->SendMessage(PROTO_CHN_DATA, nCommand, ssPayload, nPriority))
+    {
+        CheckPeerSendQueue(pBbPeer);
+        return false;
+    }
+    return true;
+}
+
+bool CBbPeerNet::SendDataMessage(uint64 nNonce, int nCommand, std::shared_ptr<const CEventPeerRawPayload> spPayload, int nPriority)
+{
+    CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
+    if (pBbPeer == nullptr)
+    {
+        return false;
+    }
+    if (!pBbPeer->SendMessage(PROTO_CHN_DATA, nCommand, spPayload, nPriority))
+    {
+        CheckPeerSendQueue(pBbPeer);
+        return false;
+    }
+    return true;
 }
 
 bool CBbPeerNet::SendDelegatedMessage(uint64 nNonce, int nCommand, xengine::CBufStream& ssPayload)
@@ -272,6 +352,27 @@ bool CBbPeerNet::SendDelegatedMessage(uint64 nNonce, int nCommand, xengine::CBuf
     return pBbPeer->SendMessage(PROTO_CHN_DELEGATE, nCommand, ssPayload);
 }
 
+int CBbPeerNet::GetInvPriority(const vector<CInv>& vInv)
+{
+    for (const CInv& inv : vInv)
+    {
+        if (inv.nType != CInv::MSG_TX)
+        {
+            return CBbPeer::SEND_PRIORITY_HIGH;
+        }
+    }
+    return CBbPeer::SEND_PRIORITY_LOW;
+}
+
+void CBbPeerNet::CheckPeerSendQueue(CBbPeer* pBbPeer)
+{
+    if (pBbPeer->IsSendQueueOverflow())
+    {
+        StdLog("CBbPeerNet", "Send queue overflow, peer: %s", GetEpString(pBbPeer->GetRemote()).c_str());
+        RemovePeer(pBbPeer, CEndpointManager::RESPONSE_FAILURE);
+    }
+}
+
 bool CBbPeerNet::SetInvTimer(uint64 nNonce, vector<CInv>& vInv)
 {
     const int64 nTimeout[] = { 0, RESPONSE_TX_TIMEOUT, RESPONSE_BLOCK_TIMEOUT,
@@ -279,17 +380,18 @@ bool CBbPeerNet::SetInvTimer(uint64 nNonce, vector<CInv>& vInv)
     CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
     if (pBbPeer != nullptr)
     {
-        int64 nElapse = 0;
         for (const CInv& inv : vInv)
         {
             if (inv.nType >= CInv::MSG_TX && inv.nType <= CInv::MSG_PUBLISH)
             {
-                nElapse += nTimeout[inv.nType];
-                string strFunc = string("InvTimer: nNonce: ") + to_string(nNonce) + ", Inv: [" + to_string(inv.nType) + "] " + inv.nHash.GetHex();
-                uint32 nTimerId = SetTimer(nNonce, nElapse, strFunc);
-                CancelTimer(pBbPeer->Request(inv, nTimerId));
+                pBbPeer->Request(inv, nTimeout[inv.nType]);
             }
         }
+        // One timer covers all requests of the peer, new requests do not extend it
+        if (pBbPeer->nInvTimerId == 0)
+        {
+            ResetInvTimer(pBbPeer);
+        }
     }
     else
     {
@@ -298,6 +400,30 @@ bool CBbPeerNet::SetInvTimer(uint64 nNonce, vector<CInv>& vInv)
     return true;
 }
 
+void CBbPeerNet::ResetInvTimer(CBbPeer* pBbPeer)
+{
+    if (pBbPeer->nInvTimerId != 0)
+    {
+        CancelTimer(pBbPeer->nInvTimerId);
+        pBbPeer->nInvTimerId = 0;
+    }
+    int64 nElapse = pBbPeer->GetRequestTimeout();
+    if (nElapse > 0)
+    {
+        string strFunc = string("InvTimer: nNonce: ") + to_string(pBbPeer->GetNonce());
+        pBbPeer->nInvTimerId = SetTimer(pBbPeer->GetNonce(), nElapse, strFunc);
+    }
+}
+
+void CBbPeerNet::RespondedInv(CBbPeer* pBbPeer, const CInv& inv)
+{
+    // Any response is progress, restart the timer for the requests still outstanding
+    if (pBbPeer->Responded(inv))
+    {
+        ResetInvTimer(pBbPeer);
+    }
+}
+
 void CBbPeerNet::ProcessAskFor(CPeer* pPeer)
 {
     uint256 hashFork;
@@ -334,6 +460,7 @@ uint32 CBbPeerNet::BuildPing(xengine::CPeer* pPeer, xengine::CBufStream& ssPaylo
 void CBbPeerNet::HandlePeerWriten(CPeer* pPeer)
 {
     ProcessAskFor(pPeer);
+    static_cast<CBbPeer*>(pPeer)->FlushSendQueue();
 }
 
 bool CBbPeerNet::HandlePeerHandshaked(CPeer* pPeer, uint32 nTimerId)
@@ -568,7 +695,7 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
             {
                 ssPayload >> pEvent->data;
                 CInv inv(CInv::MSG_TX, pEvent->data.GetHash());
-                CancelTimer(pBbPeer->Responded(inv));
+                RespondedInv(pBbPeer, inv);
                 pNetChannel->PostEvent(pEvent);
                 return true;
             }
@@ -581,7 +708,44 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
             {
                 ssPayload >> pEvent->data;
                 CInv inv(CInv::MSG_BLOCK, pEvent->data.GetHash());
-                CancelTimer(pBbPeer->Responded(inv));
+                RespondedInv(pBbPeer, inv);
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_CMPCTBLOCK:
+        {
+            CEventPeerCmpctBlock* pEvent = new CEventPeerCmpctBlock(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                CInv inv(CInv::MSG_BLOCK, pEvent->data.block.GetHash());
+                RespondedInv(pBbPeer, inv);
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_GETBLOCKTXN:
+        {
+            CEventPeerGetBlockTxn* pEvent = new CEventPeerGetBlockTxn(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_BLOCKTXN:
+        {
+            CEventPeerBlockTxn* pEvent = new CEventPeerBlockTxn(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                CInv inv(CInv::MSG_BLOCK, pEvent->data.hashBlock);
+                RespondedInv(pBbPeer, inv);
                 pNetChannel->PostEvent(pEvent);
                 return true;
             }
@@ -595,7 +759,7 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
                 ssPayload >> pEvent->data;
                 for (const CInv& inv : pEvent->data)
                 {
-                    CancelTimer(pBbPeer->Responded(inv));
+                    RespondedInv(pBbPeer, inv);
                 }
                 pNetChannel->PostEvent(pEvent);
                 return true;
@@ -656,7 +820,7 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
                 ss << hashAnchor << (pEvent->data.destDelegate);
                 uint256 hash = crypto::CryptoHash(ss.GetData(), ss.GetSize());
                 CInv inv(CInv::MSG_DISTRIBUTE, hash);
-                CancelTimer(pBbPeer->Responded(inv));
+                RespondedInv(pBbPeer, inv);
 
                 pDelegatedChannel->PostEvent(pEvent);
 
@@ -675,7 +839,7 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
                 ss << hashAnchor << (pEvent->data.destDelegate);
                 uint256 hash = crypto::CryptoHash(ss.GetData(), ss.GetSize());
                 CInv inv(CInv::MSG_PUBLISH, hash);
-                CancelTimer(pBbPeer->Responded(inv));
+                RespondedInv(pBbPeer, inv);
 
                 pDelegatedChannel->PostEvent(pEvent);
                 return true;
@@ -689,6 +853,17 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
     return false;
 }
 
+bool CBbPeerNet::VerifyPeerPayload(CPeer* pPeer, CBufStream& ssPayload, uint32 nPayloadChecksum)
+{
+    // The peer may be removed before the worker completes, so the worker hashes a copy
+    // of the payload and the result is delivered by nonce
+    std::shared_ptr<vector<uint8>> spPayload(new vector<uint8>((uint8*)ssPayload.GetData(), (uint8*)ssPayload.GetData() + ssPayload.GetSize()));
+    std::shared_ptr<bool> spValid(new bool(false));
+    PostWork(boost::bind(&VerifyPayloadChecksum, spPayload, nPayloadChecksum, spValid),
+             boost::bind(&CBbPeerNet::HandlePeerPayloadVerified, this, pPeer->GetNonce(), spValid));
+    return true;
+}
+
 uint32 CBbPeerNet::SetPingTimer(uint32 nOldTimerId, uint64 nNonce, int64 nElapse)
 {
     if (nOldTimerId != 0)
@@ -706,5 +881,14 @@ uint32 CBbPeerNet::CreateSeq(uint64 nNonce)
     return ibrio::crypto::crc24q((const unsigned char*)ss.GetData(), ss.GetSize());
 }
 
+void CBbPeerNet::HandlePeerPayloadVerified(uint64 nNonce, std::shared_ptr<bool> spValid)
+{
+    CBbPeer* pBbPeer = static_cast<CBbPeer*>(GetPeer(nNonce));
+    if (pBbPeer != nullptr && !pBbPeer->HandlePayloadVerified(*spValid))
+    {
+        HandlePeerViolate(pBbPeer);
+    }
+}
+
 } // namespace network
 } // namespace ibrio
@@ -5,6 +5,7 @@
 #ifndef NETWORK_PEERNET_H
 #define NETWORK_PEERNET_H
 
+#include "peer.h"
 #include "peerevent.h"
 #include "proto.h"
 #include "xengine.h"
@@ -28,6 +29,8 @@ public:
     virtual bool SubmitCachePowBlock(const CConsensusParam& consParam) = 0;
     virtual bool IsLocalCachePowBlock(int nHeight, bool& fIsDpos) = 0;
     virtual bool AddCacheLocalPowBlock(const CBlock& block) = 0;
+    virtual void RelayVerifiedBlock(const uint256& hashFork, const CBlock& block, uint64 nNonce) = 0;
+    virtual void CompleteRelayedBlock(const uint256& hashBlock, bool fValid) = 0;
 };
 
 class IDelegatedChannel : public xengine::IIOModule, virtual public CBbPeerEventListener
@@ -55,6 +58,7 @@ public:
     virtual bool HandlePeerRecvMessage(xengine::CPeer* pPeer, int nChannel, int nCommand,
                                        xengine::CBufStream& ssPayload);
     uint32 SetPingTimer(uint32 nOldTimerId, uint64 nNonce, int64 nElapse);
+    bool VerifyPeerPayload(xengine::CPeer* pPeer, xengine::CBufStream& ssPayload, uint32 nPayloadChecksum);
 
 protected:
     bool HandleInitialize() override;
@@ -68,6 +72,11 @@ protected:
     bool HandleEvent(CEventPeerBlock& eventBlock) override;
     bool HandleEvent(CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(CEventPeerCmpctBlock& eventCmpctBlock) override;
+    bool HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(CEventPeerBlockTxn& eventBlockTxn) override;
+    bool HandleEvent(CEventPeerRawBlock& eventRawBlock) override;
+    bool HandleEvent(CEventPeerRawInv& eventRawInv) override;
     bool HandleEvent(CEventPeerBulletin& eventBulletin) override;
     bool HandleEvent(CEventPeerGetDelegated& eventGetDelegated) override;
     bool HandleEvent(CEventPeerDistribute& eventDistribute) override;
@@ -76,9 +85,16 @@ protected:
     void DestroyPeer(xengine::CPeer* pPeer) override;
     xengine::CPeerInfo* GetPeerInfo(xengine::CPeer* pPeer, xengine::CPeerInfo* pInfo) override;
     CAddress GetGateWayAddress(const CNetHost& gateWayAddr);
-    bool SendDataMessage(uint64 nNonce, int nCommand, xengine::CBufStream& ssPayload);
+    bool SendDataMessage(uint64 nNonce, int nCommand, xengine::CBufStream& ssPayload,
+                         int nPriority = CBbPeer::SEND_PRIORITY_HIGH);
+    bool SendDataMessage(uint64 nNonce, int nCommand, std::shared_ptr<const CEventPeerRawPayload> spPayload,
+                         int nPriority = CBbPeer::SEND_PRIORITY_HIGH);
+    int GetInvPriority(const std::vector<CInv>& vInv);
+    void CheckPeerSendQueue(CBbPeer* pBbPeer);
     bool SendDelegatedMessage(uint64 nNonce, int nCommand, xengine::CBufStream& ssPayload);
     bool SetInvTimer(uint64 nNonce, std::vector<CInv>& vInv);
+    void ResetInvTimer(CBbPeer* pBbPeer);
+    void RespondedInv(CBbPeer* pBbPeer, const CInv& inv);
     virtual void ProcessAskFor(xengine::CPeer* pPeer);
     void Configure(uint32 nMagicNumIn, uint32 nVersionIn, uint64 nServiceIn,
                    const std::string& subVersionIn, bool fEnclosedIn, const uint256& hashGenesisIn)
@@ -92,6 +108,7 @@ protected:
     }
     virtual bool CheckPeerVersion(uint32 nVersionIn, uint64 nServiceIn, const std::string& subVersionIn) = 0;
     uint32 CreateSeq(uint64 nNonce);
+    void HandlePeerPayloadVerified(uint64 nNonce, std::shared_ptr<bool> spValid);
 
 protected:
     INetChannel* pNetChannel;
@@ -5,6 +5,7 @@
 #include "proto.h"
 
 #include <boost/asio.hpp>
+#include <snappy.h>
 
 using namespace std;
 using namespace xengine;
@@ -147,5 +148,43 @@ bool CEndpoint::IsRoutable()
     return true;
 }
 
+///////////////////////////////
+// Payload compression
+
+bool CompressPayload(const uint8* pData, size_t nSize, vector<uint8>& vchCompressed)
+{
+    // The receiver rejects a payload which is larger than the limit once uncompressed
+    if (nSize > MESSAGE_PAYLOAD_MAX_SIZE)
+    {
+        return false;
+    }
+    string strSnappy;
+    snappy::Compress((const char*)pData, nSize, &strSnappy);
+    if (strSnappy.size() >= nSize)
+    {
+        return false;
+    }
+    vchCompressed.assign(strSnappy.begin(), strSnappy.end());
+    return true;
+}
+
+bool UncompressPayload(const uint8* pData, size_t nSize, CBufStream& ss)
+{
+    // Length is read from the snappy preamble and checked before the buffer is allocated
+    size_t nLength = 0;
+    if (!snappy::GetUncompressedLength((const char*)pData, nSize, &nLength)
+        || nLength == 0 || nLength > MESSAGE_PAYLOAD_MAX_SIZE)
+    {
+        return false;
+    }
+    vector<char> vchUncompressed(nLength);
+    if (!snappy::RawUncompress((const char*)pData, nSize, vchUncompressed.data()))
+    {
+        return false;
+    }
+    ss.Write(vchUncompressed.data(), nLength);
+    return true;
+}
+
 } // namespace network
 } // namespace ibrio
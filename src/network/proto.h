@@ -19,6 +19,8 @@ enum
 {
     NODE_NETWORK = (1 << 0),
     NODE_DELEGATED = (1 << 1),
+    NODE_COMPACTBLOCK = (1 << 2),
+    NODE_SNAPPY = (1 << 3),
 };
 
 enum
@@ -50,6 +52,9 @@ enum
     PROTO_CMD_BLOCK = 7,
     PROTO_CMD_GETFAIL = 8,
     PROTO_CMD_MSGRSP = 9,
+    PROTO_CMD_CMPCTBLOCK = 10,
+    PROTO_CMD_GETBLOCKTXN = 11,
+    PROTO_CMD_BLOCKTXN = 12,
 };
 
 enum
@@ -63,6 +68,10 @@ enum
 #define MESSAGE_HEADER_SIZE 16
 #define MESSAGE_PAYLOAD_MAX_SIZE 0x400000
 #define PING_TIMER_DURATION 120
+// Data channel payloads at least this large are sent snappy compressed to peers with NODE_SNAPPY,
+// and the compressed ones are marked by this bit of command
+#define MESSAGE_PAYLOAD_SNAPPY_SIZE 1024
+#define MESSAGE_COMMAND_SNAPPY 0x20
 
 class CPeerMessageHeader
 {
@@ -246,6 +255,9 @@ public:
     CEndpoint ssEndpoint;
 };
 
+bool CompressPayload(const uint8* pData, std::size_t nSize, std::vector<uint8>& vchCompressed);
+bool UncompressPayload(const uint8* pData, std::size_t nSize, xengine::CBufStream& ss);
+
 } // namespace network
 } // namespace ibrio
 
@@ -17,6 +17,7 @@ namespace storage
 {
 
 #define ADDRESS_TXINDEX_FLUSH_INTERVAL (600)
+#define ADDRESS_TXINDEX_LOAD_BATCH_SIZE (100000)
 
 //////////////////////////////
 // CGetAddressTxIndexWalker
@@ -69,6 +70,7 @@ bool CGetAddressTxIndexWalker::Walk(const CAddrTxIndex& key, const CAddrTxInfo&
 // CForkAddressTxIndexDB
 
 CForkAddressTxIndexDB::CForkAddressTxIndexDB(const boost::filesystem::path& pathDB)
+  : fAddressTxCount(false)
 {
     CLevelDBArguments args;
     args.path = pathDB.string();
@@ -79,6 +81,10 @@ CForkAddressTxIndexDB::CForkAddressTxIndexDB(const boost::filesystem::path& path
     {
         delete engine;
     }
+    else if (!InitAddressTxCount())
+    {
+        StdError("CForkAddressTxIndexDB", "Init address tx count fail, path: %s", pathDB.string().c_str());
+    }
 }
 
 CForkAddressTxIndexDB::~CForkAddressTxIndexDB()
@@ -94,7 +100,8 @@ bool CForkAddressTxIndexDB::RemoveAll()
         return false;
     }
     dblCache.Clear();
-    return true;
+    fAddressTxCount = false;
+    return InitAddressTxCount();
 }
 
 bool CForkAddressTxIndexDB::UpdateAddressTxIndex(const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew, const vector<CAddrTxIndex>& vRemove)
@@ -118,6 +125,26 @@ bool CForkAddressTxIndexDB::UpdateAddressTxIndex(const vector<pair<CAddrTxIndex,
 
 bool CForkAddressTxIndexDB::RepairAddressTxIndex(const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddUpdate, const vector<CAddrTxIndex>& vRemove)
 {
+    map<CDestination, int64> mapCountDelta;
+    if (fAddressTxCount)
+    {
+        CAddrTxInfo info;
+        for (const auto& vd : vAddUpdate)
+        {
+            if (!Read(CAddrTxIndex(vd.first.dest, BSwap64(vd.first.nHeightSeq), vd.first.txid), info))
+            {
+                mapCountDelta[vd.first.dest]++;
+            }
+        }
+        for (const auto& vd : vRemove)
+        {
+            if (Read(CAddrTxIndex(vd.dest, BSwap64(vd.nHeightSeq), vd.txid), info))
+            {
+                mapCountDelta[vd.dest]--;
+            }
+        }
+    }
+
     if (!TxnBegin())
     {
         return false;
@@ -133,6 +160,12 @@ bool CForkAddressTxIndexDB::RepairAddressTxIndex(const vector<pair<CAddrTxIndex,
         Erase(CAddrTxIndex(vd.dest, BSwap64(vd.nHeightSeq), vd.txid));
     }
 
+    if (!UpdateAddressTxCount(mapCountDelta))
+    {
+        TxnAbort();
+        return false;
+    }
+
     if (!TxnCommit())
     {
         return false;
@@ -140,6 +173,44 @@ bool CForkAddressTxIndexDB::RepairAddressTxIndex(const vector<pair<CAddrTxIndex,
     return true;
 }
 
+bool CForkAddressTxIndexDB::BulkLoadAddressTxIndex(const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew)
+{
+    xengine::CWriteLock wlock(rwLower);
+
+    for (size_t nBegin = 0; nBegin < vAddNew.size(); nBegin += ADDRESS_TXINDEX_LOAD_BATCH_SIZE)
+    {
+        const size_t nEnd = min(nBegin + ADDRESS_TXINDEX_LOAD_BATCH_SIZE, vAddNew.size());
+
+        map<CDestination, int64> mapCountDelta;
+        if (!TxnBegin())
+        {
+            return false;
+        }
+
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            const CAddrTxIndex& key = vAddNew[i].first;
+            Write(CAddrTxIndex(key.dest, BSwap64(key.nHeightSeq), key.txid), vAddNew[i].second);
+            if (fAddressTxCount)
+            {
+                mapCountDelta[key.dest]++;
+            }
+        }
+
+        if (!UpdateAddressTxCount(mapCountDelta))
+        {
+            TxnAbort();
+            return false;
+        }
+
+        if (!TxnCommit())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CForkAddressTxIndexDB::WriteAddressTxIndex(const CAddrTxIndex& key, const CAddrTxInfo& value)
 {
     return Write(CAddrTxIndex(key.dest, BSwap64(key.nHeightSeq), key.txid), value);
@@ -184,6 +255,10 @@ bool CForkAddressTxIndexDB::ReadAddressTxIndex(const CAddrTxIndex& key, CAddrTxI
 
 int64 CForkAddressTxIndexDB::RetrieveAddressTxIndex(const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
 {
+    if ((nPrevHeight < -1 || nPrevTxSeq == -1) && nOffset >= -1 && !dest.IsNull() && fAddressTxCount)
+    {
+        return RetrieveAddressTxIndexOfCount(dest, nOffset, nCount, mapAddrTxIndex);
+    }
     if ((nPrevHeight < -1 || nPrevTxSeq == -1) && nOffset == -1)
     {
         // last count tx
@@ -226,6 +301,30 @@ bool CForkAddressTxIndexDB::RetrieveTxIndex(const CAddrTxIndex& addrTxIndex, CAd
     return Read(CAddrTxIndex(addrTxIndex.dest, BSwap64(addrTxIndex.nHeightSeq), addrTxIndex.txid), addrTxInfo);
 }
 
+int64 CForkAddressTxIndexDB::GetAddressTxCount(const CDestination& dest)
+{
+    if (!fAddressTxCount)
+    {
+        return -1;
+    }
+
+    try
+    {
+        xengine::CReadLock rdlock(rwLower);
+        xengine::CReadLock rulock(rwUpper);
+        boost::recursive_mutex::scoped_lock lock(mtx);
+
+        MapType mapCache;
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vCacheTx;
+        return GetAddressTxCountWithCache(dest, mapCache, vCacheTx);
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return -1;
+}
+
 bool CForkAddressTxIndexDB::Copy(CForkAddressTxIndexDB& dbAddressTxIndex)
 {
     if (!dbAddressTxIndex.RemoveAll())
@@ -244,6 +343,7 @@ bool CForkAddressTxIndexDB::Copy(CForkAddressTxIndexDB& dbAddressTxIndex)
         }
 
         dbAddressTxIndex.SetCache(dblCache);
+        dbAddressTxIndex.fAddressTxCount = fAddressTxCount;
     }
     catch (exception& e)
     {
@@ -260,76 +360,98 @@ bool CForkAddressTxIndexDB::WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalke
         xengine::CReadLock rdlock(rwLower);
         xengine::CReadLock rulock(rwUpper);
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        MapType& mapLower = dblCache.GetLowerMap();
+        return InnerWalkThroughAddressTxIndex(walker, dest, nPrevHeight, nPrevTxSeq);
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return false;
+}
 
-        if (dest.IsNull())
+bool CForkAddressTxIndexDB::InnerWalkThroughAddressTxIndex(CForkAddressTxIndexDBWalker& walker, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq)
+{
+    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapLower = dblCache.GetLowerMap();
+
+    if (dest.IsNull())
+    {
+        if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                     boost::ref(mapUpper), boost::ref(mapLower))))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (nPrevHeight < -1 || nPrevTxSeq == -1)
         {
             if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
-                                         boost::ref(mapUpper), boost::ref(mapLower))))
+                                         boost::ref(mapUpper), boost::ref(mapLower)),
+                             dest, true))
             {
                 return false;
             }
         }
         else
         {
-            if (nPrevHeight < -1 || nPrevTxSeq == -1)
-            {
-                if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
-                                             boost::ref(mapUpper), boost::ref(mapLower)),
-                                 dest, true))
-                {
-                    return false;
-                }
-            }
-            else
+            int64 nHeightSeq = (((int64)nPrevHeight << 32) | (nPrevTxSeq & 0xFFFFFFFFL));
+            if (!WalkThroughOfPrefix(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                                 boost::ref(mapUpper), boost::ref(mapLower)),
+                                     make_pair(dest, BSwap64(nHeightSeq)), dest))
             {
-                int64 nHeightSeq = (((int64)nPrevHeight << 32) | (nPrevTxSeq & 0xFFFFFFFFL));
-                if (!WalkThroughOfPrefix(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
-                                                     boost::ref(mapUpper), boost::ref(mapLower)),
-                                         make_pair(dest, BSwap64(nHeightSeq)), dest))
-                {
-                    return false;
-                }
+                return false;
             }
         }
+    }
 
-        for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+    for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+    {
+        const CAddrTxIndex& key = (*it).first;
+        const CAddrTxInfo& value = (*it).second;
+        if ((dest.IsNull() || key.dest == dest) && !mapUpper.count(key) && !value.IsNull())
         {
-            const CAddrTxIndex& key = (*it).first;
-            const CAddrTxInfo& value = (*it).second;
-            if ((dest.IsNull() || key.dest == dest) && !mapUpper.count(key) && !value.IsNull())
+            if (!walker.Walk(key, value))
             {
-                if (!walker.Walk(key, value))
-                {
-                    return false;
-                }
+                return false;
             }
         }
-        for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+    }
+    for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+    {
+        const CAddrTxIndex& key = (*it).first;
+        const CAddrTxInfo& value = (*it).second;
+        if ((dest.IsNull() || key.dest == dest) && !value.IsNull())
         {
-            const CAddrTxIndex& key = (*it).first;
-            const CAddrTxInfo& value = (*it).second;
-            if ((dest.IsNull() || key.dest == dest) && !value.IsNull())
+            if (!walker.Walk(key, value))
             {
-                if (!walker.Walk(key, value))
-                {
-                    return false;
-                }
+                return false;
             }
         }
     }
-    catch (exception& e)
-    {
-        StdError(__PRETTY_FUNCTION__, e.what());
-        return false;
-    }
     return true;
 }
 
 bool CForkAddressTxIndexDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
                                        CForkAddressTxIndexDB& dbAddressUnspent)
 {
+    if (IsAddressTxCountKey(ssKey))
+    {
+        if (ssKey.GetSize() == 1)
+        {
+            uint8 nPrefix;
+            uint32 nVersion;
+            ssKey >> nPrefix;
+            ssValue >> nVersion;
+            return dbAddressUnspent.Write(nPrefix, nVersion);
+        }
+        pair<uint8, CDestination> key;
+        int64 nTxCount;
+        ssKey >> key;
+        ssValue >> nTxCount;
+        return dbAddressUnspent.Write(key, nTxCount);
+    }
+
     CAddrTxIndex key;
     CAddrTxInfo value;
 
@@ -343,6 +465,11 @@ bool CForkAddressTxIndexDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
 bool CForkAddressTxIndexDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
                                        CForkAddressTxIndexDBWalker& walker, const MapType& mapUpper, const MapType& mapLower)
 {
+    if (IsAddressTxCountKey(ssKey))
+    {
+        return true;
+    }
+
     CAddrTxIndex key;
     CAddrTxInfo value;
     ssKey >> key;
@@ -378,6 +505,26 @@ bool CForkAddressTxIndexDB::Flush()
         }
     }
 
+    map<CDestination, int64> mapCountDelta;
+    if (fAddressTxCount)
+    {
+        CAddrTxInfo info;
+        for (const auto& addr : vAddNew)
+        {
+            if (!Read(addr.first, info))
+            {
+                mapCountDelta[addr.first.dest]++;
+            }
+        }
+        for (const auto& addr : vRemove)
+        {
+            if (Read(addr, info))
+            {
+                mapCountDelta[addr.dest]--;
+            }
+        }
+    }
+
     if (!TxnBegin())
     {
         return false;
@@ -393,6 +540,12 @@ bool CForkAddressTxIndexDB::Flush()
         Erase(vRemove[i]);
     }
 
+    if (!UpdateAddressTxCount(mapCountDelta))
+    {
+        TxnAbort();
+        return false;
+    }
+
     if (!TxnCommit())
     {
         return false;
@@ -408,6 +561,222 @@ bool CForkAddressTxIndexDB::Flush()
     return true;
 }
 
+bool CForkAddressTxIndexDB::InitAddressTxCount()
+{
+    uint32 nVersion = 0;
+    if (Read((uint8)ADDRESS_TXCOUNT_PREFIX, nVersion) && nVersion == ADDRESS_TXCOUNT_VERSION)
+    {
+        fAddressTxCount = true;
+        return true;
+    }
+
+    // count the existing index once, stale counters are counted as zero and removed
+    map<CDestination, int64> mapTxCount;
+    if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::CountWalker, this, _1, _2, boost::ref(mapTxCount))))
+    {
+        return false;
+    }
+
+    if (!TxnBegin())
+    {
+        return false;
+    }
+
+    for (const auto& kv : mapTxCount)
+    {
+        if (kv.second > 0)
+        {
+            Write(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, kv.first), kv.second);
+        }
+        else
+        {
+            Erase(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, kv.first));
+        }
+    }
+    Write((uint8)ADDRESS_TXCOUNT_PREFIX, (uint32)ADDRESS_TXCOUNT_VERSION);
+
+    if (!TxnCommit())
+    {
+        return false;
+    }
+
+    if (!mapTxCount.empty())
+    {
+        StdLog("CForkAddressTxIndexDB", "Init address tx count: address count: %lu", mapTxCount.size());
+    }
+    fAddressTxCount = true;
+    return true;
+}
+
+bool CForkAddressTxIndexDB::UpdateAddressTxCount(const map<CDestination, int64>& mapCountDelta)
+{
+    for (const auto& kv : mapCountDelta)
+    {
+        if (kv.second == 0)
+        {
+            continue;
+        }
+        int64 nTxCount = 0;
+        Read(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, kv.first), nTxCount);
+        nTxCount += kv.second;
+        if (nTxCount > 0)
+        {
+            if (!Write(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, kv.first), nTxCount))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            Erase(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, kv.first));
+        }
+    }
+    return true;
+}
+
+int64 CForkAddressTxIndexDB::GetAddressTxCountWithCache(const CDestination& dest, MapType& mapCache, vector<pair<CAddrTxIndex, CAddrTxInfo>>& vCacheTx)
+{
+    // caller holds rwLower, rwUpper and mtx
+    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapLower = dblCache.GetLowerMap();
+
+    const CAddrTxIndex keyBegin(dest, (int64)0, uint256());
+    for (auto it = mapLower.lower_bound(keyBegin); it != mapLower.end() && it->first.dest == dest; ++it)
+    {
+        mapCache[it->first] = it->second;
+    }
+    for (auto it = mapUpper.lower_bound(keyBegin); it != mapUpper.end() && it->first.dest == dest; ++it)
+    {
+        mapCache[it->first] = it->second;
+    }
+
+    int64 nTxCount = 0;
+    Read(make_pair((uint8)ADDRESS_TXCOUNT_PREFIX, dest), nTxCount);
+
+    CAddrTxInfo info;
+    for (const auto& kv : mapCache)
+    {
+        bool fExist = Read(CAddrTxIndex(kv.first.dest, BSwap64(kv.first.nHeightSeq), kv.first.txid), info);
+        if (!kv.second.IsNull())
+        {
+            vCacheTx.push_back(kv);
+            if (!fExist)
+            {
+                nTxCount++;
+            }
+        }
+        else if (fExist)
+        {
+            nTxCount--;
+        }
+    }
+    return nTxCount;
+}
+
+int64 CForkAddressTxIndexDB::RetrieveAddressTxIndexOfCount(const CDestination& dest, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
+{
+    try
+    {
+        xengine::CReadLock rdlock(rwLower);
+        xengine::CReadLock rulock(rwUpper);
+        boost::recursive_mutex::scoped_lock lock(mtx);
+
+        MapType mapCache;
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vCacheTx;
+        const int64 nTxCount = GetAddressTxCountWithCache(dest, mapCache, vCacheTx);
+
+        // the page is [nBegin, nEnd) in positive sequence
+        int64 nBegin, nEnd;
+        if (nOffset < 0)
+        {
+            nEnd = nTxCount;
+            nBegin = (nCount >= 0 ? std::max(nTxCount - nCount, (int64)0) : 0);
+        }
+        else
+        {
+            if (nOffset >= nTxCount)
+            {
+                return nTxCount;
+            }
+            nBegin = nOffset;
+            nEnd = (nCount > 0 ? std::min(nOffset + nCount, nTxCount) : nTxCount);
+            if (nBegin < nTxCount - nEnd)
+            {
+                // nearer to the first tx
+                CGetAddressTxIndexWalker walker(-2, -1, nOffset, nCount, mapAddrTxIndex);
+                InnerWalkThroughAddressTxIndex(walker, dest, -2, -1);
+                return walker.nCurPos;
+            }
+        }
+
+        // walk from the last tx, merging the cached changes into the stored index
+        int64 nPos = nTxCount;
+        auto fnAdd = [&](const CAddrTxIndex& key, const CAddrTxInfo& value) -> bool {
+            if (--nPos < nEnd)
+            {
+                mapAddrTxIndex.insert(make_pair(key, value));
+            }
+            return (nPos > nBegin);
+        };
+
+        bool fContinue = (nBegin < nEnd);
+        auto itCache = vCacheTx.rbegin();
+        if (fContinue)
+        {
+            WalkThroughReverse(
+                [&](CBufStream& ssKey, CBufStream& ssValue) -> bool {
+                    CAddrTxIndex key;
+                    ssKey >> key;
+                    key.nHeightSeq = BSwap64(key.nHeightSeq);
+                    if (mapCache.count(key))
+                    {
+                        return true;
+                    }
+                    for (; itCache != vCacheTx.rend() && key < itCache->first; ++itCache)
+                    {
+                        if (!(fContinue = fnAdd(itCache->first, itCache->second)))
+                        {
+                            return false;
+                        }
+                    }
+                    CAddrTxInfo value;
+                    ssValue >> value;
+                    return (fContinue = fnAdd(key, value));
+                },
+                dest);
+        }
+        for (; fContinue && itCache != vCacheTx.rend(); ++itCache)
+        {
+            fContinue = fnAdd(itCache->first, itCache->second);
+        }
+        return (nOffset < 0 ? nTxCount : nEnd);
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+    return -1;
+}
+
+bool CForkAddressTxIndexDB::CountWalker(CBufStream& ssKey, CBufStream& ssValue, map<CDestination, int64>& mapTxCount)
+{
+    if (IsAddressTxCountKey(ssKey))
+    {
+        if (ssKey.GetSize() > 1)
+        {
+            pair<uint8, CDestination> key;
+            ssKey >> key;
+            mapTxCount[key.second];
+        }
+        return true;
+    }
+
+    CAddrTxIndex key;
+    ssKey >> key;
+    mapTxCount[key.dest]++;
+    return true;
+}
+
 //////////////////////////////
 // CAddressTxIndexDB
 
@@ -565,6 +934,19 @@ bool CAddressTxIndexDB::RepairAddressTxIndex(const uint256& hashFork, const vect
     return it->second->RepairAddressTxIndex(vAddUpdate, vRemove);
 }
 
+bool CAddressTxIndexDB::BulkLoadAddressTxIndex(const uint256& hashFork, const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressTxIndexDB", "BulkLoadAddressTxIndex: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->BulkLoadAddressTxIndex(vAddNew);
+}
+
 int64 CAddressTxIndexDB::RetrieveAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
 {
     CReadLock rlock(rwAccess);
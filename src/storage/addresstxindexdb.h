@@ -50,6 +50,11 @@ public:
 class CForkAddressTxIndexDB : public xengine::CKVDB
 {
     typedef std::map<CAddrTxIndex, CAddrTxInfo> MapType;
+    enum
+    {
+        ADDRESS_TXCOUNT_PREFIX = 0xFF,
+        ADDRESS_TXCOUNT_VERSION = 1
+    };
     class CDblMap
     {
     public:
@@ -87,6 +92,8 @@ public:
     bool RemoveAll();
     bool UpdateAddressTxIndex(const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew, const std::vector<CAddrTxIndex>& vRemove);
     bool RepairAddressTxIndex(const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddUpdate, const std::vector<CAddrTxIndex>& vRemove);
+    // Write the sorted new tx index straight to the db in large batches, the caller must not update the fork meanwhile
+    bool BulkLoadAddressTxIndex(const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew);
     bool WriteAddressTxIndex(const CAddrTxIndex& key, const CAddrTxInfo& value);
     bool ReadAddressTxIndex(const CAddrTxIndex& key, CAddrTxInfo& value);
     int64 RetrieveAddressTxIndex(const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex);
@@ -97,9 +104,20 @@ public:
         dblCache = dblCacheIn;
     }
     bool WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalker& walker, const CDestination& dest = CDestination(), const int nPrevHeight = -2, const uint64 nPrevTxSeq = -1);
+    int64 GetAddressTxCount(const CDestination& dest);
     bool Flush();
 
 protected:
+    bool InitAddressTxCount();
+    bool UpdateAddressTxCount(const std::map<CDestination, int64>& mapCountDelta);
+    int64 GetAddressTxCountWithCache(const CDestination& dest, MapType& mapCache, std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vCacheTx);
+    int64 RetrieveAddressTxIndexOfCount(const CDestination& dest, const int64 nOffset, const int64 nCount, std::map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex);
+    bool InnerWalkThroughAddressTxIndex(CForkAddressTxIndexDBWalker& walker, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq);
+    bool IsAddressTxCountKey(xengine::CBufStream& ssKey)
+    {
+        return (ssKey.GetSize() > 0 && (uint8)ssKey.GetData()[0] == ADDRESS_TXCOUNT_PREFIX);
+    }
+    bool CountWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, std::map<CDestination, int64>& mapTxCount);
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkAddressTxIndexDB& dbAddressTxIndex);
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
@@ -109,6 +127,7 @@ protected:
     xengine::CRWAccess rwUpper;
     xengine::CRWAccess rwLower;
     CDblMap dblCache;
+    bool fAddressTxCount;
 };
 
 class CAddressTxIndexDB
@@ -128,6 +147,7 @@ public:
     void Clear();
     bool UpdateAddressTxIndex(const uint256& hashFork, const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew, const std::vector<CAddrTxIndex>& vRemove);
     bool RepairAddressTxIndex(const uint256& hashFork, const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddUpdate, const std::vector<CAddrTxIndex>& vRemove);
+    bool BulkLoadAddressTxIndex(const uint256& hashFork, const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew);
     int64 RetrieveAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex);
     bool RetrieveTxIndex(const uint256& hashFork, const CAddrTxIndex& addrTxIndex, CAddrTxInfo& addrTxInfo);
     bool Copy(const uint256& srcFork, const uint256& destFork);
@@ -17,11 +17,13 @@ namespace storage
 {
 
 #define ADDRESS_UNSPENT_FLUSH_INTERVAL (600)
+#define ADDRESS_UNSPENT_LOAD_BATCH_SIZE (100000)
 
 //////////////////////////////
 // CForkAddressUnspentDB
 
 CForkAddressUnspentDB::CForkAddressUnspentDB(const boost::filesystem::path& pathDB, const uint256& hashLastBlockIn)
+  : fAddressIndex(false)
 {
     CLevelDBArguments args;
     args.path = pathDB.string();
@@ -32,6 +34,10 @@ CForkAddressUnspentDB::CForkAddressUnspentDB(const boost::filesystem::path& path
     {
         delete engine;
     }
+    else if (!InitAddressIndex())
+    {
+        StdError("CForkAddressUnspentDB", "Init address index fail, path: %s", pathDB.string().c_str());
+    }
     hashLastBlock = hashLastBlockIn;
 }
 
@@ -48,7 +54,8 @@ bool CForkAddressUnspentDB::RemoveAll()
         return false;
     }
     dblCache.Clear();
-    return true;
+    fAddressIndex = false;
+    return InitAddressIndex();
 }
 
 bool CForkAddressUnspentDB::UpdateAddressUnspent(const uint256& hashLastBlockIn, const vector<CTxUnspent>& vAddNew, const vector<CTxUnspent>& vRemove)
@@ -56,15 +63,19 @@ bool CForkAddressUnspentDB::UpdateAddressUnspent(const uint256& hashLastBlockIn,
     xengine::CWriteLock wlock(rwUpper);
 
     MapType& mapUpper = dblCache.GetUpperMap();
+    SummaryType& mapSummary = dblCache.GetUpperSummary();
 
     for (const auto& vd : vAddNew)
     {
-        mapUpper[CAddrUnspentKey(vd.output.destTo, static_cast<const CTxOutPoint&>(vd))] = CUnspentOut(vd.output, vd.nTxType, vd.nHeight);
+        CUnspentOut unspent(vd.output, vd.nTxType, vd.nHeight);
+        mapUpper[CAddrUnspentKey(vd.output.destTo, static_cast<const CTxOutPoint&>(vd))] = unspent;
+        mapSummary[vd.output.destTo].Add(unspent);
     }
 
     for (const auto& vd : vRemove)
     {
         mapUpper[CAddrUnspentKey(vd.output.destTo, static_cast<const CTxOutPoint&>(vd))].SetNull();
+        mapSummary[vd.output.destTo].Remove(CUnspentOut(vd.output, vd.nTxType, vd.nHeight));
     }
 
     hashLastBlock = hashLastBlockIn;
@@ -73,14 +84,47 @@ bool CForkAddressUnspentDB::UpdateAddressUnspent(const uint256& hashLastBlockIn,
 
 bool CForkAddressUnspentDB::RepairAddressUnspent(const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vAddUpdate, const std::vector<CAddrUnspentKey>& vRemove)
 {
+    SummaryType mapSummaryDelta;
+    vector<AmountKeyType> vAmountRemove;
+    if (fAddressIndex)
+    {
+        CUnspentOut unspent;
+        for (const auto& vd : vAddUpdate)
+        {
+            if (Read(vd.first, unspent))
+            {
+                mapSummaryDelta[vd.first.dest].Remove(unspent);
+                vAmountRemove.push_back(GetAmountKey(vd.first, unspent.nAmount));
+            }
+            mapSummaryDelta[vd.first.dest].Add(vd.second);
+        }
+        for (const auto& out : vRemove)
+        {
+            if (Read(out, unspent))
+            {
+                mapSummaryDelta[out.dest].Remove(unspent);
+                vAmountRemove.push_back(GetAmountKey(out, unspent.nAmount));
+            }
+        }
+    }
+
     if (!TxnBegin())
     {
         return false;
     }
 
+    for (const auto& key : vAmountRemove)
+    {
+        Erase(key);
+    }
+
     for (const auto& vd : vAddUpdate)
     {
         Write(vd.first, vd.second);
+        if (fAddressIndex)
+        {
+            Write(GetAmountKey(vd.first, vd.second.nAmount), vd.second);
+        }
     }
 
     for (const auto& out : vRemove)
@@ -88,6 +132,12 @@ bool CForkAddressUnspentDB::RepairAddressUnspent(const std::vector<std::pair<CAd
         Erase(out);
     }
 
+    if (!UpdateAddressSummary(mapSummaryDelta))
+    {
+        TxnAbort();
+        return false;
+    }
+
     if (!TxnCommit())
     {
         return false;
@@ -95,6 +145,46 @@ bool CForkAddressUnspentDB::RepairAddressUnspent(const std::vector<std::pair<CAd
     return true;
 }
 
+bool CForkAddressUnspentDB::BulkLoadAddressUnspent(const vector<pair<CAddrUnspentKey, CUnspentOut>>& vUnspent)
+{
+    xengine::CWriteLock wlock(rwLower);
+
+    for (size_t nBegin = 0; nBegin < vUnspent.size(); nBegin += ADDRESS_UNSPENT_LOAD_BATCH_SIZE)
+    {
+        const size_t nEnd = min(nBegin + ADDRESS_UNSPENT_LOAD_BATCH_SIZE, vUnspent.size());
+
+        SummaryType mapSummaryDelta;
+        if (!TxnBegin())
+        {
+            return false;
+        }
+
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            const CAddrUnspentKey& out = vUnspent[i].first;
+            const CUnspentOut& unspent = vUnspent[i].second;
+            Write(out, unspent);
+            if (fAddressIndex)
+            {
+                Write(GetAmountKey(out, unspent.nAmount), unspent);
+                mapSummaryDelta[out.dest].Add(unspent);
+            }
+        }
+
+        if (fAddressIndex && !UpdateAddressSummary(mapSummaryDelta))
+        {
+            TxnAbort();
+            return false;
+        }
+
+        if (!TxnCommit())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CForkAddressUnspentDB::WriteAddressUnspent(const CAddrUnspentKey& out, const CUnspentOut& unspent)
 {
     return Write(out, unspent);
@@ -165,6 +255,7 @@ bool CForkAddressUnspentDB::Copy(CForkAddressUnspentDB& dbAddressUnspent)
         }
 
         dbAddressUnspent.SetCache(dblCache);
+        dbAddressUnspent.fAddressIndex = fAddressIndex;
     }
     catch (exception& e)
     {
@@ -239,6 +330,31 @@ bool CForkAddressUnspentDB::WalkThroughAddressUnspent(CForkAddressUnspentDBWalke
 bool CForkAddressUnspentDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
                                        CForkAddressUnspentDB& dbAddressUnspent)
 {
+    if (IsAddressIndexKey(ssKey))
+    {
+        if (ssKey.GetSize() == 1)
+        {
+            uint8 nPrefix;
+            uint32 nVersion;
+            ssKey >> nPrefix;
+            ssValue >> nVersion;
+            return dbAddressUnspent.Write(nPrefix, nVersion);
+        }
+        if ((uint8)ssKey.GetData()[0] == ADDRESS_AMOUNT_PREFIX)
+        {
+            AmountKeyType key;
+            CUnspentOut unspent;
+            ssKey >> key;
+            ssValue >> unspent;
+            return dbAddressUnspent.Write(key, unspent);
+        }
+        pair<uint8, CDestination> key;
+        CUnspentSummary summary;
+        ssKey >> key;
+        ssValue >> summary;
+        return dbAddressUnspent.Write(key, summary);
+    }
+
     CAddrUnspentKey out;
     CUnspentOut unspent;
     ssKey >> out;
@@ -250,6 +366,11 @@ bool CForkAddressUnspentDB::CopyWalker(CBufStream& ssKey, CBufStream& ssValue,
 bool CForkAddressUnspentDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
                                        CForkAddressUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower)
 {
+    if (IsAddressIndexKey(ssKey))
+    {
+        return true;
+    }
+
     CAddrUnspentKey out;
     CUnspentOut unspent;
     ssKey >> out;
@@ -270,6 +391,7 @@ bool CForkAddressUnspentDB::Flush()
 
     vector<pair<CAddrUnspentKey, CUnspentOut>> vAddNew;
     vector<CAddrUnspentKey> vRemove;
+    vector<AmountKeyType> vAmountRemove;
 
     MapType& mapLower = dblCache.GetLowerMap();
     for (typename MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
@@ -277,6 +399,11 @@ bool CForkAddressUnspentDB::Flush()
         if (it->second.IsNull())
         {
             vRemove.push_back(it->first);
+            CUnspentOut unspent;
+            if (fAddressIndex && Read(it->first, unspent))
+            {
+                vAmountRemove.push_back(GetAmountKey(it->first, unspent.nAmount));
+            }
         }
         else
         {
@@ -289,9 +416,19 @@ bool CForkAddressUnspentDB::Flush()
         return false;
     }
 
+    if (fAddressIndex && !UpdateAddressSummary(dblCache.GetLowerSummary()))
+    {
+        TxnAbort();
+        return false;
+    }
+
     for (const auto& addr : vAddNew)
     {
         Write(addr.first, addr.second);
+        if (fAddressIndex)
+        {
+            Write(GetAmountKey(addr.first, addr.second.nAmount), addr.second);
+        }
     }
 
     for (int i = 0; i < vRemove.size(); i++)
@@ -299,9 +436,19 @@ bool CForkAddressUnspentDB::Flush()
         Erase(vRemove[i]);
     }
 
-    if (!TxnCommit())
+    for (const auto& key : vAmountRemove)
     {
-        return false;
+        Erase(key);
+    }
+
+    {
+        // summary readers must not add the lower delta once it is saved
+        boost::recursive_mutex::scoped_lock lock(mtx);
+        if (!TxnCommit())
+        {
+            return false;
+        }
+        dblCache.SetLowerSaved();
     }
 
     ulock.Upgrade();
@@ -314,6 +461,277 @@ bool CForkAddressUnspentDB::Flush()
     return true;
 }
 
+bool CForkAddressUnspentDB::RetrieveAddressUnspentSummary(const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut)
+{
+    if (dest.IsNull() || !fAddressIndex)
+    {
+        return false;
+    }
+
+    try
+    {
+        xengine::CReadLock rdlock(rwLower);
+        xengine::CReadLock rulock(rwUpper);
+        boost::recursive_mutex::scoped_lock lock(mtx);
+
+        summary.SetNull();
+        Read(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, dest), summary);
+
+        if (!dblCache.IsLowerSaved())
+        {
+            SummaryType& mapLower = dblCache.GetLowerSummary();
+            auto it = mapLower.find(dest);
+            if (it != mapLower.end())
+            {
+                summary.Merge(it->second);
+            }
+        }
+
+        SummaryType& mapUpper = dblCache.GetUpperSummary();
+        auto it = mapUpper.find(dest);
+        if (it != mapUpper.end())
+        {
+            summary.Merge(it->second);
+        }
+        hashLastBlockOut = hashLastBlock;
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CForkAddressUnspentDB::WalkThroughAddressUnspentByAmount(CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount,
+                                                              const bool fDescending, uint256& hashLastBlockOut)
+{
+    if (dest.IsNull() || !fAddressIndex)
+    {
+        return false;
+    }
+
+    try
+    {
+        xengine::CReadLock rdlock(rwLower);
+        xengine::CReadLock rulock(rwUpper);
+
+        MapType& mapUpper = dblCache.GetUpperMap();
+        MapType& mapLower = dblCache.GetLowerMap();
+        int64 nAmountBound = max(nAmount, (int64)0);
+
+        // the cached coins are merged into the index walk by amount
+        vector<pair<CAddrUnspentKey, CUnspentOut>> vCacheCoin;
+        for (auto it = mapLower.lower_bound(CAddrUnspentKey(dest, CTxOutPoint())); it != mapLower.end() && it->first.dest == dest; ++it)
+        {
+            if (!it->second.IsNull() && !mapUpper.count(it->first))
+            {
+                vCacheCoin.push_back(*it);
+            }
+        }
+        for (auto it = mapUpper.lower_bound(CAddrUnspentKey(dest, CTxOutPoint())); it != mapUpper.end() && it->first.dest == dest; ++it)
+        {
+            if (!it->second.IsNull())
+            {
+                vCacheCoin.push_back(*it);
+            }
+        }
+        vCacheCoin.erase(remove_if(vCacheCoin.begin(), vCacheCoin.end(),
+                                   [&](const pair<CAddrUnspentKey, CUnspentOut>& coin) {
+                                       return (fDescending ? coin.second.nAmount > nAmountBound : coin.second.nAmount < nAmountBound);
+                                   }),
+                         vCacheCoin.end());
+        sort(vCacheCoin.begin(), vCacheCoin.end(),
+             [&](const pair<CAddrUnspentKey, CUnspentOut>& a, const pair<CAddrUnspentKey, CUnspentOut>& b) {
+                 return (fDescending ? a.second.nAmount > b.second.nAmount : a.second.nAmount < b.second.nAmount);
+             });
+
+        size_t nCachePos = 0;
+        bool fContinue = true;
+        WalkerFunc fnWalker = [&](CBufStream& ssKey, CBufStream& ssValue) -> bool {
+            return AmountWalker(ssKey, ssValue, walker, mapUpper, mapLower, vCacheCoin, nCachePos, fDescending, fContinue);
+        };
+        auto keyPrefix = make_pair((uint8)ADDRESS_AMOUNT_PREFIX, dest);
+        if (!fDescending)
+        {
+            if (!WalkThroughOfPrefix(fnWalker, make_pair(keyPrefix, BSwap64((uint64)nAmountBound)), keyPrefix))
+            {
+                return false;
+            }
+        }
+        else if (nAmountBound == numeric_limits<int64>::max())
+        {
+            if (!WalkThroughReverse(fnWalker, keyPrefix))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (!WalkThroughReverse(fnWalker, make_pair(keyPrefix, BSwap64((uint64)(nAmountBound + 1))), keyPrefix))
+            {
+                return false;
+            }
+        }
+
+        for (; fContinue && nCachePos < vCacheCoin.size(); ++nCachePos)
+        {
+            fContinue = walker.Walk(vCacheCoin[nCachePos].first, vCacheCoin[nCachePos].second);
+        }
+        hashLastBlockOut = hashLastBlock;
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CForkAddressUnspentDB::InitAddressIndex()
+{
+    uint32 nVersion = 0;
+    if (Read((uint8)ADDRESS_SUMMARY_PREFIX, nVersion) && nVersion == ADDRESS_INDEX_VERSION)
+    {
+        fAddressIndex = true;
+        return true;
+    }
+
+    // index the existing unspent once, stale index keys are replaced
+    SummaryType mapSummary;
+    if (!TxnBegin())
+    {
+        return false;
+    }
+
+    if (!WalkThrough(boost::bind(&CForkAddressUnspentDB::IndexWalker, this, _1, _2, boost::ref(mapSummary))))
+    {
+        TxnAbort();
+        return false;
+    }
+
+    for (const auto& kv : mapSummary)
+    {
+        if (kv.second.nCount > 0)
+        {
+            Write(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, kv.first), kv.second);
+        }
+        else
+        {
+            Erase(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, kv.first));
+        }
+    }
+    Write((uint8)ADDRESS_SUMMARY_PREFIX, (uint32)ADDRESS_INDEX_VERSION);
+
+    if (!TxnCommit())
+    {
+        return false;
+    }
+
+    if (!mapSummary.empty())
+    {
+        StdLog("CForkAddressUnspentDB", "Init address index: address count: %lu", mapSummary.size());
+    }
+    fAddressIndex = true;
+    return true;
+}
+
+bool CForkAddressUnspentDB::UpdateAddressSummary(const SummaryType& mapSummaryDelta)
+{
+    for (const auto& kv : mapSummaryDelta)
+    {
+        if (kv.second.IsNull())
+        {
+            continue;
+        }
+        CUnspentSummary summary;
+        Read(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, kv.first), summary);
+        summary.Merge(kv.second);
+        if (summary.nCount > 0)
+        {
+            if (!Write(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, kv.first), summary))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            Erase(make_pair((uint8)ADDRESS_SUMMARY_PREFIX, kv.first));
+        }
+    }
+    return true;
+}
+
+bool CForkAddressUnspentDB::IndexWalker(CBufStream& ssKey, CBufStream& ssValue, SummaryType& mapSummary)
+{
+    if (IsAddressIndexKey(ssKey))
+    {
+        if ((uint8)ssKey.GetData()[0] == ADDRESS_AMOUNT_PREFIX)
+        {
+            // the amount keys follow the unspent keys, only the stale ones are erased
+            AmountKeyType key;
+            CUnspentOut unspent;
+            ssKey >> key;
+            if (!Read(CAddrUnspentKey(key.first.second, key.second.second), unspent)
+                || BSwap64((uint64)unspent.nAmount) != key.second.first)
+            {
+                Erase(key);
+            }
+        }
+        else if (ssKey.GetSize() > 1)
+        {
+            pair<uint8, CDestination> key;
+            ssKey >> key;
+            mapSummary[key.second];
+        }
+        return true;
+    }
+
+    CAddrUnspentKey out;
+    CUnspentOut unspent;
+    ssKey >> out;
+    ssValue >> unspent;
+    mapSummary[out.dest].Add(unspent);
+    return Write(GetAmountKey(out, unspent.nAmount), unspent);
+}
+
+bool CForkAddressUnspentDB::AmountWalker(CBufStream& ssKey, CBufStream& ssValue, CForkAddressUnspentDBWalker& walker,
+                                         const MapType& mapUpper, const MapType& mapLower, const vector<pair<CAddrUnspentKey, CUnspentOut>>& vCacheCoin,
+                                         size_t& nCachePos, const bool fDescending, bool& fContinue)
+{
+    AmountKeyType key;
+    CUnspentOut unspent;
+    ssKey >> key;
+    ssValue >> unspent;
+
+    for (; nCachePos < vCacheCoin.size(); ++nCachePos)
+    {
+        const CUnspentOut& cache = vCacheCoin[nCachePos].second;
+        if (fDescending ? cache.nAmount < unspent.nAmount : cache.nAmount > unspent.nAmount)
+        {
+            break;
+        }
+        if (!walker.Walk(vCacheCoin[nCachePos].first, cache))
+        {
+            fContinue = false;
+            return false;
+        }
+    }
+
+    CAddrUnspentKey out(key.first.second, key.second.second);
+    if (mapUpper.count(out) || mapLower.count(out))
+    {
+        return true;
+    }
+
+    if (!walker.Walk(out, unspent))
+    {
+        fContinue = false;
+        return false;
+    }
+    return true;
+}
+
 //////////////////////////////
 // CAddressUnspentDB
 
@@ -470,6 +888,19 @@ bool CAddressUnspentDB::RepairAddressUnspent(const uint256& hashFork, const vect
     return it->second->RepairAddressUnspent(vAddUpdate, vRemove);
 }
 
+bool CAddressUnspentDB::BulkLoadAddressUnspent(const uint256& hashFork, const vector<pair<CAddrUnspentKey, CUnspentOut>>& vUnspent)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressUnspentDB", "BulkLoadAddressUnspent: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->BulkLoadAddressUnspent(vUnspent);
+}
+
 bool CAddressUnspentDB::RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut)
 {
     CReadLock rlock(rwAccess);
@@ -483,6 +914,33 @@ bool CAddressUnspentDB::RetrieveAddressUnspent(const uint256& hashFork, const CD
     return it->second->RetrieveAddressUnspent(dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CAddressUnspentDB::RetrieveAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressUnspentDB", "RetrieveAddressUnspentSummary: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->RetrieveAddressUnspentSummary(dest, summary, hashLastBlockOut);
+}
+
+bool CAddressUnspentDB::WalkThroughAddressUnspentByAmount(const uint256& hashFork, CForkAddressUnspentDBWalker& walker, const CDestination& dest,
+                                                          const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressUnspentDB", "WalkThroughAddressUnspentByAmount: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->WalkThroughAddressUnspentByAmount(walker, dest, nAmount, fDescending, hashLastBlockOut);
+}
+
 bool CAddressUnspentDB::Copy(const uint256& srcFork, const uint256& destFork)
 {
     CReadLock rlock(rwAccess);
@@ -5,6 +5,7 @@
 #ifndef STORAGE_ADDRESSUNSPENTDB_H
 #define STORAGE_ADDRESSUNSPENTDB_H
 
+#include <boost/function.hpp>
 #include <boost/thread/thread.hpp>
 
 #include "transaction.h"
@@ -97,17 +98,43 @@ public:
     std::map<CTxOutPoint, CUnspentOut>& mapAddressUnspent;
 };
 
+//////////////////////////////
+// CFnAddressUnspentWalker
+
+class CFnAddressUnspentWalker : public CForkAddressUnspentDBWalker
+{
+public:
+    typedef boost::function<bool(const CAddrUnspentKey&, const CUnspentOut&)> WalkerFunc;
+    CFnAddressUnspentWalker(WalkerFunc fnWalkerIn)
+      : fnWalker(fnWalkerIn) {}
+    bool Walk(const CAddrUnspentKey& out, const CUnspentOut& unspent) override
+    {
+        return fnWalker(out, unspent);
+    }
+
+protected:
+    WalkerFunc fnWalker;
+};
+
 //////////////////////////////
 // CForkAddressUnspentDB
 
 class CForkAddressUnspentDB : public xengine::CKVDB
 {
     typedef std::map<CAddrUnspentKey, CUnspentOut> MapType;
+    typedef std::map<CDestination, CUnspentSummary> SummaryType;
+    enum
+    {
+        ADDRESS_AMOUNT_PREFIX = 0xFE,
+        ADDRESS_SUMMARY_PREFIX = 0xFF,
+        ADDRESS_INDEX_VERSION = 2
+    };
+    typedef std::pair<std::pair<uint8, CDestination>, std::pair<uint64, CTxOutPoint>> AmountKeyType;
     class CDblMap
     {
     public:
         CDblMap()
-          : nIdxUpper(0) {}
+          : nIdxUpper(0), fLowerSaved(false) {}
         MapType& GetUpperMap()
         {
             return mapCache[nIdxUpper];
@@ -116,22 +143,45 @@ class CForkAddressUnspentDB : public xengine::CKVDB
         {
             return mapCache[nIdxUpper ^ 1];
         }
+        SummaryType& GetUpperSummary()
+        {
+            return mapSummary[nIdxUpper];
+        }
+        SummaryType& GetLowerSummary()
+        {
+            return mapSummary[nIdxUpper ^ 1];
+        }
+        void SetLowerSaved()
+        {
+            fLowerSaved = true;
+        }
+        bool IsLowerSaved() const
+        {
+            return fLowerSaved;
+        }
         void Flip()
         {
             MapType& mapLower = mapCache[nIdxUpper ^ 1];
             mapLower.clear();
+            mapSummary[nIdxUpper ^ 1].clear();
             nIdxUpper = nIdxUpper ^ 1;
+            fLowerSaved = false;
         }
         void Clear()
         {
             mapCache[0].clear();
             mapCache[1].clear();
+            mapSummary[0].clear();
+            mapSummary[1].clear();
             nIdxUpper = 0;
+            fLowerSaved = false;
         }
 
     protected:
         MapType mapCache[2];
+        SummaryType mapSummary[2];
         int nIdxUpper;
+        bool fLowerSaved;
     };
 
 public:
@@ -140,6 +190,8 @@ public:
     bool RemoveAll();
     bool UpdateAddressUnspent(const uint256& hashLastBlockIn, const std::vector<CTxUnspent>& vAddNew, const std::vector<CTxUnspent>& vRemove);
     bool RepairAddressUnspent(const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vAddUpdate, const std::vector<CAddrUnspentKey>& vRemove);
+    // Write the sorted unspent straight to the db in large batches, the caller must not update the fork meanwhile
+    bool BulkLoadAddressUnspent(const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vUnspent);
     bool WriteAddressUnspent(const CAddrUnspentKey& out, const CUnspentOut& unspent);
     bool ReadAddressUnspent(const CAddrUnspentKey& out, CUnspentOut& unspent);
     bool RetrieveAddressUnspent(const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
@@ -149,9 +201,26 @@ public:
         dblCache = dblCacheIn;
     }
     bool WalkThroughAddressUnspent(CForkAddressUnspentDBWalker& walker, const CDestination& dest, uint256& hashLastBlockOut);
+    bool RetrieveAddressUnspentSummary(const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut);
+    // Walk the unspent of dest in amount order, from nAmount up or from nAmount down, until the walker returns false
+    bool WalkThroughAddressUnspentByAmount(CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut);
     bool Flush();
 
 protected:
+    bool InitAddressIndex();
+    bool UpdateAddressSummary(const SummaryType& mapSummaryDelta);
+    AmountKeyType GetAmountKey(const CAddrUnspentKey& out, const int64 nAmount)
+    {
+        return std::make_pair(std::make_pair((uint8)ADDRESS_AMOUNT_PREFIX, out.dest), std::make_pair(xengine::BSwap64((uint64)nAmount), out.out));
+    }
+    bool IsAddressIndexKey(xengine::CBufStream& ssKey)
+    {
+        return (ssKey.GetSize() > 0 && ((uint8)ssKey.GetData()[0] == ADDRESS_SUMMARY_PREFIX || (uint8)ssKey.GetData()[0] == ADDRESS_AMOUNT_PREFIX));
+    }
+    bool IndexWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, SummaryType& mapSummary);
+    bool AmountWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, CForkAddressUnspentDBWalker& walker,
+                      const MapType& mapUpper, const MapType& mapLower, const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vCacheCoin,
+                      std::size_t& nCachePos, const bool fDescending, bool& fContinue);
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkAddressUnspentDB& dbAddressUnspent);
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
@@ -162,6 +231,7 @@ protected:
     xengine::CRWAccess rwLower;
     CDblMap dblCache;
     uint256 hashLastBlock;
+    bool fAddressIndex;
 };
 
 class CAddressUnspentDB
@@ -181,7 +251,10 @@ public:
     void Clear();
     bool UpdateAddressUnspent(const uint256& hashFork, const uint256& hashLastBlockIn, const std::vector<CTxUnspent>& vAddNew, const std::vector<CTxUnspent>& vRemove);
     bool RepairAddressUnspent(const uint256& hashFork, const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vAddUpdate, const std::vector<CAddrUnspentKey>& vRemove);
+    bool BulkLoadAddressUnspent(const uint256& hashFork, const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vUnspent);
     bool RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
+    bool RetrieveAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut);
+    bool WalkThroughAddressUnspentByAmount(const uint256& hashFork, CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkAddressUnspentDBWalker& walker);
     void Flush(const uint256& hashFork);
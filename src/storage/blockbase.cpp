@@ -860,6 +860,38 @@ bool CBlockBase::RetrieveFork(const uint256& hash, CBlockIndex** ppIndex)
     return false;
 }
 
+bool CBlockBase::RetrieveForkCommitSeq(const uint256& hash, CBlockIndex** ppIndex, uint64& nCommitSeq)
+{
+    CReadLock rlock(rwAccess);
+
+    boost::shared_ptr<CBlockFork> spFork = GetFork(hash);
+    if (spFork != nullptr)
+    {
+        CReadLock rForkLock(spFork->GetRWAccess());
+
+        *ppIndex = spFork->GetLast();
+        nCommitSeq = spFork->GetCommitSeq();
+
+        return true;
+    }
+
+    return false;
+}
+
+bool CBlockBase::RetrieveForkCommitSeq(const uint256& hash, uint64& nCommitSeq)
+{
+    CReadLock rlock(rwAccess);
+
+    boost::shared_ptr<CBlockFork> spFork = GetFork(hash);
+    if (spFork != nullptr)
+    {
+        nCommitSeq = spFork->GetCommitSeq();
+        return true;
+    }
+
+    return false;
+}
+
 bool CBlockBase::RetrieveFork(const string& strName, CBlockIndex** ppIndex)
 {
     CReadLock rlock(rwAccess);
@@ -1314,9 +1346,12 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
         spFork->UpgradeToWrite();
     }
 
+    // readers which saw the sequence before the commit must read again
+    spFork->BeginCommit();
     if (!dbBlock.UpdateFork(hashFork, pIndexNew->GetBlockHash(), view.GetForkHash(), vTxNew, vTxDel, vAddrTxNew, vAddrTxDel, vAddNewUnspent, vRemoveUnspent))
     {
         StdTrace("BlockBase", "CommitBlockView::Update fork %s  failed", hashFork.ToString().c_str());
+        spFork->EndCommit();
         return false;
     }
     spFork->UpdateLast(pIndexNew);
@@ -1330,15 +1365,18 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
         if (!AddDeFiRelation(hashFork, spFork, vAdd, vRemove))
         {
             StdLog("CBlockBase", "CommitBlockView: AddDeFiRelation fail, fork: %s", hashFork.ToString().c_str());
+            spFork->EndCommit();
             return false;
         }
 
         if (!UpdateDeFiMintHeight(hashFork, spFork, vAdd, vRemove))
         {
             StdLog("CBlockBase", "CommitBlockView: UpdateDeFiMintHeight fail, fork: %s", hashFork.ToString().c_str());
+            spFork->EndCommit();
             return false;
         }
     }
+    spFork->EndCommit();
 
     Log("B", "Update fork %s, last block hash=%s", hashFork.ToString().c_str(),
         pIndexNew->GetBlockHash().ToString().c_str());
@@ -2082,6 +2120,16 @@ bool CBlockBase::RetrieveAddressUnspent(const uint256& hashFork, const CDestinat
     return dbBlock.RetrieveAddressUnspent(hashFork, dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CBlockBase::RetrieveAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut)
+{
+    return dbBlock.RetrieveAddressUnspentSummary(hashFork, dest, summary, hashLastBlockOut);
+}
+
+bool CBlockBase::WalkThroughAddressUnspentByAmount(const uint256& hashFork, CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut)
+{
+    return dbBlock.WalkThroughAddressUnspentByAmount(hashFork, walker, dest, nAmount, fDescending, hashLastBlockOut);
+}
+
 int64 CBlockBase::RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, vector<CTxInfo>& vTx)
 {
     map<CAddrTxIndex, CAddrTxInfo> mapAddrTxIndex;
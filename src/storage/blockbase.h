@@ -7,6 +7,7 @@
 
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <atomic>
 #include <boost/thread/thread.hpp>
 #include <list>
 #include <map>
@@ -31,7 +32,7 @@ class CBlockFork
 {
 public:
     CBlockFork(const CProfile& profileIn, CBlockIndex* pIndexLastIn)
-      : forkProfile(profileIn), pIndexLast(pIndexLastIn), pIndexOrigin(pIndexLast->pOrigin)
+      : forkProfile(profileIn), pIndexLast(pIndexLastIn), pIndexOrigin(pIndexLast->pOrigin), nCommitSeq(0)
     {
     }
     void ReadLock()
@@ -82,6 +83,19 @@ public:
     {
         return pIndexOrigin;
     }
+    // The commit sequence is odd while a block view is being committed to the fork
+    uint64 GetCommitSeq() const
+    {
+        return nCommitSeq.load();
+    }
+    void BeginCommit()
+    {
+        ++nCommitSeq;
+    }
+    void EndCommit()
+    {
+        ++nCommitSeq;
+    }
     void UpdateLast(CBlockIndex* pIndexLastIn)
     {
         pIndexLast = pIndexLastIn;
@@ -131,6 +145,7 @@ protected:
     CBlockIndex* pIndexLast;
     CBlockIndex* pIndexOrigin;
     xengine::CForest<CDestination, CDestination> relation;
+    std::atomic<uint64> nCommitSeq;
 };
 
 class CBlockView
@@ -276,6 +291,8 @@ public:
     bool RetrieveIndex(const uint256& hash, CBlockIndex** ppIndex);
     bool RetrieveFork(const uint256& hash, CBlockIndex** ppIndex);
     bool RetrieveFork(const std::string& strName, CBlockIndex** ppIndex);
+    bool RetrieveForkCommitSeq(const uint256& hash, CBlockIndex** ppIndex, uint64& nCommitSeq);
+    bool RetrieveForkCommitSeq(const uint256& hash, uint64& nCommitSeq);
     bool RetrieveProfile(const uint256& hash, CProfile& profile);
     bool RetrieveForkContext(const uint256& hash, CForkContext& ctxt);
     bool RetrieveAncestry(const uint256& hash, std::vector<std::pair<uint256, uint256>> vAncestry);
@@ -306,6 +323,8 @@ public:
     bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent);
     bool ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent);
     bool RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
+    bool RetrieveAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut);
+    bool WalkThroughAddressUnspentByAmount(const uint256& hashFork, CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut);
     int64 RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx);
 
     // DeFi
@@ -363,6 +382,68 @@ public:
         return true;
     }
 
+    template <typename D, typename Convert>
+    bool ListDeFiRelation(const uint256& hashFork, const CBlockView& view, xengine::CFlatForest<CDestination, D>& relation, Convert convert)
+    {
+        boost::shared_ptr<CBlockFork> spFork;
+        {
+            xengine::CReadLock rlock(rwAccess);
+            spFork = GetFork(hashFork);
+            if (!spFork)
+            {
+                return false;
+            }
+        }
+
+        if (spFork->GetProfile().nForkType != FORK_TYPE_DEFI)
+        {
+            return false;
+        }
+
+        std::vector<CBlockEx> vAdd;
+        std::vector<CBlockEx> vRemove;
+        view.GetBlockChanges(vAdd, vRemove);
+
+        std::set<CDestination> setRemove;
+        for (const CBlockEx& block : vRemove)
+        {
+            for (const CTransaction& tx : block.vtx)
+            {
+                if (tx.IsDeFiRelation())
+                {
+                    setRemove.insert(tx.sendTo);
+                }
+            }
+        }
+
+        relation.Clear();
+        auto& mapNode = spFork->GetRelation().mapNode;
+        relation.Reserve(mapNode.size());
+        for (auto& node : mapNode)
+        {
+            auto spParent = node.second->spParent.lock();
+            if (spParent && !setRemove.count(node.first))
+            {
+                relation.AddEdge(node.first, spParent->key, D(node.second->data));
+            }
+        }
+
+        for (const CBlockEx& block : boost::adaptors::reverse(vAdd))
+        {
+            for (std::size_t i = 0; i < block.vtx.size(); i++)
+            {
+                const CTransaction& tx = block.vtx[i];
+                const CTxContxt& txContxt = block.vTxContxt[i];
+                if (tx.IsDeFiRelation())
+                {
+                    relation.AddEdge(tx.sendTo, txContxt.destIn, convert(tx, txContxt.destIn));
+                }
+            }
+        }
+
+        return relation.Build();
+    }
+
     bool ListForkAllAddressAmount(const uint256& hashFork, CBlockView& view, std::map<CDestination, int64>& mapAddressAmount);
     bool AddDeFiRelation(const uint256& hashFork, boost::shared_ptr<CBlockFork> spFork, const std::vector<CBlockEx>& vAdd, const std::vector<CBlockEx>& vRemove);
     bool GetDeFiRelation(const uint256& hashFork, const CDestination& destIn, CAddrInfo& addrInfo);
@@ -347,6 +347,16 @@ bool CBlockDB::RetrieveAddressUnspent(const uint256& hashFork, const CDestinatio
     return dbAddressUnspent.RetrieveAddressUnspent(hashFork, dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CBlockDB::RetrieveAddressUnspentSummary(const uint256& hashFork, const CDestination& dest, CUnspentSummary& summary, uint256& hashLastBlockOut)
+{
+    return dbAddressUnspent.RetrieveAddressUnspentSummary(hashFork, dest, summary, hashLastBlockOut);
+}
+
+bool CBlockDB::WalkThroughAddressUnspentByAmount(const uint256& hashFork, CForkAddressUnspentDBWalker& walker, const CDestination& dest, const int64 nAmount, const bool fDescending, uint256& hashLastBlockOut)
+{
+    return dbAddressUnspent.WalkThroughAddressUnspentByAmount(hashFork, walker, dest, nAmount, fDescending, hashLastBlockOut);
+}
+
 int64 CBlockDB::RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
 {
     if (fDbCfgAddrTxIndex)
@@ -16,6 +16,67 @@ namespace ibrio
 namespace storage
 {
 
+//////////////////////////////
+// CCTSBloom
+
+static uint64 BloomHash(const uint8* pKey, size_t nSize)
+{
+    // FNV-1a
+    uint64 h = 14695981039346656037ULL;
+    for (size_t i = 0; i < nSize; i++)
+    {
+        h ^= pKey[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void CCTSBloom::Initialize(size_t nKeyCount)
+{
+    size_t nBits = nKeyCount * BITS_PER_KEY;
+    if (nBits < 64)
+    {
+        nBits = 64;
+    }
+    vchBits.assign((nBits + 7) / 8, 0);
+}
+
+void CCTSBloom::Add(const uint8* pKey, size_t nSize)
+{
+    if (vchBits.empty())
+    {
+        return;
+    }
+    uint64 h = BloomHash(pKey, nSize);
+    uint32 h1 = (uint32)h, h2 = (uint32)(h >> 32);
+    size_t nBits = vchBits.size() * 8;
+    for (int i = 0; i < HASH_COUNT; i++)
+    {
+        size_t nBit = (h1 + (uint64)i * h2) % nBits;
+        vchBits[nBit >> 3] |= (1 << (nBit & 7));
+    }
+}
+
+bool CCTSBloom::MayContain(const uint8* pKey, size_t nSize) const
+{
+    if (vchBits.empty())
+    {
+        return true;
+    }
+    uint64 h = BloomHash(pKey, nSize);
+    uint32 h1 = (uint32)h, h2 = (uint32)(h >> 32);
+    size_t nBits = vchBits.size() * 8;
+    for (int i = 0; i < HASH_COUNT; i++)
+    {
+        size_t nBit = (h1 + (uint64)i * h2) % nBits;
+        if ((vchBits[nBit >> 3] & (1 << (nBit & 7))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 //////////////////////////////
 // CCTSIndex
 
@@ -48,9 +109,10 @@ void CCTSIndex::Deinitialize()
     Close();
 }
 
-bool CCTSIndex::Update(const vector<int64>& vTime, const vector<CDiskPos>& vPos, const vector<int64>& vDel)
+bool CCTSIndex::Update(const vector<int64>& vTime, const vector<CDiskPos>& vPos,
+                       const vector<CCTSBloom>& vBloom, const vector<int64>& vDel)
 {
-    if (vTime.size() != vPos.size())
+    if (vTime.size() != vPos.size() || vTime.size() != vBloom.size())
     {
         return false;
     }
@@ -62,7 +124,10 @@ bool CCTSIndex::Update(const vector<int64>& vTime, const vector<CDiskPos>& vPos,
 
     for (int i = 0; i < vTime.size(); i++)
     {
-        Write(vTime[i], vPos[i]);
+        CIndexValue value;
+        value.pos = vPos[i];
+        value.bloom = vBloom[i];
+        Write(vTime[i], value);
     }
 
     for (int i = 0; i < vDel.size(); i++)
@@ -83,5 +148,17 @@ bool CCTSIndex::Retrieve(const int64 nTime, CDiskPos& pos)
     return Read(nTime, pos);
 }
 
+bool CCTSIndex::Retrieve(const int64 nTime, CDiskPos& pos, CCTSBloom& bloom)
+{
+    CIndexValue value;
+    if (!Read(nTime, value))
+    {
+        return false;
+    }
+    pos = value.pos;
+    bloom = value.bloom;
+    return true;
+}
+
 } // namespace storage
 } // namespace ibrio
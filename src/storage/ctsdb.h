@@ -7,7 +7,9 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/range/algorithm.hpp>
+#include <boost/thread/thread.hpp>
 #include <iostream>
+#include <list>
 #include <snappy.h>
 
 #include "timeseries.h"
@@ -20,16 +22,86 @@ namespace ibrio
 namespace storage
 {
 
+// Compact bloom filter of the keys in a chunk. It is stored in index beside the chunk position,
+// so that a key absent from the chunk is answered without reading and decoding it.
+// Empty filter, as the index written before it, matches any key
+class CCTSBloom
+{
+    friend class xengine::CStream;
+
+public:
+    enum
+    {
+        BITS_PER_KEY = 10,
+        HASH_COUNT = 7
+    };
+
+    CCTSBloom() {}
+    void Initialize(std::size_t nKeyCount);
+    void Add(const uint8* pKey, std::size_t nSize);
+    bool MayContain(const uint8* pKey, std::size_t nSize) const;
+    template <typename K>
+    void Add(const K& key)
+    {
+        Add((const uint8*)&key, sizeof(K));
+    }
+    template <typename K>
+    bool MayContain(const K& key) const
+    {
+        return MayContain((const uint8*)&key, sizeof(K));
+    }
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(vchBits, opt);
+    }
+
+protected:
+    std::vector<uint8> vchBits;
+};
+
 class CCTSIndex : public xengine::CKVDB
 {
+    class CIndexValue
+    {
+        friend class xengine::CStream;
+
+    public:
+        CDiskPos pos;
+        CCTSBloom bloom;
+
+    protected:
+        void Serialize(xengine::CStream& s, xengine::SaveType& opt)
+        {
+            s.Serialize(pos, opt);
+            s.Serialize(bloom, opt);
+        }
+        void Serialize(xengine::CStream& s, xengine::LoadType& opt)
+        {
+            s.Serialize(pos, opt);
+            if (s.GetSize() > 0)
+            {
+                s.Serialize(bloom, opt);
+            }
+        }
+        void Serialize(xengine::CStream& s, std::size_t& serSize)
+        {
+            s.Serialize(pos, serSize);
+            s.Serialize(bloom, serSize);
+        }
+    };
+
 public:
     CCTSIndex();
     ~CCTSIndex();
     bool Initialize(const boost::filesystem::path& pathCTSDB);
     void Deinitialize();
     bool Update(const std::vector<int64>& vTime, const std::vector<CDiskPos>& vPos,
-                const std::vector<int64>& vDel);
+                const std::vector<CCTSBloom>& vBloom, const std::vector<int64>& vDel);
     bool Retrieve(const int64, CDiskPos& pos);
+    bool Retrieve(const int64, CDiskPos& pos, CCTSBloom& bloom);
 };
 
 template <typename K, typename V>
@@ -45,7 +117,7 @@ public:
       : basetype(first, last)
     {
     }
-    bool Find(const K& k, V& v)
+    bool Find(const K& k, V& v) const
     {
         int s = 0, m = 0, e = basetype::size() - 1;
         while (s <= e)
@@ -129,6 +201,99 @@ protected:
     }
 };
 
+// LRU of decoded chunks, bounded by the size of decoded data and shared by several CCTSDB
+template <typename C>
+class CCTSChunkCache
+{
+    typedef std::pair<uint64, int64> CChunkKey;
+    class CChunkEntry
+    {
+    public:
+        std::shared_ptr<const C> spChunk;
+        std::size_t nSize;
+        typename std::list<CChunkKey>::iterator itLru;
+    };
+
+public:
+    enum
+    {
+        DEFAULT_MAX_SIZE = 64 * 1024 * 1024
+    };
+
+    CCTSChunkCache(std::size_t nMaxSizeIn = DEFAULT_MAX_SIZE)
+      : nMaxSize(nMaxSizeIn), nSize(0), nIdCreate(0) {}
+    uint64 CreateId()
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCache);
+        return ++nIdCreate;
+    }
+    std::shared_ptr<const C> Get(const uint64 nId, const int64 nTime)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCache);
+        typename std::map<CChunkKey, CChunkEntry>::iterator it = mapChunk.find(CChunkKey(nId, nTime));
+        if (it == mapChunk.end())
+        {
+            return nullptr;
+        }
+        lstLru.splice(lstLru.end(), lstLru, (*it).second.itLru);
+        return (*it).second.spChunk;
+    }
+    void Add(const uint64 nId, const int64 nTime, std::shared_ptr<const C> spChunk, const std::size_t nChunkSize)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCache);
+        if (nChunkSize > nMaxSize)
+        {
+            return;
+        }
+        EraseEntry(CChunkKey(nId, nTime));
+        while (!lstLru.empty() && nSize + nChunkSize > nMaxSize)
+        {
+            EraseEntry(lstLru.front());
+        }
+        CChunkEntry& entry = mapChunk[CChunkKey(nId, nTime)];
+        entry.spChunk = spChunk;
+        entry.nSize = nChunkSize;
+        entry.itLru = lstLru.insert(lstLru.end(), CChunkKey(nId, nTime));
+        nSize += nChunkSize;
+    }
+    void Remove(const uint64 nId, const int64 nTime)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCache);
+        EraseEntry(CChunkKey(nId, nTime));
+    }
+    void Remove(const uint64 nId)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxCache);
+        typename std::map<CChunkKey, CChunkEntry>::iterator it = mapChunk.lower_bound(CChunkKey(nId, INT64_MIN));
+        while (it != mapChunk.end() && (*it).first.first == nId)
+        {
+            nSize -= (*it).second.nSize;
+            lstLru.erase((*it).second.itLru);
+            mapChunk.erase(it++);
+        }
+    }
+
+protected:
+    void EraseEntry(const CChunkKey& key)
+    {
+        typename std::map<CChunkKey, CChunkEntry>::iterator it = mapChunk.find(key);
+        if (it != mapChunk.end())
+        {
+            nSize -= (*it).second.nSize;
+            lstLru.erase((*it).second.itLru);
+            mapChunk.erase(it);
+        }
+    }
+
+protected:
+    boost::mutex mtxCache;
+    std::size_t nMaxSize;
+    std::size_t nSize;
+    uint64 nIdCreate;
+    std::map<CChunkKey, CChunkEntry> mapChunk;
+    std::list<CChunkKey> lstLru;
+};
+
 template <typename K, typename V, typename C = CCTSChunk<K, V>>
 class CCTSDB
 {
@@ -170,6 +335,13 @@ class CCTSDB
     };
 
 public:
+    CCTSDB()
+      : nCacheId(0) {}
+    void SetChunkCache(std::shared_ptr<CCTSChunkCache<C>> spChunkCacheIn)
+    {
+        spChunkCache = spChunkCacheIn;
+        nCacheId = (spChunkCache ? spChunkCache->CreateId() : 0);
+    }
     bool Initialize(const boost::filesystem::path& pathCTSDB)
     {
         if (!boost::filesystem::exists(pathCTSDB))
@@ -199,11 +371,19 @@ public:
         dbIndex.Deinitialize();
         tsChunk.Deinitialize();
         dblMeta.Clear();
+        if (spChunkCache)
+        {
+            spChunkCache->Remove(nCacheId);
+        }
     }
     void RemoveAll()
     {
         dbIndex.RemoveAll();
         dblMeta.Clear();
+        if (spChunkCache)
+        {
+            spChunkCache->Remove(nCacheId);
+        }
     }
     void Update(const int64 nTime, const K& key, const V& value)
     {
@@ -234,12 +414,12 @@ public:
             return false;
         }
 
-        C chunk;
-        if (LoadFromFile(nTime, chunk))
+        std::shared_ptr<const C> spChunk;
+        if (LoadChunk(nTime, key, spChunk))
         {
             if (fSaveLoad)
             {
-                mapUpper[nTime].insert(chunk.begin(), chunk.end());
+                mapUpper[nTime].insert(spChunk->begin(), spChunk->end());
 
                 int64 nDelStartTime = nTime - CACHE_UPPER_DURATION;
                 for (auto it = mapUpper.begin(); it != mapUpper.end();)
@@ -251,7 +431,7 @@ public:
                     mapUpper.erase(it++);
                 }
             }
-            return chunk.Find(key, value);
+            return spChunk->Find(key, value);
         }
 
         return false;
@@ -263,6 +443,7 @@ public:
 
         std::vector<int64> vTime, vDel;
         std::vector<C> vChunk;
+        std::vector<CCTSBloom> vBloom;
         MapType& flushMap = dblMeta.GetUpperMap();
         if (!fAll && flushMap.size() < FLUSH_THRESH)
         {
@@ -280,6 +461,14 @@ public:
             {
                 vTime.push_back((*it).first);
                 vChunk.push_back(C(mapValue.begin(), mapValue.end()));
+
+                vBloom.push_back(CCTSBloom());
+                CCTSBloom& bloom = vBloom.back();
+                bloom.Initialize(mapValue.size());
+                for (typename std::map<K, V>::iterator mi = mapValue.begin(); mi != mapValue.end(); ++mi)
+                {
+                    bloom.Add((*mi).first);
+                }
             }
         }
 
@@ -294,12 +483,24 @@ public:
 
         if (!vPos.empty() || !vDel.empty())
         {
-            if (!dbIndex.Update(vTime, vPos, vDel))
+            if (!dbIndex.Update(vTime, vPos, vBloom, vDel))
             {
                 return false;
             }
         }
 
+        if (spChunkCache)
+        {
+            for (const int64 nTime : vTime)
+            {
+                spChunkCache->Remove(nCacheId, nTime);
+            }
+            for (const int64 nTime : vDel)
+            {
+                spChunkCache->Remove(nCacheId, nTime);
+            }
+        }
+
         ulock.Upgrade();
         flushMap.clear();
 
@@ -325,6 +526,37 @@ protected:
         return mapUpdate[nTime];
     }
 
+    bool LoadChunk(const int64 nTime, const K& key, std::shared_ptr<const C>& spChunk)
+    {
+        if (spChunkCache)
+        {
+            spChunk = spChunkCache->Get(nCacheId, nTime);
+            if (spChunk)
+            {
+                return true;
+            }
+        }
+
+        CDiskPos pos;
+        CCTSBloom bloom;
+        if (!dbIndex.Retrieve(nTime, pos, bloom) || !bloom.MayContain(key))
+        {
+            return false;
+        }
+
+        std::shared_ptr<C> spNewChunk(new C());
+        if (!tsChunk.Read(*spNewChunk, pos))
+        {
+            return false;
+        }
+        if (spChunkCache)
+        {
+            spChunkCache->Add(nCacheId, nTime, spNewChunk, spNewChunk->size() * sizeof(std::pair<K, V>));
+        }
+        spChunk = spNewChunk;
+        return true;
+    }
+
     bool LoadFromFile(const int64 nTime, C& chunk)
     {
         CDiskPos pos;
@@ -340,6 +572,8 @@ protected:
     CCTSIndex dbIndex;
     CTimeSeriesChunk tsChunk;
     CDblMap dblMeta;
+    std::shared_ptr<CCTSChunkCache<C>> spChunkCache;
+    uint64 nCacheId;
 };
 
 } // namespace storage
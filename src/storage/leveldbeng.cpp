@@ -221,5 +221,60 @@ bool CLevelDBEngine::MoveNext(CBufStream& ssKey, CBufStream& ssValue)
     return true;
 }
 
+bool CLevelDBEngine::MoveLast()
+{
+    delete piter;
+
+    if ((piter = pdb->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    piter->SeekToLast();
+
+    return true;
+}
+
+bool CLevelDBEngine::MoveToPrev(CBufStream& ssKey)
+{
+    delete piter;
+
+    leveldb::Slice slKey(ssKey.GetData(), ssKey.GetSize());
+
+    if ((piter = pdb->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    // position at the last key less than ssKey
+    piter->Seek(slKey);
+    if (piter->Valid())
+    {
+        piter->Prev();
+    }
+    else
+    {
+        piter->SeekToLast();
+    }
+
+    return true;
+}
+
+bool CLevelDBEngine::MovePrev(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (piter == nullptr || !piter->Valid())
+        return false;
+
+    leveldb::Slice slKey = piter->key();
+    leveldb::Slice slValue = piter->value();
+
+    ssKey.Write(slKey.data(), slKey.size());
+    ssValue.Write(slValue.data(), slValue.size());
+
+    piter->Prev();
+
+    return true;
+}
+
 } // namespace storage
 } // namespace ibrio
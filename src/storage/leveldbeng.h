@@ -46,6 +46,9 @@ public:
     bool MoveFirst() override;
     bool MoveTo(xengine::CBufStream& ssKey) override;
     bool MoveNext(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
+    bool MoveLast() override;
+    bool MoveToPrev(xengine::CBufStream& ssKey) override;
+    bool MovePrev(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
 
 protected:
     std::string path;
@@ -6,7 +6,10 @@
 #define STORAGE_TIMESERIES_H
 
 #include <boost/filesystem.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/thread.hpp>
+#include <deque>
+#include <memory>
 #include <xengine.h>
 
 #include "crc24q.h"
@@ -89,6 +92,58 @@ protected:
     uint32 nLastFile;
 };
 
+template <typename T>
+class CTSWalkChunk
+{
+public:
+    class CRecord
+    {
+    public:
+        CRecord(uint32 nOffsetIn, uint32 nSizeIn, uint32 nCrcIn, std::size_t nDataPosIn)
+          : nOffset(nOffsetIn), nSize(nSizeIn), nCrc(nCrcIn), nDataPos(nDataPosIn) {}
+
+    public:
+        uint32 nOffset;
+        uint32 nSize;
+        uint32 nCrc;
+        std::size_t nDataPos;
+    };
+
+public:
+    CTSWalkChunk(uint32 nFileIn)
+      : nFile(nFileIn), fClaimed(false), fDecoded(false), nValid(0), fDataError(false), nErrorOffset(0), fReadError(false) {}
+
+public:
+    uint32 nFile;
+    std::vector<uint8> vData;
+    std::vector<CRecord> vRecord;
+    std::vector<T> vItem;
+    bool fClaimed;
+    bool fDecoded;
+    std::size_t nValid;
+    bool fDataError;
+    uint32 nErrorOffset;
+    bool fReadError;
+};
+
+template <typename T>
+class CTSParallelWalkContext
+{
+public:
+    CTSParallelWalkContext(const std::size_t nMaxChunkIn)
+      : nMaxChunk(nMaxChunkIn), fReadComplete(false), fAbort(false) {}
+
+public:
+    boost::mutex mtxChunk;
+    boost::condition_variable condRead;
+    boost::condition_variable condDecode;
+    boost::condition_variable condWalk;
+    std::deque<std::shared_ptr<CTSWalkChunk<T>>> queChunk;
+    const std::size_t nMaxChunk;
+    bool fReadComplete;
+    bool fAbort;
+};
+
 class CTimeSeriesCached : public CTimeSeriesBase
 {
 public:
@@ -414,6 +469,125 @@ public:
         }
         return fRet;
     }
+    /**
+     * Same result as WalkThrough, files are read sequentially on a reader thread,
+     * records are checked and deserialized in chunks by nThreads decode threads,
+     * and the walker is called in file order on the calling thread.
+     */
+    template <typename T>
+    bool ParallelWalkThrough(CTSWalker<T>& walker, uint32& nLastFileRet, uint32& nLastPosRet, bool fRepairFile, const uint32 nThreads)
+    {
+        if (nThreads <= 1)
+        {
+            return WalkThrough(walker, nLastFileRet, nLastPosRet, fRepairFile);
+        }
+
+        const uint32 nHeadSize = sizeof(uint32) + sizeof(uint32) + sizeof(uint32);
+        nLastFileRet = 0;
+        nLastPosRet = 0;
+
+        CTSParallelWalkContext<T> ctx(nThreads * 2 + 2);
+        boost::thread thrRead([&]() { ParallelReadChunk(ctx); });
+        boost::thread_group thrDecode;
+        for (uint32 i = 0; i < nThreads; i++)
+        {
+            thrDecode.create_thread([&]() { ParallelDecodeChunk(ctx); });
+        }
+
+        bool fRet = true;
+        bool fFileDataError = false;
+        uint32 nFile = 0;
+        uint32 nOffset = 0;
+        try
+        {
+            for (;;)
+            {
+                std::shared_ptr<CTSWalkChunk<T>> spChunk;
+                {
+                    boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+                    while (ctx.queChunk.empty() ? !ctx.fReadComplete : !ctx.queChunk.front()->fDecoded)
+                    {
+                        ctx.condWalk.wait(lock);
+                    }
+                    if (ctx.queChunk.empty())
+                    {
+                        break;
+                    }
+                    spChunk = ctx.queChunk.front();
+                    ctx.queChunk.pop_front();
+                    ctx.condRead.notify_one();
+                }
+
+                if (spChunk->nFile != nFile)
+                {
+                    nFile = spChunk->nFile;
+                    nOffset = 0;
+                    nLastFileRet = nFile;
+                }
+                for (std::size_t i = 0; i < spChunk->nValid; i++)
+                {
+                    const typename CTSWalkChunk<T>::CRecord& record = spChunk->vRecord[i];
+                    if (!walker.Walk(spChunk->vItem[i], nFile, record.nOffset + nHeadSize))
+                    {
+                        xengine::StdLog("TimeSeriesCached", "ParallelWalkThrough: Walk fail");
+                        fRet = false;
+                        break;
+                    }
+                    nOffset = record.nOffset + nHeadSize + record.nSize;
+                }
+                if (!fRet)
+                {
+                    break;
+                }
+                if (spChunk->nValid < spChunk->vRecord.size())
+                {
+                    nOffset = spChunk->vRecord[spChunk->nValid].nOffset;
+                    fFileDataError = true;
+                    break;
+                }
+                if (spChunk->fDataError)
+                {
+                    nOffset = spChunk->nErrorOffset;
+                    fFileDataError = true;
+                    break;
+                }
+                if (spChunk->fReadError)
+                {
+                    fRet = false;
+                    break;
+                }
+            }
+        }
+        catch (std::exception& e)
+        {
+            xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: catch error, nFile: %d, msg: %s", nFile, e.what());
+            fRet = false;
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+            ctx.fAbort = true;
+            ctx.condRead.notify_all();
+            ctx.condDecode.notify_all();
+        }
+        thrRead.join();
+        thrDecode.join_all();
+
+        if (fRet && fFileDataError && fRepairFile)
+        {
+            if (!RepairFile(nFile, nOffset))
+            {
+                xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: RepairFile fail");
+                fRet = false;
+            }
+            else
+            {
+                xengine::StdLog("TimeSeriesCached", "ParallelWalkThrough: RepairFile success");
+            }
+        }
+        nLastPosRet = nOffset;
+        return fRet;
+    }
     template <typename T>
     bool ReadDirect(T& t, uint32 nFile, uint32 nOffset)
     {
@@ -468,6 +642,195 @@ protected:
     void ResetCache();
     bool VacateCache(uint32 nNeeded);
     template <typename T>
+    bool PushWalkChunk(CTSParallelWalkContext<T>& ctx, std::shared_ptr<CTSWalkChunk<T>>& spChunk)
+    {
+        boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+        while (ctx.queChunk.size() >= ctx.nMaxChunk && !ctx.fAbort)
+        {
+            ctx.condRead.wait(lock);
+        }
+        if (ctx.fAbort)
+        {
+            return false;
+        }
+        ctx.queChunk.push_back(spChunk);
+        ctx.condDecode.notify_one();
+        return true;
+    }
+    template <typename T>
+    void ParallelReadChunk(CTSParallelWalkContext<T>& ctx)
+    {
+        const uint32 nHeadSize = sizeof(uint32) + sizeof(uint32) + sizeof(uint32);
+        std::string pathFile;
+        for (uint32 nFile = 1; GetFilePath(nFile, pathFile); nFile++)
+        {
+            std::shared_ptr<CTSWalkChunk<T>> spChunk(new CTSWalkChunk<T>(nFile));
+            try
+            {
+                xengine::CFileStream fs(pathFile.c_str());
+                fs.Seek(0);
+                uint32 nOffset = 0;
+                std::size_t nFileSize = fs.GetSize();
+                if (nFileSize > MAX_FILE_SIZE)
+                {
+                    xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: File size error, nFile: %d, size: %lu", nFile, nFileSize);
+                    spChunk->fDataError = true;
+                }
+                while (!spChunk->fDataError && nOffset < (uint32)nFileSize)
+                {
+                    if (nOffset + nHeadSize > (uint32)nFileSize)
+                    {
+                        xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: (nOffset + %d) error, nFile: %d, nFileSize: %lu, nOffset: %d", nHeadSize, nFile, nFileSize, nOffset);
+                        spChunk->fDataError = true;
+                        break;
+                    }
+                    uint32 nMagic, nSize, nCrc;
+                    try
+                    {
+                        fs >> nMagic >> nSize >> nCrc;
+                    }
+                    catch (std::exception& e)
+                    {
+                        xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: Read nMagic and nSize error, nFile: %d, msg: %s", nFile, e.what());
+                        spChunk->fDataError = true;
+                        break;
+                    }
+                    if (nMagic != nMagicNum)
+                    {
+                        xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: nMagic error, nFile: %d, nOffset: %d, nMagic: %x, right magic: %x",
+                                          nFile, nOffset, nMagic, nMagicNum);
+                        spChunk->fDataError = true;
+                        break;
+                    }
+                    if (nOffset + nHeadSize + nSize > (uint32)nFileSize)
+                    {
+                        xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: (nOffset + %d + nSize) error, nFile: %d, nFileSize: %lu, nOffset: %d, nSize: %d",
+                                          nHeadSize, nFile, nFileSize, nOffset, nSize);
+                        spChunk->fDataError = true;
+                        break;
+                    }
+                    std::size_t nDataPos = spChunk->vData.size();
+                    if (nSize > 0)
+                    {
+                        spChunk->vData.resize(nDataPos + nSize);
+                        try
+                        {
+                            fs.Read((char*)&spChunk->vData[nDataPos], nSize);
+                        }
+                        catch (std::exception& e)
+                        {
+                            xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: Read data error, nFile: %d, msg: %s", nFile, e.what());
+                            spChunk->vData.resize(nDataPos);
+                            spChunk->fDataError = true;
+                            break;
+                        }
+                    }
+                    spChunk->vRecord.push_back(typename CTSWalkChunk<T>::CRecord(nOffset, nSize, nCrc, nDataPos));
+                    nOffset += nHeadSize + nSize;
+
+                    if (spChunk->vData.size() >= WALK_CHUNK_SIZE || spChunk->vRecord.size() >= WALK_CHUNK_RECORD)
+                    {
+                        if (!PushWalkChunk(ctx, spChunk))
+                        {
+                            return;
+                        }
+                        spChunk.reset(new CTSWalkChunk<T>(nFile));
+                    }
+                }
+                spChunk->nErrorOffset = nOffset;
+            }
+            catch (std::exception& e)
+            {
+                xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: catch error, nFile: %d, msg: %s", nFile, e.what());
+                spChunk->fReadError = true;
+            }
+            // The last chunk of a file is pushed even if empty, the walker tracks the current file by it
+            if (!PushWalkChunk(ctx, spChunk) || spChunk->fDataError || spChunk->fReadError)
+            {
+                break;
+            }
+        }
+
+        boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+        ctx.fReadComplete = true;
+        ctx.condDecode.notify_all();
+        ctx.condWalk.notify_all();
+    }
+    template <typename T>
+    void ParallelDecodeChunk(CTSParallelWalkContext<T>& ctx)
+    {
+        for (;;)
+        {
+            std::shared_ptr<CTSWalkChunk<T>> spChunk;
+            {
+                boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+                while (!ctx.fAbort)
+                {
+                    for (std::size_t i = 0; i < ctx.queChunk.size(); i++)
+                    {
+                        if (!ctx.queChunk[i]->fClaimed)
+                        {
+                            spChunk = ctx.queChunk[i];
+                            spChunk->fClaimed = true;
+                            break;
+                        }
+                    }
+                    if (spChunk || ctx.fReadComplete)
+                    {
+                        break;
+                    }
+                    ctx.condDecode.wait(lock);
+                }
+                if (!spChunk)
+                {
+                    return;
+                }
+            }
+
+            DecodeWalkChunk(*spChunk);
+
+            boost::unique_lock<boost::mutex> lock(ctx.mtxChunk);
+            spChunk->fDecoded = true;
+            ctx.condWalk.notify_all();
+        }
+    }
+    template <typename T>
+    void DecodeWalkChunk(CTSWalkChunk<T>& chunk)
+    {
+        chunk.vItem.resize(chunk.vRecord.size());
+        for (std::size_t i = 0; i < chunk.vRecord.size(); i++)
+        {
+            const typename CTSWalkChunk<T>::CRecord& record = chunk.vRecord[i];
+            if (record.nSize > 0)
+            {
+                const uint8* pData = &chunk.vData[record.nDataPos];
+                if (record.nCrc != ibrio::crypto::crc24q(pData, record.nSize))
+                {
+                    xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: crc error, nFile: %d, nOffset: %d", chunk.nFile, record.nOffset);
+                    break;
+                }
+                try
+                {
+                    xengine::CBufStream bs;
+                    bs.Write((const char*)pData, record.nSize);
+                    bs >> chunk.vItem[i];
+                    if (bs.size() > 0)
+                    {
+                        xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: data size error, nFile: %d, nOffset: %d", chunk.nFile, record.nOffset);
+                        break;
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    xengine::StdError("TimeSeriesCached", "ParallelWalkThrough: Read t error, nFile: %d, msg: %s", chunk.nFile, e.what());
+                    break;
+                }
+            }
+            chunk.nValid = i + 1;
+        }
+        std::vector<uint8>().swap(chunk.vData);
+    }
+    template <typename T>
     bool WriteToCache(const T& t, const CDiskPos& diskpos)
     {
         xengine::CBufStream ss;
@@ -525,7 +888,9 @@ protected:
 protected:
     enum
     {
-        FILE_CACHE_SIZE = 0x2000000
+        FILE_CACHE_SIZE = 0x2000000,
+        WALK_CHUNK_SIZE = 0x100000,
+        WALK_CHUNK_RECORD = 1024
     };
     boost::mutex mtxCache;
     xengine::CCircularStream cacheStream;
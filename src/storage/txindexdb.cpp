@@ -19,6 +19,7 @@ namespace storage
 // CTxIndexDB
 
 CTxIndexDB::CTxIndexDB()
+  : spChunkCache(new CCTSChunkCache<CForkTxChunk>()), vForkHint(1 << FORK_HINT_BITS)
 {
     pThreadFlush = nullptr;
     fStopFlush = true;
@@ -106,6 +107,7 @@ bool CTxIndexDB::LoadFork(const uint256& hashFork)
     {
         return false;
     }
+    spTxDB->SetChunkCache(spChunkCache);
     mapTxDB.insert(make_pair(hashFork, spTxDB));
     return true;
 }
@@ -151,6 +153,7 @@ bool CTxIndexDB::Update(const uint256& hashFork, const vector<pair<uint256, CTxI
     {
         CTxId txid(vTxNew[i].first);
         spTxDB->Update(txid.GetTxTime(), txid.GetTxHash(), vTxNew[i].second);
+        SetForkHint(vTxNew[i].first, hashFork);
     }
 
     for (int i = 0; i < vTxDel.size(); i++)
@@ -184,6 +187,17 @@ bool CTxIndexDB::Retrieve(const uint256& txidIn, CTxIndex& txIndex, uint256& has
 
     CTxId txid(txidIn);
 
+    uint256 hashHint;
+    if (GetForkHint(txidIn, hashHint))
+    {
+        map<uint256, std::shared_ptr<CForkTxDB>>::iterator it = mapTxDB.find(hashHint);
+        if (it != mapTxDB.end() && (*it).second->Retrieve(txid.GetTxTime(), txid.GetTxHash(), txIndex))
+        {
+            hashFork = hashHint;
+            return true;
+        }
+    }
+
     for (map<uint256, std::shared_ptr<CForkTxDB>>::iterator it = mapTxDB.begin();
          it != mapTxDB.end(); ++it)
     {
@@ -191,6 +205,7 @@ bool CTxIndexDB::Retrieve(const uint256& txidIn, CTxIndex& txIndex, uint256& has
         if (spTxDB->Retrieve(txid.GetTxTime(), txid.GetTxHash(), txIndex))
         {
             hashFork = (*it).first;
+            SetForkHint(txidIn, hashFork);
             return true;
         }
     }
@@ -227,6 +242,24 @@ void CTxIndexDB::Flush(const uint256& hashFork)
     spTxDB->Flush();
 }
 
+bool CTxIndexDB::GetForkHint(const uint256& txid, uint256& hashFork)
+{
+    boost::unique_lock<boost::mutex> lock(mtxForkHint);
+    const pair<uint256, uint256>& hint = vForkHint[txid.Get32() & (vForkHint.size() - 1)];
+    if (hint.first != txid)
+    {
+        return false;
+    }
+    hashFork = hint.second;
+    return true;
+}
+
+void CTxIndexDB::SetForkHint(const uint256& txid, const uint256& hashFork)
+{
+    boost::unique_lock<boost::mutex> lock(mtxForkHint);
+    vForkHint[txid.Get32() & (vForkHint.size() - 1)] = make_pair(txid, hashFork);
+}
+
 void CTxIndexDB::FlushProc()
 {
     SetThreadName("TxIndexDB");
@@ -18,7 +18,13 @@ namespace storage
 
 class CTxIndexDB
 {
-    typedef CCTSDB<uint224, CTxIndex, CCTSChunkSnappy<uint224, CTxIndex>> CForkTxDB;
+    typedef CCTSChunkSnappy<uint224, CTxIndex> CForkTxChunk;
+    typedef CCTSDB<uint224, CTxIndex, CForkTxChunk> CForkTxDB;
+
+    enum
+    {
+        FORK_HINT_BITS = 16
+    };
 
 public:
     CTxIndexDB();
@@ -38,11 +44,19 @@ public:
 
 protected:
     void FlushProc();
+    bool GetForkHint(const uint256& txid, uint256& hashFork);
+    void SetForkHint(const uint256& txid, const uint256& hashFork);
 
 protected:
     boost::filesystem::path pathTxIndex;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkTxDB>> mapTxDB;
+    std::shared_ptr<CCTSChunkCache<CForkTxChunk>> spChunkCache;
+
+    // Direct mapped table of the fork of recently added or retrieved txid,
+    // tried first by lookup without fork
+    boost::mutex mtxForkHint;
+    std::vector<std::pair<uint256, uint256>> vForkHint;
 
     boost::mutex mtxFlush;
     boost::condition_variable condFlush;
@@ -103,10 +103,134 @@ bool CWalletAddrDB::AddressDBWalker(CBufStream& ssKey, CBufStream& ssValue, CWal
     return false;
 }
 
+//////////////////////////////
+// CWalletIndexDB
+
+bool CWalletIndexDB::Initialize(const boost::filesystem::path& pathWallet)
+{
+    CLevelDBArguments args;
+    args.path = (pathWallet / "index").string();
+    args.syncwrite = true;
+    args.files = 8;
+    args.cache = 4 << 20;
+
+    CLevelDBEngine* engine = new CLevelDBEngine(args);
+
+    if (!Open(engine))
+    {
+        delete engine;
+        return false;
+    }
+
+    return true;
+}
+
+void CWalletIndexDB::Deinitialize()
+{
+    Close();
+}
+
+bool CWalletIndexDB::Update(const uint256& hashFork, const CWalletIndexChange& change)
+{
+    if (!TxnBegin())
+    {
+        return false;
+    }
+
+    Write(make_pair((uint8)WALLET_INDEX_FORK_PREFIX, hashFork), make_pair(change.hashLastBlock, change.nExtendedSeq));
+
+    for (const auto& vd : change.mapDest)
+    {
+        auto key = make_pair(make_pair((uint8)WALLET_INDEX_DEST_PREFIX, hashFork), vd.first);
+        if (vd.second)
+        {
+            Write(key, change.hashLastBlock);
+        }
+        else
+        {
+            Erase(key);
+        }
+    }
+
+    for (const auto& vd : change.mapUnspent)
+    {
+        auto key = make_pair(make_pair((uint8)WALLET_INDEX_UNSPENT_PREFIX, hashFork), vd.first);
+        if (!vd.second.IsNull())
+        {
+            Write(key, vd.second);
+        }
+        else
+        {
+            Erase(key);
+        }
+    }
+
+    for (const auto& vd : change.mapTx)
+    {
+        auto key = make_pair(make_pair((uint8)WALLET_INDEX_TX_PREFIX, hashFork), vd.first);
+        if (vd.second.nDirection != CAddrTxInfo::TXI_DIRECTION_NULL)
+        {
+            Write(key, vd.second);
+        }
+        else
+        {
+            Erase(key);
+        }
+    }
+
+    return TxnCommit();
+}
+
+bool CWalletIndexDB::WalkThroughIndex(CWalletDBIndexWalker& walker)
+{
+    return WalkThrough(boost::bind(&CWalletIndexDB::IndexDBWalker, this, _1, _2, boost::ref(walker)));
+}
+
+bool CWalletIndexDB::IndexDBWalker(CBufStream& ssKey, CBufStream& ssValue, CWalletDBIndexWalker& walker)
+{
+    uint8 nPrefix;
+    uint256 hashFork;
+    ssKey >> nPrefix >> hashFork;
+
+    if (nPrefix == WALLET_INDEX_FORK_PREFIX)
+    {
+        uint256 hashLastBlock;
+        int nExtendedSeq;
+        ssValue >> hashLastBlock >> nExtendedSeq;
+        return walker.WalkFork(hashFork, hashLastBlock, nExtendedSeq);
+    }
+    else if (nPrefix == WALLET_INDEX_DEST_PREFIX)
+    {
+        CDestination dest;
+        ssKey >> dest;
+        return walker.WalkDest(hashFork, dest);
+    }
+    else if (nPrefix == WALLET_INDEX_UNSPENT_PREFIX)
+    {
+        CDestination dest;
+        CTxOutPoint out;
+        CUnspentOut unspent;
+        ssKey >> dest >> out;
+        ssValue >> unspent;
+        return walker.WalkUnspent(hashFork, dest, out, unspent);
+    }
+    else if (nPrefix == WALLET_INDEX_TX_PREFIX)
+    {
+        CAddrTxIndex txIndex;
+        CAddrTxInfo txInfo;
+        ssKey >> txIndex;
+        ssValue >> txInfo;
+        return walker.WalkTx(hashFork, txIndex, txInfo);
+    }
+
+    return false;
+}
+
 //////////////////////////////
 // CWalletDB
 
 CWalletDB::CWalletDB()
+  : fIndex(false)
 {
 }
 
@@ -115,8 +239,10 @@ CWalletDB::~CWalletDB()
     Deinitialize();
 }
 
-bool CWalletDB::Initialize(const boost::filesystem::path& pathWallet)
+bool CWalletDB::Initialize(const boost::filesystem::path& pathWallet, const bool fIndexIn)
 {
+    fIndex = fIndexIn;
+
     if (!boost::filesystem::exists(pathWallet))
     {
         boost::filesystem::create_directories(pathWallet);
@@ -132,11 +258,17 @@ bool CWalletDB::Initialize(const boost::filesystem::path& pathWallet)
         return false;
     }
 
+    if (fIndex && !dbIndex.Initialize(pathWallet))
+    {
+        return false;
+    }
+
     return true;
 }
 
 void CWalletDB::Deinitialize()
 {
+    dbIndex.Deinitialize();
     dbAddr.Deinitialize();
 }
 
@@ -165,5 +297,23 @@ bool CWalletDB::WalkThroughAddress(CWalletDBAddrWalker& walker)
     return dbAddr.WalkThroughAddress(walker);
 }
 
+bool CWalletDB::UpdateIndex(const uint256& hashFork, const CWalletIndexChange& change)
+{
+    if (!fIndex)
+    {
+        return false;
+    }
+    return dbIndex.Update(hashFork, change);
+}
+
+bool CWalletDB::WalkThroughIndex(CWalletDBIndexWalker& walker)
+{
+    if (!fIndex)
+    {
+        return false;
+    }
+    return dbIndex.WalkThroughIndex(walker);
+}
+
 } // namespace storage
 } // namespace ibrio
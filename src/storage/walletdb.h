@@ -43,21 +43,72 @@ protected:
     bool AddressDBWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, CWalletDBAddrWalker& walker);
 };
 
+class CWalletIndexChange
+{
+public:
+    CWalletIndexChange()
+      : nExtendedSeq(0) {}
+
+public:
+    uint256 hashLastBlock;
+    int nExtendedSeq;
+    // false : erase
+    std::map<CDestination, bool> mapDest;
+    // null unspent : erase
+    std::map<std::pair<CDestination, CTxOutPoint>, CUnspentOut> mapUnspent;
+    // TXI_DIRECTION_NULL : erase
+    std::map<CAddrTxIndex, CAddrTxInfo> mapTx;
+};
+
+class CWalletDBIndexWalker
+{
+public:
+    virtual bool WalkFork(const uint256& hashFork, const uint256& hashLastBlock, const int nExtendedSeq) = 0;
+    virtual bool WalkDest(const uint256& hashFork, const CDestination& dest) = 0;
+    virtual bool WalkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& out, const CUnspentOut& unspent) = 0;
+    virtual bool WalkTx(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo) = 0;
+};
+
+class CWalletIndexDB : public xengine::CKVDB
+{
+    enum
+    {
+        WALLET_INDEX_FORK_PREFIX = 0x01,
+        WALLET_INDEX_DEST_PREFIX = 0x02,
+        WALLET_INDEX_UNSPENT_PREFIX = 0x03,
+        WALLET_INDEX_TX_PREFIX = 0x04
+    };
+
+public:
+    CWalletIndexDB() {}
+    bool Initialize(const boost::filesystem::path& pathWallet);
+    void Deinitialize();
+    bool Update(const uint256& hashFork, const CWalletIndexChange& change);
+    bool WalkThroughIndex(CWalletDBIndexWalker& walker);
+
+protected:
+    bool IndexDBWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, CWalletDBIndexWalker& walker);
+};
+
 class CWalletDB
 {
 public:
     CWalletDB();
     ~CWalletDB();
-    bool Initialize(const boost::filesystem::path& pathWallet);
+    bool Initialize(const boost::filesystem::path& pathWallet, const bool fIndexIn = false);
     void Deinitialize();
     bool UpdateKey(const crypto::CPubKey& pubkey, int version, const crypto::CCryptoCipher& cipher);
     bool RemoveKey(const crypto::CPubKey& pubkey);
     bool UpdateTemplate(const CTemplateId& tid, const std::vector<unsigned char>& vchData);
     bool RemoveTemplate(const CTemplateId& tid);
     bool WalkThroughAddress(CWalletDBAddrWalker& walker);
+    bool UpdateIndex(const uint256& hashFork, const CWalletIndexChange& change);
+    bool WalkThroughIndex(CWalletDBIndexWalker& walker);
 
 protected:
+    bool fIndex;
     CWalletAddrDB dbAddr;
+    CWalletIndexDB dbIndex;
 };
 
 } // namespace storage
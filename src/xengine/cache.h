@@ -24,11 +24,13 @@ class CCache
     public:
         K key;
         mutable V value;
+        mutable std::size_t nSize;
 
     public:
-        CKeyValue() {}
-        CKeyValue(const K& keyIn, const V& valueIn)
-          : key(keyIn), value(valueIn) {}
+        CKeyValue()
+          : nSize(0) {}
+        CKeyValue(const K& keyIn, const V& valueIn, const std::size_t nSizeIn = 0)
+          : key(keyIn), value(valueIn), nSize(nSizeIn) {}
     };
     typedef boost::multi_index_container<
         CKeyValue,
@@ -40,7 +42,7 @@ class CCache
 
 public:
     CCache(std::size_t nMaxCountIn = 0)
-      : nMaxCount(nMaxCountIn) {}
+      : nMaxCount(nMaxCountIn), nMaxSize(0), nTotalSize(0) {}
     bool Exists(const K& key) const
     {
         CReadLock rlock(rwAccess);
@@ -57,35 +59,74 @@ public:
         }
         return false;
     }
-    void AddNew(const K& key, const V& value)
+    // nSize is the caller's measure of the value, only counted against the max size
+    void AddNew(const K& key, const V& value, const std::size_t nSize = 0)
     {
         CWriteLock wlock(rwAccess);
-        std::pair<typename CKeyValueContainer::iterator, bool> ret = cntrCache.insert(CKeyValue(key, value));
+        if (nMaxSize != 0 && nSize > nMaxSize)
+        {
+            Erase(key);
+            return;
+        }
+        std::pair<typename CKeyValueContainer::iterator, bool> ret = cntrCache.insert(CKeyValue(key, value, nSize));
         if (!ret.second)
         {
+            nTotalSize -= (*(ret.first)).nSize;
             (*(ret.first)).value = value;
+            (*(ret.first)).nSize = nSize;
         }
-        if (nMaxCount != 0 && cntrCache.size() > nMaxCount)
+        nTotalSize += nSize;
+        CKeyValueList& listCache = cntrCache.template get<1>();
+        while ((nMaxCount != 0 && cntrCache.size() > nMaxCount) || (nMaxSize != 0 && nTotalSize > nMaxSize))
         {
-            CKeyValueList& listCache = cntrCache.template get<1>();
+            nTotalSize -= listCache.front().nSize;
             listCache.pop_front();
         }
     }
     void Remove(const K& key)
     {
         CWriteLock wlock(rwAccess);
-        cntrCache.erase(key);
+        Erase(key);
     }
     void Clear()
     {
         CWriteLock wlock(rwAccess);
         cntrCache.clear();
+        nTotalSize = 0;
+    }
+    void SetMaxCount(std::size_t nMaxCountIn)
+    {
+        CWriteLock wlock(rwAccess);
+        nMaxCount = nMaxCountIn;
+    }
+    void SetMaxSize(std::size_t nMaxSizeIn)
+    {
+        CWriteLock wlock(rwAccess);
+        nMaxSize = nMaxSizeIn;
+    }
+    std::size_t GetTotalSize() const
+    {
+        CReadLock rlock(rwAccess);
+        return nTotalSize;
+    }
+
+protected:
+    void Erase(const K& key)
+    {
+        typename CKeyValueContainer::iterator it = cntrCache.find(key);
+        if (it != cntrCache.end())
+        {
+            nTotalSize -= (*it).nSize;
+            cntrCache.erase(it);
+        }
     }
 
 protected:
     mutable CRWAccess rwAccess;
     CKeyValueContainer cntrCache;
     std::size_t nMaxCount;
+    std::size_t nMaxSize;
+    std::size_t nTotalSize;
 };
 
 } // namespace xengine
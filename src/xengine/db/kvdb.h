@@ -31,6 +31,9 @@ public:
     virtual bool MoveFirst() = 0;
     virtual bool MoveTo(CBufStream& ssKey) = 0;
     virtual bool MoveNext(CBufStream& ssKey, CBufStream& ssValue) = 0;
+    virtual bool MoveLast() = 0;
+    virtual bool MoveToPrev(CBufStream& ssKey) = 0;
+    virtual bool MovePrev(CBufStream& ssKey, CBufStream& ssValue) = 0;
 };
 
 class CKVDB
@@ -373,6 +376,84 @@ protected:
         return false;
     }
 
+    // Walk the keys starting with keyPrefix from the last to the first
+    template <typename P>
+    bool WalkThroughReverse(WalkerFunc fnWalker, const P& keyPrefix)
+    {
+        CBufStream ssKeyPrefix;
+        ssKeyPrefix << keyPrefix;
+
+        // the least key greater than all keys with the prefix
+        std::string strKeyEnd(ssKeyPrefix.GetData(), ssKeyPrefix.GetSize());
+        while (!strKeyEnd.empty() && (unsigned char)strKeyEnd.back() == 0xFF)
+        {
+            strKeyEnd.pop_back();
+        }
+        if (!strKeyEnd.empty())
+        {
+            strKeyEnd.back() = (char)((unsigned char)strKeyEnd.back() + 1);
+        }
+
+        CBufStream ssKeyEnd;
+        ssKeyEnd.Write(strKeyEnd.data(), strKeyEnd.size());
+        return WalkThroughReverse(fnWalker, ssKeyEnd, ssKeyPrefix);
+    }
+
+    // Walk the keys less than keyEnd and starting with keyPrefix from the last to the first
+    template <typename K, typename P>
+    bool WalkThroughReverse(WalkerFunc fnWalker, const K& keyEnd, const P& keyPrefix)
+    {
+        CBufStream ssKeyEnd, ssKeyPrefix;
+        ssKeyEnd << keyEnd;
+        ssKeyPrefix << keyPrefix;
+        return WalkThroughReverse(fnWalker, ssKeyEnd, ssKeyPrefix);
+    }
+
+    bool WalkThroughReverse(WalkerFunc fnWalker, CBufStream& ssKeyEnd, CBufStream& ssKeyPrefix)
+    {
+        try
+        {
+            boost::recursive_mutex::scoped_lock lock(mtx);
+
+            if (dbEngine == nullptr)
+                return false;
+
+            if (ssKeyEnd.GetSize() == 0)
+            {
+                if (!dbEngine->MoveLast())
+                    return false;
+            }
+            else
+            {
+                if (!dbEngine->MoveToPrev(ssKeyEnd))
+                    return false;
+            }
+
+            for (;;)
+            {
+                CBufStream ssKey, ssValue;
+                if (!dbEngine->MovePrev(ssKey, ssValue))
+                    break;
+
+                if (ssKey.GetSize() < ssKeyPrefix.GetSize())
+                    break;
+
+                if (memcmp(ssKey.GetData(), ssKeyPrefix.GetData(), ssKeyPrefix.GetSize()) != 0)
+                    break;
+
+                if (!fnWalker(ssKey, ssValue))
+                    break;
+            }
+            return true;
+        }
+        catch (std::exception& e)
+        {
+            StdError(__PRETTY_FUNCTION__, e.what());
+        }
+
+        return false;
+    }
+
 protected:
     boost::recursive_mutex mtx;
     CKVDBEngine* dbEngine;
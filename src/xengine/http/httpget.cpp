@@ -10,6 +10,8 @@
 #include "netio/netio.h"
 
 #define HTTPGET_CONNET_TIMEOUT 10
+#define HTTPGET_IDLE_TIMEOUT 60
+#define HTTPGET_MAX_IDLE_CONN 8
 
 using namespace std;
 #if BOOST_VERSION >= 106000
@@ -23,12 +25,14 @@ namespace xengine
 ///////////////////////////////
 // CHttpGetClient
 
-CHttpGetClient::CHttpGetClient(const string& strIOModuleIn, const uint64 nNonceIn,
+CHttpGetClient::CHttpGetClient(const string& strIOModuleIn, const uint64 nNonceIn, const string& strPoolKeyIn,
                                CHttpGet* pHttpGetIn, CIOClient* pClientIn)
-  : strIOModule(strIOModuleIn), nNonce(nNonceIn), pHttpGet(pHttpGetIn), pClient(pClientIn)
+  : strIOModule(strIOModuleIn), nNonce(nNonceIn), strPoolKey(strPoolKeyIn), pHttpGet(pHttpGetIn), pClient(pClientIn)
 {
     nTimerId = 0;
     fIdle = true;
+    fReused = false;
+    fWritten = false;
 }
 
 CHttpGetClient::~CHttpGetClient()
@@ -49,11 +53,21 @@ uint64 CHttpGetClient::GetNonce()
     return nNonce;
 }
 
+const string& CHttpGetClient::GetPoolKey()
+{
+    return strPoolKey;
+}
+
 uint32 CHttpGetClient::GetTimerId()
 {
     return nTimerId;
 }
 
+void CHttpGetClient::SetTimerId(uint32 nTimerIdIn)
+{
+    nTimerId = nTimerIdIn;
+}
+
 CNetHost CHttpGetClient::GetHost()
 {
     return CNetHost(pClient->GetRemote());
@@ -64,6 +78,24 @@ bool CHttpGetClient::IsIdle()
     return fIdle;
 }
 
+bool CHttpGetClient::IsRetryable()
+{
+    // reused connection may have been closed by the server while parked, and the request never reached it.
+    // Once written, the server may have run a non-idempotent request, so it is never sent again.
+    return (fReused && !fIdle && !fWritten);
+}
+
+CHttpReqData& CHttpGetClient::GetRequest()
+{
+    return reqRetry;
+}
+
+void CHttpGetClient::Bind(const string& strIOModuleIn, const uint64 nNonceIn)
+{
+    strIOModule = strIOModuleIn;
+    nNonce = nNonceIn;
+}
+
 void CHttpGetClient::GetResponse(CHttpRsp& rsp)
 {
     rsp.nStatusCode = atoi(mapHeader["status"].c_str());
@@ -80,10 +112,13 @@ void CHttpGetClient::GetResponse(CHttpRsp& rsp)
     fIdle = true;
 }
 
-void CHttpGetClient::Activate(CHttpReqData& httpReqData, uint32 nTimerIdIn)
+void CHttpGetClient::Activate(CHttpReqData& httpReqData, uint32 nTimerIdIn, bool fReusedIn)
 {
     nTimerId = nTimerIdIn;
     fIdle = false;
+    fReused = fReusedIn;
+    fWritten = false;
+    reqRetry = fReused ? httpReqData : CHttpReqData();
     mapHeader.clear();
     mapCookie.clear();
     strChunked.clear();
@@ -101,6 +136,7 @@ void CHttpGetClient::HandleWritenRequest(size_t nTransferred)
 {
     if (nTransferred != 0)
     {
+        fWritten = true;
         pClient->ReadUntil(ssRecv, "\r\n\r\n",
                            boost::bind(&CHttpGetClient::HandleReadHeader, this, _1));
     }
@@ -235,6 +271,10 @@ void CHttpGet::HandleClientCompleted(CHttpGetClient* pGetClient)
         {
             CloseConn(pGetClient);
         }
+        else
+        {
+            ParkConn(pGetClient);
+        }
     }
     else
     {
@@ -244,6 +284,15 @@ void CHttpGet::HandleClientCompleted(CHttpGetClient* pGetClient)
 
 void CHttpGet::HandleClientError(CHttpGetClient* pGetClient)
 {
+    if (pGetClient->IsRetryable())
+    {
+        // send the request once more on a new connection
+        CEventHttpGet eventGet(pGetClient->GetNonce());
+        eventGet.data = pGetClient->GetRequest();
+        CloseConn(pGetClient);
+        StartConn(eventGet);
+        return;
+    }
     CloseConn(pGetClient, HTTPGET_INTERRUPTED);
 }
 
@@ -332,7 +381,7 @@ int CHttpGet::ActivateConn(CIOClient* pClient, CEventHttpGet& eventGet)
     uint64 nNonce = eventGet.nNonce;
     CHttpReqData& httpReqData = eventGet.data;
 
-    CHttpGetClient* pGetClient = new CHttpGetClient(httpReqData.strIOModule, nNonce, this, pClient);
+    CHttpGetClient* pGetClient = new CHttpGetClient(httpReqData.strIOModule, nNonce, GetPoolKey(httpReqData), this, pClient);
     if (pGetClient == nullptr)
     {
         return HTTPGET_ACTIVATE_FAILED;
@@ -401,8 +450,9 @@ bool CHttpGet::HandleEvent(CEventHttpGet& eventGet)
         {
             if (pGetClient->IsIdle())
             {
+                UnparkConn(pGetClient);
                 uint32 nTimerId = httpReqData.nTimeout > 0 ? SetTimer(nNonce, httpReqData.nTimeout, "CHttpGet eventGet") : 0;
-                pGetClient->Activate(httpReqData, nTimerId);
+                pGetClient->Activate(httpReqData, nTimerId, true);
             }
             else
             {
@@ -412,14 +462,29 @@ bool CHttpGet::HandleEvent(CEventHttpGet& eventGet)
         }
     }
 
+    CHttpGetClient* pIdleClient = TakeIdleConn(eventGet);
+    if (pIdleClient != nullptr)
+    {
+        uint32 nTimerId = httpReqData.nTimeout > 0 ? SetTimer(nNonce, httpReqData.nTimeout, "CHttpGet eventGet") : 0;
+        pIdleClient->Activate(httpReqData, nTimerId, true);
+        return true;
+    }
+
+    StartConn(eventGet);
+    return true;
+}
+
+void CHttpGet::StartConn(CEventHttpGet& eventGet)
+{
+    CHttpReqData& httpReqData = eventGet.data;
     CNetHost host(httpReqData.mapHeader["host"], httpReqData.strProtocol == "https" ? 443 : 80);
     tcp::endpoint ep = host.ToEndPoint();
     if (ep != tcp::endpoint())
     {
         if (!SSLConnect(ep, HTTPGET_CONNET_TIMEOUT, GetSSLOption(httpReqData, host.strHost)))
         {
-            PostError(httpReqData.strIOModule, nNonce, HTTPGET_CONNECT_FAILED);
-            return true;
+            PostError(eventGet, HTTPGET_CONNECT_FAILED);
+            return;
         }
     }
     else
@@ -428,8 +493,6 @@ bool CHttpGet::HandleEvent(CEventHttpGet& eventGet)
     }
 
     mapRequest.insert(make_pair(host, eventGet));
-
-    return true;
 }
 
 bool CHttpGet::HandleEvent(CEventHttpAbort& eventAbort)
@@ -472,6 +535,7 @@ bool CHttpGet::HandleEvent(CEventHttpAbort& eventAbort)
 void CHttpGet::CloseConn(CHttpGetClient* pGetClient, int nErrCode)
 {
     CancelTimer(pGetClient->GetTimerId());
+    UnparkConn(pGetClient);
 
     uint64 nNonce = pGetClient->GetNonce();
     if (nErrCode != HTTPGET_OK && !pGetClient->IsIdle())
@@ -491,6 +555,74 @@ void CHttpGet::CloseConn(CHttpGetClient* pGetClient, int nErrCode)
     delete pGetClient;
 }
 
+void CHttpGet::ParkConn(CHttpGetClient* pGetClient)
+{
+    // keep-alive connection waits in pool for next request to the same host
+    const string& strPoolKey = pGetClient->GetPoolKey();
+    if (mapIdleClient.count(strPoolKey) >= HTTPGET_MAX_IDLE_CONN)
+    {
+        CloseConn(pGetClient);
+        return;
+    }
+    pGetClient->SetTimerId(SetTimer(pGetClient->GetNonce(), HTTPGET_IDLE_TIMEOUT, "CHttpGet ParkConn"));
+    mapIdleClient.insert(make_pair(strPoolKey, pGetClient));
+}
+
+void CHttpGet::UnparkConn(CHttpGetClient* pGetClient)
+{
+    const string& strPoolKey = pGetClient->GetPoolKey();
+    for (multimap<string, CHttpGetClient*>::iterator it = mapIdleClient.lower_bound(strPoolKey);
+         it != mapIdleClient.upper_bound(strPoolKey); ++it)
+    {
+        if (pGetClient == (*it).second)
+        {
+            CancelTimer(pGetClient->GetTimerId());
+            pGetClient->SetTimerId(0);
+            mapIdleClient.erase(it);
+            break;
+        }
+    }
+}
+
+CHttpGetClient* CHttpGet::TakeIdleConn(CEventHttpGet& eventGet)
+{
+    multimap<string, CHttpGetClient*>::iterator it = mapIdleClient.find(GetPoolKey(eventGet.data));
+    if (it == mapIdleClient.end())
+    {
+        return nullptr;
+    }
+
+    CHttpGetClient* pGetClient = (*it).second;
+    UnparkConn(pGetClient);
+
+    // rebind the connection to the nonce of new request
+    uint64 nNonce = pGetClient->GetNonce();
+    for (multimap<uint64, CHttpGetClient*>::iterator mi = mapGetClient.lower_bound(nNonce);
+         mi != mapGetClient.upper_bound(nNonce); ++mi)
+    {
+        if (pGetClient == (*mi).second)
+        {
+            mapGetClient.erase(mi);
+            break;
+        }
+    }
+    pGetClient->Bind(eventGet.data.strIOModule, eventGet.nNonce);
+    mapGetClient.insert(make_pair(eventGet.nNonce, pGetClient));
+    return pGetClient;
+}
+
+string CHttpGet::GetPoolKey(CHttpReqData& httpReqData)
+{
+    string strKey = httpReqData.strProtocol + "://" + httpReqData.mapHeader["host"];
+    if (httpReqData.strProtocol == "https")
+    {
+        // a connection is reused only with the ssl options it was verified with
+        strKey += string("#") + (httpReqData.fVerifyPeer ? "1" : "0") + "#" + httpReqData.strPathCA
+                  + "#" + httpReqData.strPathCert + "#" + httpReqData.strPathPK;
+    }
+    return strKey;
+}
+
 CIOSSLOption CHttpGet::GetSSLOption(CHttpReqData& httpReqData, const string& strHost)
 {
     return CIOSSLOption(httpReqData.strProtocol == "https", httpReqData.fVerifyPeer,
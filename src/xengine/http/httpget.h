@@ -29,16 +29,21 @@ class CHttpGet;
 class CHttpGetClient
 {
 public:
-    CHttpGetClient(const std::string& strIOModuleIn, const uint64 nNonceIn,
+    CHttpGetClient(const std::string& strIOModuleIn, const uint64 nNonceIn, const std::string& strPoolKeyIn,
                    CHttpGet* pHttpGetIn, CIOClient* pClientIn);
     ~CHttpGetClient();
     const std::string& GetIOModule();
     uint64 GetNonce();
+    const std::string& GetPoolKey();
     uint32 GetTimerId();
+    void SetTimerId(uint32 nTimerIdIn);
     CNetHost GetHost();
     bool IsIdle();
+    bool IsRetryable();
+    CHttpReqData& GetRequest();
+    void Bind(const std::string& strIOModuleIn, const uint64 nNonceIn);
     void GetResponse(CHttpRsp& rsp);
-    void Activate(CHttpReqData& httpReqData, uint32 nTimerIdIn);
+    void Activate(CHttpReqData& httpReqData, uint32 nTimerIdIn, bool fReusedIn = false);
 
 protected:
     void HandleWritenRequest(std::size_t nTransferred);
@@ -48,12 +53,16 @@ protected:
     void HandleReadCompleted();
 
 protected:
-    const std::string strIOModule;
-    const uint64 nNonce;
+    std::string strIOModule;
+    uint64 nNonce;
+    const std::string strPoolKey;
     CHttpGet* pHttpGet;
     CIOClient* pClient;
     uint32 nTimerId;
     bool fIdle;
+    bool fReused;
+    bool fWritten;
+    CHttpReqData reqRetry;
     CBufStream ssRecv;
     CBufStream ssSend;
     MAPIKeyValue mapHeader;
@@ -82,12 +91,18 @@ protected:
     void PostError(const std::string& strIOModule, uint64 nNonce, int nErrCode);
     bool HandleEvent(CEventHttpGet& eventGet) override;
     bool HandleEvent(CEventHttpAbort& eventAbort) override;
+    void StartConn(CEventHttpGet& eventGet);
     void CloseConn(CHttpGetClient* pGetClient, int nErrCode = HTTPGET_OK);
+    void ParkConn(CHttpGetClient* pGetClient);
+    void UnparkConn(CHttpGetClient* pGetClient);
+    CHttpGetClient* TakeIdleConn(CEventHttpGet& eventGet);
     CIOSSLOption GetSSLOption(CHttpReqData& httpGet, const std::string& strHost);
+    std::string GetPoolKey(CHttpReqData& httpReqData);
 
 protected:
     std::multimap<CNetHost, CEventHttpGet> mapRequest;
     std::multimap<uint64, CHttpGetClient*> mapGetClient;
+    std::multimap<std::string, CHttpGetClient*> mapIdleClient;
 };
 
 } // namespace xengine
@@ -16,13 +16,115 @@ using boost::asio::ip::tcp;
 namespace xengine
 {
 
+///////////////////////////////
+// CHttpPipeline
+
+void CHttpPipeline::Clear()
+{
+    fHold = false;
+    fClosing = false;
+    quePendingRsp.clear();
+}
+
+bool CHttpPipeline::IsEmpty() const
+{
+    return quePendingRsp.empty();
+}
+
+size_t CHttpPipeline::GetSize() const
+{
+    return quePendingRsp.size();
+}
+
+bool CHttpPipeline::IsHold() const
+{
+    return fHold;
+}
+
+bool CHttpPipeline::IsClosing() const
+{
+    return fClosing;
+}
+
+void CHttpPipeline::Close()
+{
+    fClosing = true;
+}
+
+bool CHttpPipeline::IsReadable(size_t nMaxPipeline) const
+{
+    // read ahead while the pipeline has room, a request that may be held (GET) is answered first
+    return (!fHold && !fClosing && quePendingRsp.size() < nMaxPipeline);
+}
+
+void CHttpPipeline::AddRequest(const string& strMethod)
+{
+    quePendingRsp.push_back(CHttpPendingRsp());
+    fHold = (strMethod != "POST");
+}
+
+bool CHttpPipeline::SetResponse(string& strResponse, bool fKeepAlive)
+{
+    // io module replies to the requests of a connection in the order they were posted
+    for (CHttpPendingRsp& rsp : quePendingRsp)
+    {
+        if (!rsp.fReady)
+        {
+            rsp.fReady = true;
+            rsp.fKeepAlive = fKeepAlive;
+            rsp.strResponse.swap(strResponse);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CHttpPipeline::SetErrorResponse(string& strResponse)
+{
+    // an error answers the request just read, the connection is closed after it
+    if (quePendingRsp.empty())
+    {
+        quePendingRsp.push_back(CHttpPendingRsp());
+    }
+    CHttpPendingRsp& rsp = quePendingRsp.back();
+    rsp.fReady = true;
+    rsp.fKeepAlive = false;
+    rsp.strResponse.swap(strResponse);
+    fClosing = true;
+}
+
+string* CHttpPipeline::GetReadyResponse()
+{
+    if (quePendingRsp.empty() || !quePendingRsp.front().fReady)
+    {
+        return nullptr;
+    }
+    return &quePendingRsp.front().strResponse;
+}
+
+bool CHttpPipeline::PopResponse()
+{
+    bool fKeepAlive = quePendingRsp.front().fKeepAlive;
+    quePendingRsp.pop_front();
+    if (!fKeepAlive || (fClosing && quePendingRsp.empty()))
+    {
+        return false;
+    }
+
+    if (quePendingRsp.empty())
+    {
+        fHold = false;
+    }
+    return true;
+}
+
 ///////////////////////////////
 // CHttpClient
 
 CHttpClient::CHttpClient(CHttpServer* pServerIn, CHttpProfile* pProfileIn,
                          CIOClient* pClientIn, uint64 nNonceIn)
-  : pServer(pServerIn), pProfile(pProfileIn), pClient(pClientIn),
-    nNonce(nNonceIn), fKeepAlive(false), fEventStream(false)
+  : pServer(pServerIn), pProfile(pProfileIn), pClient(pClientIn), nNonce(nNonceIn),
+    fEventStream(false), fReading(false), fWriting(false), nContentLength(0)
 {
 }
 
@@ -44,21 +146,11 @@ uint64 CHttpClient::GetNonce()
     return nNonce;
 }
 
-bool CHttpClient::IsKeepAlive()
-{
-    return fKeepAlive;
-}
-
 bool CHttpClient::IsEventStream()
 {
     return fEventStream;
 }
 
-void CHttpClient::KeepAlive()
-{
-    fKeepAlive = true;
-}
-
 void CHttpClient::SetEventStream()
 {
     fEventStream = true;
@@ -66,8 +158,11 @@ void CHttpClient::SetEventStream()
 
 void CHttpClient::Activate()
 {
-    fKeepAlive = false;
     fEventStream = false;
+    fReading = false;
+    fWriting = false;
+    nContentLength = 0;
+    pipeline.Clear();
     ssRecv.Clear();
     ssSend.Clear();
     mapHeader.clear();
@@ -77,16 +172,23 @@ void CHttpClient::Activate()
     StartReadHeader();
 }
 
-void CHttpClient::SendResponse(string& strResponse)
+void CHttpClient::SendResponse(string& strResponse, bool fKeepAliveIn)
 {
-    CBinary binary(&strResponse[0], strResponse.size());
-    ssSend.Clear();
-    ssSend << binary;
-    pClient->Write(ssSend, boost::bind(&CHttpClient::HandleWritenResponse, this, _1));
+    if (pipeline.SetResponse(strResponse, fKeepAliveIn))
+    {
+        StartWriteResponse();
+    }
+}
+
+void CHttpClient::SendErrorResponse(string& strResponse)
+{
+    pipeline.SetErrorResponse(strResponse);
+    StartWriteResponse();
 }
 
 void CHttpClient::StartReadHeader()
 {
+    fReading = true;
     pClient->ReadUntil(ssRecv, "\r\n\r\n",
                        boost::bind(&CHttpClient::HandleReadHeader, this, _1));
 }
@@ -97,30 +199,59 @@ void CHttpClient::StartReadPayload(size_t nLength)
                   boost::bind(&CHttpClient::HandleReadPayload, this, _1));
 }
 
+void CHttpClient::StartNextRequest()
+{
+    if (!fReading && pipeline.IsReadable(pProfile->nMaxPipeline))
+    {
+        StartReadHeader();
+    }
+}
+
+void CHttpClient::StartWriteResponse()
+{
+    string* pResponse = fWriting ? nullptr : pipeline.GetReadyResponse();
+    if (pResponse == nullptr)
+    {
+        return;
+    }
+
+    CBinary binary(&(*pResponse)[0], pResponse->size());
+    ssSend.Clear();
+    ssSend << binary;
+    fWriting = true;
+    pClient->Write(ssSend, boost::bind(&CHttpClient::HandleWritenResponse, this, _1));
+}
+
 void CHttpClient::HandleReadHeader(size_t nTransferred)
 {
     istream is(&ssRecv);
     if (nTransferred != 0 && CHttpUtil().ParseRequestHeader(is, mapHeader, mapQuery, mapCookie))
     {
-        size_t nLength = 0;
+        nContentLength = 0;
         MAPIKeyValue::iterator it = mapHeader.find("content-length");
         if (it != mapHeader.end())
         {
-            nLength = atoi((*it).second.c_str());
+            nContentLength = atoi((*it).second.c_str());
         }
-        if (nLength > MAX_HTTP_CONTENT_LENGTH)
+        if (nContentLength > MAX_HTTP_CONTENT_LENGTH)
         {
             pServer->HandleClientError(this);
         }
-        else if (nLength > 0 && ssRecv.GetSize() < nLength)
+        else if (nContentLength > 0 && ssRecv.GetSize() < nContentLength)
         {
-            StartReadPayload(nLength - ssRecv.GetSize());
+            StartReadPayload(nContentLength - ssRecv.GetSize());
         }
         else
         {
             HandleReadCompleted();
         }
     }
+    else if (nTransferred == 0 && !pipeline.IsEmpty() && !pipeline.IsHold())
+    {
+        // peer stops sending, answer the requests already received
+        fReading = false;
+        pipeline.Close();
+    }
     else
     {
         pServer->HandleClientError(this);
@@ -141,19 +272,35 @@ void CHttpClient::HandleReadPayload(size_t nTransferred)
 
 void CHttpClient::HandleReadCompleted()
 {
-    pServer->HandleClientRecv(this, mapHeader, mapQuery, mapCookie, ssRecv);
+    fReading = false;
+
+    // pipelined requests may follow the payload in receive buffer
+    CBufStream ssPayload;
+    ssPayload.Write(ssRecv.GetData(), nContentLength);
+    ssRecv.consume(nContentLength);
+
+    pipeline.AddRequest(mapHeader["method"]);
+    pServer->HandleClientRecv(this, mapHeader, mapQuery, mapCookie, ssPayload);
+
+    StartNextRequest();
 }
 
 void CHttpClient::HandleWritenResponse(std::size_t nTransferred)
 {
-    if (nTransferred != 0)
+    fWriting = false;
+    if (nTransferred == 0)
     {
-        pServer->HandleClientSent(this);
+        pServer->HandleClientError(this);
+        return;
     }
-    else
+
+    if (!pipeline.PopResponse())
     {
-        pServer->HandleClientError(this);
+        pServer->HandleClientSent(this);
+        return;
     }
+    StartWriteResponse();
+    StartNextRequest();
 }
 
 ///////////////////////////////
@@ -212,6 +359,7 @@ bool CHttpServer::CreateProfile(const CHttpHostConfig& confHost)
     }
 
     profile.nMaxConnections = confHost.nMaxConnections;
+    profile.nMaxPipeline = std::max(confHost.nMaxPipeline, 1u);
     profile.vAllowMask = confHost.vAllowMask;
 
     mapProfile[confHost.epHost] = profile;
@@ -338,14 +486,7 @@ void CHttpServer::HandleClientRecv(CHttpClient* pHttpClient, MAPIKeyValue& mapHe
 
 void CHttpServer::HandleClientSent(CHttpClient* pHttpClient)
 {
-    if (pHttpClient->IsKeepAlive())
-    {
-        pHttpClient->Activate();
-    }
-    else
-    {
-        RemoveClient(pHttpClient);
-    }
+    RemoveClient(pHttpClient);
 }
 
 void CHttpServer::HandleClientError(CHttpClient* pHttpClient)
@@ -434,7 +575,7 @@ void CHttpServer::RespondError(CHttpClient* pHttpClient, int nStatusCode, const
     string strRsp = CHttpUtil().BuildResponseHeader(nStatusCode, mapHeader, mapCookie, strContent.size())
                     + strContent;
 
-    pHttpClient->SendResponse(strRsp);
+    pHttpClient->SendErrorResponse(strRsp);
 }
 
 bool CHttpServer::HandleEvent(CEventHttpRsp& eventRsp)
@@ -459,11 +600,8 @@ bool CHttpServer::HandleEvent(CEventHttpRsp& eventRsp)
         pHttpClient->SetEventStream();
     }
 
-    if (rsp.mapHeader.count("connection") && rsp.mapHeader["connection"] == "Keep-Alive")
-    {
-        pHttpClient->KeepAlive();
-    }
-    pHttpClient->SendResponse(strRsp);
+    bool fKeepAlive = (rsp.mapHeader.count("connection") && rsp.mapHeader["connection"] == "Keep-Alive");
+    pHttpClient->SendResponse(strRsp, fKeepAlive);
     return true;
 }
 
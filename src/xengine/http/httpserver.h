@@ -5,6 +5,8 @@
 #ifndef XENGINE_HTTP_HTTPSERVER_H
 #define XENGINE_HTTP_HTTPSERVER_H
 
+#include <deque>
+
 #include "http/httpevent.h"
 #include "http/httputil.h"
 #include "netio/ioproc.h"
@@ -19,9 +21,10 @@ class CHttpHostConfig
 public:
     CHttpHostConfig() {}
     CHttpHostConfig(const boost::asio::ip::tcp::endpoint& epHostIn, unsigned int nMaxConnectionsIn,
-                    const CIOSSLOption& optSSLIn, const std::map<std::string, std::string>& mapUserPassIn,
+                    unsigned int nMaxPipelineIn, const CIOSSLOption& optSSLIn,
+                    const std::map<std::string, std::string>& mapUserPassIn,
                     const std::vector<std::string>& vAllowMaskIn, const std::string& strIOModuleIn)
-      : epHost(epHostIn), nMaxConnections(nMaxConnectionsIn), optSSL(optSSLIn),
+      : epHost(epHostIn), nMaxConnections(nMaxConnectionsIn), nMaxPipeline(nMaxPipelineIn), optSSL(optSSLIn),
         mapUserPass(mapUserPassIn), vAllowMask(vAllowMaskIn), strIOModule(strIOModuleIn)
     {
     }
@@ -29,6 +32,7 @@ public:
 public:
     boost::asio::ip::tcp::endpoint epHost;
     unsigned int nMaxConnections;
+    unsigned int nMaxPipeline;
     CIOSSLOption optSSL;
     std::map<std::string, std::string> mapUserPass;
     std::vector<std::string> vAllowMask;
@@ -39,7 +43,7 @@ class CHttpProfile
 {
 public:
     CHttpProfile()
-      : pIOModule(nullptr), pSSLContext(nullptr), nMaxConnections(0) {}
+      : pIOModule(nullptr), pSSLContext(nullptr), nMaxConnections(0), nMaxPipeline(1) {}
 
 public:
     IIOModule* pIOModule;
@@ -47,6 +51,43 @@ public:
     std::map<std::string, std::string> mapAuthrizeUser;
     std::vector<std::string> vAllowMask;
     unsigned int nMaxConnections;
+    unsigned int nMaxPipeline;
+};
+
+class CHttpPendingRsp
+{
+public:
+    CHttpPendingRsp()
+      : fReady(false), fKeepAlive(false) {}
+
+public:
+    bool fReady;
+    bool fKeepAlive;
+    std::string strResponse;
+};
+
+class CHttpPipeline
+{
+public:
+    CHttpPipeline()
+      : fHold(false), fClosing(false) {}
+    void Clear();
+    bool IsEmpty() const;
+    std::size_t GetSize() const;
+    bool IsHold() const;
+    bool IsClosing() const;
+    void Close();
+    bool IsReadable(std::size_t nMaxPipeline) const;
+    void AddRequest(const std::string& strMethod);
+    bool SetResponse(std::string& strResponse, bool fKeepAlive);
+    void SetErrorResponse(std::string& strResponse);
+    std::string* GetReadyResponse();
+    bool PopResponse();
+
+protected:
+    bool fHold;
+    bool fClosing;
+    std::deque<CHttpPendingRsp> quePendingRsp;
 };
 
 class CHttpClient
@@ -57,16 +98,17 @@ public:
     ~CHttpClient();
     CHttpProfile* GetProfile();
     uint64 GetNonce();
-    bool IsKeepAlive();
     bool IsEventStream();
-    void KeepAlive();
     void SetEventStream();
     void Activate();
-    void SendResponse(std::string& strResponse);
+    void SendResponse(std::string& strResponse, bool fKeepAliveIn);
+    void SendErrorResponse(std::string& strResponse);
 
 protected:
     void StartReadHeader();
     void StartReadPayload(std::size_t nLength);
+    void StartNextRequest();
+    void StartWriteResponse();
 
     void HandleReadHeader(std::size_t nTransferred);
     void HandleReadPayload(std::size_t nTransferred);
@@ -78,8 +120,11 @@ protected:
     CHttpProfile* pProfile;
     CIOClient* pClient;
     uint64 nNonce;
-    bool fKeepAlive;
     bool fEventStream;
+    bool fReading;
+    bool fWriting;
+    std::size_t nContentLength;
+    CHttpPipeline pipeline;
     CBufStream ssRecv;
     CBufStream ssSend;
     MAPIKeyValue mapHeader;
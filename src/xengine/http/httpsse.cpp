@@ -86,6 +86,12 @@ bool CHttpEventStream::UpdateEventData(const string& strEventName, CHttpSSEData&
     return false;
 }
 
+uint64 CHttpEventStream::GetEventId()
+{
+    boost::unique_lock<boost::mutex> lock(mtxEvent);
+    return nEventId;
+}
+
 bool CHttpEventStream::ConstructResponse(uint64 nLastEventId, CHttpRsp& rsp)
 {
     boost::unique_lock<boost::mutex> lock(mtxEvent);
@@ -84,7 +84,8 @@ template <typename T>
 class CHttpSSEQueGenerator : public CHttpSSEGenerator
 {
 public:
-    CHttpSSEQueGenerator() {}
+    CHttpSSEQueGenerator(std::size_t nMaxQueueIn = 0)
+      : nMaxQueue(nMaxQueueIn) {}
     virtual void ResetData()
     {
         while (!q.empty())
@@ -100,6 +101,11 @@ public:
             if (q.empty() || !(s == q.back().second))
             {
                 q.push(std::make_pair(nEventNewId, s));
+                // the oldest events are dropped for a slow reader
+                while (nMaxQueue != 0 && q.size() > nMaxQueue)
+                {
+                    q.pop();
+                }
                 return true;
             }
         }
@@ -125,6 +131,7 @@ public:
 
 protected:
     typename std::queue<std::pair<uint64, T>> q;
+    std::size_t nMaxQueue;
 };
 
 class CHttpEventStream
@@ -148,6 +155,7 @@ public:
     void UnregisterEvent(const std::string& strEventName);
     void ResetData(const std::string& strEventName);
     bool UpdateEventData(const std::string& strEventName, CHttpSSEData& data);
+    uint64 GetEventId();
     bool ConstructResponse(uint64 nLastEventId, CHttpRsp& rsp);
 
 protected:
@@ -125,6 +125,23 @@ bool CIOProc::HandleInvoke()
 
     ioSSLOutBound.Invoke(GetMaxOutBoundCount());
 
+    size_t nWorkerThreads = GetWorkerThreadCount();
+    if (nWorkerThreads > 0)
+    {
+        ioWorker.reset();
+        spWorkerGuard.reset(new boost::asio::io_service::work(ioWorker));
+        for (size_t i = 0; i < nWorkerThreads; i++)
+        {
+            shared_ptr<CThread> spThread(new CThread(GetOwnKey() + "-worker", boost::bind(&CIOProc::WorkerThreadFunc, this)));
+            if (!ThreadStart(*spThread))
+            {
+                Error("Failed to start worker thread");
+                return false;
+            }
+            vThrWorker.push_back(spThread);
+        }
+    }
+
     if (!ThreadDelayStart(thrIOProc))
     {
         Error("Failed to start iothread");
@@ -143,6 +160,14 @@ void CIOProc::HandleHalt()
     thrIOProc.Interrupt();
     ThreadExit(thrIOProc);
 
+    spWorkerGuard.reset();
+    ioWorker.stop();
+    for (shared_ptr<CThread>& spThread : vThrWorker)
+    {
+        ThreadExit(*spThread);
+    }
+    vThrWorker.clear();
+
     ioOutBound.Halt();
     ioSSLOutBound.Halt();
 
@@ -271,6 +296,18 @@ void CIOProc::ResolveHost(const CNetHost& host)
                                            boost::asio::placeholders::iterator));
 }
 
+void CIOProc::PostWork(WorkFunc fnWork, WorkFunc fnComplt)
+{
+    // fnWork runs on a worker thread when there is any, fnComplt always runs on the io thread
+    if (vThrWorker.empty())
+    {
+        fnWork();
+        fnComplt();
+        return;
+    }
+    ioWorker.post(boost::bind(&CIOProc::IOProcHandleWork, this, fnWork, fnComplt));
+}
+
 void CIOProc::EnterLoop()
 {
 }
@@ -292,6 +329,11 @@ size_t CIOProc::GetMaxOutBoundCount()
     return DEFAULT_MAX_OUTBOUND;
 }
 
+size_t CIOProc::GetWorkerThreadCount()
+{
+    return 0;
+}
+
 bool CIOProc::ClientAccepted(const tcp::endpoint& epService, CIOClient* pClient, std::string& strFailCause)
 {
     return false;
@@ -333,6 +375,11 @@ void CIOProc::IOThreadFunc()
     mapTimerByExpiry.clear();
 }
 
+void CIOProc::WorkerThreadFunc()
+{
+    ioWorker.run();
+}
+
 void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
 {
     if (!err)
@@ -388,6 +435,12 @@ void CIOProc::IOProcHandleEvent(CEvent* pEvent, shared_ptr<CIOCompletion> spComp
     spComplt->Completed(pEvent->Handle(*this));
 }
 
+void CIOProc::IOProcHandleWork(WorkFunc fnWork, WorkFunc fnComplt)
+{
+    fnWork();
+    ioStrand.post(fnComplt);
+}
+
 void CIOProc::IOProcHandleResolved(const CNetHost& host, const boost::system::error_code& err,
                                    tcp::resolver::iterator endpoint_iterator)
 {
@@ -10,6 +10,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/base.h"
 #include "netio/ioclient.h"
@@ -56,6 +57,8 @@ class CIOProc : public IIOProc
     friend class CIOInBound;
 
 public:
+    typedef boost::function<void()> WorkFunc;
+
     CIOProc(const std::string& ownKeyIn);
     virtual ~CIOProc();
     boost::asio::io_service& GetIoService();
@@ -83,11 +86,13 @@ protected:
                                  const CIOSSLOption& optSSL = CIOSSLOption());
     std::size_t GetOutBoundIdleCount();
     void ResolveHost(const CNetHost& host);
+    void PostWork(WorkFunc fnWork, WorkFunc fnComplt);
     virtual void EnterLoop();
     virtual void LeaveLoop();
     virtual void HeartBeat();
     virtual void Timeout(uint64 nNonce, uint32 nTimerId, const std::string& strFunctionIn);
     virtual std::size_t GetMaxOutBoundCount();
+    virtual std::size_t GetWorkerThreadCount();
     virtual bool ClientAccepted(const boost::asio::ip::tcp::endpoint& epService, CIOClient* pClient, std::string& strFailCause);
     virtual bool ClientConnected(CIOClient* pClient);
     virtual void ClientFailToConnect(const boost::asio::ip::tcp::endpoint& epRemote);
@@ -96,6 +101,8 @@ protected:
 
 private:
     void IOThreadFunc();
+    void WorkerThreadFunc();
+    void IOProcHandleWork(WorkFunc fnWork, WorkFunc fnComplt);
     void IOProcHeartBeat(const boost::system::error_code& err);
     void IOProcPollTimer();
     void IOProcHandleEvent(CEvent* pEvent, std::shared_ptr<CIOCompletion> spComplt);
@@ -114,6 +121,10 @@ private:
     boost::asio::deadline_timer timerHeartbeat;
     std::map<uint32, CIOTimer> mapTimerById;
     std::multimap<int64, uint32> mapTimerByExpiry;
+
+    boost::asio::io_service ioWorker;
+    std::shared_ptr<boost::asio::io_service::work> spWorkerGuard;
+    std::vector<std::shared_ptr<CThread>> vThrWorker;
 };
 
 } // namespace xengine
@@ -175,6 +175,11 @@ std::size_t CPeerNet::GetMaxOutBoundCount()
     return confNetwork.nMaxOutBounds;
 }
 
+std::size_t CPeerNet::GetWorkerThreadCount()
+{
+    return confNetwork.nWorkerThreads;
+}
+
 bool CPeerNet::ClientAccepted(const tcp::endpoint& epService, CIOClient* pClient, std::string& strFailCause)
 {
     if (!epMngr.AcceptInBound(pClient->GetRemote(), strFailCause))
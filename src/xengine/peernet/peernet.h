@@ -41,6 +41,7 @@ public:
     std::vector<CNetHost> vecNode;
     CNetHost gateWayAddr;
     std::size_t nMaxOutBounds;
+    std::size_t nWorkerThreads;
     unsigned short nPortDefault;
     std::string strSocketBindLocalIpV4;
     std::string strSocketBindLocalIpV6;
@@ -63,6 +64,7 @@ protected:
     void HeartBeat() override;
     void Timeout(uint64 nNonce, uint32 nTimerId, const std::string& strFunctionIn) override;
     std::size_t GetMaxOutBoundCount() override;
+    std::size_t GetWorkerThreadCount() override;
     bool ClientAccepted(const boost::asio::ip::tcp::endpoint& epService, CIOClient* pClient, std::string& strFailCause) override;
     bool ClientConnected(CIOClient* pClient) override;
     void ClientFailToConnect(const boost::asio::ip::tcp::endpoint& epRemote) override;
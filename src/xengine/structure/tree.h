@@ -5,10 +5,14 @@
 #ifndef XENGINE_STRUCTURE_TREE_H
 #define XENGINE_STRUCTURE_TREE_H
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
 #include <stack>
+#include <vector>
+
+#include "../type.h"
 
 namespace xengine
 {
@@ -315,6 +319,228 @@ public:
 
 }; // namespace xengine
 
+// Flat forest: nodes are kept in one contiguous array laid out in postorder
+// (every child precedes its parent), links are array indexes.
+// It is built in bulk from a list of (key, parent, data) edges by Build(),
+// and is read-only afterwards except for node data.
+template <typename K, typename D>
+class CFlatForest
+{
+public:
+    static const uint32 NIL = (uint32)-1;
+
+    class CFlatNode
+    {
+    public:
+        K key;
+        D data;
+        uint32 nParent;
+        uint32 nChildBegin;
+        uint32 nChildEnd;
+
+        CFlatNode()
+          : nParent(NIL), nChildBegin(0), nChildEnd(0)
+        {
+        }
+    };
+
+    std::vector<CFlatNode> vNode;
+    std::vector<uint32> vChild;
+    std::vector<uint32> vRoot;
+
+    CFlatForest() {}
+    ~CFlatForest() {}
+
+    void Clear()
+    {
+        vNode.clear();
+        vChild.clear();
+        vRoot.clear();
+        vSorted.clear();
+        vEdge.clear();
+    }
+
+    void Reserve(std::size_t nEdge)
+    {
+        vEdge.reserve(nEdge);
+    }
+
+    // add a relation key -> parent, the forest is rebuilt by Build()
+    void AddEdge(const K& key, const K& parent, const D& data)
+    {
+        vEdge.push_back(CEdge(key, parent, data));
+    }
+
+    // build forest from the added edges. Return false if a key has more than one parent or the graph has cycle.
+    bool Build()
+    {
+        std::vector<CEdge> vIn;
+        vIn.swap(vEdge);
+        vNode.clear();
+        vChild.clear();
+        vRoot.clear();
+        vSorted.clear();
+
+        std::sort(vIn.begin(), vIn.end(), [](const CEdge& a, const CEdge& b) { return a.key < b.key; });
+
+        // all keys, sorted and unique, index of key is temporary node id
+        std::vector<K> vKey;
+        vKey.reserve(vIn.size() * 2);
+        for (std::size_t i = 0; i < vIn.size(); i++)
+        {
+            if (vIn[i].key == vIn[i].parent || (i > 0 && vIn[i].key == vIn[i - 1].key))
+            {
+                return false;
+            }
+            vKey.push_back(vIn[i].key);
+            vKey.push_back(vIn[i].parent);
+        }
+        std::sort(vKey.begin(), vKey.end());
+        vKey.erase(std::unique(vKey.begin(), vKey.end()), vKey.end());
+
+        const uint32 nSize = vKey.size();
+        std::vector<uint32> vParent(nSize, NIL);
+        std::vector<uint32> vEdgeOf(nSize, NIL);
+        std::vector<uint32> vOffset(nSize + 1, 0);
+        for (uint32 i = 0; i < vIn.size(); i++)
+        {
+            uint32 n = std::lower_bound(vKey.begin(), vKey.end(), vIn[i].key) - vKey.begin();
+            uint32 p = std::lower_bound(vKey.begin(), vKey.end(), vIn[i].parent) - vKey.begin();
+            vParent[n] = p;
+            vEdgeOf[n] = i;
+            ++vOffset[p + 1];
+        }
+
+        // children of temporary node id, ordered by key
+        for (uint32 i = 0; i < nSize; i++)
+        {
+            vOffset[i + 1] += vOffset[i];
+        }
+        std::vector<uint32> vTmpChild(vIn.size());
+        {
+            std::vector<uint32> vFill(vOffset.begin(), vOffset.end() - 1);
+            for (uint32 n = 0; n < nSize; n++)
+            {
+                if (vParent[n] != NIL)
+                {
+                    vTmpChild[vFill[vParent[n]]++] = n;
+                }
+            }
+        }
+
+        // postorder of roots in key order
+        std::vector<uint32> vPos(nSize, NIL);
+        std::vector<uint32> vOrder;
+        vOrder.reserve(nSize);
+        std::vector<std::pair<uint32, uint32>> st;
+        for (uint32 r = 0; r < nSize; r++)
+        {
+            if (vParent[r] != NIL)
+            {
+                continue;
+            }
+            st.push_back(std::make_pair(r, vOffset[r]));
+            while (!st.empty())
+            {
+                std::pair<uint32, uint32>& top = st.back();
+                if (top.second < vOffset[top.first + 1])
+                {
+                    uint32 c = vTmpChild[top.second++];
+                    st.push_back(std::make_pair(c, vOffset[c]));
+                }
+                else
+                {
+                    vPos[top.first] = vOrder.size();
+                    vOrder.push_back(top.first);
+                    st.pop_back();
+                }
+            }
+        }
+
+        // the nodes unreachable from any root are in cycles
+        if (vOrder.size() != nSize)
+        {
+            return false;
+        }
+
+        vNode.resize(nSize);
+        vChild.reserve(vIn.size());
+        for (uint32 i = 0; i < nSize; i++)
+        {
+            uint32 n = vOrder[i];
+            CFlatNode& node = vNode[i];
+            node.key = vKey[n];
+            if (vEdgeOf[n] != NIL)
+            {
+                node.data = vIn[vEdgeOf[n]].data;
+            }
+            node.nParent = (vParent[n] == NIL) ? NIL : vPos[vParent[n]];
+            node.nChildBegin = vChild.size();
+            for (uint32 j = vOffset[n]; j < vOffset[n + 1]; j++)
+            {
+                vChild.push_back(vPos[vTmpChild[j]]);
+            }
+            node.nChildEnd = vChild.size();
+            if (node.nParent == NIL)
+            {
+                vRoot.push_back(i);
+            }
+        }
+
+        vSorted.swap(vPos);
+        return true;
+    }
+
+    std::size_t Size() const
+    {
+        return vNode.size();
+    }
+
+    // return node index of key, or NIL
+    uint32 Find(const K& key) const
+    {
+        auto it = std::lower_bound(vSorted.begin(), vSorted.end(), key,
+                                   [this](uint32 n, const K& k) { return vNode[n].key < k; });
+        return (it != vSorted.end() && vNode[*it].key == key) ? *it : NIL;
+    }
+
+    // postorder traversal
+    // walker: bool (*function)(CFlatNode&)
+    template <typename NodeWalker>
+    bool PostorderTraversal(NodeWalker walker)
+    {
+        for (CFlatNode& node : vNode)
+        {
+            if (!walker(node))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    class CEdge
+    {
+    public:
+        K key;
+        K parent;
+        D data;
+
+        CEdge(const K& keyIn, const K& parentIn, const D& dataIn)
+          : key(keyIn), parent(parentIn), data(dataIn)
+        {
+        }
+    };
+
+    // node indexes sorted by key
+    std::vector<uint32> vSorted;
+    std::vector<CEdge> vEdge;
+};
+
+template <typename K, typename D>
+const uint32 CFlatForest<K, D>::NIL;
+
 } // namespace xengine
 
 #endif // XENGINE_STRUCTURE_TREE_H
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <boost/test/unit_test.hpp>
 #include <sodium.h>
 
+#include "crc24q.h"
 #include "crypto.h"
 #include "curve25519/curve25519.h"
 #include "test_big.h"
@@ -112,4 +113,44 @@ BOOST_AUTO_TEST_CASE(multisign_defect)
     std::cout << "multisign verify2 count : " << count << "; time per count : " << verifyTime2 / count << "us.; time per key: " << verifyTime2 / signCount << "us." << std::endl;
 }
 
+
+static unsigned int Crc24qBitwise(const unsigned char* data, int size)
+{
+    unsigned int crc = 0;
+    for (int i = 0; i < size; i++)
+    {
+        crc ^= ((unsigned int)data[i] << 16);
+        for (int j = 0; j < 8; j++)
+        {
+            crc <<= 1;
+            if (crc & 0x1000000)
+            {
+                crc ^= 0x1864CFB;
+            }
+        }
+    }
+    return (crc & 0x00ffffff);
+}
+
+BOOST_AUTO_TEST_CASE(crc24q_check)
+{
+    const std::string strCheck("123456789");
+    BOOST_CHECK(crc24q((const unsigned char*)strCheck.data(), strCheck.size()) == 0xCDE703);
+    BOOST_CHECK(crc24q(nullptr, 0) == 0);
+
+    srand(time(0));
+    std::vector<unsigned char> vData(4099);
+    for (std::size_t i = 0; i < vData.size(); i++)
+    {
+        vData[i] = rand() & 0xFF;
+    }
+    for (int nOffset = 0; nOffset < 8; nOffset++)
+    {
+        for (int nSize = 0; nSize + nOffset <= (int)vData.size(); nSize += (nSize < 64 ? 1 : 997))
+        {
+            BOOST_CHECK(crc24q(&vData[nOffset], nSize) == Crc24qBitwise(&vData[nOffset], nSize));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
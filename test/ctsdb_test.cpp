@@ -95,4 +95,73 @@ BOOST_AUTO_TEST_CASE(ctsdb)
     boost::filesystem::remove_all(fullpath);
 }
 
+BOOST_AUTO_TEST_CASE(ctsdb_bloom_cache)
+{
+    CCTSBloom bloom;
+    bloom.Initialize(1000);
+    std::vector<uint224> vKey;
+    for (int i = 0; i < 1000; i++)
+    {
+        uint256 hash;
+        ibrio::crypto::CryptoGetRand256(hash);
+        vKey.push_back(uint224(hash));
+        bloom.Add(vKey.back());
+    }
+    int nFalsePositive = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        BOOST_CHECK(bloom.MayContain(vKey[i]));
+        uint256 hash;
+        ibrio::crypto::CryptoGetRand256(hash);
+        if (bloom.MayContain(uint224(hash)))
+        {
+            nFalsePositive++;
+        }
+    }
+    BOOST_CHECK(nFalsePositive < 50);
+    BOOST_CHECK(CCTSBloom().MayContain(vKey[0]));
+
+    CMetaDB db;
+    std::shared_ptr<CCTSChunkCache<CCTSChunkSnappy<uint224, CMetaData>>> spCache(new CCTSChunkCache<CCTSChunkSnappy<uint224, CMetaData>>());
+    db.SetChunkCache(spCache);
+
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_cache";
+    BOOST_CHECK(db.Initialize(boost::filesystem::path(fullpath)));
+    db.RemoveAll();
+
+    for (int i = 0; i < 1000; i++)
+    {
+        CMetaData data;
+        data.hash = vKey[i];
+        data.file = 1;
+        data.offset = i;
+        data.blocktime = i % 10;
+        db.Update(data.blocktime, data.hash, data);
+    }
+    BOOST_CHECK(db.Flush());
+
+    for (int loop = 0; loop < 2; loop++)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            CMetaData data;
+            BOOST_CHECK(db.Retrieve(i % 10, vKey[i], data));
+            BOOST_CHECK(data.hash == vKey[i] && data.offset == i);
+            BOOST_CHECK(!db.Retrieve((i + 1) % 10, vKey[i], data));
+        }
+    }
+
+    CMetaData data;
+    data.hash = vKey[0];
+    data.file = 2;
+    data.offset = 0;
+    data.blocktime = 0;
+    db.Update(0, data.hash, data);
+    BOOST_CHECK(db.Flush());
+    BOOST_CHECK(db.Retrieve(0, vKey[0], data) && data.file == 2);
+
+    db.Deinitialize();
+    boost::filesystem::remove_all(fullpath);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include <map>
 #include <set>
 #include <sodium.h>
+#include <thread>
 
 #include "crypto.h"
 #include "defi.h"
@@ -572,11 +573,238 @@ BOOST_AUTO_TEST_CASE(reward)
         BOOST_CHECK(it != destIdx.end() && it->nReward == 1762663353);
         it = destIdx.find(B);
         BOOST_CHECK(it != destIdx.end() && it->nReward == 8845274860);
+
+        // flat graph
+        CDeFiRelationFlatGraph flatRelation;
+        for (auto& x : mapAddress)
+        {
+            flatRelation.AddEdge(x.first, x.second.destParent, x.second.destParent);
+        }
+        BOOST_CHECK(flatRelation.Build());
+        CDeFiRewardSet flatReward = r.ComputePromotionReward(nReward, balance, profile1.defi.mapPromotionTokenTimes, flatRelation, set<CDestination>());
+        BOOST_CHECK(flatReward.size() == reward.size());
+        for (auto& x : reward)
+        {
+            auto im = flatReward.get<0>().find(x.dest);
+            BOOST_CHECK(im != flatReward.get<0>().end() && im->nReward == x.nReward
+                        && im->nPower == x.nPower && im->nAchievement == x.nAchievement && im->nAmount == x.nAmount);
+        }
     }
 
     // boost::filesystem::remove_all(logPath);
 }
 
+// stake reward of single thread multimap implementation, used to check parallel implementation
+static CDeFiRewardSet ComputeStakeRewardByMultimap(const int64 nMin, const int64 nReward, const std::map<CDestination, int64>& mapAddressAmount)
+{
+    CDeFiRewardSet rewardSet;
+    multimap<int64, pair<CDestination, uint64>> mapRank;
+    for (auto& p : mapAddressAmount)
+    {
+        if (p.second >= nMin)
+        {
+            mapRank.insert(make_pair(p.second, make_pair(p.first, 0)));
+        }
+    }
+
+    uint64 nRank = 1;
+    uint64 nPos = 0;
+    uint64 nTotal = 0;
+    int64 nToken = -1;
+    for (auto& p : mapRank)
+    {
+        ++nPos;
+        if (p.first != nToken)
+        {
+            p.second.second = nPos;
+            nRank = nPos;
+            nToken = p.first;
+        }
+        else
+        {
+            p.second.second = nRank;
+        }
+        nTotal += p.second.second;
+    }
+
+    double fUnitReward = (double)nReward / nTotal;
+    for (auto& p : mapRank)
+    {
+        CDeFiReward reward;
+        reward.dest = p.second.first;
+        reward.nAmount = p.first;
+        reward.nRank = p.second.second;
+        reward.nStakeReward = fUnitReward * p.second.second;
+        reward.nReward = reward.nStakeReward;
+        rewardSet.insert(std::move(reward));
+    }
+    return rewardSet;
+}
+
+static bool IsEqualReward(const CDeFiReward& a, const CDeFiReward& b)
+{
+    return a.dest == b.dest && a.nReward == b.nReward && a.nAmount == b.nAmount && a.nRank == b.nRank
+           && a.nStakeReward == b.nStakeReward && a.nAchievement == b.nAchievement && a.nPower == b.nPower
+           && a.nPromotionReward == b.nPromotionReward;
+}
+
+BOOST_AUTO_TEST_CASE(reward_parallel)
+{
+    // fixed seed, a failure is reproducible
+    srand(20210601);
+    CDeFiForkReward r;
+    r.SetParallelNum(4);
+
+    const int nCount = CDeFiForkReward::PARALLEL_CHUNK_MIN_SIZE * 5 + 17;
+    vector<CDestination> vDest;
+    map<CDestination, int64> balance;
+    for (int i = 0; i < nCount; i++)
+    {
+        CDestination dest = CDestination(CPubKey(uint256(i + 1)));
+        vDest.push_back(dest);
+        // many addresses have the same amount
+        balance[dest] = (rand() % 1000) * COIN;
+    }
+
+    // stake reward
+    {
+        const int64 nReward = 1234567 * COIN;
+        CDeFiRewardSet reward = r.ComputeStakeReward(100 * COIN, nReward, balance);
+        CDeFiRewardSet rewardRef = ComputeStakeRewardByMultimap(100 * COIN, nReward, balance);
+        BOOST_CHECK(reward.size() == rewardRef.size());
+        BOOST_CHECK(std::equal(reward.get<0>().begin(), reward.get<0>().end(), rewardRef.get<0>().begin(), IsEqualReward));
+        BOOST_CHECK(std::equal(reward.get<1>().begin(), reward.get<1>().end(), rewardRef.get<1>().begin(), IsEqualReward));
+    }
+
+    // promotion reward
+    {
+        map<int64, uint32> mapPromotionTokenTimes{ { 10, 10 }, { 500, 5 } };
+        CDeFiRelationGraph relation;
+        CDeFiRelationFlatGraph flatRelation;
+        for (int i = 1; i < nCount; i++)
+        {
+            // about 1% are roots
+            if (rand() % 100 != 0)
+            {
+                const CDestination& parent = vDest[rand() % i];
+                BOOST_CHECK(relation.Insert(vDest[i], parent, parent));
+                flatRelation.AddEdge(vDest[i], parent, parent);
+            }
+        }
+        BOOST_CHECK(flatRelation.Build());
+        BOOST_CHECK(flatRelation.Size() == relation.mapNode.size());
+
+        set<CDestination> setBlackList{ vDest[0], vDest[nCount / 2] };
+        const int64 nReward = 7654321 * COIN;
+        CDeFiRewardSet reward = r.ComputePromotionReward(nReward, balance, mapPromotionTokenTimes, flatRelation, setBlackList);
+        CDeFiRewardSet rewardRef = r.ComputePromotionReward(nReward, balance, mapPromotionTokenTimes, relation, setBlackList);
+        BOOST_CHECK(reward.size() == rewardRef.size());
+        BOOST_CHECK(std::equal(reward.get<0>().begin(), reward.get<0>().end(), rewardRef.get<0>().begin(), IsEqualReward));
+
+        // the result does not depend on the number of threads
+        r.SetParallelNum(1);
+        CDeFiRewardSet rewardSingle = r.ComputePromotionReward(nReward, balance, mapPromotionTokenTimes, flatRelation, setBlackList);
+        BOOST_CHECK(reward.size() == rewardSingle.size());
+        BOOST_CHECK(std::equal(reward.get<1>().begin(), reward.get<1>().end(), rewardSingle.get<1>().begin(), IsEqualReward));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(reward_fork_parallel)
+{
+    // blocks of two defi forks are added at the same time, as subsidiary forks are connected in parallel
+    CDeFiForkReward r;
+    const int nForkCount = 2;
+    const int nRewardCycle = 10;
+    const int nSectionCount = 200;
+
+    CProfile profile;
+    profile.strName = "IBR Test";
+    profile.strSymbol = "IBRT";
+    profile.nVersion = 1;
+    profile.nMinTxFee = MIN_TX_FEE;
+    profile.nAmount = 21000000 * COIN;
+    profile.nJointHeight = 8;
+    profile.nForkType = FORK_TYPE_DEFI;
+    profile.defi.nMintHeight = 0;
+    profile.defi.nMaxSupply = 2100000000 * COIN;
+    profile.defi.nCoinbaseType = FIXED_DEFI_COINBASE_TYPE;
+    profile.defi.nDecayCycle = 1036800;
+    profile.defi.nCoinbaseDecayPercent = 50;
+    profile.defi.nInitCoinbasePercent = 10;
+    profile.defi.nPromotionRewardPercent = 50;
+    profile.defi.nRewardCycle = nRewardCycle;
+    profile.defi.nSupplyCycle = 43200;
+    profile.defi.nStakeMinToken = 100 * COIN;
+    profile.defi.nStakeRewardPercent = 50;
+
+    const int32 nMintHeight = profile.nJointHeight + 2;
+    auto fnSection = [&](const int nFork, const int nSection) -> uint256 {
+        return uint256(nMintHeight + (nSection + 1) * nRewardCycle - 1, uint224(nFork + 1));
+    };
+
+    vector<uint256> vForkId;
+    for (int i = 0; i < nForkCount; i++)
+    {
+        vForkId.push_back(uint256(i + 1));
+    }
+
+    vector<int> vFail(nForkCount, 0);
+    vector<std::shared_ptr<const CDeFiRewardSet>> vFirst(nForkCount);
+    auto fnAddBlock = [&](const int nFork) {
+        const uint256& forkid = vForkId[nFork];
+        r.AddFork(forkid, profile);
+        for (int n = 0; n < nSectionCount; n++)
+        {
+            const uint256 section = fnSection(nFork, n);
+            const int32 nHeight = CBlock::GetBlockHeightByHash(section);
+            if (!r.ExistFork(forkid) || !r.IsMinted(forkid, nHeight)
+                || r.PrevRewardHeight(forkid, nHeight) != nHeight - nRewardCycle
+                || r.GetSectionReward(forkid, section) <= 0 || r.ExistForkSection(forkid, section))
+            {
+                vFail[nFork]++;
+                continue;
+            }
+
+            CDeFiRewardSet reward;
+            CDeFiReward item;
+            item.dest = CDestination(CPubKey(uint256(nFork * nSectionCount + n + 1)));
+            item.nReward = n;
+            reward.insert(item);
+            std::shared_ptr<const CDeFiRewardSet> spReward = r.AddForkSection(forkid, section, std::move(reward));
+            std::shared_ptr<const CDeFiRewardSet> spGet = r.GetForkSection(forkid, section);
+            if (!spReward || spGet != spReward || spGet->size() != 1 || spGet->begin()->nReward != n)
+            {
+                vFail[nFork]++;
+            }
+            if (n == 0)
+            {
+                vFirst[nFork] = spGet;
+            }
+        }
+    };
+
+    std::thread t(fnAddBlock, 1);
+    fnAddBlock(0);
+    t.join();
+
+    for (int i = 0; i < nForkCount; i++)
+    {
+        BOOST_CHECK(vFail[i] == 0);
+        // only the last sections are cached, a set taken before stays valid after it is evicted
+        BOOST_CHECK(!r.GetForkSection(vForkId[i], fnSection(i, 0)));
+        BOOST_CHECK(vFirst[i] && vFirst[i]->size() == 1 && vFirst[i]->begin()->nReward == 0);
+        for (int n = nSectionCount - CDeFiForkReward::MAX_REWARD_CACHE; n < nSectionCount; n++)
+        {
+            std::shared_ptr<const CDeFiRewardSet> spReward = r.GetForkSection(vForkId[i], fnSection(i, n));
+            BOOST_CHECK(spReward && spReward->begin()->nReward == n
+                        && spReward->begin()->dest == CDestination(CPubKey(uint256(i * nSectionCount + n + 1))));
+        }
+    }
+
+    // section of a fork which is not exist is not cached
+    BOOST_CHECK(!r.AddForkSection(uint256(nForkCount + 1), fnSection(0, 0), CDeFiRewardSet()));
+}
+
 BOOST_AUTO_TEST_CASE(reward2)
 {
     CDeFiForkReward r;
@@ -0,0 +1,153 @@
+// Copyright (c) 2019-2021 The Ibrio developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "http/httpserver.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "http/httpget.h"
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+
+BOOST_FIXTURE_TEST_SUITE(http_tests, BasicUtfSetup)
+
+BOOST_AUTO_TEST_CASE(pipeline_order)
+{
+    const size_t nMaxPipeline = 3;
+    CHttpPipeline pipeline;
+    BOOST_CHECK(pipeline.IsEmpty() && pipeline.IsReadable(nMaxPipeline));
+
+    pipeline.AddRequest("POST");
+    pipeline.AddRequest("POST");
+    BOOST_CHECK(pipeline.IsReadable(nMaxPipeline));
+    pipeline.AddRequest("POST");
+    BOOST_CHECK(pipeline.GetSize() == nMaxPipeline && !pipeline.IsReadable(nMaxPipeline));
+
+    // nothing is written before the first request is answered
+    BOOST_CHECK(pipeline.GetReadyResponse() == nullptr);
+
+    vector<string> vResponse = { "1", "2", "3" };
+    for (string& strResponse : vResponse)
+    {
+        string strSet = strResponse;
+        BOOST_CHECK(pipeline.SetResponse(strSet, true));
+    }
+    string strExtra = "4";
+    BOOST_CHECK(!pipeline.SetResponse(strExtra, true));
+
+    // responses go out in request order, a written one makes room for the next request
+    vector<string> vWritten;
+    string* pResponse = nullptr;
+    while ((pResponse = pipeline.GetReadyResponse()) != nullptr)
+    {
+        vWritten.push_back(*pResponse);
+        BOOST_CHECK(pipeline.PopResponse());
+        BOOST_CHECK(pipeline.IsReadable(nMaxPipeline));
+    }
+    BOOST_CHECK(vWritten == vResponse);
+    BOOST_CHECK(pipeline.IsEmpty());
+
+    // connection without keep-alive is closed after its response
+    pipeline.AddRequest("POST");
+    pipeline.AddRequest("POST");
+    string strClose = "close";
+    BOOST_CHECK(pipeline.SetResponse(strClose, false));
+    BOOST_CHECK(pipeline.GetReadyResponse() != nullptr && *pipeline.GetReadyResponse() == "close");
+    BOOST_CHECK(!pipeline.PopResponse());
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_hold)
+{
+    const size_t nMaxPipeline = 16;
+    CHttpPipeline pipeline;
+
+    // a GET may be held by the module, nothing is read behind it
+    pipeline.AddRequest("POST");
+    pipeline.AddRequest("GET");
+    BOOST_CHECK(pipeline.IsHold() && !pipeline.IsReadable(nMaxPipeline));
+
+    string strPost = "post";
+    BOOST_CHECK(pipeline.SetResponse(strPost, true));
+    BOOST_CHECK(pipeline.PopResponse());
+    BOOST_CHECK(pipeline.IsHold() && !pipeline.IsReadable(nMaxPipeline));
+
+    // reading goes on once the GET is answered
+    string strGet = "get";
+    BOOST_CHECK(pipeline.SetResponse(strGet, true));
+    BOOST_CHECK(*pipeline.GetReadyResponse() == "get");
+    BOOST_CHECK(pipeline.PopResponse());
+    BOOST_CHECK(!pipeline.IsHold() && pipeline.IsReadable(nMaxPipeline));
+
+    // an error answers the last request and closes the connection after the earlier ones
+    pipeline.AddRequest("POST");
+    pipeline.AddRequest("POST");
+    string strError = "error";
+    pipeline.SetErrorResponse(strError);
+    BOOST_CHECK(pipeline.IsClosing() && !pipeline.IsReadable(nMaxPipeline));
+    BOOST_CHECK(pipeline.GetReadyResponse() == nullptr);
+    string strFirst = "first";
+    BOOST_CHECK(pipeline.SetResponse(strFirst, true));
+    BOOST_CHECK(*pipeline.GetReadyResponse() == "first");
+    BOOST_CHECK(pipeline.PopResponse());
+    BOOST_CHECK(*pipeline.GetReadyResponse() == "error");
+    BOOST_CHECK(!pipeline.PopResponse());
+}
+
+class CHttpGetPoolKey : public CHttpGet
+{
+public:
+    using CHttpGet::GetPoolKey;
+};
+
+BOOST_AUTO_TEST_CASE(httpget_pool_key)
+{
+    CHttpGetPoolKey httpGet;
+    CHttpReqData req;
+    req.strProtocol = "https";
+    req.mapHeader["host"] = "127.0.0.1:6812";
+    req.fVerifyPeer = true;
+    req.strPathCA = "ca.pem";
+
+    CHttpReqData reqNoVerify = req;
+    reqNoVerify.fVerifyPeer = false;
+    CHttpReqData reqOtherCA = req;
+    reqOtherCA.strPathCA = "other.pem";
+    CHttpReqData reqSame = req;
+
+    // a connection is not reused with other ssl verify options
+    BOOST_CHECK(httpGet.GetPoolKey(req) == httpGet.GetPoolKey(reqSame));
+    BOOST_CHECK(httpGet.GetPoolKey(req) != httpGet.GetPoolKey(reqNoVerify));
+    BOOST_CHECK(httpGet.GetPoolKey(req) != httpGet.GetPoolKey(reqOtherCA));
+}
+
+class CHttpGetClientRetry : public CHttpGetClient
+{
+public:
+    CHttpGetClientRetry()
+      : CHttpGetClient("", 0, "", nullptr, nullptr) {}
+    void SetState(const bool fReusedIn, const bool fWrittenIn)
+    {
+        fIdle = false;
+        fReused = fReusedIn;
+        fWritten = fWrittenIn;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(httpget_retry)
+{
+    CHttpGetClientRetry client;
+    BOOST_CHECK(!client.IsRetryable());
+
+    // only a request on a reused connection that never reached the server is sent again
+    client.SetState(true, false);
+    BOOST_CHECK(client.IsRetryable());
+    client.SetState(true, true);
+    BOOST_CHECK(!client.IsRetryable());
+    client.SetState(false, false);
+    BOOST_CHECK(!client.IsRetryable());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,260 @@
+// Copyright (c) 2019-2021 The Ibrio developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netchn.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "peer.h"
+#include "peerevent.h"
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+using namespace ibrio;
+using namespace ibrio::network;
+
+class CRelayPeerNet : public CBbPeerNet
+{
+public:
+    bool DispatchEvent(CEvent* pEvent) override
+    {
+        vEvent.push_back(make_pair(pEvent->nType, pEvent->nNonce));
+        if (pEvent->nType == EVENT_PEER_RAWINV)
+        {
+            vInvNonce = static_cast<CEventPeerRawInv*>(pEvent)->data.vNonce;
+        }
+        return true;
+    }
+    bool CheckPeerVersion(uint32 nVersionIn, uint64 nServiceIn, const string& subVersionIn) override
+    {
+        return true;
+    }
+
+public:
+    vector<pair<int, uint64>> vEvent;
+    vector<uint64> vInvNonce;
+};
+
+class CRelayNetChannel : public CNetChannel
+{
+public:
+    CRelayNetChannel(CBbPeerNet* pPeerNetIn, const uint256& hashFork, const vector<uint64>& vPeer)
+    {
+        pPeerNet = pPeerNetIn;
+        mapSched.insert(make_pair(hashFork, CNetSchedulePtr(new CNetSchedule())));
+        for (const uint64 nPeer : vPeer)
+        {
+            mapPeer[nPeer].Subscribe(hashFork);
+        }
+    }
+    bool IsRelayPending(const uint256& hashBlock)
+    {
+        return (mapRelayBlock.count(hashBlock) != 0);
+    }
+    using CNetChannel::GetPeerBlock;
+};
+
+BOOST_FIXTURE_TEST_SUITE(network_tests, BasicUtfSetup)
+
+BOOST_AUTO_TEST_CASE(compact_block_send)
+{
+    const int64 nTime = 1600000000;
+    const uint64 nCompactService = NODE_NETWORK | NODE_COMPACTBLOCK;
+
+    // recent block to a peer with compact block
+    BOOST_CHECK(CNetChannel::IsCompactBlockSend(nCompactService, nTime - 10, nTime));
+    // peer without compact block gets the full block
+    BOOST_CHECK(!CNetChannel::IsCompactBlockSend(NODE_NETWORK, nTime - 10, nTime));
+    // old block is sent in full, its txs are not known by the peer any more
+    BOOST_CHECK(CNetChannel::IsCompactBlockSend(nCompactService, nTime - 3600, nTime));
+    BOOST_CHECK(!CNetChannel::IsCompactBlockSend(nCompactService, nTime - 3601, nTime));
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_payload)
+{
+    CBlock block;
+    block.nTimeStamp = 1600000000;
+    block.hashPrev = uint256(1);
+    block.vtx.resize(2);
+    block.vtx[0].nAmount = 1;
+    block.vtx[1].nAmount = 2;
+    const uint256 hashFork(3);
+
+    // the cached payload gives back the block without reading it from the block chain
+    CEventPeerRawPayload payload;
+    payload.SetPayload(hashFork, block);
+    uint256 hashForkOut;
+    CBlock blockOut;
+    BOOST_CHECK(payload.GetPayload(hashForkOut, blockOut));
+    BOOST_CHECK(hashForkOut == hashFork);
+    BOOST_CHECK(blockOut.GetHash() == block.GetHash());
+    BOOST_CHECK(blockOut.vtx.size() == 2 && blockOut.vtx[1].GetHash() == block.vtx[1].GetHash());
+
+    payload.vchPayload.resize(payload.vchPayload.size() / 2);
+    BOOST_CHECK(!payload.GetPayload(hashForkOut, blockOut));
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_priority)
+{
+    auto fnMessage = [](uint32 nId, size_t nSize) -> CSendMessage {
+        CEventPeerRawPayload* pPayload = new CEventPeerRawPayload();
+        pPayload->vchPayload.resize(nSize);
+        pPayload->nChecksum = nId;
+        CSendMessage msg;
+        msg.spPayload.reset(pPayload);
+        return msg;
+    };
+
+    CPeerSendQueue queSend;
+    BOOST_CHECK(queSend.IsEmpty());
+
+    queSend.Push(fnMessage(1, 100), CPeerSendQueue::SEND_PRIORITY_LOW);
+    queSend.Push(fnMessage(2, 100), CPeerSendQueue::SEND_PRIORITY_HIGH);
+    queSend.Push(fnMessage(3, 100), CPeerSendQueue::SEND_PRIORITY_HIGH);
+    queSend.Push(fnMessage(4, 10), CPeerSendQueue::SEND_PRIORITY_CONTROL);
+    BOOST_CHECK(!queSend.IsEmpty());
+    BOOST_CHECK(queSend.GetSize() == 3 * (MESSAGE_HEADER_SIZE + 100) + MESSAGE_HEADER_SIZE + 10);
+
+    // ping queued behind a data burst goes out first, then data in order, then tx relay
+    vector<uint32> vOrder;
+    CSendMessage msg;
+    while (queSend.Pop(msg))
+    {
+        vOrder.push_back(msg.spPayload->nChecksum);
+    }
+    BOOST_CHECK(vOrder == vector<uint32>({ 4, 2, 3, 1 }));
+    BOOST_CHECK(queSend.IsEmpty() && queSend.GetSize() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_limit)
+{
+    CPeerSendQueue queSend;
+    const size_t nMaxSize = CPeerSendQueue::MAX_SEND_QUEUE_SIZE;
+    const size_t nMaxLowSize = CPeerSendQueue::MAX_SEND_LOW_QUEUE_SIZE;
+
+    BOOST_CHECK(queSend.Check(0, nMaxSize, CPeerSendQueue::SEND_PRIORITY_HIGH));
+    BOOST_CHECK(!queSend.Check(1, nMaxSize, CPeerSendQueue::SEND_PRIORITY_HIGH));
+    BOOST_CHECK(!queSend.Check(0, nMaxLowSize + 1, CPeerSendQueue::SEND_PRIORITY_LOW));
+    BOOST_CHECK(queSend.Check(0, nMaxLowSize + 1, CPeerSendQueue::SEND_PRIORITY_CONTROL));
+
+    CEventPeerRawPayload* pPayload = new CEventPeerRawPayload();
+    pPayload->vchPayload.resize(nMaxLowSize - MESSAGE_HEADER_SIZE);
+    CSendMessage msg;
+    msg.spPayload.reset(pPayload);
+    queSend.Push(msg, CPeerSendQueue::SEND_PRIORITY_LOW);
+
+    // tx relay is full, blocks can still be queued
+    BOOST_CHECK(!queSend.Check(0, 1, CPeerSendQueue::SEND_PRIORITY_LOW));
+    BOOST_CHECK(queSend.Check(0, 1, CPeerSendQueue::SEND_PRIORITY_HIGH));
+}
+
+BOOST_AUTO_TEST_CASE(snappy_payload)
+{
+    vector<uint8> vchData(MESSAGE_PAYLOAD_SNAPPY_SIZE * 4);
+    for (size_t i = 0; i < vchData.size(); i++)
+    {
+        vchData[i] = (uint8)(i % 7);
+    }
+
+    vector<uint8> vchCompressed;
+    BOOST_CHECK(CompressPayload(vchData.data(), vchData.size(), vchCompressed));
+    BOOST_CHECK(vchCompressed.size() < vchData.size());
+
+    CBufStream ss;
+    BOOST_CHECK(UncompressPayload(vchCompressed.data(), vchCompressed.size(), ss));
+    BOOST_CHECK(ss.GetSize() == vchData.size() && memcmp(ss.GetData(), vchData.data(), vchData.size()) == 0);
+
+    // a payload over the limit is not compressed, it would be rejected by the receiver
+    vector<uint8> vchLarge(MESSAGE_PAYLOAD_MAX_SIZE + 1, 0);
+    vector<uint8> vchLargeCompressed;
+    BOOST_CHECK(!CompressPayload(vchLarge.data(), vchLarge.size(), vchLargeCompressed));
+    BOOST_CHECK(vchLargeCompressed.empty());
+    BOOST_CHECK(CompressPayload(vchLarge.data(), MESSAGE_PAYLOAD_MAX_SIZE, vchLargeCompressed));
+
+    // uncompressed length over the limit in the snappy preamble, rejected before allocating
+    vector<uint8> vchOversize;
+    uint32 nLength = MESSAGE_PAYLOAD_MAX_SIZE + 1;
+    while (nLength >= 0x80)
+    {
+        vchOversize.push_back((uint8)(nLength | 0x80));
+        nLength >>= 7;
+    }
+    vchOversize.push_back((uint8)nLength);
+    CBufStream ssOversize;
+    BOOST_CHECK(!UncompressPayload(vchOversize.data(), vchOversize.size(), ssOversize));
+    BOOST_CHECK(ssOversize.GetSize() == 0);
+
+    // corrupted data
+    vchCompressed.resize(vchCompressed.size() / 2);
+    CBufStream ssCorrupted;
+    BOOST_CHECK(!UncompressPayload(vchCompressed.data(), vchCompressed.size(), ssCorrupted));
+}
+
+BOOST_AUTO_TEST_CASE(fast_relay_block)
+{
+    const uint256 hashFork(1);
+    const uint64 nRelayer = 1;
+    const uint64 nOtherPeer = 2;
+    CRelayPeerNet peerNet;
+    CRelayNetChannel netChannel(&peerNet, hashFork, { nRelayer, nOtherPeer });
+
+    CBlock block;
+    block.nTimeStamp = 1600000000;
+    block.hashPrev = uint256(3);
+    block.vtx.resize(1);
+    const uint256 hashBlock = block.GetHash();
+
+    // announced before it is stored, getdata is answered from the relay cache
+    netChannel.RelayVerifiedBlock(hashFork, block, nRelayer);
+    BOOST_CHECK(peerNet.vEvent.size() == 1 && peerNet.vEvent[0].first == EVENT_PEER_RAWINV);
+    BOOST_CHECK(peerNet.vInvNonce == vector<uint64>({ nRelayer, nOtherPeer }));
+    CBlock blockGet;
+    BOOST_CHECK(netChannel.GetPeerBlock(hashFork, hashBlock, blockGet));
+    BOOST_CHECK(blockGet.GetHash() == hashBlock);
+
+    // stored block is read from the block chain again, the relayer is not penalized
+    netChannel.CompleteRelayedBlock(hashBlock, true);
+    BOOST_CHECK(!netChannel.IsRelayPending(hashBlock));
+    BOOST_CHECK(peerNet.vEvent.size() == 1);
+
+    // full validation rejects the block, the peer which sent it is closed
+    netChannel.RelayVerifiedBlock(hashFork, block, nRelayer);
+    BOOST_CHECK(peerNet.vEvent.size() == 2 && peerNet.vEvent[1].first == EVENT_PEER_RAWINV);
+    netChannel.CompleteRelayedBlock(hashBlock, false);
+    BOOST_CHECK(!netChannel.IsRelayPending(hashBlock));
+    BOOST_CHECK(peerNet.vEvent.size() == 3);
+    BOOST_CHECK(peerNet.vEvent[2] == make_pair((int)EVENT_PEERNET_CLOSE, nRelayer));
+
+    // a block completed twice is penalized once
+    netChannel.CompleteRelayedBlock(hashBlock, false);
+    BOOST_CHECK(peerNet.vEvent.size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(schedule_lock)
+{
+    CNetSchedulePtr spSched(new CNetSchedule());
+    bool fLocked = true;
+    {
+        CNetScheduleLock lockSched(spSched);
+        BOOST_CHECK(&lockSched.Get() == &spSched->sched);
+
+        // another thread (rpc, ref block worker) waits while the handle is alive
+        boost::thread thr([&]() { fLocked = !spSched->mtxSched.try_lock(); });
+        thr.join();
+        BOOST_CHECK(fLocked);
+    }
+
+    boost::thread thr([&]() {
+        fLocked = !spSched->mtxSched.try_lock();
+        if (!fLocked)
+        {
+            spSched->mtxSched.unlock();
+        }
+    });
+    thr.join();
+    BOOST_CHECK(!fLocked);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+// Copyright (c) 2019-2021 The Ibrio developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "schedule.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "peerevent.h"
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+using namespace ibrio;
+using namespace ibrio::network;
+
+BOOST_FIXTURE_TEST_SUITE(schedule_tests, BasicUtfSetup)
+
+BOOST_AUTO_TEST_CASE(cmpct_block_assigned)
+{
+    CSchedule sched;
+    const uint64 nPeer = 1;
+    const uint64 nOtherPeer = 2;
+    const uint256 hash(100);
+    const uint256 hashUnknown(200);
+
+    BOOST_CHECK(sched.AddNewInv(CInv(CInv::MSG_BLOCK, hash), nPeer));
+    BOOST_CHECK(sched.AddNewInv(CInv(CInv::MSG_BLOCK, hash), nOtherPeer));
+
+    // announced but not requested yet
+    BOOST_CHECK(!sched.IsAssignedBlock(nPeer, hash));
+
+    vector<CInv> vInv;
+    bool fMissingPrev = false, fEmpty = false;
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeer, vInv, CSchedule::MAX_PEER_BLOCK_INFLIGHT, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == 1 && vInv[0].nHash == hash);
+
+    // only the peer the block was requested from may send it
+    BOOST_CHECK(sched.IsAssignedBlock(nPeer, hash));
+    BOOST_CHECK(!sched.IsAssignedBlock(nOtherPeer, hash));
+    BOOST_CHECK(!sched.IsAssignedBlock(nPeer, hashUnknown));
+
+    set<uint64> setSchedPeer;
+    BOOST_CHECK(sched.ReceiveBlock(nPeer, hash, CBlock(), setSchedPeer));
+    BOOST_CHECK(!sched.IsAssignedBlock(nPeer, hash));
+}
+
+BOOST_AUTO_TEST_CASE(cmpct_block_tx_count)
+{
+    const size_t nMaxTxCount = CEventPeerCompactBlock::GetMaxTxCount();
+    BOOST_CHECK(nMaxTxCount > 0 && nMaxTxCount * GetSerializeSize(CTransaction()) <= MAX_BLOCK_SIZE);
+
+    CBlock block;
+    block.vtx.resize(3);
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        block.vtx[i].nAmount = i + 1;
+    }
+    CEventPeerCompactBlock cmpct;
+    cmpct.SetBlock(block, 1, [](const uint256& txid) -> bool { return false; });
+    BOOST_CHECK(cmpct.GetTxCount() == block.vtx.size());
+
+    // short id list of an oversized block, as sent by a peer
+    cmpct.vShortTxId.resize(nMaxTxCount + 1);
+    BOOST_CHECK(cmpct.GetTxCount() > CEventPeerCompactBlock::GetMaxTxCount());
+}
+
+BOOST_AUTO_TEST_CASE(block_inflight)
+{
+    CSchedule sched;
+    const uint64 nPeer = 1;
+    const uint64 nOtherPeer = 2;
+    const size_t nBlockCount = CSchedule::MAX_PEER_BLOCK_INFLIGHT + 4;
+
+    for (size_t i = 0; i < nBlockCount; i++)
+    {
+        CInv inv(CInv::MSG_BLOCK, uint256(i + 1, uint224(i + 1)));
+        BOOST_CHECK(sched.AddNewInv(inv, nPeer));
+        BOOST_CHECK(sched.AddNewInv(inv, nOtherPeer));
+    }
+
+    // one peer gets no more than MAX_PEER_BLOCK_INFLIGHT blocks at a time
+    vector<CInv> vInv;
+    bool fMissingPrev = false, fEmpty = false;
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeer, vInv, nBlockCount, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == CSchedule::MAX_PEER_BLOCK_INFLIGHT);
+
+    vector<CInv> vInvMore;
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeer, vInvMore, nBlockCount, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInvMore.empty());
+
+    // the rest goes to the other peer
+    vector<CInv> vInvOther;
+    BOOST_CHECK(sched.ScheduleBlockInv(nOtherPeer, vInvOther, nBlockCount, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInvOther.size() == nBlockCount - CSchedule::MAX_PEER_BLOCK_INFLIGHT);
+    for (const CInv& inv : vInvOther)
+    {
+        BOOST_CHECK(find(vInv.begin(), vInv.end(), inv) == vInv.end());
+    }
+
+    // a received block frees a slot
+    set<uint64> setSchedPeer;
+    BOOST_CHECK(sched.ReceiveBlock(nPeer, vInv[0].nHash, CBlock(), setSchedPeer));
+    BOOST_CHECK(sched.IsAssignedBlock(nPeer, vInv[1].nHash));
+    BOOST_CHECK(!sched.IsAssignedBlock(nPeer, vInv[0].nHash));
+}
+
+BOOST_AUTO_TEST_CASE(block_download_window)
+{
+    CSchedule sched;
+    const uint64 nPeer = 1;
+    const uint32 nLowHeight = 10;
+    const uint32 nHighHeight = nLowHeight + CSchedule::MAX_BLOCK_DOWNLOAD_WINDOW + 1;
+    const uint256 hashLow(nLowHeight, uint224(1));
+    const uint256 hashHigh(nHighHeight, uint224(2));
+
+    BOOST_CHECK(sched.GetDownloadWindowHeight() == numeric_limits<uint32>::max());
+    BOOST_CHECK(sched.AddNewInv(CInv(CInv::MSG_BLOCK, hashHigh), nPeer));
+    BOOST_CHECK(sched.AddNewInv(CInv(CInv::MSG_BLOCK, hashLow), nPeer));
+    BOOST_CHECK(sched.GetDownloadWindowHeight() == nLowHeight + CSchedule::MAX_BLOCK_DOWNLOAD_WINDOW);
+
+    // the block above the window waits for the lowest block
+    vector<CInv> vInv;
+    bool fMissingPrev = false, fEmpty = false;
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeer, vInv, CSchedule::MAX_PEER_BLOCK_INFLIGHT, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == 1 && vInv[0].nHash == hashLow);
+
+    // receiving the lowest block moves the window up
+    set<uint64> setSchedPeer;
+    BOOST_CHECK(sched.ReceiveBlock(nPeer, hashLow, CBlock(), setSchedPeer));
+    BOOST_CHECK(sched.GetDownloadWindowHeight() == nHighHeight + CSchedule::MAX_BLOCK_DOWNLOAD_WINDOW);
+
+    vInv.clear();
+    BOOST_CHECK(sched.ScheduleBlockInv(nPeer, vInv, CSchedule::MAX_PEER_BLOCK_INFLIGHT, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == 1 && vInv[0].nHash == hashHigh);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,9 +5,14 @@
 #include <boost/test/unit_test.hpp>
 
 #include "address.h"
+#include "addresstxindexdb.h"
+#include "addressunspentdb.h"
 #include "block.h"
+#include "blockbase.h"
+#include "struct.h"
 #include "test_big.h"
 #include "timeseries.h"
+#include "walletdb.h"
 
 using namespace std;
 using namespace xengine;
@@ -100,6 +105,82 @@ BOOST_AUTO_TEST_CASE(timewalk)
     cout << GetLocalTime() << "  WalkThrough success, count: " << walker.nBlockCount << endl;
 }
 
+class CPositionWalker : public CTSWalker<uint256>
+{
+public:
+    bool Walk(const uint256& t, uint32 nFile, uint32 nOffset) override
+    {
+        vWalked.push_back(make_pair(t, CDiskPos(nFile, nOffset)));
+        return (nStop == 0 || vWalked.size() < nStop);
+    }
+
+public:
+    size_t nStop = 0;
+    vector<pair<uint256, CDiskPos>> vWalked;
+};
+
+BOOST_AUTO_TEST_CASE(parallelwalk)
+{
+    path pathTest = path("./.ibrio") / "parallelwalk";
+    remove_all(pathTest);
+
+    vector<pair<uint256, CDiskPos>> vWrite;
+    {
+        CTimeSeriesCached tsData;
+        BOOST_CHECK(tsData.Initialize(pathTest, "data"));
+        for (uint32 i = 0; i < 5000; i++)
+        {
+            uint256 t(i);
+            CDiskPos pos;
+            BOOST_CHECK(tsData.Write(t, pos));
+            vWrite.push_back(make_pair(t, pos));
+        }
+        tsData.Deinitialize();
+    }
+
+    CTimeSeriesCached tsData;
+    BOOST_CHECK(tsData.Initialize(pathTest, "data"));
+
+    uint32 nLastFile = 0, nLastPos = 0;
+    CPositionWalker walkerSeq;
+    BOOST_CHECK(tsData.WalkThrough(walkerSeq, nLastFile, nLastPos, false));
+
+    uint32 nLastFileRet = 0, nLastPosRet = 0;
+    CPositionWalker walker;
+    BOOST_CHECK(tsData.ParallelWalkThrough(walker, nLastFileRet, nLastPosRet, false, 4));
+    BOOST_CHECK(walker.vWalked == vWrite);
+    BOOST_CHECK(nLastFileRet == nLastFile && nLastPosRet == nLastPos);
+
+    CPositionWalker walkerStop;
+    walkerStop.nStop = 100;
+    BOOST_CHECK(!tsData.ParallelWalkThrough(walkerStop, nLastFileRet, nLastPosRet, false, 4));
+    BOOST_CHECK(walkerStop.vWalked.size() == 100);
+    BOOST_CHECK(nLastPosRet == vWrite[99].second.nOffset - 12);
+
+    // Corrupt the data of record 3000
+    {
+        std::fstream fs((pathTest / "data_000001.dat").string(), ios::in | ios::out | ios::binary);
+        fs.seekp(vWrite[3000].second.nOffset);
+        fs.put((char)0xFF);
+    }
+
+    CPositionWalker walkerSeqError;
+    BOOST_CHECK(tsData.WalkThrough(walkerSeqError, nLastFile, nLastPos, false));
+    CPositionWalker walkerError;
+    BOOST_CHECK(tsData.ParallelWalkThrough(walkerError, nLastFileRet, nLastPosRet, false, 4));
+    BOOST_CHECK(walkerError.vWalked.size() == 3000);
+    BOOST_CHECK(walkerError.vWalked == walkerSeqError.vWalked);
+    BOOST_CHECK(nLastFileRet == nLastFile && nLastPosRet == nLastPos);
+
+    CPositionWalker walkerRepair;
+    BOOST_CHECK(tsData.ParallelWalkThrough(walkerRepair, nLastFileRet, nLastPosRet, true, 4));
+    BOOST_CHECK(walkerRepair.vWalked.size() == 3000);
+    BOOST_CHECK(file_size(pathTest / "data_000001.dat") == vWrite[3000].second.nOffset - 12);
+
+    tsData.Deinitialize();
+    remove_all(pathTest);
+}
+
 BOOST_AUTO_TEST_CASE(fileread)
 {
     cout << GetLocalTime() << "  start...." << endl;
@@ -167,4 +248,381 @@ BOOST_AUTO_TEST_CASE(fileread)
     free(pBuf);
 }
 
+BOOST_AUTO_TEST_CASE(addresstxcount)
+{
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_addrtx";
+    boost::filesystem::remove_all(fullpath);
+
+    CDestination destA(crypto::CPubKey(uint256(1)));
+    CDestination destB(crypto::CPubKey(uint256(2)));
+    auto fnIndex = [](const CDestination& dest, const int nHeight) {
+        return CAddrTxIndex(dest, nHeight, 0, 0, uint256(nHeight));
+    };
+    const CAddrTxInfo info(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 0, 0, 1, 0);
+
+    {
+        CForkAddressTxIndexDB db(fullpath);
+        BOOST_CHECK(db.IsValid());
+
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
+        for (int i = 0; i < 100; i++)
+        {
+            vAddNew.push_back(make_pair(fnIndex(destA, i), info));
+        }
+        vAddNew.push_back(make_pair(fnIndex(destB, 1000), info));
+        BOOST_CHECK(db.UpdateAddressTxIndex(vAddNew, vector<CAddrTxIndex>()));
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 100);
+
+        // move to storage, then change the cache
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.Flush());
+        vAddNew.clear();
+        vAddNew.push_back(make_pair(fnIndex(destA, 100), info));
+        vAddNew.push_back(make_pair(fnIndex(destA, 101), info));
+        BOOST_CHECK(db.UpdateAddressTxIndex(vAddNew, vector<CAddrTxIndex>(1, fnIndex(destA, 99))));
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 101);
+        BOOST_CHECK(db.GetAddressTxCount(destB) == 1);
+
+        // last count
+        map<CAddrTxIndex, CAddrTxInfo> mapTx;
+        BOOST_CHECK(db.RetrieveAddressTxIndex(destA, -2, -1, -1, 3, mapTx) == 101);
+        BOOST_CHECK(mapTx.size() == 3);
+        BOOST_CHECK(mapTx.begin()->first == fnIndex(destA, 98));
+        BOOST_CHECK(mapTx.rbegin()->first == fnIndex(destA, 101));
+
+        // offset near the last and near the first
+        mapTx.clear();
+        BOOST_CHECK(db.RetrieveAddressTxIndex(destA, -2, -1, 97, 10, mapTx) == 101);
+        BOOST_CHECK(mapTx.size() == 4);
+        BOOST_CHECK(mapTx.begin()->first == fnIndex(destA, 97));
+        mapTx.clear();
+        BOOST_CHECK(db.RetrieveAddressTxIndex(destA, -2, -1, 5, 10, mapTx) >= 15);
+        BOOST_CHECK(mapTx.size() == 10);
+        BOOST_CHECK(mapTx.begin()->first == fnIndex(destA, 5));
+        mapTx.clear();
+        BOOST_CHECK(db.RetrieveAddressTxIndex(destA, -2, -1, 200, 10, mapTx) == 101);
+        BOOST_CHECK(mapTx.empty());
+
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 101);
+    }
+
+    {
+        CForkAddressTxIndexDB db(fullpath);
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 101);
+        BOOST_CHECK(db.GetAddressTxCount(destB) == 1);
+    }
+
+    boost::filesystem::remove_all(fullpath);
+}
+
+BOOST_AUTO_TEST_CASE(addressunspentsummary)
+{
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_addrunspent";
+    boost::filesystem::remove_all(fullpath);
+
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    auto fnUnspent = [&](const int n, const int64 nAmount, const uint32 nLockUntil) {
+        return CTxUnspent(CTxOutPoint(uint256(n), 0), CTxOut(dest, nAmount, 0, nLockUntil), 0, 10);
+    };
+
+    {
+        CForkAddressUnspentDB db(fullpath, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        vector<CTxUnspent> vAddNew;
+        vAddNew.push_back(fnUnspent(1, 100, 0));
+        vAddNew.push_back(fnUnspent(2, 200, 50));
+        vAddNew.push_back(fnUnspent(3, 300, 80));
+        BOOST_CHECK(db.UpdateAddressUnspent(uint256(1), vAddNew, vector<CTxUnspent>()));
+
+        CUnspentSummary summary;
+        uint256 hashLastBlock;
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(dest, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 600 && summary.nCount == 3);
+        BOOST_CHECK(summary.GetLocked(40) == 500);
+        BOOST_CHECK(summary.GetLocked(50) == 300);
+        BOOST_CHECK(summary.GetLocked(80) == 0);
+
+        // lower saved to storage, upper spends one
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.UpdateAddressUnspent(uint256(2), vector<CTxUnspent>(), vector<CTxUnspent>(1, fnUnspent(2, 200, 50))));
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(dest, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 400 && summary.nCount == 2);
+        BOOST_CHECK(summary.GetLocked(40) == 300);
+        BOOST_CHECK(hashLastBlock == uint256(2));
+
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(dest, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 400 && summary.nCount == 2);
+        BOOST_CHECK(db.Flush());
+    }
+
+    {
+        CForkAddressUnspentDB db(fullpath, uint256(2));
+        CUnspentSummary summary;
+        uint256 hashLastBlock;
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(dest, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 400 && summary.nCount == 2);
+        BOOST_CHECK(summary.GetLocked(40) == 300);
+
+        map<CTxOutPoint, CUnspentOut> mapUnspent;
+        BOOST_CHECK(db.RetrieveAddressUnspent(dest, mapUnspent, hashLastBlock));
+        BOOST_CHECK(mapUnspent.size() == 2);
+    }
+
+    boost::filesystem::remove_all(fullpath);
+}
+
+BOOST_AUTO_TEST_CASE(addressbulkload)
+{
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_addrbulkload";
+    boost::filesystem::remove_all(fullpath);
+    const std::string pathUnspent = fullpath + "/addressunspent";
+    const std::string pathTxIndex = fullpath + "/addresstxindex";
+    boost::filesystem::create_directories(pathUnspent);
+    boost::filesystem::create_directories(pathTxIndex);
+
+    CDestination destA(crypto::CPubKey(uint256(1)));
+    CDestination destB(crypto::CPubKey(uint256(2)));
+
+    {
+        CForkAddressUnspentDB db(pathUnspent, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        vector<pair<CAddrUnspentKey, CUnspentOut>> vUnspent;
+        for (int i = 1; i <= 10; i++)
+        {
+            const CDestination& dest = (i <= 8 ? destA : destB);
+            const CTxOut out(dest, i * 100, 0, (i % 2 == 0 ? 50 : 0));
+            vUnspent.push_back(make_pair(CAddrUnspentKey(dest, CTxOutPoint(uint256(i), 0)), CUnspentOut(out, 0, 10)));
+        }
+        BOOST_CHECK(db.BulkLoadAddressUnspent(vUnspent));
+
+        CUnspentSummary summary;
+        uint256 hashLastBlock;
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(destA, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 3600 && summary.nCount == 8);
+        BOOST_CHECK(summary.GetLocked(40) == 2000);
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(destB, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 1900 && summary.nCount == 2);
+    }
+
+    {
+        CForkAddressTxIndexDB db(pathTxIndex);
+        BOOST_CHECK(db.IsValid());
+
+        const CAddrTxInfo info(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 0, 0, 1, 0);
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
+        for (int i = 0; i < 100; i++)
+        {
+            vAddNew.push_back(make_pair(CAddrTxIndex(destA, i, 0, 0, uint256(i)), info));
+        }
+        vAddNew.push_back(make_pair(CAddrTxIndex(destB, 1000, 0, 0, uint256(1000)), info));
+        BOOST_CHECK(db.BulkLoadAddressTxIndex(vAddNew));
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 100);
+        BOOST_CHECK(db.GetAddressTxCount(destB) == 1);
+    }
+
+    // reopen, the bulk loaded data is already in storage
+    {
+        CForkAddressUnspentDB db(pathUnspent, uint256());
+        CUnspentSummary summary;
+        uint256 hashLastBlock;
+        BOOST_CHECK(db.RetrieveAddressUnspentSummary(destA, summary, hashLastBlock));
+        BOOST_CHECK(summary.nTotal == 3600 && summary.nCount == 8);
+
+        map<CTxOutPoint, CUnspentOut> mapUnspent;
+        BOOST_CHECK(db.RetrieveAddressUnspent(destB, mapUnspent, hashLastBlock));
+        BOOST_CHECK(mapUnspent.size() == 2);
+    }
+
+    {
+        CForkAddressTxIndexDB db(pathTxIndex);
+        BOOST_CHECK(db.GetAddressTxCount(destA) == 100);
+        BOOST_CHECK(db.GetAddressTxCount(destB) == 1);
+
+        map<CAddrTxIndex, CAddrTxInfo> mapTx;
+        BOOST_CHECK(db.RetrieveAddressTxIndex(destA, -2, -1, -1, 3, mapTx) == 100);
+        BOOST_CHECK(mapTx.size() == 3);
+        BOOST_CHECK(mapTx.rbegin()->first == CAddrTxIndex(destA, 99, 0, 0, uint256(99)));
+    }
+
+    boost::filesystem::remove_all(fullpath);
+}
+
+BOOST_AUTO_TEST_CASE(addressunspentamount)
+{
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_addrunspentamount";
+    boost::filesystem::remove_all(fullpath);
+
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    CDestination destOther(crypto::CPubKey(uint256(2)));
+    auto fnUnspent = [&](const CDestination& destTo, const int n, const int64 nAmount) {
+        return CTxUnspent(CTxOutPoint(uint256(n), 0), CTxOut(destTo, nAmount, 0, 0), 0, 10);
+    };
+    auto fnWalk = [&](CForkAddressUnspentDB& db, const int64 nAmount, const bool fDescending, const size_t nMax) {
+        vector<int64> vAmount;
+        uint256 hashLastBlock;
+        CFnAddressUnspentWalker walker([&](const CAddrUnspentKey& out, const CUnspentOut& unspent) {
+            vAmount.push_back(unspent.nAmount);
+            return (vAmount.size() < nMax);
+        });
+        BOOST_CHECK(db.WalkThroughAddressUnspentByAmount(walker, dest, nAmount, fDescending, hashLastBlock));
+        return vAmount;
+    };
+
+    {
+        CForkAddressUnspentDB db(fullpath, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        vector<CTxUnspent> vAddNew;
+        vAddNew.push_back(fnUnspent(dest, 1, 300));
+        vAddNew.push_back(fnUnspent(dest, 2, 100));
+        vAddNew.push_back(fnUnspent(dest, 3, 0x10000));
+        vAddNew.push_back(fnUnspent(destOther, 4, 200));
+        BOOST_CHECK(db.UpdateAddressUnspent(uint256(1), vAddNew, vector<CTxUnspent>()));
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.Flush());
+
+        // storage and cache are merged in amount order
+        vAddNew.clear();
+        vAddNew.push_back(fnUnspent(dest, 5, 200));
+        vAddNew.push_back(fnUnspent(dest, 6, 400));
+        BOOST_CHECK(db.UpdateAddressUnspent(uint256(2), vAddNew, vector<CTxUnspent>(1, fnUnspent(dest, 1, 300))));
+        BOOST_CHECK(fnWalk(db, 0, false, 10) == vector<int64>({ 100, 200, 400, 0x10000 }));
+        BOOST_CHECK(fnWalk(db, 150, false, 1) == vector<int64>({ 200 }));
+        BOOST_CHECK(fnWalk(db, 399, true, 10) == vector<int64>({ 200, 100 }));
+        BOOST_CHECK(fnWalk(db, std::numeric_limits<int64>::max(), true, 2) == vector<int64>({ 0x10000, 400 }));
+
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(db.Flush());
+        BOOST_CHECK(fnWalk(db, 0, false, 10) == vector<int64>({ 100, 200, 400, 0x10000 }));
+    }
+
+    {
+        CForkAddressUnspentDB db(fullpath, uint256(2));
+        BOOST_CHECK(fnWalk(db, 400, true, 10) == vector<int64>({ 400, 200, 100 }));
+
+        uint256 hashLastBlock;
+        CGetAddressUnspentWalker walker;
+        BOOST_CHECK(db.WalkThroughAddressUnspent(walker, CDestination(), hashLastBlock));
+        BOOST_CHECK(walker.mapAddressUnspent.size() == 5);
+    }
+
+    boost::filesystem::remove_all(fullpath);
+}
+
+class CWalletIndexCountWalker : public CWalletDBIndexWalker
+{
+public:
+    CWalletIndexCountWalker()
+      : nExtendedSeq(-1), nDest(0), nUnspent(0), nTx(0) {}
+    bool WalkFork(const uint256& hashFork, const uint256& hashLastBlockIn, const int nExtendedSeqIn) override
+    {
+        hashLastBlock = hashLastBlockIn;
+        nExtendedSeq = nExtendedSeqIn;
+        return true;
+    }
+    bool WalkDest(const uint256& hashFork, const CDestination& dest) override
+    {
+        nDest++;
+        return true;
+    }
+    bool WalkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& out, const CUnspentOut& unspent) override
+    {
+        nUnspent++;
+        return true;
+    }
+    bool WalkTx(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo) override
+    {
+        nTx++;
+        return true;
+    }
+
+public:
+    uint256 hashLastBlock;
+    int nExtendedSeq;
+    int nDest;
+    int nUnspent;
+    int nTx;
+};
+
+BOOST_AUTO_TEST_CASE(forkcommitseq)
+{
+    CBlockIndex index;
+    CBlockFork fork(CProfile(), &index);
+
+    CReadSnapshot snapshot;
+    snapshot.nCommitSeq = fork.GetCommitSeq();
+    BOOST_CHECK(snapshot.IsValid(fork.GetCommitSeq()));
+
+    // a block is being committed, the snapshot taken before is invalidated
+    fork.BeginCommit();
+    BOOST_CHECK(!snapshot.IsValid(fork.GetCommitSeq()));
+
+    // a snapshot taken during the commit is never valid
+    CReadSnapshot snapshotCommit;
+    snapshotCommit.nCommitSeq = fork.GetCommitSeq();
+    BOOST_CHECK(!snapshotCommit.IsValid(fork.GetCommitSeq()));
+
+    fork.EndCommit();
+    BOOST_CHECK(!snapshot.IsValid(fork.GetCommitSeq()));
+    BOOST_CHECK(!snapshotCommit.IsValid(fork.GetCommitSeq()));
+
+    CReadSnapshot snapshotNew;
+    snapshotNew.nCommitSeq = fork.GetCommitSeq();
+    BOOST_CHECK(snapshotNew.IsValid(fork.GetCommitSeq()));
+    BOOST_CHECK(snapshotNew.nCommitSeq == snapshot.nCommitSeq + 2);
+}
+
+BOOST_AUTO_TEST_CASE(walletindex)
+{
+    std::string fullpath = boost::filesystem::initial_path<boost::filesystem::path>().string() + "/dbpath_walletindex";
+    boost::filesystem::remove_all(fullpath);
+
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    {
+        CWalletDB db;
+        BOOST_CHECK(db.Initialize(fullpath, true));
+
+        CWalletIndexChange change;
+        change.hashLastBlock = uint256(1);
+        change.nExtendedSeq = 1;
+        change.mapDest[dest] = true;
+        change.mapUnspent[make_pair(dest, CTxOutPoint(uint256(1), 0))] = CUnspentOut(100, 0, 0, 0, 1);
+        change.mapUnspent[make_pair(dest, CTxOutPoint(uint256(2), 0))] = CUnspentOut(200, 0, 0, 0, 1);
+        change.mapTx[CAddrTxIndex(dest, 1, 0, 1, uint256(1))] = CAddrTxInfo(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 0, 0, 100, 0);
+        change.mapTx[CAddrTxIndex(dest, 1, 0, 2, uint256(2))] = CAddrTxInfo(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 0, 0, 200, 0);
+        BOOST_CHECK(db.UpdateIndex(uint256(), change));
+
+        // null values are erased
+        change.hashLastBlock = uint256(2);
+        change.nExtendedSeq = 0;
+        change.mapDest.clear();
+        change.mapUnspent.clear();
+        change.mapTx.clear();
+        change.mapUnspent[make_pair(dest, CTxOutPoint(uint256(1), 0))] = CUnspentOut();
+        change.mapTx[CAddrTxIndex(dest, 1, 0, 2, uint256(2))] = CAddrTxInfo();
+        BOOST_CHECK(db.UpdateIndex(uint256(), change));
+    }
+
+    {
+        CWalletDB db;
+        BOOST_CHECK(db.Initialize(fullpath, true));
+
+        CWalletIndexCountWalker walker;
+        BOOST_CHECK(db.WalkThroughIndex(walker));
+        BOOST_CHECK(walker.hashLastBlock == uint256(2));
+        BOOST_CHECK(walker.nExtendedSeq == 0);
+        BOOST_CHECK(walker.nDest == 1);
+        BOOST_CHECK(walker.nUnspent == 1);
+        BOOST_CHECK(walker.nTx == 1);
+    }
+
+    boost::filesystem::remove_all(fullpath);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
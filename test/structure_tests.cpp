@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "address.h"
+#include "struct.h"
 #include "structure/tree.h"
 #include "test_big.h"
 
@@ -193,4 +194,70 @@ BOOST_AUTO_TEST_CASE(tree)
     BOOST_CHECK(relation2.GetRelation(b4)->spParent.lock()->key == B);
 }
 
+BOOST_AUTO_TEST_CASE(flat_tree)
+{
+    CAddress A("1632srrskscs1d809y3x5ttf50f0gabf86xjz2s6aetc9h9ewwhm58dj3");
+    CAddress a1("1f1nj5gjgrcz45g317s1y4tk18bbm89jdtzd41m9s0t14tp2ngkz4cg0x");
+    CAddress a11("1pmj5p47zhqepwa9vfezkecxkerckhrks31pan5fh24vs78s6cbkrqnxp");
+    CAddress a111("1bvaag2t23ybjmasvjyxnzetja0awe5d1pyw361ea3jmkfdqt5greqvfq");
+    CAddress a2("1ab1sjh07cz7xpb0xdkpwykfm2v91cvf2j1fza0gj07d2jktdnrwtyd57");
+    CAddress a21("1782a5jv06egd6pb2gjgp2p664tgej6n4gmj79e1hbvgfgy3t006wvwzt");
+    CAddress a22("1c7s095dcvzdsedrkpj6y5kjysv5sz3083xkahvyk7ry3tag4ddyydbv4");
+    CAddress B("1fpt2z9nyh0a5999zrmabg6ppsbx78wypqapm29fsasx993z11crp6zm7");
+    CAddress b1("1rampdvtmzmxfzr3crbzyz265hbr9a8y4660zgpbw6r7qt9hdy535zed7");
+
+    typedef CFlatForest<CAddress, CDestination> FlatForest;
+    FlatForest relation;
+    relation.AddEdge(a111, a11, a11);
+    relation.AddEdge(a1, A, A);
+    relation.AddEdge(a21, a2, a2);
+    relation.AddEdge(a11, a1, a1);
+    relation.AddEdge(b1, B, B);
+    relation.AddEdge(a2, A, A);
+    relation.AddEdge(a22, a2, a2);
+    BOOST_CHECK(relation.Build());
+    BOOST_CHECK(relation.Size() == 9);
+    BOOST_CHECK(relation.vRoot.size() == 2);
+
+    // children always precede parent
+    for (uint32 i = 0; i < relation.Size(); i++)
+    {
+        const FlatForest::CFlatNode& node = relation.vNode[i];
+        BOOST_CHECK(node.nParent == FlatForest::NIL || node.nParent > i);
+        for (uint32 j = node.nChildBegin; j < node.nChildEnd; j++)
+        {
+            BOOST_CHECK(relation.vChild[j] < i);
+            BOOST_CHECK(relation.vNode[relation.vChild[j]].nParent == i);
+        }
+    }
+
+    uint32 n = relation.Find(a11);
+    BOOST_CHECK(n != FlatForest::NIL && relation.vNode[n].key == a11);
+    BOOST_CHECK(relation.vNode[relation.vNode[n].nParent].key == a1);
+    BOOST_CHECK(relation.vNode[n].data == a1);
+    n = relation.Find(A);
+    BOOST_CHECK(n != FlatForest::NIL && relation.vNode[n].nParent == FlatForest::NIL);
+    BOOST_CHECK(relation.vNode[n].nChildEnd - relation.vNode[n].nChildBegin == 2);
+    BOOST_CHECK(relation.Find(CAddress("1965p604xzdrffvg90ax9bk0q3xyqn5zz2vc9zpbe3wdswzazj7d144mm")) == FlatForest::NIL);
+
+    int nCount = 0;
+    BOOST_CHECK(relation.PostorderTraversal([&](FlatForest::CFlatNode& node) { return ++nCount > 0; }));
+    BOOST_CHECK(nCount == 9);
+
+    // more than one parent
+    relation.AddEdge(a1, A, A);
+    relation.AddEdge(a1, B, B);
+    BOOST_CHECK(!relation.Build());
+
+    // cyclic graph
+    relation.AddEdge(a1, A, A);
+    relation.AddEdge(a11, a1, a1);
+    relation.AddEdge(A, a11, a11);
+    BOOST_CHECK(!relation.Build());
+
+    // self relation
+    relation.AddEdge(a1, a1, a1);
+    BOOST_CHECK(!relation.Build());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
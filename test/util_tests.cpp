@@ -6,7 +6,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include "cache.h"
 #include "forkcontext.h"
+#include "http/httpsse.h"
 #include "profile.h"
 #include "test_big.h"
 
@@ -154,4 +156,72 @@ BOOST_AUTO_TEST_CASE(defi_profile)
     BOOST_CHECK(forkContextRead.GetProfile().defi.mapPromotionTokenTimes.size() == profile.defi.mapPromotionTokenTimes.size());
 }
 
+class CTestSSEData : public CHttpSSEData
+{
+public:
+    CTestSSEData(int nIn = 0)
+      : n(nIn) {}
+    bool operator==(const CHttpSSEData& data) const override
+    {
+        const CTestSSEData* p = dynamic_cast<const CTestSSEData*>(&data);
+        return (p != nullptr && p->n == n);
+    }
+    std::string ToString() override
+    {
+        return std::to_string(n);
+    }
+
+public:
+    int n;
+};
+
+BOOST_AUTO_TEST_CASE(ssequeue)
+{
+    CHttpEventStream stream("test");
+    stream.RegisterEvent("num", new CHttpSSEQueGenerator<CTestSSEData>(2));
+    for (int i = 1; i <= 3; i++)
+    {
+        CTestSSEData data(i);
+        BOOST_CHECK(stream.UpdateEventData("num", data));
+    }
+    BOOST_CHECK(stream.GetEventId() == 3);
+
+    // the oldest event is dropped by the bounded queue
+    CHttpRsp rsp;
+    BOOST_CHECK(stream.ConstructResponse(0, rsp));
+    BOOST_CHECK(rsp.strContent.find("data: 1\n") == std::string::npos);
+    BOOST_CHECK(rsp.strContent.find("data: 2\n") != std::string::npos);
+    BOOST_CHECK(rsp.strContent.find("data: 3\n") != std::string::npos);
+    BOOST_CHECK(!stream.ConstructResponse(3, rsp));
+}
+
+BOOST_AUTO_TEST_CASE(cache_size)
+{
+    CCache<int, std::string> cache;
+    cache.SetMaxSize(100);
+
+    cache.AddNew(1, "a", 40);
+    cache.AddNew(2, "b", 40);
+    BOOST_CHECK(cache.GetTotalSize() == 80);
+
+    // the oldest is dropped until the total fits
+    cache.AddNew(3, "c", 50);
+    BOOST_CHECK(!cache.Exists(1) && cache.Exists(2) && cache.Exists(3));
+    BOOST_CHECK(cache.GetTotalSize() == 90);
+
+    // replacing a value counts its new size only
+    cache.AddNew(3, "cc", 20);
+    BOOST_CHECK(cache.GetTotalSize() == 60);
+    std::string value;
+    BOOST_CHECK(cache.Retrieve(3, value) && value == "cc");
+
+    // a value larger than the max size is never kept
+    cache.AddNew(2, "big", 101);
+    BOOST_CHECK(!cache.Exists(2) && cache.Exists(3));
+    BOOST_CHECK(cache.GetTotalSize() == 20);
+
+    cache.Remove(3);
+    BOOST_CHECK(cache.GetTotalSize() == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()